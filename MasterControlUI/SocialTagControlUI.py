@@ -22,6 +22,7 @@ class SocialTagControlUI(ctk.CTk):
             "raw_log": self.on_raw_log, #
             "slave_update": self.on_slave_update, #
             "mode_update": self.on_mode_update, #
+            "link_stats": self.on_link_stats,
         }
         self.scan_ports() #
         self.protocol("WM_DELETE_WINDOW", self.on_closing) #
@@ -60,7 +61,7 @@ class SocialTagControlUI(ctk.CTk):
         
         # --- Tab View (Simplified) ---
         self.tab_view = ctk.CTkTabview(self, text_color="white"); self.tab_view.grid(row=2, column=0, padx=10, pady=10, sticky="nsew") #
-        self.tab_view.add("Profile Management"); self.tab_view.add("Raw Log") #
+        self.tab_view.add("Profile Management"); self.tab_view.add("Link Health"); self.tab_view.add("Raw Log") #
         
         # --- Profile Management Tab ---
         profile_tab_frame = self.tab_view.tab("Profile Management"); profile_tab_frame.grid_columnconfigure(1, weight=3); profile_tab_frame.grid_columnconfigure(0, weight=1); profile_tab_frame.grid_rowconfigure(0, weight=1) #
@@ -74,6 +75,9 @@ class SocialTagControlUI(ctk.CTk):
         self.save_profile_button = ctk.CTkButton(button_frame, text="Save Current Profile", command=self.handle_save_profile_button, state="disabled"); self.save_profile_button.grid(row=0, column=0, padx=5, sticky="ew") #
         self.remove_profile_button = ctk.CTkButton(button_frame, text="Remove This User", command=lambda: self.backend.remove_slave(self.currently_selected_id), state="disabled", fg_color="#D32F2F", hover_color="#B71C1C"); self.remove_profile_button.grid(row=0, column=1, padx=5, sticky="ew") #
 
+        # --- Link Health Tab ---
+        self.link_stats_textbox = ctk.CTkTextbox(self.tab_view.tab("Link Health"), state="disabled", font=ctk.CTkFont(family="Courier", size=13)); self.link_stats_textbox.pack(fill="both", expand=True, padx=5, pady=5)
+
         # --- Raw Log Tab ---
         self.raw_log_textbox = ctk.CTkTextbox(self.tab_view.tab("Raw Log"), state="disabled"); self.raw_log_textbox.pack(fill="both", expand=True, padx=5, pady=5) #
 
@@ -129,6 +133,16 @@ class SocialTagControlUI(ctk.CTk):
     def on_raw_log(self, message):
         self.log_to_textbox(self.raw_log_textbox, message) #
 
+    def on_link_stats(self, stats):
+        # One row per slave from the master's [STATS] lines (every 10 s). poll = count/failed, rtt_max in ms, rpd = share of strong receptions
+        lines = [f"{'ID':>4}  {'poll':>10}  {'poll ARC 0,1,2,3,4+':>22}  {'rtt max ms':>10}  {'uplink':>8}  {'plos':>4}  {'rpd':>5}"]
+        for device_id in sorted(stats.keys()):
+            f = stats[device_id]
+            lines.append(f"{device_id:>4}  {f.get('poll', '-'):>10}  {f.get('arc', '-'):>22}  {f.get('rtt_max', '-'):>10}  "
+                         f"{f.get('up', '-'):>8}  {f.get('plos', '-'):>4}  {f.get('rpd', '-'):>5}")
+        self.link_stats_textbox.configure(state="normal"); self.link_stats_textbox.delete("1.0", tk.END)
+        self.link_stats_textbox.insert(tk.END, "\n".join(lines)); self.link_stats_textbox.configure(state="disabled")
+
     def display_profile(self, device_id):
         self.currently_selected_id = device_id #
         with self.backend.data_lock: #
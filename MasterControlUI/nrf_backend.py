@@ -19,6 +19,7 @@ class NrfBackend:
         # --- Simplified Data Storage ---
         self.discovered_slaves = {} #
         self.is_discovery_mode = True #
+        self.link_stats = {} # device_id -> latest [STATS] fields
         
         self.config_file = "config.json" #
         self.config = {} #
@@ -75,7 +76,9 @@ class NrfBackend:
             self.read_thread.join(timeout=0.2)
         if self.serial_port and self.serial_port.is_open:
             self.serial_port.close()
-        with self.data_lock: self.discovered_slaves.clear() #
+        with self.data_lock:
+            self.discovered_slaves.clear() #
+            self.link_stats.clear()
         self._notify_ui("connection_status", False, "Disconnected")
 
     def read_from_port(self):
@@ -109,6 +112,13 @@ class NrfBackend:
                         del self.discovered_slaves[device_id] #
                         self._notify_ui("slave_update", self.discovered_slaves, self.config.get("user_profiles", {}))
         
+        elif "[STATS]" in line:
+            fields = dict(re.findall(r"(\w+)=(\S+)", line))
+            if "id" in fields:
+                device_id = int(fields.pop("id"))
+                with self.data_lock: self.link_stats[device_id] = fields
+                self._notify_ui("link_stats", self.link_stats)
+
         elif "System now in Discovery Mode" in line:
             with self.data_lock: self.is_discovery_mode = True #
             self._notify_ui("mode_update", True)
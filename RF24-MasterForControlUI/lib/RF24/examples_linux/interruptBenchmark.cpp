@@ -0,0 +1,181 @@
+/*
+ * See documentation at https://nRF24.github.io/RF24
+ * See License information at root directory of this library
+ */
+
+/**
+ * Compares busy-polling available() against the SPIDEV driver's
+ * GPIO chardev IRQ thread on the receiving side.
+ *
+ * For each received payload the delay from the IRQ pin's falling edge
+ * (the kernel's event timestamp) to the payload being in hand is measured,
+ * together with the CPU time the process used during the run.
+ *
+ * Run the gettingstarted example as radio '0' in TX role on another node,
+ * then on this node: interruptBenchmark <poll|irq> [seconds]
+ * The event timestamps are CLOCK_MONOTONIC on Linux 5.7 and newer.
+ */
+#include <cstdlib>        // atoi()
+#include <cstring>        // strcmp()
+#include <iostream>       // cout, endl
+#include <time.h>         // CLOCK_MONOTONIC, timespec, clock_gettime()
+#include <sys/resource.h> // getrusage()
+#include <unistd.h>       // close(), usleep()
+#include <RF24/RF24.h>    // RF24, RF24_PA_LOW, attachInterrupt(), interruptOpen(), INT_EDGE_FALLING
+
+using namespace std;
+
+// We will be using the nRF24L01's IRQ pin for this example
+#define IRQ_PIN 12 // the line offset on RF24_SPIDEV_GPIO_CHIP
+
+/****************** Linux ***********************/
+// Radio CE Pin, CSN Pin, SPI Speed
+// CE Pin uses GPIO number with BCM and SPIDEV drivers, other platforms use their own pin numbering
+// CS Pin addresses the SPI bus number at /dev/spidev<a>.<b>
+// ie: RF24 radio(<ce_pin>, <a>*10+<b>); spidev1.0 is 10, spidev1.1 is 11 etc..
+
+// Generic:
+RF24 radio(22, 0);
+/****************** Linux (BBB,x86,etc) ***********************/
+// See http://nRF24.github.io/RF24/pages.html for more information on usage
+// See https://www.kernel.org/doc/Documentation/spi/spidev for more information on SPIDEV
+
+float payload = 0.0; // same payload as the gettingstarted example
+
+// results, updated by whichever thread receives (read after detachInterrupt() joined the IRQ thread)
+unsigned long received = 0;
+uint64_t latency_sum = 0; // ns
+uint64_t latency_max = 0; // ns
+unsigned long latency_count = 0;
+
+uint64_t nowNanos();                  // prototype to read CLOCK_MONOTONIC in nanoseconds
+uint64_t cpuMicros();                 // prototype to read the process' user + system time
+void recordLatency(uint64_t edge_ns); // prototype to accumulate one edge-to-payload delay
+unsigned int drainFifo();             // prototype to read every payload waiting in the RX FIFO
+void interruptHandler();              // prototype called by the IRQ thread on each falling edge
+
+int main(int argc, char** argv)
+{
+    bool use_irq = argc > 1 && strcmp(argv[1], "irq") == 0;
+    if (argc < 2 || (!use_irq && strcmp(argv[1], "poll") != 0)) {
+        cout << "usage: " << argv[0] << " <poll|irq> [seconds]" << endl;
+        return 0;
+    }
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+
+    // perform hardware check
+    if (!radio.begin()) {
+        cout << "radio hardware is not responding!!" << endl;
+        return 0; // quit now
+    }
+
+    uint8_t address[6] = "1Node";
+    radio.setPayloadSize(sizeof(payload));
+    radio.setPALevel(RF24_PA_LOW);
+    radio.openReadingPipe(1, address);
+    radio.maskIRQ(true, true, false); // args = "data_sent", "data_fail", "data_ready"
+    radio.startListening();
+
+    int event_fd = -1;
+    if (use_irq) {
+        if (attachInterrupt(IRQ_PIN, INT_EDGE_FALLING, &interruptHandler) < 0) {
+            cout << "can't request line " << IRQ_PIN << " of " << RF24_SPIDEV_GPIO_CHIP << endl;
+            return 0;
+        }
+    }
+    else {
+        // only used for the edge timestamps; the loop below never waits on it
+        event_fd = interruptOpen(IRQ_PIN, INT_EDGE_FALLING);
+        if (event_fd < 0) {
+            cout << "can't request line " << IRQ_PIN << " of " << RF24_SPIDEV_GPIO_CHIP << endl;
+            return 0;
+        }
+    }
+
+    cout << "Receiving for " << seconds << "s using " << argv[1] << "..." << endl;
+    uint64_t cpu_start = cpuMicros();
+    uint64_t wall_start = nowNanos();
+    uint64_t wall_end = wall_start + seconds * 1000000000ULL;
+
+    if (use_irq) {
+        while (nowNanos() < wall_end) {
+            usleep(100000); // the IRQ thread does all the work
+        }
+        detachInterrupt(IRQ_PIN);
+    }
+    else {
+        while (nowNanos() < wall_end) {
+            if (!radio.available()) {
+                continue;
+            }
+            uint64_t edge_ns = 0, ts;
+            while (interruptRead(event_fd, &ts) == 1) {
+                edge_ns = ts; // latest edge
+            }
+            drainFifo();
+            if (edge_ns) {
+                recordLatency(edge_ns);
+            }
+        }
+        close(event_fd);
+    }
+
+    uint64_t wall_us = (nowNanos() - wall_start) / 1000;
+    uint64_t cpu_us = cpuMicros() - cpu_start;
+    radio.stopListening();
+    radio.powerDown();
+
+    cout << received << " payloads received" << endl;
+    if (latency_count) {
+        cout << "  edge-to-payload latency: " << (latency_sum / latency_count) / 1000.0
+             << " us mean, " << latency_max / 1000.0 << " us max" << endl;
+    }
+    cout << "  CPU: " << 100.0 * cpu_us / wall_us << "% of one core" << endl;
+    return 0;
+}
+
+unsigned int drainFifo()
+{
+    unsigned int count = 0;
+    while (radio.available()) {
+        radio.read(&payload, sizeof(payload));
+        ++count;
+    }
+    received += count;
+    return count;
+}
+
+void interruptHandler()
+{
+    if (drainFifo()) {
+        recordLatency(interruptTimestamp(IRQ_PIN));
+    }
+}
+
+void recordLatency(uint64_t edge_ns)
+{
+    uint64_t now = nowNanos();
+    if (now < edge_ns) {
+        return; // timestamps from an older kernel's CLOCK_REALTIME
+    }
+    uint64_t latency = now - edge_ns;
+    latency_sum += latency;
+    if (latency > latency_max) {
+        latency_max = latency;
+    }
+    ++latency_count;
+}
+
+uint64_t nowNanos()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+uint64_t cpuMicros()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
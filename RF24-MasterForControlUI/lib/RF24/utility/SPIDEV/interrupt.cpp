@@ -3,23 +3,309 @@ Interrupt functions
 */
 
 #include "interrupt.h"
-#include <pigpio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <atomic>
+#include <linux/gpio.h>
+#include <map>
+#include <pthread.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+struct IrqThread
+{
+    int pin;
+    int line_fd;
+    int stop_fd;
+    int epoll_fd;
+    pthread_t id;
+    void (*function)(void);
+    volatile uint64_t timestamp;
+    std::atomic<bool> stopping;
+};
+
+// irq_threads is only touched under threads_mutex, which is never held while
+// a handler runs or a thread is joined
+static std::map<int, IrqThread*> irq_threads;
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t irq_mutex;
+static pthread_once_t irq_mutex_once = PTHREAD_ONCE_INIT;
+
+static void irqMutexInit()
+{
+    // recursive, so a handler may call rfNoInterrupts() itself
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&irq_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static int requestLine(int pin, int mode)
+{
+    int chip = open(RF24_SPIDEV_GPIO_CHIP, O_RDONLY | O_CLOEXEC);
+    if (chip < 0) {
+        return -1;
+    }
+
+    struct gpioevent_request req;
+    memset(&req, 0, sizeof(req));
+    req.lineoffset = pin;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags = mode == INT_EDGE_RISING ? GPIOEVENT_REQUEST_RISING_EDGE : mode == INT_EDGE_BOTH ? GPIOEVENT_REQUEST_BOTH_EDGES
+                                                                                                    : GPIOEVENT_REQUEST_FALLING_EDGE;
+    strncpy(req.consumer_label, "RF24 IRQ", sizeof(req.consumer_label) - 1);
+
+    int ret = ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req);
+    close(chip);
+    return ret < 0 ? -1 : req.fd;
+}
+
+int interruptOpen(int pin, int mode)
+{
+    int fd = requestLine(pin, mode);
+    if (fd < 0 && errno == EBUSY) {
+        // pinMode(pin, INPUT) exports the line through sysfs, which holds it
+        GPIO::close(pin);
+        fd = requestLine(pin, mode);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int interruptRead(int fd, uint64_t* timestamp_ns)
+{
+    struct gpioevent_data event;
+    ssize_t n = read(fd, &event, sizeof(event));
+    if (n == (ssize_t)sizeof(event)) {
+        if (timestamp_ns) {
+            *timestamp_ns = event.timestamp;
+        }
+        return 1;
+    }
+    return (n < 0 && errno == EAGAIN) ? 0 : -1;
+}
+
+// Wait for irq_mutex like rfNoInterrupts(), but give up once the thread is
+// being stopped: detachInterrupt() may be called by a thread that holds
+// irq_mutex and is about to join this one.
+static bool lockForHandler(IrqThread* irq)
+{
+    while (!irq->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        int ret = pthread_mutex_timedlock(&irq_mutex, &deadline);
+        if (ret == 0) {
+            if (!irq->stopping) {
+                return true;
+            }
+            pthread_mutex_unlock(&irq_mutex);
+            return false;
+        }
+        if (ret != ETIMEDOUT) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static void releaseIrqThread(void* arg)
+{
+    IrqThread* irq = static_cast<IrqThread*>(arg);
+    if (irq->epoll_fd >= 0) {
+        close(irq->epoll_fd);
+    }
+    close(irq->line_fd);
+    close(irq->stop_fd);
+    delete irq;
+}
+
+// Run handlers until detachInterrupt() signals stop_fd (returns true) or
+// epoll fails (returns false)
+static bool waitForEdges(IrqThread* irq)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = irq->line_fd;
+    if (epoll_ctl(irq->epoll_fd, EPOLL_CTL_ADD, irq->line_fd, &ev) < 0) {
+        return false;
+    }
+    ev.data.fd = irq->stop_fd;
+    if (epoll_ctl(irq->epoll_fd, EPOLL_CTL_ADD, irq->stop_fd, &ev) < 0) {
+        return false;
+    }
+
+    for (;;) {
+        struct epoll_event ready[2];
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        int n = epoll_wait(irq->epoll_fd, ready, 2, -1);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (ready[i].data.fd == irq->stop_fd) {
+                return true;
+            }
+        }
+
+        // coalesce every queued edge into one call
+        uint64_t timestamp;
+        bool edge = false;
+        while (interruptRead(irq->line_fd, &timestamp) == 1) {
+            irq->timestamp = timestamp;
+            edge = true;
+        }
+        if (edge && lockForHandler(irq)) {
+            irq->function();
+            pthread_mutex_unlock(&irq_mutex);
+        }
+    }
+}
+
+static void* irqThreadMain(void* arg)
+{
+    IrqThread* irq = static_cast<IrqThread*>(arg);
+
+    // detachInterrupt() may cancel this thread, but only while it waits, never
+    // while a handler holds irq_mutex; the thread frees irq either way
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    pthread_cleanup_push(releaseIrqThread, irq);
+
+    irq->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (irq->epoll_fd < 0 || !waitForEdges(irq)) {
+        // epoll failed: drop the pin's entry unless detachInterrupt() already
+        // took it, in which case it is about to signal (or cancel) and join us
+        pthread_mutex_lock(&threads_mutex);
+        std::map<int, IrqThread*>::iterator i = irq_threads.find(irq->pin);
+        bool owned = i != irq_threads.end() && i->second == irq;
+        if (owned) {
+            irq_threads.erase(i);
+            pthread_detach(pthread_self());
+        }
+        pthread_mutex_unlock(&threads_mutex);
+
+        if (!owned) {
+            uint64_t value;
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            while (read(irq->stop_fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+            }
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        }
+    }
+
+    pthread_cleanup_pop(1);
+    return NULL;
+}
 
 int attachInterrupt(int pin, int mode, void (*function)(void))
 {
-    gpioInitialise();
-    return gpioSetISRFunc(pin, mode, 0, (gpioISRFunc_t)function);
+    pthread_once(&irq_mutex_once, irqMutexInit);
+    detachInterrupt(pin);
+
+    IrqThread* irq = new IrqThread();
+    irq->pin = pin;
+    irq->function = function;
+    irq->timestamp = 0;
+    irq->stopping = false;
+    irq->epoll_fd = -1;
+    irq->line_fd = interruptOpen(pin, mode);
+    irq->stop_fd = eventfd(0, EFD_CLOEXEC);
+
+    // publish the entry before the thread starts so interruptTimestamp() sees
+    // an immediate IRQ; holding threads_mutex keeps detachInterrupt() from
+    // taking it before irq->id is set
+    bool started = false;
+    if (irq->line_fd >= 0 && irq->stop_fd >= 0) {
+        pthread_mutex_lock(&threads_mutex);
+        irq_threads[pin] = irq;
+        started = pthread_create(&irq->id, NULL, irqThreadMain, irq) == 0;
+        if (!started) {
+            irq_threads.erase(pin);
+        }
+        pthread_mutex_unlock(&threads_mutex);
+    }
+    if (!started) {
+        if (irq->line_fd >= 0) {
+            close(irq->line_fd);
+        }
+        if (irq->stop_fd >= 0) {
+            close(irq->stop_fd);
+        }
+        delete irq;
+        return -1;
+    }
+    return 0;
 }
 
 int detachInterrupt(int pin)
 {
-    return gpioSetISRFunc(pin, 0, 0, NULL);
+    pthread_mutex_lock(&threads_mutex);
+    std::map<int, IrqThread*>::iterator i = irq_threads.find(pin);
+    if (i == irq_threads.end()) {
+        pthread_mutex_unlock(&threads_mutex);
+        return 0;
+    }
+    IrqThread* irq = i->second;
+    irq_threads.erase(i);
+    pthread_mutex_unlock(&threads_mutex);
+
+    // a thread waiting for irq_mutex sees this and exits instead of calling
+    // the handler, so joining it is safe even inside rfNoInterrupts()
+    irq->stopping = true;
+    pthread_t id = irq->id;
+    uint64_t one = 1;
+    int result = 0;
+    if (write(irq->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        // the thread never sees the request; cancel it at its next wait
+        // instead, so it still exits and frees irq
+        pthread_cancel(id);
+        result = -1;
+    }
+
+    // the thread frees itself; joining from inside the handler would deadlock
+    if (pthread_equal(id, pthread_self())) {
+        pthread_detach(id);
+    }
+    else {
+        pthread_join(id, NULL);
+    }
+    return result;
+}
+
+uint64_t interruptTimestamp(int pin)
+{
+    pthread_mutex_lock(&threads_mutex);
+    std::map<int, IrqThread*>::iterator i = irq_threads.find(pin);
+    uint64_t timestamp = i == irq_threads.end() ? 0 : i->second->timestamp;
+    pthread_mutex_unlock(&threads_mutex);
+    return timestamp;
 }
 
 void rfNoInterrupts()
 {
+    pthread_once(&irq_mutex_once, irqMutexInit);
+    pthread_mutex_lock(&irq_mutex);
 }
 
 void rfInterrupts()
 {
+    pthread_mutex_unlock(&irq_mutex);
 }
@@ -1,16 +1,23 @@
 /*
 Interrupt functions
+
+IRQ edges are read from the GPIO character device (linux/gpio.h line events),
+so no pigpio daemon or library is needed for the SPIDEV driver.
 */
 #ifndef __RF24_INTERRUPT_H__
 #define __RF24_INTERRUPT_H__
 
 #include "RF24_arch_config.h"
-#include <pigpio.h>
+
+/* GPIO chip whose line offsets are used as pin numbers by attachInterrupt() */
+#ifndef RF24_SPIDEV_GPIO_CHIP
+    #define RF24_SPIDEV_GPIO_CHIP "/dev/gpiochip0"
+#endif
 
 #define INT_EDGE_SETUP   0
-#define INT_EDGE_FALLING FALLING_EDGE
-#define INT_EDGE_RISING  RISING_EDGE
-#define INT_EDGE_BOTH    EITHER_EDGE
+#define INT_EDGE_FALLING 1
+#define INT_EDGE_RISING  2
+#define INT_EDGE_BOTH    3
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,28 +25,55 @@ extern "C" {
 
 /*
  * attachInterrupt (Original: wiringPiISR):
- *      Pi Specific.
- *      Take the details and create an interrupt handler that will do a call-
- *      back to the user supplied function.
+ *      Request edge events for a line of RF24_SPIDEV_GPIO_CHIP and start a
+ *      thread that sleeps in epoll_wait() until an edge arrives, then calls
+ *      the user supplied function. Edges that queue up while the function
+ *      runs are coalesced into one call, so the function should drain the
+ *      radio's RX FIFO rather than assume one payload per call.
+ *      Returns 0 on success, -1 on failure.
  *********************************************************************************
  */
 extern int attachInterrupt(int pin, int mode, void (*function)(void));
 
 /*
  * detachInterrupt:
- *      Pi Specific detachInterrupt.
- *      Will cancel the interrupt thread, close the filehandle and
- *		setting wiringPi back to 'none' mode.
+ *      Stop the interrupt thread of a pin and release its line. May be called
+ *      from the pin's own handler and between rfNoInterrupts() and
+ *      rfInterrupts(); a pending edge is then dropped instead of handled.
  *********************************************************************************
  */
 extern int detachInterrupt(int pin);
 
-/* Deprecated, no longer functional
-*/
+/*
+ * interruptTimestamp:
+ *      Kernel timestamp (ns, CLOCK_MONOTONIC since Linux 5.7) of the latest
+ *      edge handled for a pin by attachInterrupt(); 0 if none yet.
+ *********************************************************************************
+ */
+extern uint64_t interruptTimestamp(int pin);
+
+/*
+ * interruptOpen:
+ *      Request edge events for a line without starting a thread. Returns a
+ *      non-blocking file descriptor that becomes readable (epoll/poll/select)
+ *      on every edge, or -1 on failure. Close it with close().
+ *********************************************************************************
+ */
+extern int interruptOpen(int pin, int mode);
+
+/*
+ * interruptRead:
+ *      Consume one pending edge from a descriptor returned by interruptOpen().
+ *      Returns 1 and stores the kernel timestamp when an edge was pending,
+ *      0 when none was, -1 on error.
+ *********************************************************************************
+ */
+extern int interruptRead(int fd, uint64_t* timestamp_ns);
+
+/* Block the interrupt threads from calling their functions (nestable) */
 extern void rfNoInterrupts();
 
-/* Deprecated, no longer functional
-*/
+/* Allow the interrupt threads to call their functions again */
 extern void rfInterrupts();
 
 #ifdef __cplusplus
@@ -22,6 +22,8 @@
 
 #define RF24_SPIDEV_BITS 8
 
+uint32_t SPI::_syscalls = 0;
+
 SPI::SPI()
     : fd(-1), _spi_speed(RF24_SPI_SPEED)
 {
@@ -135,27 +137,16 @@ void SPI::init(uint32_t speed)
 
 uint8_t SPI::transfer(uint8_t tx)
 {
+    uint8_t rx;
     struct spi_ioc_transfer tr;
     memset(&tr, 0, sizeof(tr));
     tr.tx_buf = (unsigned long)&tx;
-    uint8_t rx;
     tr.rx_buf = (unsigned long)&rx;
     tr.len = sizeof(tx);
     tr.speed_hz = _spi_speed; //RF24_SPI_SPEED;
-    tr.delay_usecs = 0;
     tr.bits_per_word = RF24_SPIDEV_BITS;
-    tr.cs_change = 0;
-
-    int ret;
-    ret = ioctl(this->fd, SPI_IOC_MESSAGE(1), &tr);
-    if (ret < 1) {
-        throw SPIException("can't send spi message");
-    }
-    /*{
-        perror("can't send spi message");
-        abort();
-    }*/
 
+    submit(&tr, 1);
     return rx;
 }
 
@@ -167,19 +158,47 @@ void SPI::transfernb(char* tbuf, char* rbuf, uint32_t len)
     tr.rx_buf = (unsigned long)rbuf;
     tr.len = len;
     tr.speed_hz = _spi_speed; //RF24_SPI_SPEED;
-    tr.delay_usecs = 0;
     tr.bits_per_word = RF24_SPIDEV_BITS;
-    tr.cs_change = 0;
 
-    int ret;
-    ret = ioctl(this->fd, SPI_IOC_MESSAGE(1), &tr);
+    submit(&tr, 1);
+}
+
+void SPI::queue(const void* tbuf, void* rbuf, uint32_t len, bool cs_change)
+{
+    if (_batch_len == RF24_SPIDEV_BATCH_MAX) {
+        flush();
+    }
+
+    struct spi_ioc_transfer* tr = &_batch[_batch_len++];
+    memset(tr, 0, sizeof(*tr));
+    tr->tx_buf = (unsigned long)tbuf; // spidev shifts out zeros when tx_buf is NULL
+    tr->rx_buf = (unsigned long)rbuf; // and discards MISO when rx_buf is NULL
+    tr->len = len;
+    tr->speed_hz = _spi_speed;
+    tr->bits_per_word = RF24_SPIDEV_BITS;
+    tr->cs_change = cs_change;
+}
+
+void SPI::flush()
+{
+    if (!_batch_len) {
+        return;
+    }
+
+    // cs_change on the last transfer would keep CS asserted after the message
+    _batch[_batch_len - 1].cs_change = 0;
+    uint8_t count = _batch_len;
+    _batch_len = 0;
+    submit(_batch, count);
+}
+
+void SPI::submit(struct spi_ioc_transfer* tr, uint8_t count)
+{
+    ++_syscalls;
+    int ret = ioctl(this->fd, SPI_IOC_MESSAGE(count), tr);
     if (ret < 1) {
         throw SPIException("can't send spi message");
     }
-    /*{
-        perror("can't send spi message");
-        abort();
-    }*/
 }
 
 void SPI::transfern(char* buf, uint32_t len)
@@ -0,0 +1,127 @@
+// ChannelManager.cpp
+
+#include "ChannelManager.h"
+
+ChannelManager::ChannelManager(RadioModule& radio)
+    : _radio(radio), _scan_index(0), _scan_upper(false), _sweeps(0), _last_scan_time(0),
+      _last_rendezvous_time(0), _rate_hold_until(0), _hopping(false), _hop_channel(RENDEZVOUS_CHANNEL),
+      _hop_rate(HOP_RATE_1MBPS), _hop_start(0), _last_announce_time(0) {
+    resetScan();
+}
+
+void ChannelManager::update() {
+    if (!FREQUENCY_AGILITY) return;
+    unsigned long now = millis();
+    if (_hopping) {
+        unsigned long elapsed = now - _hop_start;
+        // 【更新】: 切換由 RadioModule 在時間到時進行 (sendCommand 進行中也會切換)，這裡只做收尾
+        if (_radio.serviceHop() || !_radio.hopPending()) {
+            finishHop();
+        } else if (now - _last_announce_time >= HOP_ANNOUNCE_INTERVAL_MS) {
+            // 每次公告都帶剩餘時間，重送的公告不會讓從機晚切換
+            _radio.announceHop(_hop_channel, _hop_rate, HOP_ANNOUNCE_MS - elapsed);
+            _last_announce_time = now;
+        }
+        return;
+    }
+
+    bool at_rendezvous = _radio.rfChannel() == RENDEZVOUS_CHANNEL && _radio.dataRate() == HOP_RATE_1MBPS;
+    if (!at_rendezvous && now - _last_rendezvous_time >= RENDEZVOUS_INTERVAL_MS) {
+        _radio.sendRendezvousBeacon();
+        _last_rendezvous_time = now;
+    }
+    if (now - _last_scan_time >= SCAN_STEP_MS) {
+        sampleNext();
+        _last_scan_time = now;
+    }
+}
+
+void ChannelManager::returnToRendezvous() {
+    _hopping = false;
+    _radio.cancelHop();
+    resetScan();
+    if (_radio.rfChannel() == RENDEZVOUS_CHANNEL && _radio.dataRate() == HOP_RATE_1MBPS) return;
+    Serial.printf("[HOP] Returning to rendezvous channel %u.\n", RENDEZVOUS_CHANNEL);
+    _radio.announceHop(RENDEZVOUS_CHANNEL, HOP_RATE_1MBPS, 0, 3);
+    _radio.setRfChannel(RENDEZVOUS_CHANNEL, HOP_RATE_1MBPS);
+}
+
+/**
+ * @brief 量測一次 (頻道本身與上方相鄰頻道輪流)，一輪結束時計數；滿 SCAN_SWEEPS 輪後評估
+ */
+void ChannelManager::sampleNext() {
+    uint8_t channel = HOP_CHANNELS[_scan_index] + (_scan_upper ? 1 : 0);
+    if (_radio.sampleChannel(channel)) _busy[_scan_index]++;
+    if (!_scan_upper) {
+        _scan_upper = true;
+        return;
+    }
+    _scan_upper = false;
+    if (++_scan_index < HOP_CHANNEL_COUNT) return;
+    _scan_index = 0;
+    if (++_sweeps >= SCAN_SWEEPS) evaluate();
+}
+
+void ChannelManager::evaluate() {
+    uint32_t polls = 0;
+    uint32_t retransmits = 0;
+    _radio.takeLinkStats(polls, retransmits);
+    uint32_t retransmit_pct = polls > 0 ? retransmits * 100 / polls : 0;
+
+    Serial.print("[HOP] Scan:");
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < HOP_CHANNEL_COUNT; ++i) {
+        Serial.printf(" %u:%u", HOP_CHANNELS[i], _busy[i]);
+        if (_busy[i] < _busy[best]) best = i;
+    }
+    Serial.printf(" | link %lu polls, %lu retransmits per 100 polls\n", (unsigned long)polls, (unsigned long)retransmit_pct);
+
+    int current = channelIndex(_radio.rfChannel());
+    uint8_t channel = _radio.rfChannel();
+    bool link_measured = polls >= LINK_MIN_POLLS;
+    if (_radio.dataRate() == HOP_RATE_2MBPS && link_measured && retransmit_pct > LINK_FALLBACK_PCT) {
+        _rate_hold_until = millis() + RATE_HOLD_MS;
+        startHop(channel, HOP_RATE_1MBPS);
+    } else if (current < 0 || _busy[current] >= _busy[best] + HOP_MIN_GAIN) {
+        // 換頻道時先用 1 Mbps，新頻道的鏈路品質量過之後才考慮 2 Mbps
+        startHop(HOP_CHANNELS[best], HOP_RATE_1MBPS);
+    } else if (_radio.dataRate() == HOP_RATE_1MBPS && _busy[current] <= HOP_2MBPS_MAX_BUSY && link_measured &&
+               retransmit_pct <= LINK_UPGRADE_MAX_PCT && (long)(millis() - _rate_hold_until) >= 0) {
+        startHop(channel, HOP_RATE_2MBPS);
+    }
+    resetScan();
+}
+
+void ChannelManager::startHop(uint8_t channel, uint8_t data_rate) {
+    Serial.printf("[HOP] Moving from channel %u (%s) to channel %u (%s) in %lu ms.\n",
+                  _radio.rfChannel(), protocolDataRateName(_radio.dataRate()),
+                  channel, protocolDataRateName(data_rate), HOP_ANNOUNCE_MS);
+    _hopping = true;
+    _hop_channel = channel;
+    _hop_rate = data_rate;
+    _hop_start = millis();
+    _last_announce_time = _hop_start;
+    _radio.announceHop(channel, data_rate, HOP_ANNOUNCE_MS);
+    _radio.scheduleHop(channel, data_rate, HOP_ANNOUNCE_MS);
+}
+
+void ChannelManager::finishHop() {
+    _hopping = false;
+    resetScan();
+    _last_rendezvous_time = millis();
+    Serial.printf("[HOP] Switched to channel %u (%s).\n", _hop_channel, protocolDataRateName(_hop_rate));
+}
+
+void ChannelManager::resetScan() {
+    memset(_busy, 0, sizeof(_busy));
+    _scan_index = 0;
+    _scan_upper = false;
+    _sweeps = 0;
+}
+
+int ChannelManager::channelIndex(uint8_t channel) const {
+    for (uint8_t i = 0; i < HOP_CHANNEL_COUNT; ++i) {
+        if (HOP_CHANNELS[i] == channel) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,44 @@
+// ChannelManager.h
+
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "Protocol.h"
+#include "RadioModule.h"
+
+/**
+ * @brief 【新增】: 跳頻。loop 每 SCAN_STEP_MS 量測 HOP_CHANNELS 中的一個頻道 (不阻塞)，
+ * 每 SCAN_SWEEPS 輪評估一次：換到明顯較乾淨的頻道 (先用 1 Mbps)，
+ * 或在頻譜乾淨且輪詢重送率低時升到 2 Mbps。跳頻前公告 HOP_ANNOUNCE_MS，主機與從機在同一時間切換。
+ */
+class ChannelManager {
+public:
+    explicit ChannelManager(RadioModule& radio);
+    // 非發現模式下由 loop 呼叫
+    void update();
+    // 進入發現模式前帶所有從機回到會合頻道 (新從機只會在會合頻道上送出加入請求)
+    void returnToRendezvous();
+
+private:
+    void sampleNext();
+    void evaluate();
+    void startHop(uint8_t channel, uint8_t data_rate);
+    void finishHop();
+    void resetScan();
+    int channelIndex(uint8_t channel) const;
+
+    RadioModule& _radio;
+    uint8_t _busy[HOP_CHANNEL_COUNT];   // RPD 命中次數 (頻道本身 + 上方相鄰頻道)
+    uint8_t _scan_index;
+    bool _scan_upper;
+    uint8_t _sweeps;
+    unsigned long _last_scan_time;
+    unsigned long _last_rendezvous_time;
+    unsigned long _rate_hold_until;
+
+    bool _hopping;
+    uint8_t _hop_channel;
+    uint8_t _hop_rate;
+    unsigned long _hop_start;
+    unsigned long _last_announce_time;
+};
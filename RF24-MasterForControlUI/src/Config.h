@@ -6,6 +6,7 @@
 // --- 1. 硬體接腳定義 ---
 #define NRF_CE       (4)
 #define NRF_CSN      (5)
+#define NRF_IRQ      (22)   // nRF24 IRQ (active low)，只開啟 RX_DR 中斷
 // --- LED制御ピン ---
 #define LED1_PIN (26)        // LED1用ピン（起動時制約なし）
 #define LED2_PIN (27)        // LED2用ピン
@@ -21,6 +22,7 @@
 // --- 2. NRF24L01 通訊設定 ---
 const uint8_t command_pipe[6] = "CMD01";
 const uint8_t discovery_pipe[6] = "DISC1";
+const uint8_t uplink_pipe[6] = "UPLNK";     // 所有從機共用的上行位址，發送者 ID 在封包 source 欄位
 
 
 
@@ -34,4 +36,71 @@ enum SystemMode {
 
 // --- 4. 常數設定 ---
 // RESPONSE_TIMEOUT_MS 已移入遊戲模組內部管理
-const int MIN_DEVICES_REQUIRED = 2;
\ No newline at end of file
+const int MIN_DEVICES_REQUIRED = 2;
+
+// --- 5. 指令傳送 (序號 + ACK) ---
+const unsigned long COMMAND_RETRY_INTERVAL_MS = 10;  // 每次送出後等待 ACK 的時間
+const unsigned long COMMAND_DEADLINE_MS = 250;       // 超過此時間仍未確認則放棄 (目標很少時的最短時限)
+const uint8_t COMMAND_MIN_ATTEMPTS = 4;              // 時限至少容納這麼多次完整的 ACK 視窗 (視窗隨目標數變長)
+const unsigned long ACK_SPACING_US = 1000;           // 從機依目標內排序錯開 ACK 的間隔
+const uint8_t BATCH_COPIES = 2;                      // 批次傳送 (無 ACK) 時每個封包送出的份數
+const unsigned long BATCH_STANDBY_TIMEOUT_MS = 50;   // 每一波寫完後等待 TX FIFO 清空的時限
+const uint8_t BATCH_WAVE_FRAMES = 3;                 // 每一波的封包數 = 從機 RX FIFO 深度
+const unsigned long BATCH_WAVE_GAP_MS = 3;           // 波與波之間讓從機清空 RX FIFO (從機每 2 ms 檢查一次)
+
+// --- 5b. 輪詢上行 (ACK payload) ---
+// true: 主機依序輪詢從機，從機把心跳/讀卡結果/CMD_ACK 預先放在 ACK payload 中，不必切換到 TX
+// false: 從機自行在 TDMA 時槽送出上行封包
+const bool UPLINK_POLLING = true;
+const unsigned long POLL_INTERVAL_MS = 2;    // loop 兩次輪詢之間的最短間隔
+// 【新增】: 閒置從機的輪詢退避。輪詢取回封包或剛收到指令的從機每 POLL_INTERVAL_MS 即可再被輪詢，
+// 之後每次空輪詢把該從機的間隔加倍，最長 POLL_IDLE_MAX_MS (遠小於 POLL_TIMEOUT_MS，從機不會退出輪詢模式)
+const unsigned long POLL_IDLE_MAX_MS = 64;
+const unsigned long POLL_PRELOAD_MS = 3;     // 廣播指令後等待從機放好 CMD_ACK (從機每 2 ms 檢查一次 RX)
+const unsigned long POLL_SWEEP_MS = 30;      // 指令送出後輪詢尚未確認的從機，超過此時間則重送指令
+const uint8_t POLL_RETRY_DELAY = 1;          // ARD: (1 + 1) x 250 us，1 Mbps 下足以容納 32 bytes 的 ACK payload
+const uint8_t POLL_RETRY_COUNT = 3;
+const unsigned long POLL_TIMEOUT_MS = 1000;  // 與從機相同：超過此時間沒被輪詢，從機才退回自行傳送上行封包
+
+// --- 5c. 跳頻 (頻道品質掃描) ---
+// 非發現模式下 loop 每 SCAN_STEP_MS 離開工作頻道約 0.5 ms，量測 HOP_CHANNELS 中一個頻道的 RPD
+// (頻道本身與上方相鄰頻道輪流，2 Mbps 佔 2 MHz)。每 SCAN_SWEEPS 輪評估一次
+const bool FREQUENCY_AGILITY = true;
+const unsigned long SCAN_STEP_MS = 25;
+const uint16_t SCAN_DWELL_US = 250;             // RPD 需要在 RX 停留 170 us 以上才有效
+const uint8_t SCAN_SWEEPS = 8;                  // 每個頻道累積 2 x SCAN_SWEEPS 次量測
+const uint8_t HOP_MIN_GAIN = 4;                 // 工作頻道的忙碌次數比最乾淨的頻道多這麼多才換頻道
+const uint8_t HOP_2MBPS_MAX_BUSY = 0;           // 頻道忙碌次數不超過此值才考慮 2 Mbps
+const unsigned long HOP_ANNOUNCE_MS = 500;      // 公告到切換的時間 (超過一次 sendCommand 的時限)
+const unsigned long HOP_ANNOUNCE_INTERVAL_MS = 100;
+const unsigned long RENDEZVOUS_INTERVAL_MS = 2000; // 離開會合頻道後，每隔多久回去送一次跳頻信標
+const uint8_t RENDEZVOUS_COPIES = 2;
+// 輪詢的重送率 (每 100 次輪詢的硬體重送次數) 作為鏈路品質
+const uint16_t LINK_MIN_POLLS = 50;             // 評估期間至少要有這麼多次輪詢才判斷速率 (閒置的單台從機每次評估約 60 次)
+const uint8_t LINK_UPGRADE_MAX_PCT = 5;         // 1 Mbps 下重送率不超過此值才升到 2 Mbps
+const uint8_t LINK_FALLBACK_PCT = 30;           // 2 Mbps 下重送率超過此值則退回 1 Mbps
+const unsigned long RATE_HOLD_MS = 300000;      // 退回 1 Mbps 後多久內不再嘗試 2 Mbps
+
+// --- 5d. 鏈路統計 ---
+const unsigned long LINK_STATS_INTERVAL_MS = 10000;  // "[STATS]" 的輸出間隔 (從機的回報間隔相同)
+
+// --- 6. 上行 TDMA 時槽 ---
+// 時槽 0 保留給主機的同步信標，從機在加入時被指派 1..MAX_SLOTS-1
+const uint8_t MAX_SLOTS = 64;
+const uint8_t SLOT_MS = 4;
+const unsigned long SYNC_INTERVAL_MS = 1000;
+
+// --- 7. 中斷驅動接收 ---
+const uint16_t RX_RING_SIZE = 32;             // 必須是 2 的次方
+const unsigned long RX_IDLE_POLL_MS = 20;     // 萬一漏掉 IRQ 邊緣，RX task 仍會定期檢查 FIFO
+// --- 8. 遊戲模式 ---
+// 狀態全部預先配置 (最多 MAX_GAME_PLAYERS 台)，update() 每次只做有限的工作
+const uint8_t MAX_GAME_PLAYERS = MAX_SLOTS;
+const unsigned long GAME_ROUND_TIMEOUT_MS = 22000;    // 從機讀卡/模擬時限為 20 秒，多留一點餘裕
+const unsigned long GAME_ROUND_GAP_MS = 3000;         // 回合之間的休息時間
+const unsigned long GAME_FINALE_MS = 5000;            // 結束前贏家彩虹燈的展示時間
+const unsigned long GAME_REARM_DELAY_MS = 1000;       // 讀到不算數的卡片後稍等再讀 (卡片可能還放在讀卡機上)
+const uint8_t ROUND_ROBIN_MAX_ROUNDS = 5;             // *SCENARIO2_START# 的回合數上限
+const uint8_t TEAM_SIZE = 4;                          // *SCENARIO1_START#: 每隊人數 (含隊長)
+const unsigned long TEAM_BUILDING_TIMEOUT_MS = 120000;
+const unsigned long TEAM_EMULATE_REARM_MS = 21000;    // 從機模擬 20 秒後回到待機，之後再重新指派
@@ -0,0 +1,23 @@
+// GameModeRegistry.cpp
+
+#include "GameModeRegistry.h"
+#include "PairingGameMode.h"
+#include "TeamBuildingGameMode.h"
+
+static PairingGameMode random_pairing(1);
+static PairingGameMode round_robin(ROUND_ROBIN_MAX_ROUNDS);
+static TeamBuildingGameMode team_building;
+
+// 新增遊戲模式時只需在此加入一行
+static const GameModeEntry GAME_MODES[] = {
+    { "*RANDOM_01#",         "1v1 Random Pairing",   &random_pairing },
+    { "*SCENARIO1_START#",   "Team Building",        &team_building },
+    { "*SCENARIO2_START#",   "1v1 Round Robin",      &round_robin },
+};
+
+const GameModeEntry* findGameMode(const String& command) {
+    for (const GameModeEntry& entry : GAME_MODES) {
+        if (command == entry.command) return &entry;
+    }
+    return nullptr;
+}
@@ -0,0 +1,20 @@
+// GameModeRegistry.h
+
+#pragma once
+#include <Arduino.h>
+#include "IGameMode.h"
+
+/**
+ * @brief 【新增】: UI 指令 -> 遊戲模式 對照表。
+ * 每個模式只有一個預先配置的實體，start() 時重設狀態，不在遊戲中動態配置記憶體。
+ */
+struct GameModeEntry {
+    const char* command;    // 完整的 UI 指令，例如 "*RANDOM_01#"
+    const char* name;
+    IGameMode* mode;
+};
+
+/**
+ * @return 對應指令的項目；不是遊戲指令時回傳 nullptr
+ */
+const GameModeEntry* findGameMode(const String& command);
@@ -13,12 +13,35 @@ public:
     virtual void update() = 0;
 
     /**
-     * @brief 【已修改】: 回傳型別改為 String，以便將要發送的指令回傳給主程式
-     * @param payload 收到的封包內容
+     * @brief 【已修改】: 改為處理二進位封包，需要廣播的指令寫入 reply
+     * @param packet 收到的封包
      * @param sender_id 發送者的ID
-     * @return 需要主程式代為廣播的指令字串，如果不需要則回傳空字串
+     * @param reply 需要主程式代為廣播的指令封包
+     * @return 若 reply 需要廣播則回傳 true
      */
-    virtual String handlePacket(const String& payload, uint8_t sender_id) = 0;
+    virtual bool handlePacket(const Packet& packet, uint8_t sender_id, Packet& reply) = 0;
 
     virtual bool isFinished() = 0;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief 【新增】: 每局開始時產生的 session token (不為 0)，隨 READ / EMULATE 送給從機。
+ * 模擬卡的從機把它寫進 peer record，上一局殘留的感應因此不會被算進這一局
+ */
+inline uint16_t newSessionToken() { return (uint16_t)random(1, 0x10000); }
+
+inline Packet sessionCommand(uint8_t opcode, const TargetMask& targets, uint16_t session_token) {
+    Packet packet(opcode, targets);
+    encodeSession(packet, session_token);
+    return packet;
+}
+
+/**
+ * @brief 【更新】: 由上行封包找出被感應的從機。OP_ENCOUNTER 帶有讀卡方自行解析的對方 ID，
+ * 不再由 UID 對照 my_uid。只有 UID 的 OP_READ_RESULT (不是模擬中的從機) 與其他局的 session 都回傳 0
+ */
+inline uint8_t encounteredPeer(const Packet& packet, uint16_t session_token, uint32_t& latency_us) {
+    PeerInfo peer;
+    if (packet.opcode != OP_ENCOUNTER || !decodeEncounter(packet, peer, latency_us)) return 0;
+    return peer.session_token == session_token ? peer.device_id : 0;
+}
@@ -0,0 +1,81 @@
+// LinkTelemetry.cpp
+
+#include "LinkTelemetry.h"
+
+namespace {
+void bump(uint16_t& counter) {
+    if (counter < UINT16_MAX) counter++;
+}
+}
+
+LinkTelemetry::LinkTelemetry() {
+    memset(_links, 0, sizeof(_links));
+}
+
+LinkTelemetry::Link* LinkTelemetry::find(uint8_t id, bool create) {
+    Link* free_link = nullptr;
+    for (Link& link : _links) {
+        if (link.id == id) return &link;
+        if (!free_link && link.id == 0) free_link = &link;
+    }
+    if (!create || !free_link || id == PROTOCOL_MASTER_ID) return nullptr;
+    memset(free_link, 0, sizeof(Link));
+    free_link->id = id;
+    return free_link;
+}
+
+void LinkTelemetry::recordPoll(uint8_t id, bool acked, uint8_t arc) {
+    Link* link = find(id, true);
+    if (!link) return;
+    bump(link->polls);
+    if (acked) bump(link->poll_arc[linkArcBin(arc)]);
+    else bump(link->poll_failed);
+}
+
+void LinkTelemetry::recordRtt(uint8_t id, uint32_t rtt_us) {
+    Link* link = find(id, true);
+    if (!link) return;
+    uint8_t bin = 0;
+    for (uint32_t limit_us = 1000; bin < RTT_BINS - 1 && rtt_us >= limit_us; limit_us <<= 1) bin++;
+    bump(link->rtt[bin]);
+    if (rtt_us > link->rtt_max_us) link->rtt_max_us = rtt_us;
+}
+
+void LinkTelemetry::recordReport(uint8_t id, const LinkReport& report) {
+    Link* link = find(id, true);
+    if (!link) return;
+    link->report = report;
+    link->has_report = true;
+}
+
+void LinkTelemetry::forget(uint8_t id) {
+    Link* link = find(id, false);
+    if (link) link->id = 0;
+}
+
+/**
+ * @brief 一行一台: poll=次數/失敗 arc=0,1,2,3,4+ rtt=各區間次數 (max ms) 之後是從機的回報
+ * (up=自行送出/失敗 uarc=ARC 分布 plos=遺失計數 rx=收到的主機封包 rpd=其中 -64 dBm 以上的比例)
+ */
+void LinkTelemetry::printFrames(const std::vector<uint8_t>& slaves) {
+    for (uint8_t id : slaves) {
+        Link* link = find(id, false);
+        if (!link) continue;
+        Serial.printf("[STATS] id=%u poll=%u/%u arc=", id, link->polls, link->poll_failed);
+        for (uint8_t i = 0; i < LINK_ARC_BINS; ++i) Serial.printf(i ? ",%u" : "%u", link->poll_arc[i]);
+        Serial.print(" rtt=");
+        for (uint8_t i = 0; i < RTT_BINS; ++i) Serial.printf(i ? ",%u" : "%u", link->rtt[i]);
+        Serial.printf(" rtt_max=%lu.%lu", (unsigned long)(link->rtt_max_us / 1000), (unsigned long)(link->rtt_max_us % 1000 / 100));
+        if (link->has_report) {
+            const LinkReport& report = link->report;
+            Serial.printf(" up=%u/%u uarc=", report.writes, report.failed);
+            for (uint8_t i = 0; i < LINK_ARC_BINS; ++i) Serial.printf(i ? ",%u" : "%u", report.arc[i]);
+            unsigned rpd_pct = report.rx > 0 ? (unsigned)((uint32_t)report.rx_strong * 100 / report.rx) : 0;
+            Serial.printf(" plos=%u rx=%u rpd=%u%%", report.lost, report.rx, rpd_pct);
+        }
+        Serial.println();
+
+        memset(link, 0, sizeof(Link));
+        link->id = id;
+    }
+}
@@ -0,0 +1,43 @@
+// LinkTelemetry.h
+
+#pragma once
+#include <Arduino.h>
+#include <vector>
+#include "Config.h"
+#include "Protocol.h"
+
+/**
+ * @brief 【新增】: 每台從機的鏈路統計 (固定大小，最多 MAX_SLOTS 台)。
+ * 主機端: 輪詢的 ARC 分布與失敗次數、指令的往返時間 (送出 -> CMD_ACK)；
+ * 從機端: 最近一次 OP_LINK_STATS 回報 (自行送出的 ARC 分布、失敗、PLOS、RPD)。
+ * printFrames() 每行輸出一台從機並開始新的統計期間。
+ */
+class LinkTelemetry {
+public:
+    // 往返時間的分布: < 1, 2, 4, 8, 16, 32, 64 ms 與 64 ms 以上
+    static const uint8_t RTT_BINS = 8;
+
+    LinkTelemetry();
+    void recordPoll(uint8_t id, bool acked, uint8_t arc);
+    void recordRtt(uint8_t id, uint32_t rtt_us);
+    void recordReport(uint8_t id, const LinkReport& report);
+    // "[STATS] id=.." 每台一行 (只輸出 slaves 中的從機)，之後歸零
+    void printFrames(const std::vector<uint8_t>& slaves);
+    void forget(uint8_t id);
+
+private:
+    struct Link {
+        uint8_t id;                     // 0 = 未使用
+        uint16_t polls;
+        uint16_t poll_failed;
+        uint16_t poll_arc[LINK_ARC_BINS];
+        uint16_t rtt[RTT_BINS];
+        uint32_t rtt_max_us;
+        bool has_report;
+        LinkReport report;
+    };
+
+    Link* find(uint8_t id, bool create);
+
+    Link _links[MAX_SLOTS];
+};
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <MD_MAX72xx.h>
 #include <MD_Parola.h>
+#include "Config.h"
 
 class MasterMatrixModule {
 public:
@@ -0,0 +1,50 @@
+// PacketRing.h
+
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @brief 單一生產者 / 單一消費者的無鎖環形緩衝區。
+ * 生產者 (RX task) 只更新 _head，消費者 (loop) 只更新 _tail，因此不需要鎖。
+ * N 必須是 2 的次方。
+ */
+template <typename T, uint16_t N>
+class PacketRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "PacketRing size must be a power of two");
+
+public:
+    // 生產者端
+    bool push(const T& item) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        uint16_t tail = _tail.load(std::memory_order_acquire);
+        if ((uint16_t)(head - tail) >= N) return false;
+        _items[head & (N - 1)] = item;
+        _head.store((uint16_t)(head + 1), std::memory_order_release);
+        return true;
+    }
+
+    // 消費者端
+    bool pop(T& item) {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        uint16_t head = _head.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        item = _items[tail & (N - 1)];
+        _tail.store((uint16_t)(tail + 1), std::memory_order_release);
+        return true;
+    }
+
+    // 消費者端: 丟棄目前所有項目
+    void clear() {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T _items[N];
+    std::atomic<uint16_t> _head{0};
+    std::atomic<uint16_t> _tail{0};
+};
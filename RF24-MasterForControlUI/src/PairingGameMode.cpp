@@ -0,0 +1,214 @@
+// PairingGameMode.cpp
+
+#include "PairingGameMode.h"
+
+PairingGameMode::PairingGameMode(uint8_t max_rounds)
+    : _max_rounds(max_rounds > 0 ? max_rounds : 1), _session(0), _radio(nullptr), _slaves(nullptr),
+      _phase(PHASE_FINISHED), _phase_start(0), _player_count(0), _positions(0), _rounds(0), _round(0),
+      _pair_count(0), _pending_pairs(0) {}
+
+void PairingGameMode::start(RadioModule& radio, std::vector<uint8_t>& slaves) {
+    _radio = &radio;
+    _slaves = &slaves;
+    _session = newSessionToken();
+    _player_count = 0;
+    for (uint8_t id : slaves) {
+        if (_player_count >= MAX_GAME_PLAYERS) break;
+        _players[_player_count] = id;
+        _wins[_player_count] = 0;
+        _player_count++;
+    }
+    // Fisher-Yates 洗牌，每局的配對都不同
+    for (int i = _player_count - 1; i > 0; --i) {
+        int j = random(i + 1);
+        uint8_t tmp = _players[i];
+        _players[i] = _players[j];
+        _players[j] = tmp;
+    }
+    _positions = _player_count + (_player_count % 2);
+    _rounds = _positions > 1 ? min<uint8_t>(_max_rounds, _positions - 1) : 0;
+    _round = 0;
+    if (_rounds == 0) {
+        Serial.println("[GAME] Not enough players for pairing.");
+        _phase = PHASE_FINISHED;
+        return;
+    }
+    beginRound();
+}
+
+/**
+ * @brief 循環賽排程: 位置 0 固定，其餘位置每回合輪轉一格；輪空位置回傳 0
+ */
+uint8_t PairingGameMode::playerAt(uint8_t position) const {
+    uint8_t index = position == 0 ? 0 : 1 + (position - 1 + _round) % (_positions - 1);
+    return index < _player_count ? _players[index] : 0;
+}
+
+void PairingGameMode::beginRound() {
+    TargetMask readers;
+    TargetMask emulators;
+    uint8_t sitter = 0;
+    _pair_count = 0;
+    for (uint8_t i = 0; i < _positions / 2; ++i) {
+        uint8_t a = playerAt(i);
+        uint8_t b = playerAt(_positions - 1 - i);
+        if (a == 0 || b == 0) {
+            sitter = a ? a : b;
+            continue;
+        }
+        // 每回合交換角色，避免同一台一直讀卡
+        bool a_reads = ((i + _round) % 2) == 0;
+        _readers[_pair_count] = a_reads ? a : b;
+        _emulators[_pair_count] = a_reads ? b : a;
+        _pair_state[_pair_count] = PAIR_PENDING;
+        _rearm[_pair_count] = false;
+        readers.add(_readers[_pair_count]);
+        emulators.add(_emulators[_pair_count]);
+        _pair_count++;
+    }
+    _pending_pairs = _pair_count;
+
+    Serial.printf("[GAME] Round %u/%u: %u pairs\n", _round + 1, _rounds, _pair_count);
+    for (uint8_t p = 0; p < _pair_count; ++p) {
+        Serial.printf("[GAME]   #%d reads #%d\n", _readers[p], _emulators[p]);
+    }
+    // 先讓被感應的一方進入模擬模式，讀卡方開始輪詢時卡片已就緒
+    _radio->sendCommand(sessionCommand(OP_EMULATE, emulators, _session), *_slaves);
+    _radio->sendCommand(sessionCommand(OP_READ, readers, _session), *_slaves);
+    if (sitter) {
+        Serial.printf("[GAME]   #%d sits out this round\n", sitter);
+        _radio->sendCommand(Packet(OP_TEAM_WAIT, TargetMask::single(sitter)), *_slaves);
+    }
+    _phase = PHASE_ROUND;
+    _phase_start = millis();
+}
+
+void PairingGameMode::update() {
+    unsigned long elapsed = millis() - _phase_start;
+    switch (_phase) {
+        case PHASE_ROUND:
+            if (_pending_pairs == 0 || elapsed >= GAME_ROUND_TIMEOUT_MS) endRound();
+            else rearmReaders();
+            break;
+        case PHASE_GAP:
+            if (elapsed >= GAME_ROUND_GAP_MS) {
+                _round++;
+                beginRound();
+            }
+            break;
+        case PHASE_FINALE:
+            if (elapsed >= GAME_FINALE_MS) _phase = PHASE_FINISHED;
+            break;
+        case PHASE_FINISHED:
+            break;
+    }
+}
+
+void PairingGameMode::endRound() {
+    uint8_t matched = 0;
+    for (uint8_t p = 0; p < _pair_count; ++p) {
+        if (_pair_state[p] == PAIR_PENDING) {
+            Serial.printf("[GAME] Pair #%d <-> #%d timed out\n", _readers[p], _emulators[p]);
+            _pair_state[p] = PAIR_FAILED;
+        }
+        if (_pair_state[p] == PAIR_MATCHED) matched++;
+    }
+    _pending_pairs = 0;
+    Serial.printf("[GAME] Round %u finished: %u/%u pairs matched\n", _round + 1, matched, _pair_count);
+
+    if (_round + 1 < _rounds) {
+        _phase = PHASE_GAP;
+        _phase_start = millis();
+    } else {
+        showWinners();
+    }
+}
+
+void PairingGameMode::showWinners() {
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < _player_count; ++i) best = max(best, _wins[i]);
+    if (best == 0) {
+        Serial.println("[GAME] No pairs matched.");
+        _phase = PHASE_FINISHED;
+        return;
+    }
+    TargetMask winners;
+    Serial.printf("[GAME] Winners (%u matches):", best);
+    for (uint8_t i = 0; i < _player_count; ++i) {
+        if (_wins[i] != best) continue;
+        winners.add(_players[i]);
+        Serial.printf(" #%d", _players[i]);
+    }
+    Serial.println();
+    _radio->sendCommand(Packet(OP_SPOTLIGHT, winners), *_slaves);
+    _phase = PHASE_FINALE;
+    _phase_start = millis();
+}
+
+/**
+ * @brief 時間已到的讀卡方合併成一個封包重新指派 READ_
+ */
+void PairingGameMode::rearmReaders() {
+    unsigned long now = millis();
+    TargetMask readers;
+    for (uint8_t p = 0; p < _pair_count; ++p) {
+        if (!_rearm[p] || (long)(now - _rearm_at[p]) < 0) continue;
+        _rearm[p] = false;
+        if (_pair_state[p] == PAIR_PENDING) readers.add(_readers[p]);
+    }
+    if (!readers.isEmpty()) _radio->sendCommand(sessionCommand(OP_READ, readers, _session), *_slaves);
+}
+
+int8_t PairingGameMode::findPairByReader(uint8_t reader_id) const {
+    for (uint8_t p = 0; p < _pair_count; ++p) {
+        if (_readers[p] == reader_id) return p;
+    }
+    return -1;
+}
+
+int8_t PairingGameMode::playerIndex(uint8_t id) const {
+    for (uint8_t i = 0; i < _player_count; ++i) {
+        if (_players[i] == id) return i;
+    }
+    return -1;
+}
+
+bool PairingGameMode::handlePacket(const Packet& packet, uint8_t sender_id, Packet& reply) {
+    if (_phase != PHASE_ROUND) return false;
+    int8_t pair = findPairByReader(sender_id);
+    if (pair < 0 || _pair_state[pair] != PAIR_PENDING) return false;
+    uint8_t partner = _emulators[pair];
+
+    if (packet.opcode == OP_ENCOUNTER || packet.opcode == OP_READ_RESULT) {
+        uint32_t latency_us = 0;
+        uint8_t tagged = encounteredPeer(packet, _session, latency_us);
+        if (tagged != partner) {
+            // 讀到別組的從機或不是本局從機的卡片: 不算數，稍後讓讀卡方繼續找自己的夥伴
+            if (tagged) Serial.printf("[GAME] #%d read #%d instead of #%d, re-arming reader\n", sender_id, tagged, partner);
+            else Serial.printf("[GAME] #%d read a tag that is not a player, re-arming reader\n", sender_id);
+            _rearm[pair] = true;
+            _rearm_at[pair] = millis() + GAME_REARM_DELAY_MS;
+            return false;
+        }
+        _pair_state[pair] = PAIR_MATCHED;
+        // playerIndex 找不到時回傳 -1，不可直接當作索引
+        int8_t reader = playerIndex(sender_id);
+        int8_t emulator = playerIndex(partner);
+        if (reader >= 0) _wins[reader]++;
+        if (emulator >= 0) _wins[emulator]++;
+        Serial.printf("[GAME] Pair #%d <-> #%d matched (tap->uplink %lu us)\n", sender_id, partner, (unsigned long)latency_us);
+    } else if (packet.opcode == OP_READ_TIMEOUT) {
+        _pair_state[pair] = PAIR_FAILED;
+        Serial.printf("[GAME] Pair #%d <-> #%d failed (reader timed out)\n", sender_id, partner);
+    } else {
+        return false;
+    }
+
+    // 這一組已結束: 兩台都亮黃燈等待下一回合 (模擬中的一方也會因此離開模擬模式)
+    _pending_pairs--;
+    TargetMask pair_mask;
+    pair_mask.add(sender_id);
+    pair_mask.add(partner);
+    reply = Packet(OP_TEAM_WAIT, pair_mask);
+    return true;
+}
@@ -0,0 +1,57 @@
+// PairingGameMode.h
+
+#pragma once
+#include "IGameMode.h"
+#include "Config.h"
+
+/**
+ * @brief 【新增】: 1 對 1 配對遊戲。每組一台讀卡 (READ_)、一台被感應 (EMULATE_)，
+ * 落單的一台以黃燈 (SETCOLOR_YELLOW_) 等待。讀到夥伴的卡片即配對成功。
+ * rounds = 1 為 *RANDOM_01# 的隨機配對；rounds > 1 以循環賽 (circle method)
+ * 排出每回合的對手，最後由成功次數最多的從機點亮彩虹燈 (SETCOLOR_RAINBOW_)。
+ */
+class PairingGameMode : public IGameMode {
+public:
+    explicit PairingGameMode(uint8_t max_rounds);
+
+    void start(RadioModule& radio, std::vector<uint8_t>& slaves) override;
+    void update() override;
+    bool handlePacket(const Packet& packet, uint8_t sender_id, Packet& reply) override;
+    bool isFinished() override { return _phase == PHASE_FINISHED; }
+
+private:
+    enum Phase : uint8_t { PHASE_ROUND, PHASE_GAP, PHASE_FINALE, PHASE_FINISHED };
+    enum PairState : uint8_t { PAIR_PENDING, PAIR_MATCHED, PAIR_FAILED };
+
+    void beginRound();
+    void endRound();
+    void showWinners();
+    void rearmReaders();
+    uint8_t playerAt(uint8_t position) const;
+    int8_t findPairByReader(uint8_t reader_id) const;
+    int8_t playerIndex(uint8_t id) const;
+
+    const uint8_t _max_rounds;
+    uint16_t _session;
+    RadioModule* _radio;
+    std::vector<uint8_t>* _slaves;
+    Phase _phase;
+    unsigned long _phase_start;
+
+    // 參賽者 (開始時打亂一次) 與每人的成功次數
+    uint8_t _players[MAX_GAME_PLAYERS];
+    uint8_t _wins[MAX_GAME_PLAYERS];
+    uint8_t _player_count;
+    uint8_t _positions;     // 循環賽的位置數 (奇數人時多一個輪空位置)
+    uint8_t _rounds;
+    uint8_t _round;
+
+    // 本回合的配對
+    uint8_t _readers[MAX_GAME_PLAYERS / 2];
+    uint8_t _emulators[MAX_GAME_PLAYERS / 2];
+    PairState _pair_state[MAX_GAME_PLAYERS / 2];
+    bool _rearm[MAX_GAME_PLAYERS / 2];          // 讀卡方需在 _rearm_at 之後重新讀卡
+    unsigned long _rearm_at[MAX_GAME_PLAYERS / 2];
+    uint8_t _pair_count;
+    uint8_t _pending_pairs;
+};
@@ -0,0 +1,203 @@
+// Protocol.h (Shared by Master & Slave - keep both copies identical)
+//
+// 固定格式的二進位無線協定。
+// 舊的 "*CMD_ID-ID#" 字串封包已由此格式取代。
+//
+// Frame layout (max 32 bytes = one nRF24 payload, sent with dynamic payload length):
+//   [0] opcode
+//   [1] sequence number
+//   [2] source ID (0 = master)
+//   [3] bits 7-6: target kind, bit 5: ACK requested, bits 4-0: payload length
+//   [4..] target:  TARGET_ALL  -> (nothing)
+//                  TARGET_ONE  -> 1 byte ID
+//                  TARGET_MASK -> 1 byte first mask byte, 1 byte mask length n, n bytes of bitmask
+//   [..] payload (payload length bytes)
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// --- 1. 格式常數 ---
+const uint8_t PROTOCOL_MAX_FRAME   = 32;
+const uint8_t PROTOCOL_HEADER_SIZE = 4;
+const uint8_t PROTOCOL_MAX_PAYLOAD = PROTOCOL_MAX_FRAME - PROTOCOL_HEADER_SIZE;
+const uint8_t PROTOCOL_MASTER_ID   = 0;
+const uint8_t PROTOCOL_FLAG_ACK    = 0x20;
+const uint8_t PROTOCOL_LEN_MASK    = 0x1F;
+
+enum TargetKind : uint8_t {
+    TARGET_ALL  = 0,
+    TARGET_ONE  = 1,
+    TARGET_MASK = 2
+};
+
+// --- 2. 指令碼 ---
+enum Opcode : uint8_t {
+    OP_NONE            = 0x00,
+
+    // Master -> Slave
+    OP_JOIN_ACK        = 0x01, // 加入確認, payload: [指派的上行時槽]
+    OP_STOP            = 0x02,
+    OP_REMOVE_JOIN     = 0x03,
+    OP_BLINK_WHITE     = 0x04,
+    OP_NAME            = 0x05, // payload: 名稱字串 (不含結尾 0)
+    OP_TEST_PIPE       = 0x06,
+    OP_READ            = 0x07, // payload (可省略): 見 encodeSession()
+    OP_EMULATE         = 0x08, // payload (可省略): 見 encodeSession()
+    OP_TEAM_WAIT       = 0x09, // 舊 *SETCOLOR_YELLOW_
+    OP_SPOTLIGHT       = 0x0A, // 舊 *SETCOLOR_RAINBOW_
+    OP_SCORE_START     = 0x0B,
+    OP_SCORE_STOP      = 0x0C,
+    OP_COOLDOWN_START  = 0x0D,
+    OP_COOLDOWN_END    = 0x0E,
+    OP_SYNC            = 0x0F, // 時槽同步信標, payload: [slot_count, slot_ms]
+    OP_POLL            = 0x10, // 輪詢 (送到從機各自的輪詢位址)，從機以 ACK payload 回覆上行封包
+    OP_HOP             = 0x11, // 跳頻公告, payload: 見 encodeHop()
+
+    // Slave -> Master
+    OP_JOIN_REQUEST    = 0x80,
+    OP_HEARTBEAT       = 0x81,
+    OP_CHANNEL_TEST    = 0x82,
+    OP_READ_RESULT     = 0x83, // payload: 見 encodeReadResult()
+    OP_READ_TIMEOUT    = 0x84,
+    OP_EMULATOR_ACK    = 0x85, // 模擬模式被 STOP 中斷後的確認
+    OP_CMD_ACK         = 0x86, // payload: [已收到的指令序號]
+    OP_LINK_STATS      = 0x87, // 從機的鏈路統計, payload: 見 encodeLinkReport()
+    OP_ENCOUNTER       = 0x88  // 讀到另一台從機 (已解析對方的 peer record), payload: 見 encodeEncounter()
+};
+
+bool protocolIsKnownOpcode(uint8_t opcode);
+const char* protocolOpcodeName(uint8_t opcode);
+
+// --- 3. 目標集合 (最多 256 個 ID 的位元遮罩) ---
+struct Packet;
+
+class TargetMask {
+public:
+    TargetMask();
+
+    static TargetMask all();
+    static TargetMask single(uint8_t id);
+
+    void clear();
+    void setAll();
+    void add(uint8_t id);
+    void remove(uint8_t id);
+
+    bool contains(uint8_t id) const;
+    uint16_t rankOf(uint8_t id) const; // 遮罩中比 id 小的目標數 (用於錯開 ACK)
+    bool isAll() const { return _all; }
+    bool isEmpty() const;
+    uint16_t count() const;
+
+private:
+    friend uint8_t encodePacket(const Packet& packet, uint8_t* buf, uint8_t cap);
+    friend bool decodePacket(const uint8_t* buf, uint8_t len, Packet& packet);
+
+    uint8_t _bits[32];
+    bool _all;
+};
+
+// --- 4. 封包 ---
+struct Packet {
+    uint8_t opcode;
+    uint8_t seq;
+    uint8_t source;
+    bool ack_requested; // 目標從機收到後需回覆 OP_CMD_ACK
+    TargetMask targets;
+    uint8_t payload_len;
+    uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+
+    Packet(uint8_t op = OP_NONE, const TargetMask& to = TargetMask::all());
+
+    bool setPayload(const void* data, uint8_t len);
+    void setText(const char* text);                 // 超過長度時截斷
+    void getText(char* out, size_t out_size) const; // 一定以 0 結尾
+};
+
+/**
+ * @brief 將封包編碼至 buf。
+ * @return 編碼後的位元組數；若 buf 放不下則回傳 0
+ */
+uint8_t encodePacket(const Packet& packet, uint8_t* buf, uint8_t cap);
+
+/**
+ * @brief 解碼並驗證 buf 中的封包 (長度不足、未知 opcode 或欄位越界都會回傳 false)。
+ */
+bool decodePacket(const uint8_t* buf, uint8_t len, Packet& packet);
+
+// --- 5. 讀卡結果 payload ---
+// [uid_len][uid ...][tap_to_uplink (little endian, 2 bytes)]
+// tap_to_uplink 是從機偵測到卡片到送出封包之間的時間，以 TAP_LATENCY_UNIT_US 為單位
+// (最多約 6.5 秒，超過時固定為 0xFFFF)；encode/decode 的參數仍是微秒
+const uint8_t READ_RESULT_MAX_UID = 10;
+const uint32_t TAP_LATENCY_UNIT_US = 100;
+
+bool encodeReadResult(Packet& packet, const uint8_t* uid, uint8_t uid_len, uint32_t tap_to_uplink_us);
+bool decodeReadResult(const Packet& packet, uint8_t* uid, uint8_t& uid_len, uint32_t& tap_to_uplink_us);
+
+// --- 6. 輪詢位址 ---
+// 從機以 pipe 2 接收輪詢。pipe 2..5 只有最低位元組可設定，其餘 4 bytes 與 pipe 1 (command_pipe) 相同；
+// 最低位元組設為 0x80 | ID，不會與 command_pipe 的第一個字元重複 (ID 1..127)
+const uint8_t POLL_PIPE = 2;
+
+void protocolPollAddress(uint8_t id, const uint8_t* command_address, uint8_t* out);
+
+// --- 7. 跳頻 ---
+// [channel][data_rate][switch_in_ms (little endian, 2 bytes)]
+// 從機在收到後 switch_in_ms 切換到新的頻道與速率；0 表示立即切換 (會合頻道上的信標)。
+// 開機、發現模式與失聯時都使用會合頻道 (1 Mbps)。主機只會跳到 HOP_CHANNELS 中的頻道，
+// 失聯的從機依序在這些頻道上尋找主機。頻道避開 Wi-Fi 1/6/11 的主要頻寬 (nRF24 頻道 n = 2400 + n MHz)
+const uint8_t RENDEZVOUS_CHANNEL = 76;
+const uint8_t HOP_CHANNELS[] = { 76, 84, 92, 100, 108, 116, 124, 2, 25, 49 };
+const uint8_t HOP_CHANNEL_COUNT = sizeof(HOP_CHANNELS);
+const uint8_t HOP_RATE_1MBPS = 0;   // = RF24_1MBPS
+const uint8_t HOP_RATE_2MBPS = 1;   // = RF24_2MBPS
+
+bool encodeHop(Packet& packet, uint8_t channel, uint8_t data_rate, uint16_t switch_in_ms);
+bool decodeHop(const Packet& packet, uint8_t& channel, uint8_t& data_rate, uint16_t& switch_in_ms);
+const char* protocolDataRateName(uint8_t data_rate);
+
+// --- 8. 鏈路統計 ---
+// 從機每隔一段時間回報上一個期間的計數 (回報後歸零)。
+// [writes][failed][arc x LINK_ARC_BINS][rx][rx_strong] 各 2 bytes (little endian)，最後 [lost] 1 byte
+const uint8_t LINK_ARC_BINS = 5;   // 成功送出前的重送次數: 0, 1, 2, 3, 4 次以上
+
+struct LinkReport {
+    uint16_t writes;                // 自行送出且需要 ACK 的封包
+    uint16_t failed;                // 超過重送次數仍未收到 ACK
+    uint16_t arc[LINK_ARC_BINS];    // 成功送出的封包依 ARC 分布
+    uint16_t rx;                    // 收到的主機封包
+    uint16_t rx_strong;             // 其中 RPD 為 1 (-64 dBm 以上) 的封包
+    uint8_t lost;                   // 本期間 OBSERVE_TX.PLOS_CNT 的增量 (計數器最多 15，切換頻道時歸零)
+};
+
+uint8_t linkArcBin(uint8_t arc);
+bool encodeLinkReport(Packet& packet, const LinkReport& report);
+bool decodeLinkReport(const Packet& packet, LinkReport& report);
+
+// --- 9. 從機之間的感應 ---
+// 模擬卡的 NDEF 檔最後一筆是 NFC Forum external type record "socialtag.io:p" (URL 仍是第一筆，手機行為不變)，
+// payload: [version][device_id][session_token (LE 2)][score (LE 2)]
+// 讀卡方自行解析，只向主機送出一個 OP_ENCOUNTER (source = 讀卡方):
+// [peer_id][session_token (LE 2)][peer_score (LE 2)][tap_to_uplink (LE 2, 單位同讀卡結果)]
+// session_token 由主機在每局開始時產生，隨 OP_READ / OP_EMULATE 送出 ([session_token (LE 2)])；
+// 0 表示沒有進行中的遊戲。score 是該從機在本局中以讀卡方完成的感應次數
+const char* const PEER_RECORD_TYPE = "socialtag.io:p";
+const uint8_t PEER_RECORD_VERSION = 1;
+const uint8_t PEER_RECORD_SIZE = 6;
+
+struct PeerInfo {
+    uint8_t device_id;
+    uint16_t session_token;
+    uint16_t score;
+};
+
+void encodePeerRecord(const PeerInfo& peer, uint8_t* out);   // out 需有 PEER_RECORD_SIZE bytes
+bool decodePeerRecord(const uint8_t* payload, uint32_t len, PeerInfo& peer);
+
+bool encodeEncounter(Packet& packet, const PeerInfo& peer, uint32_t tap_to_uplink_us);
+bool decodeEncounter(const Packet& packet, PeerInfo& peer, uint32_t& tap_to_uplink_us);
+
+bool encodeSession(Packet& packet, uint16_t session_token);
+uint16_t decodeSession(const Packet& packet);   // 沒有 payload 時回傳 0
@@ -3,7 +3,15 @@
 #include "RadioModule.h"
 #include "Config.h"
 
-RadioModule::RadioModule() : _radio(NRF_CE, NRF_CSN) {}
+RadioModule* RadioModule::_instance = nullptr;
+
+RadioModule::RadioModule()
+    : _radio(NRF_CE, NRF_CSN), _next_seq(0), _slot_count(1), _poll_index(0), _last_poll_time(0), _poll_seen(),
+      _poll_due(), _poll_backoff(),
+      _link_polls(0), _link_retransmits(0), _channel(RENDEZVOUS_CHANNEL), _data_rate(HOP_RATE_1MBPS),
+      _hop_pending(false), _hop_channel(RENDEZVOUS_CHANNEL), _hop_rate(HOP_RATE_1MBPS), _hop_time(0),
+      _last_batch(), _command_start_us(0), _pending_head(0), _pending_count(0),
+      _rx_task_handle(nullptr), _spi_lock(nullptr), _rx_overflows(0) {}
 
 void RadioModule::begin(uint8_t ce, uint8_t csn) {
     if (!_radio.begin()) {
@@ -11,78 +19,492 @@ void RadioModule::begin(uint8_t ce, uint8_t csn) {
         while (1);
     }
     _radio.setPALevel(RF24_PA_LOW);
-    _radio.setDataRate(RF24_1MBPS);
-    _radio.setChannel(76);
+    // 【修改】: 開機時在會合頻道，之後由 ChannelManager 依掃描結果跳頻
+    _radio.setDataRate((rf24_datarate_e)_data_rate);
+    _radio.setChannel(_channel);
     _radio.setCRCLength(RF24_CRC_16);
     _radio.setAutoAck(true);
-    _radio.setRetries(15, 15);
+    // 主機只有輪詢需要 ACK (其他都是 NO_ACK 廣播)，重送次數少才不會被離線的從機拖住
+    _radio.setRetries(POLL_RETRY_DELAY, POLL_RETRY_COUNT);
+    _radio.enableDynamicAck(); // 廣播指令以 NO_ACK 送出，避免多台從機同時回 ACK 互相碰撞
+    // 【新增】: 封包長度隨內容變化，並接收從機放在 ACK 裡的上行封包
+    _radio.enableDynamicPayloads();
+    _radio.enableAckPayload();
+    _radio.maskIRQ(true, true, false); // 只讓 RX_DR 拉低 IRQ 腳
+
+    _instance = this;
+    _spi_lock = xSemaphoreCreateMutex();
+    // loop() 在 core 1 執行，RX task 放在 core 0
+    xTaskCreatePinnedToCore(rxTaskEntry, "NRF_RX_Task", 4096, this, 2, &_rx_task_handle, 0);
+    pinMode(NRF_IRQ, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(NRF_IRQ), onIrq, FALLING);
+}
+
+void IRAM_ATTR RadioModule::onIrq() {
+    BaseType_t woken = pdFALSE;
+    if (_instance && _instance->_rx_task_handle) {
+        vTaskNotifyGiveFromISR(_instance->_rx_task_handle, &woken);
+    }
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void RadioModule::rxTaskEntry(void* arg) {
+    static_cast<RadioModule*>(arg)->rxTask();
+}
+
+void RadioModule::rxTask() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RX_IDLE_POLL_MS));
+        xSemaphoreTake(_spi_lock, portMAX_DELAY);
+        drainRxFifo();
+        xSemaphoreGive(_spi_lock);
+    }
+}
+
+/**
+ * @brief 取出 RX FIFO 中所有封包 (含 ACK payload)，解碼後放入 ring。呼叫前需持有 _spi_lock
+ * @return 【更新】: 取出的有效封包數
+ */
+uint8_t RadioModule::drainRxFifo() {
+    uint8_t received = 0;
+    while (_radio.available()) {
+        uint8_t buffer[PROTOCOL_MAX_FRAME];
+        uint8_t len = _radio.getDynamicPayloadSize();
+        if (len == 0) continue; // 長度錯誤的封包已由 RF24 清除
+        _radio.read(buffer, len);
+        Packet packet;
+        if (!decodePacket(buffer, len, packet)) continue;
+        received++;
+        if (!_rx_ring.push(packet)) _rx_overflows++;
+    }
+    return received;
+}
+
+bool RadioModule::popReceived(Packet& packet) {
+    return _rx_ring.pop(packet);
 }
 
 void RadioModule::powerUp() {
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
     _radio.powerUp();
+    xSemaphoreGive(_spi_lock);
+}
+
+// 【更新】: 盲目廣播。所有副本共用同一序號，從機只會執行一次
+bool RadioModule::broadcastPacket(const Packet& packet, int burst_count) {
+    return sendBatch(&packet, 1, burst_count > 0 ? burst_count : 1);
+}
+
+/**
+ * @brief 【新增】: 批次傳送。writeFast 只在 FIFO 滿時等待空位，不必每筆等到送完再切回 RX。
+ * 所有從機都會收到每個封包，而從機每 2 ms 才清一次 3 層 RX FIFO，因此每送 BATCH_WAVE_FRAMES 個
+ * 就以 txStandBy 等 FIFO 清空並回到 RX 等待 BATCH_WAVE_GAP_MS。副本分在不同輪次送出，
+ * 某一波被漏掉的封包還有下一輪的機會
+ * @return 全部封包都已寫入且送出
+ */
+bool RadioModule::sendBatch(const Packet* packets, uint8_t count, uint8_t copies) {
+    BatchStats stats = {};
+    stats.drained = true;
+    uint32_t start_us = micros();
+    uint8_t first_seq = _next_seq;
+    _next_seq += count; // 同一封包的副本共用序號，從機只會執行一次
+
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
+    _radio.stopListening();
+    _radio.openWritingPipe(command_pipe);
+    uint8_t in_wave = 0;
+    for (uint8_t copy = 0; copy < copies; ++copy) {
+        for (uint8_t i = 0; i < count; ++i) {
+            Packet frame = packets[i];
+            frame.seq = first_seq + i;
+            frame.source = PROTOCOL_MASTER_ID;
+            frame.ack_requested = false;
+            uint8_t buffer[PROTOCOL_MAX_FRAME];
+            uint8_t len = encodePacket(frame, buffer, sizeof(buffer));
+            if (len == 0) {
+                if (copy == 0) Serial.printf("[Radio] ERROR: cannot encode %s packet (too many targets or payload too long)\n", protocolOpcodeName(frame.opcode));
+                stats.failed++;
+                continue;
+            }
+            if (in_wave == BATCH_WAVE_FRAMES) {
+                if (!finishBurst()) stats.drained = false;
+                _radio.startListening();
+                xSemaphoreGive(_spi_lock); // 等待期間讓 RX task 取出上行封包
+                delay(BATCH_WAVE_GAP_MS);
+                xSemaphoreTake(_spi_lock, portMAX_DELAY);
+                _radio.stopListening();
+                _radio.openWritingPipe(command_pipe);
+                in_wave = 0;
+            }
+            if (_radio.writeFast(buffer, len, true)) { // multicast = NO_ACK
+                stats.frames++;
+                stats.bytes += len;
+            } else {
+                stats.failed++;
+            }
+            in_wave++;
+        }
+    }
+    if (!finishBurst()) stats.drained = false;
+    _radio.startListening();
+    xSemaphoreGive(_spi_lock);
+    stats.elapsed_us = micros() - start_us;
+    _last_batch = stats;
+
+    if (count > 1) {
+        uint32_t elapsed = stats.elapsed_us > 0 ? stats.elapsed_us : 1;
+        Serial.printf("[Radio] Batch: %u frames (%lu bytes) in %lu us, %lu frames/s, %u failed%s\n",
+                      stats.frames, (unsigned long)stats.bytes, (unsigned long)stats.elapsed_us,
+                      (unsigned long)((uint64_t)stats.frames * 1000000UL / elapsed), stats.failed,
+                      stats.drained ? "" : ", TX FIFO not drained");
+    }
+    return stats.failed == 0 && stats.drained;
+}
+
+/**
+ * @brief 等待 writeFast 寫入的封包全部送出 (呼叫前需持有 _spi_lock)
+ */
+bool RadioModule::finishBurst() {
+    if (_radio.txStandBy(BATCH_STANDBY_TIMEOUT_MS)) return true;
+    _radio.flush_tx(); // FAILURE_HANDLING 逾時時 RF24 不會清除 FIFO
+    return false;
+}
+
+bool RadioModule::sendCommand(const Packet& packet, const std::vector<uint8_t>& slaves, unsigned long deadline_ms) {
+    Packet frame = packet;
+    frame.seq = _next_seq++;
+    frame.source = PROTOCOL_MASTER_ID;
+    frame.ack_requested = true;
+
+    // 只等待目標內的已知從機
+    TargetMask waiting;
+    for (uint8_t id : slaves) {
+        if (packet.targets.contains(id)) waiting.add(id);
+    }
+    if (waiting.isEmpty()) {
+        frame.ack_requested = false;
+        transmitFrame(frame);
+        return true;
+    }
+
+    if (deadline_ms == 0) deadline_ms = commandDeadlineMs(frame);
+    unsigned long start_time = millis();
+    _command_start_us = micros();
+    uint8_t attempts = 0;
+    while (!waiting.isEmpty() && millis() - start_time < deadline_ms) {
+        serviceHop(); // 【新增】: 從機已依公告切換，之後的重送改在新頻道上
+        if (attempts > 0) {
+            frame.targets = waiting; // 重送時只針對尚未確認的從機，封包也會更短
+        }
+        transmitFrame(frame);
+        attempts++;
+        unsigned long sent_time = millis();
+        if (UPLINK_POLLING) {
+            // 【新增】: 已在輪詢中的從機把 CMD_ACK 放進 ACK payload，由主機逐一取回。
+            // 一輪超過 POLL_SWEEP_MS 就先重送，沒收到指令的從機不必等到所有從機都被輪詢過
+            delay(POLL_PRELOAD_MS);
+            for (uint8_t id : slaves) {
+                if (!waiting.contains(id) || !mayBePolling(id)) continue;
+                if (millis() - start_time >= deadline_ms || millis() - sent_time >= POLL_SWEEP_MS) break;
+                serviceHop();
+                pollSlave(id);
+                while (takeAck(frame.seq, waiting)) {}
+            }
+        }
+        // 其餘從機 (尚未被輪詢，如剛加入者) 依排序 (ALL 時為時槽) 每隔 ACK_SPACING_US 自行回覆
+        bool self_acking = false;
+        for (uint8_t id : slaves) {
+            if (waiting.contains(id) && !(UPLINK_POLLING && mayBePolling(id))) self_acking = true;
+        }
+        if (!self_acking) continue;
+        uint16_t ranks = frame.targets.isAll() ? _slot_count : frame.targets.count();
+        unsigned long ack_window_ms = COMMAND_RETRY_INTERVAL_MS + (ranks * ACK_SPACING_US) / 1000;
+        while (!waiting.isEmpty() && millis() - sent_time < ack_window_ms) {
+            if (serviceHop()) break; // 舊頻道上的 ACK 不會再來，直接在新頻道重送
+            collectAcks(frame.seq, waiting);
+        }
+    }
+
+    // 【新增】: 指令常會引起回覆 (如讀卡結果)，目標從機取消輪詢退避
+    if (UPLINK_POLLING) {
+        for (uint8_t id : slaves) {
+            if (packet.targets.contains(id)) pollSoon(id);
+        }
+    }
+
+    if (!waiting.isEmpty()) {
+        Serial.printf("[Radio] %s (seq=%u) missing ACK after %u tries from:", protocolOpcodeName(frame.opcode), frame.seq, attempts);
+        for (uint8_t id : slaves) {
+            if (waiting.contains(id)) Serial.printf(" #%d", id);
+        }
+        Serial.println();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 【新增】: sendCommand 的預設時限。每次嘗試的 ACK 視窗隨目標數 (ALL 時為時槽數) 變長，
+ * 時限至少容納 COMMAND_MIN_ATTEMPTS 次完整嘗試，固定時限在 50 台從機時只夠 3 次
+ */
+unsigned long RadioModule::commandDeadlineMs(const Packet& frame) const {
+    uint16_t ranks = frame.targets.isAll() ? _slot_count : frame.targets.count();
+    unsigned long attempt_ms = COMMAND_RETRY_INTERVAL_MS + (ranks * ACK_SPACING_US) / 1000;
+    if (UPLINK_POLLING) attempt_ms += POLL_PRELOAD_MS + POLL_SWEEP_MS;
+    unsigned long deadline_ms = COMMAND_MIN_ATTEMPTS * attempt_ms;
+    return deadline_ms > COMMAND_DEADLINE_MS ? deadline_ms : COMMAND_DEADLINE_MS;
+}
+
+void RadioModule::setSlotCount(uint8_t slot_count) {
+    _slot_count = slot_count > 0 ? slot_count : 1;
+}
+
+// 【新增】: 時槽同步信標。從機以收到信標的時間為超框 (superframe) 起點
+void RadioModule::sendSyncBeacon() {
+    Packet beacon(OP_SYNC);
+    uint8_t timing[2] = { _slot_count, SLOT_MS };
+    beacon.setPayload(timing, sizeof(timing));
+    beacon.seq = _next_seq++;
+    transmitFrame(beacon);
 }
 
-// 【新增】: 廣播字串封包的函式
-bool RadioModule::broadcastPacket(const String& packet, int burst_count) {
+void RadioModule::transmitFrame(const Packet& frame) {
+    uint8_t buffer[PROTOCOL_MAX_FRAME];
+    uint8_t len = encodePacket(frame, buffer, sizeof(buffer));
+    if (len == 0) {
+        Serial.printf("[Radio] ERROR: cannot encode %s packet (too many targets or payload too long)\n", protocolOpcodeName(frame.opcode));
+        return;
+    }
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
     _radio.stopListening();
     _radio.openWritingPipe(command_pipe);
-    bool success = false;
-    char buffer[32];
-    packet.toCharArray(buffer, sizeof(buffer));
+    _radio.write(buffer, len, true); // multicast = NO_ACK, 不做硬體重送
+    _radio.startListening();
+    xSemaphoreGive(_spi_lock);
+}
 
-    for (int i = 0; i < burst_count; ++i) {
-        if (_radio.write(&buffer, sizeof(buffer))) {
-            success = true;
+void RadioModule::collectAcks(uint8_t seq, TargetMask& waiting) {
+    if (!takeAck(seq, waiting)) {
+        delay(1); // 讓出 CPU，ACK 由 RX task 放入 ring
+    }
+}
+
+/**
+ * @brief 從 ring 取出一個封包：符合 seq 的 CMD_ACK 從 waiting 移除，其他封包暫存
+ * @return ring 為空 (或暫存已滿) 時回傳 false
+ */
+bool RadioModule::takeAck(uint8_t seq, TargetMask& waiting) {
+    // 暫存已滿時不再取出，封包留在 ring 中；ring 也滿時由 RX task 計入 rxOverflowCount()
+    if (_pending_count >= PENDING_QUEUE_SIZE) return false;
+    Packet packet;
+    if (!popReceived(packet)) return false;
+    if (packet.opcode == OP_CMD_ACK) {
+        if (packet.payload_len >= 1 && packet.payload[0] == seq && waiting.contains(packet.source)) {
+            waiting.remove(packet.source);
+            _telemetry.recordRtt(packet.source, micros() - _command_start_us);
         }
-        delay(5);
+        return true; // 舊指令的遲到 ACK 直接丟棄
     }
+    queueResponse(packet);
+    return true;
+}
+
+/**
+ * @brief 【新增】: 輪詢一台從機。從機預先放好的上行封包隨硬體 ACK 一起回來，
+ * 直接在此解碼放入 ring (之後由 listenForResponse 取出)
+ * @return 從機是否回覆 ACK
+ */
+bool RadioModule::pollSlave(uint8_t id) {
+    uint8_t address[5];
+    protocolPollAddress(id, command_pipe, address);
+    Packet poll(OP_POLL, TargetMask::single(id));
+    poll.source = PROTOCOL_MASTER_ID;
+    uint8_t buffer[PROTOCOL_MAX_FRAME];
+    uint8_t len = encodePacket(poll, buffer, sizeof(buffer));
+
+    bool was_ready = _poll_ready.contains(id);
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
+    _radio.stopListening();
+    _radio.openWritingPipe(address);
+    bool acked = _radio.write(buffer, len);
+    uint8_t retransmits = acked ? _radio.getARC() : POLL_RETRY_COUNT;
+    uint8_t received = acked ? drainRxFifo() : 0;
     _radio.startListening();
-    return success;
+    xSemaphoreGive(_spi_lock);
+
+    _telemetry.recordPoll(id, acked, acked ? retransmits : 0);
+    // 鏈路品質只計入應答中的從機 (離線的從機第一次失敗後就不再計入)
+    if (acked || was_ready) {
+        _link_polls++;
+        _link_retransmits += retransmits;
+    }
+    if (acked || was_ready) _poll_seen[id] = millis();
+    if (acked) _poll_ready.add(id);
+    else _poll_ready.remove(id);
+
+    // 【新增】: 取回封包表示可能還有排隊中的上行，儘快再輪詢；空輪詢 (或沒回應) 則間隔加倍
+    unsigned long backoff = _poll_backoff[id] > 0 ? _poll_backoff[id] : POLL_INTERVAL_MS;
+    if (received > 0) backoff = POLL_INTERVAL_MS;
+    else backoff = backoff * 2 < POLL_IDLE_MAX_MS ? backoff * 2 : POLL_IDLE_MAX_MS;
+    _poll_backoff[id] = backoff;
+    _poll_due[id] = millis() + backoff;
+    return acked;
+}
+
+void RadioModule::pollSoon(uint8_t id) {
+    _poll_backoff[id] = POLL_INTERVAL_MS;
+    _poll_due[id] = millis();
+}
+
+/**
+ * @brief 【新增】: 從機是否可能仍在輪詢模式。輪詢失敗可能只是 ACK 遺失，從機其實收到了，
+ * 在 POLL_TIMEOUT_MS 內仍只預載 CMD_ACK、不會自行回覆，sendCommand 必須繼續輪詢它
+ */
+bool RadioModule::mayBePolling(uint8_t id) const {
+    return _poll_ready.contains(id) || millis() - _poll_seen[id] < POLL_TIMEOUT_MS;
+}
+
+/**
+ * @brief 每 POLL_INTERVAL_MS 依序輪詢下一台到期的從機 (由 loop 呼叫，每次最多一台)
+ * 【更新】: 閒置的從機依 _poll_backoff 退避，沒有從機到期時不輪詢
+ */
+void RadioModule::pollNext(const std::vector<uint8_t>& slaves) {
+    if (slaves.empty() || millis() - _last_poll_time < POLL_INTERVAL_MS) return;
+    unsigned long now = millis();
+    for (size_t n = 0; n < slaves.size(); n++) {
+        if (_poll_index >= slaves.size()) _poll_index = 0;
+        uint8_t id = slaves[_poll_index++];
+        if ((long)(now - _poll_due[id]) < 0) continue;
+        pollSlave(id);
+        _last_poll_time = millis();
+        return;
+    }
+}
+
+void RadioModule::takeLinkStats(uint32_t& polls, uint32_t& retransmits) {
+    polls = _link_polls;
+    retransmits = _link_retransmits;
+    _link_polls = 0;
+    _link_retransmits = 0;
+}
+
+void RadioModule::setRfChannel(uint8_t channel, uint8_t data_rate) {
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
+    _radio.stopListening();
+    _radio.setChannel(channel);
+    _radio.setDataRate((rf24_datarate_e)data_rate);
+    _radio.startListening();
+    xSemaphoreGive(_spi_lock);
+    _channel = channel;
+    _data_rate = data_rate;
+}
+
+/**
+ * @brief 【新增】: 非阻塞頻道掃描的一步 (與內附 scanner 範例相同的 RPD 量測，但一次只量一個頻道)
+ * @return 停留期間頻道上有 -64 dBm 以上的訊號
+ */
+bool RadioModule::sampleChannel(uint8_t channel) {
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
+    _radio.stopListening();
+    _radio.setChannel(channel);
+    _radio.startListening();
+    delayMicroseconds(SCAN_DWELL_US);
+    bool busy = _radio.testRPD();
+    _radio.stopListening();
+    _radio.setChannel(_channel);
+    _radio.startListening();
+    xSemaphoreGive(_spi_lock);
+    return busy;
+}
+
+void RadioModule::announceHop(uint8_t channel, uint8_t data_rate, uint16_t switch_in_ms, uint8_t copies) {
+    Packet hop(OP_HOP);
+    encodeHop(hop, channel, data_rate, switch_in_ms);
+    broadcastPacket(hop, copies);
+}
+
+void RadioModule::scheduleHop(uint8_t channel, uint8_t data_rate, unsigned long switch_in_ms) {
+    _hop_pending = true;
+    _hop_channel = channel;
+    _hop_rate = data_rate;
+    _hop_time = millis() + switch_in_ms;
+}
+
+bool RadioModule::serviceHop() {
+    if (!_hop_pending || (long)(millis() - _hop_time) < 0) return false;
+    _hop_pending = false;
+    setRfChannel(_hop_channel, _hop_rate);
+    _link_polls = 0; // 舊頻道的統計不適用於新頻道
+    _link_retransmits = 0;
+    return true;
+}
+
+void RadioModule::sendRendezvousBeacon() {
+    uint8_t channel = _channel;
+    uint8_t data_rate = _data_rate;
+    setRfChannel(RENDEZVOUS_CHANNEL, HOP_RATE_1MBPS);
+    announceHop(channel, data_rate, 0, RENDEZVOUS_COPIES);
+    setRfChannel(channel, data_rate);
+}
+
+// 呼叫前 takeAck 已確認暫存還有空間
+void RadioModule::queueResponse(const Packet& packet) {
+    _pending[(_pending_head + _pending_count) % PENDING_QUEUE_SIZE] = packet;
+    _pending_count++;
 }
 
 void RadioModule::switchToDiscoveryMode() {
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
     _radio.stopListening();
     _radio.openReadingPipe(1, discovery_pipe);
     _radio.flush_rx();
     _radio.flush_tx();
     _radio.startListening();
+    xSemaphoreGive(_spi_lock);
+    _rx_ring.clear();
+    _poll_ready.clear(); // Discovery 期間不輪詢，從機會退回自行傳送
     Serial.println("[Radio] Switched to Discovery Mode. Listening on DISC1.");
 }
 
 bool RadioModule::listenForDiscovery(uint8_t& deviceId) {
-    if (_radio.available()) {
-        _radio.read(&deviceId, sizeof(deviceId));
-        return true;
+    Packet packet;
+    while (popReceived(packet)) {
+        if (packet.opcode == OP_JOIN_REQUEST) {
+            deviceId = packet.source;
+            return true;
+        }
     }
     return false;
 }
 
+// 【更新】: 所有從機共用 UPLNK 位址，不再受限於 5 個 pipe；發送者由封包 source 欄位辨識
 void RadioModule::switchToOperationMode(const std::vector<uint8_t>& devices) {
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
     _radio.stopListening();
-    Serial.print("[Radio] Switched to Operation Mode. Listening on pipes: ");
-    for (size_t i = 0; i < devices.size(); ++i) {
-        if (i < 5) { // RF24 library supports up to 6 pipes (0-5), pipe 0 is for writing.
-            char pipe_str[6];
-            sprintf(pipe_str, "%dNODE", devices[i]);
-            _radio.openReadingPipe(i + 1, (const uint8_t*)pipe_str);
-            Serial.print(pipe_str); Serial.print(" ");
-        }
-    }
-    Serial.println();
+    _radio.openReadingPipe(1, uplink_pipe);
+    _radio.flush_rx();
     _radio.startListening();
+    xSemaphoreGive(_spi_lock);
+    _rx_ring.clear();
+    Serial.printf("[Radio] Switched to Operation Mode. Listening on UPLNK for %u devices.\n", (unsigned)devices.size());
 }
 
-bool RadioModule::listenForResponse(String& payload, uint8_t& pipeNum) {
-    if (_radio.available(&pipeNum)) {
-        char buffer[32] = "";
-        _radio.read(&buffer, sizeof(buffer));
-        payload = String(buffer);
+bool RadioModule::listenForResponse(Packet& packet) {
+    if (_pending_count > 0) {
+        packet = _pending[_pending_head];
+        _pending_head = (_pending_head + 1) % PENDING_QUEUE_SIZE;
+        _pending_count--;
         return true;
     }
-    return false;
+    return popReceived(packet);
 }
 
 void RadioModule::flush() {
+    xSemaphoreTake(_spi_lock, portMAX_DELAY);
     _radio.flush_rx();
     _radio.flush_tx();
+    xSemaphoreGive(_spi_lock);
+    _rx_ring.clear();
+    _pending_head = 0;
+    _pending_count = 0;
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include <Arduino.h>
 #include <RF24.h>
 #include <vector>
+#include "Protocol.h"
+#include "PacketRing.h"
+#include "LinkTelemetry.h"
+#include "Config.h"
 
 class RadioModule {
 public:
@@ -11,8 +15,27 @@ public:
     void begin(uint8_t ce, uint8_t csn);
     void powerUp();
 
-    // 【更新】: 使用新的封包格式廣播指令
-    bool broadcastPacket(const String& packet, int burst_count = 5);
+    // 【更新】: 盲目廣播 (無 ACK，同一序號送 burst_count 次，從機會自行去重)
+    // 只用於從機還無法回覆的發現模式
+    bool broadcastPacket(const Packet& packet, int burst_count = 3);
+
+    // 【新增】: 批次傳送。count 個封包 (各自一個序號，每個送 copies 份) 以 writeFast 連續寫入
+    // 3 層 TX FIFO，每一波以 txStandBy 等待送出。無 ACK，用於一次推送整份名單等大量指令
+    struct BatchStats {
+        uint16_t frames;          // 成功寫入 FIFO 的封包數 (含副本)
+        uint16_t failed;          // 無法編碼或 writeFast 逾時的封包數
+        uint32_t bytes;
+        uint32_t elapsed_us;
+        bool drained;             // txStandBy 是否在時限內送完
+    };
+    bool sendBatch(const Packet* packets, uint8_t count, uint8_t copies = BATCH_COPIES);
+    const BatchStats& lastBatch() const { return _last_batch; }
+
+    // 【新增】: 可靠傳送。送出後等待 slaves 中屬於目標的從機回覆 OP_CMD_ACK，
+    // 只對尚未確認的從機重送，直到全部確認或超過 deadline_ms
+    // 【更新】: deadline_ms 為 0 時依目標數計算 (見 commandDeadlineMs)
+    bool sendCommand(const Packet& packet, const std::vector<uint8_t>& slaves,
+                     unsigned long deadline_ms = 0);
     
     // 發現模式相關函式
     void switchToDiscoveryMode();
@@ -20,10 +43,95 @@ public:
 
     // 操作模式相關函式
     void switchToOperationMode(const std::vector<uint8_t>& devices);
-    bool listenForResponse(String& payload, uint8_t& pipeNum);
+    bool listenForResponse(Packet& packet);
+
+    // 上行 TDMA: 目前使用中的時槽數 (含保留給信標的時槽 0)
+    void setSlotCount(uint8_t slot_count);
+    void sendSyncBeacon();
+
+    // 【新增】: 輪詢上行 (UPLINK_POLLING)。從機的上行封包以 ACK payload 回到主機
+    bool pollSlave(uint8_t id);
+    void pollNext(const std::vector<uint8_t>& slaves);
+    // 【新增】: 從機有新動靜 (收到指令等)，取消退避，下次 pollNext 就輪詢它
+    void pollSoon(uint8_t id);
+    // 自上次呼叫以來的輪詢次數與硬體重送次數 (呼叫後歸零)，用於判斷鏈路品質
+    void takeLinkStats(uint32_t& polls, uint32_t& retransmits);
+
+    // 【新增】: 跳頻。工作頻道與速率 (data_rate 為 rf24_datarate_e 的值)
+    void setRfChannel(uint8_t channel, uint8_t data_rate);
+    uint8_t rfChannel() const { return _channel; }
+    uint8_t dataRate() const { return _data_rate; }
+    // 短暫切到 channel 量測 RPD (-64 dBm 以上的訊號) 後回到工作頻道
+    bool sampleChannel(uint8_t channel);
+    // 在工作頻道上廣播 OP_HOP
+    void announceHop(uint8_t channel, uint8_t data_rate, uint16_t switch_in_ms, uint8_t copies = 1);
+    // 切到會合頻道廣播目前的工作頻道 (switch_in_ms = 0)，給錯過公告的從機
+    void sendRendezvousBeacon();
+    // 【新增】: 排定 switch_in_ms 後切到新頻道。時間到時由 serviceHop() 切換，sendCommand 的等待迴圈
+    // 也會呼叫，連續的長指令不會讓主機在從機切換後還留在舊頻道
+    void scheduleHop(uint8_t channel, uint8_t data_rate, unsigned long switch_in_ms);
+    void cancelHop() { _hop_pending = false; }
+    bool hopPending() const { return _hop_pending; }
+    // 排定的切換時間已到則切換頻道並回傳 true
+    bool serviceHop();
 
     void flush();
 
+    // RX ring 溢位 (loop 來不及取出) 而丟棄的封包數
+    uint32_t rxOverflowCount() const { return _rx_overflows; }
+
+    // 【新增】: 每台從機的輪詢 ARC、往返時間與從機回報的統計
+    LinkTelemetry& telemetry() { return _telemetry; }
+
 private:
+    static void IRAM_ATTR onIrq();
+    static void rxTaskEntry(void* arg);
+    void rxTask();
+    bool popReceived(Packet& packet);
+
+    void transmitFrame(const Packet& frame);
+    bool finishBurst();
+    unsigned long commandDeadlineMs(const Packet& frame) const;
+    bool mayBePolling(uint8_t id) const;
+    void collectAcks(uint8_t seq, TargetMask& waiting);
+    bool takeAck(uint8_t seq, TargetMask& waiting);
+    uint8_t drainRxFifo();
+    void queueResponse(const Packet& packet);
+
     RF24 _radio;
+    uint8_t _next_seq;
+    uint8_t _slot_count;
+    size_t _poll_index;
+    unsigned long _last_poll_time;
+    TargetMask _poll_ready;   // 最近一次輪詢有回 ACK 的從機 (已改用 ACK payload 上行)
+    unsigned long _poll_seen[256]; // 【新增】: 各從機最近一次可能收到輪詢的時間 (見 mayBePolling)
+    unsigned long _poll_due[256];     // 【新增】: 各從機下次該被 pollNext 輪詢的時間
+    unsigned long _poll_backoff[256]; // 【新增】: 各從機目前的輪詢間隔 (0 = POLL_INTERVAL_MS)
+    uint32_t _link_polls;
+    uint32_t _link_retransmits;
+    uint8_t _channel;
+    uint8_t _data_rate;
+    bool _hop_pending;            // 【新增】: scheduleHop 排定的切換 (見 serviceHop)
+    uint8_t _hop_channel;
+    uint8_t _hop_rate;
+    unsigned long _hop_time;
+    BatchStats _last_batch;
+    LinkTelemetry _telemetry;
+    uint32_t _command_start_us;   // sendCommand 第一次送出的時間 (計算往返時間)
+
+    // 等待 ACK 期間收到的其他封包 (心跳、讀卡結果) 暫存於此，由 listenForResponse 依序取出
+    // 【更新】: 對全體的指令 (如 TESTPIPE) 每台從機都會回覆，另加心跳，因此容量為 2 x MAX_SLOTS
+    static const uint8_t PENDING_QUEUE_SIZE = 2 * MAX_SLOTS;
+    Packet _pending[PENDING_QUEUE_SIZE];
+    uint8_t _pending_head;
+    uint8_t _pending_count;
+
+    // 【新增】: IRQ 驅動的接收路徑
+    // IRQ -> 通知 RX task -> 清空 nRF24 FIFO -> 解碼後放入無鎖 ring -> loop 取出
+    // 所有 SPI 操作 (RX task 與 loop 的傳送) 以 _spi_lock 互斥
+    static RadioModule* _instance;
+    TaskHandle_t _rx_task_handle;
+    SemaphoreHandle_t _spi_lock;
+    PacketRing<Packet, RX_RING_SIZE> _rx_ring;
+    volatile uint32_t _rx_overflows;
 };
\ No newline at end of file
@@ -0,0 +1,173 @@
+// TeamBuildingGameMode.cpp
+
+#include "TeamBuildingGameMode.h"
+
+TeamBuildingGameMode::TeamBuildingGameMode()
+    : _radio(nullptr), _slaves(nullptr), _session(0), _phase(PHASE_FINISHED), _phase_start(0), _last_rearm(0),
+      _player_count(0), _team_count(0), _complete_teams(0) {}
+
+void TeamBuildingGameMode::start(RadioModule& radio, std::vector<uint8_t>& slaves) {
+    _radio = &radio;
+    _slaves = &slaves;
+    _session = newSessionToken();
+    _player_count = 0;
+    for (uint8_t id : slaves) {
+        if (_player_count >= MAX_GAME_PLAYERS) break;
+        _players[_player_count++] = id;
+    }
+    if (_player_count < 2) {
+        Serial.println("[GAME] Not enough players for team building.");
+        _phase = PHASE_FINISHED;
+        return;
+    }
+    for (int i = _player_count - 1; i > 0; --i) {
+        int j = random(i + 1);
+        uint8_t tmp = _players[i];
+        _players[i] = _players[j];
+        _players[j] = tmp;
+    }
+
+    // 輪流分配，各隊人數最多差 1；每隊第一個分到的人當隊長
+    _team_count = (_player_count + TEAM_SIZE - 1) / TEAM_SIZE;
+    _complete_teams = 0;
+    for (uint8_t t = 0; t < _team_count; ++t) {
+        _team_size[t] = 0;
+        _team_joined[t] = 1;
+        _rearm[t] = false;
+    }
+    TargetMask captains;
+    TargetMask members;
+    for (uint8_t i = 0; i < _player_count; ++i) {
+        uint8_t team = i % _team_count;
+        _team_of[i] = team;
+        _team_size[team]++;
+        _recruited[i] = i < _team_count;
+        if (_recruited[i]) {
+            _captains[team] = _players[i];
+            captains.add(_players[i]);
+        } else {
+            members.add(_players[i]);
+        }
+    }
+
+    Serial.printf("[GAME] Team building: %u teams\n", _team_count);
+    for (uint8_t t = 0; t < _team_count; ++t) {
+        Serial.printf("[GAME]   Team %u: captain #%d, members:", t + 1, _captains[t]);
+        for (uint8_t i = 0; i < _player_count; ++i) {
+            if (_team_of[i] == t && !_recruited[i]) Serial.printf(" #%d", _players[i]);
+        }
+        Serial.println();
+    }
+    _radio->sendCommand(sessionCommand(OP_EMULATE, members, _session), *_slaves);
+    _radio->sendCommand(sessionCommand(OP_READ, captains, _session), *_slaves);
+    _phase = PHASE_BUILDING;
+    _phase_start = millis();
+    _last_rearm = _phase_start;
+}
+
+void TeamBuildingGameMode::update() {
+    unsigned long now = millis();
+    switch (_phase) {
+        case PHASE_BUILDING:
+            if (now - _phase_start >= TEAM_BUILDING_TIMEOUT_MS) {
+                Serial.printf("[GAME] Team building timed out: %u/%u teams complete\n", _complete_teams, _team_count);
+                _phase = PHASE_FINISHED;
+                break;
+            }
+            if (now - _last_rearm >= TEAM_EMULATE_REARM_MS) {
+                // 從機的模擬模式有時限，還沒被找到的隊員要重新指派
+                TargetMask pending = pendingMembers();
+                if (!pending.isEmpty()) _radio->sendCommand(sessionCommand(OP_EMULATE, pending, _session), *_slaves);
+                _last_rearm = now;
+            }
+            rearmCaptains();
+            break;
+        case PHASE_FINALE:
+            if (now - _phase_start >= GAME_FINALE_MS) _phase = PHASE_FINISHED;
+            break;
+        case PHASE_FINISHED:
+            break;
+    }
+}
+
+bool TeamBuildingGameMode::handlePacket(const Packet& packet, uint8_t sender_id, Packet& reply) {
+    if (_phase != PHASE_BUILDING) return false;
+    int8_t team = teamOfCaptain(sender_id);
+    if (team < 0 || _team_joined[team] == _team_size[team]) return false;
+
+    if (packet.opcode != OP_ENCOUNTER && packet.opcode != OP_READ_RESULT && packet.opcode != OP_READ_TIMEOUT) return false;
+    // 從機讀到卡片或逾時後都會回到待機；隊伍未到齊前隊長稍後繼續讀卡
+    _rearm[team] = true;
+    _rearm_at[team] = millis() + GAME_REARM_DELAY_MS;
+    if (packet.opcode == OP_READ_TIMEOUT) return false;
+
+    uint32_t latency_us = 0;
+    uint8_t tagged = encounteredPeer(packet, _session, latency_us);
+    int8_t index = tagged ? playerIndex(tagged) : -1;
+    if (index < 0 || _team_of[index] != team || _recruited[index]) {
+        Serial.printf("[GAME] Team %d: captain #%d read #%d, not a missing team member\n", team + 1, sender_id, tagged);
+        return false;
+    }
+
+    _recruited[index] = true;
+    _team_joined[team]++;
+    Serial.printf("[GAME] Team %d: captain #%d recruited #%d (%u/%u)\n", team + 1, sender_id, tagged,
+                  _team_joined[team], _team_size[team]);
+    if (_team_joined[team] < _team_size[team]) {
+        reply = Packet(OP_TEAM_WAIT, TargetMask::single(tagged));
+        return true;
+    }
+
+    _rearm[team] = false;
+    _complete_teams++;
+    Serial.printf("[GAME] Team %d complete! (%u/%u teams)\n", team + 1, _complete_teams, _team_count);
+    if (_complete_teams == _team_count) {
+        Serial.println("[GAME] All teams complete.");
+        _phase = PHASE_FINALE;
+        _phase_start = millis();
+    }
+    reply = Packet(OP_SPOTLIGHT, teamMask(team));
+    return true;
+}
+
+void TeamBuildingGameMode::rearmCaptains() {
+    unsigned long now = millis();
+    TargetMask captains;
+    for (uint8_t t = 0; t < _team_count; ++t) {
+        if (!_rearm[t] || (long)(now - _rearm_at[t]) < 0) continue;
+        _rearm[t] = false;
+        captains.add(_captains[t]);
+    }
+    if (!captains.isEmpty()) _radio->sendCommand(sessionCommand(OP_READ, captains, _session), *_slaves);
+}
+
+int8_t TeamBuildingGameMode::playerIndex(uint8_t id) const {
+    if (id == 0) return -1;
+    for (uint8_t i = 0; i < _player_count; ++i) {
+        if (_players[i] == id) return i;
+    }
+    return -1;
+}
+
+int8_t TeamBuildingGameMode::teamOfCaptain(uint8_t id) const {
+    for (uint8_t t = 0; t < _team_count; ++t) {
+        if (_captains[t] == id) return t;
+    }
+    return -1;
+}
+
+TargetMask TeamBuildingGameMode::teamMask(uint8_t team) const {
+    TargetMask mask;
+    for (uint8_t i = 0; i < _player_count; ++i) {
+        if (_team_of[i] == team) mask.add(_players[i]);
+    }
+    return mask;
+}
+
+TargetMask TeamBuildingGameMode::pendingMembers() const {
+    TargetMask mask;
+    for (uint8_t i = 0; i < _player_count; ++i) {
+        if (!_recruited[i]) mask.add(_players[i]);
+    }
+    return mask;
+}
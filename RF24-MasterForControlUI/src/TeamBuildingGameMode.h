@@ -0,0 +1,51 @@
+// TeamBuildingGameMode.h
+
+#pragma once
+#include "IGameMode.h"
+#include "Config.h"
+
+/**
+ * @brief 【新增】: 組隊遊戲 (*SCENARIO1_START#)。隨機分成每隊 TEAM_SIZE 台，
+ * 隊長讀卡 (READ_)、其餘隊員被感應 (EMULATE_)。隊長讀到自己隊員的卡片後，
+ * 該隊員亮黃燈 (SETCOLOR_YELLOW_) 等待；整隊到齊時全隊亮彩虹燈 (SETCOLOR_RAINBOW_)。
+ */
+class TeamBuildingGameMode : public IGameMode {
+public:
+    TeamBuildingGameMode();
+
+    void start(RadioModule& radio, std::vector<uint8_t>& slaves) override;
+    void update() override;
+    bool handlePacket(const Packet& packet, uint8_t sender_id, Packet& reply) override;
+    bool isFinished() override { return _phase == PHASE_FINISHED; }
+
+private:
+    enum Phase : uint8_t { PHASE_BUILDING, PHASE_FINALE, PHASE_FINISHED };
+
+    static const uint8_t MAX_TEAMS = (MAX_GAME_PLAYERS + TEAM_SIZE - 1) / TEAM_SIZE;
+
+    int8_t playerIndex(uint8_t id) const;
+    int8_t teamOfCaptain(uint8_t id) const;
+    TargetMask teamMask(uint8_t team) const;
+    TargetMask pendingMembers() const;
+    void rearmCaptains();
+
+    RadioModule* _radio;
+    std::vector<uint8_t>* _slaves;
+    uint16_t _session;
+    Phase _phase;
+    unsigned long _phase_start;
+    unsigned long _last_rearm;
+
+    uint8_t _players[MAX_GAME_PLAYERS];
+    uint8_t _team_of[MAX_GAME_PLAYERS];
+    bool _recruited[MAX_GAME_PLAYERS];      // 隊長一開始就算已到齊
+    uint8_t _player_count;
+
+    uint8_t _captains[MAX_TEAMS];
+    uint8_t _team_size[MAX_TEAMS];
+    uint8_t _team_joined[MAX_TEAMS];
+    bool _rearm[MAX_TEAMS];                 // 隊長需在 _rearm_at 之後重新讀卡
+    unsigned long _rearm_at[MAX_TEAMS];
+    uint8_t _team_count;
+    uint8_t _complete_teams;
+};
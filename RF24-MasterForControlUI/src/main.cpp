@@ -9,7 +9,10 @@
 #include <map>
 #include "Config.h"
 #include "RadioModule.h"
+#include "ChannelManager.h"
+#include "Protocol.h"
 #include "IGameMode.h"
+#include "GameModeRegistry.h"
 #include "MasterLedModule.h"
 #include "MasterMatrixModule.h"
 
@@ -17,7 +20,9 @@
 // --- Global Objects & State ---
 std::map<uint8_t, unsigned long> slave_last_heartbeat;
 std::map<uint8_t, String> id_to_name;
+std::map<uint8_t, uint8_t> slave_slot;   // 加入時指派的上行 TDMA 時槽
 RadioModule radio;
+ChannelManager channels(radio);
 MasterLedModule masterLed;
 MasterMatrixModule masterMatrix;
 SystemMode current_mode = MODE_DISCOVERY;
@@ -27,6 +32,9 @@ IGameMode* currentGameMode = nullptr;
  
 
 unsigned long lastTimeoutCheckTime = 0;
+unsigned long lastSyncBeaconTime = 0;
+unsigned long lastLinkStatsTime = 0;
+uint32_t lastReportedRxOverflows = 0;
 const unsigned long SLAVE_TIMEOUT_MS = 30000;
 const unsigned long TIMEOUT_CHECK_INTERVAL_MS = 5000;
  
@@ -34,10 +42,40 @@ const unsigned long TIMEOUT_CHECK_INTERVAL_MS = 5000;
 void handleDiscoveryState();
 void processSerialCommand(const String& command);
 void checkSlaveTimeouts();
-void handleRadioPacket(const String& payload, uint8_t pipeNum);
+void handleRadioPacket(const Packet& packet);
+uint8_t assignSlot(uint8_t id);
+void releaseSlot(uint8_t id);
+void updateSlotCount();
+String describePacket(const Packet& packet);
+bool sendToSlaves(const Packet& packet);
+bool parseTargetList(const String& ids_str, TargetMask& targets);
+void sendRoster(const String& list);
+bool forwardSerialCommand(const String& command);
 void switchToIdleMode();
 void switchToDiscoveryMode();
 void removeSlave(uint8_t id_to_remove);
+void startGameMode(const GameModeEntry& game);
+
+// --- UI 文字指令 -> 無線 opcode 對照表 ---
+// UI 仍以 "*CMD_ID-ID#" 與主機溝通；主機在此轉換成二進位封包後再廣播
+struct SerialCommandMapping {
+    const char* prefix;
+    uint8_t opcode;
+};
+const SerialCommandMapping SERIAL_COMMAND_MAP[] = {
+    { "*STOP_",             OP_STOP },
+    { "*REMOVEJOIN_",       OP_REMOVE_JOIN },
+    { "*BLINK_WHITE_",      OP_BLINK_WHITE },
+    { "*TESTPIPE_",         OP_TEST_PIPE },
+    { "*READ_",             OP_READ },
+    { "*EMULATE_",          OP_EMULATE },
+    { "*SETCOLOR_YELLOW_",  OP_TEAM_WAIT },
+    { "*SETCOLOR_RAINBOW_", OP_SPOTLIGHT },
+    { "*SCORE_MODE_START",  OP_SCORE_START },
+    { "*SCORE_MODE_STOP",   OP_SCORE_STOP },
+    { "*COOLDOWN_START_",   OP_COOLDOWN_START },
+    { "*COOLDOWN_END_",     OP_COOLDOWN_END },
+};
 
 // Auto discovery scheduling
 static bool auto_discovery_started = false;
@@ -66,12 +104,30 @@ void loop() {
 
     if (current_mode != MODE_DISCOVERY) {
         checkSlaveTimeouts();
+        if (millis() - lastSyncBeaconTime >= SYNC_INTERVAL_MS) {
+            radio.sendSyncBeacon();
+            lastSyncBeaconTime = millis();
+        }
+        // 【新增】: 依序輪詢從機，取回預載在 ACK payload 中的心跳與讀卡結果
+        if (UPLINK_POLLING) {
+            radio.pollNext(discovered_slaves);
+        }
+        // 【新增】: 背景頻道掃描與跳頻
+        channels.update();
+        // 【新增】: 每台從機的鏈路統計
+        if (millis() - lastLinkStatsTime >= LINK_STATS_INTERVAL_MS) {
+            radio.telemetry().printFrames(discovered_slaves);
+            lastLinkStatsTime = millis();
+        }
     }
 
-    String payload;
-    uint8_t pipeNum;
-    if (radio.listenForResponse(payload, pipeNum)) {
-        handleRadioPacket(payload, pipeNum);
+    // 【更新】: 封包已由 RX task 在中斷後解碼放入 ring，這裡一次處理完所有已收到的封包
+    // 【修改】: Discovery 模式下 ring 裡的 JOIN 留給 handleDiscoveryState() 處理
+    if (current_mode != MODE_DISCOVERY) {
+        Packet packet;
+        while (radio.listenForResponse(packet)) {
+            handleRadioPacket(packet);
+        }
     }
  
     if (Serial.available() > 0) {
@@ -99,7 +155,7 @@ void loop() {
             if (currentGameMode) {
                 currentGameMode->update();
                 if (currentGameMode->isFinished()) {
-                    radio.broadcastPacket("*STOP_ALL#");
+                    sendToSlaves(Packet(OP_STOP));
                     delay(100);
                     switchToIdleMode();
                 }
@@ -110,28 +166,38 @@ void loop() {
     }
 }
 
-void handleRadioPacket(const String& payload, uint8_t pipeNum) {
-    if (pipeNum <= 0 || pipeNum > discovered_slaves.size()) return;
-    uint8_t sender_id = discovered_slaves[pipeNum - 1];
-    if (payload.startsWith("*HEARTBEAT_")) {
+void handleRadioPacket(const Packet& packet) {
+    // 【更新】: 依封包內的 source ID 辨識發送者 (共用上行位址，不再依 pipe 編號)
+    uint8_t sender_id = packet.source;
+    if (std::find(discovered_slaves.begin(), discovered_slaves.end(), sender_id) == discovered_slaves.end()) {
+        Serial.printf("[WARN] Packet %s from unknown ID %d ignored.\n", protocolOpcodeName(packet.opcode), sender_id);
+        return;
+    }
+    if (packet.opcode == OP_HEARTBEAT) {
         slave_last_heartbeat[sender_id] = millis();
         String name = id_to_name.count(sender_id) ? id_to_name[sender_id] : String("");
         const char* mode_str = (current_mode == MODE_DISCOVERY) ? "MODE_DISCOVERY" : (current_mode == MODE_IDLE) ? "MODE_IDLE" : "MODE_GAME_RUNNING";
         Serial.printf("[debug] HB from ID=%d name=%s state=%s\n", sender_id, name.c_str(), mode_str);
         return; 
     }
-    Serial.printf(">>> [Radio RX] From #%d: [%s]\n", sender_id, payload.c_str());
+    if (packet.opcode == OP_LINK_STATS) {
+        LinkReport report;
+        slave_last_heartbeat[sender_id] = millis();
+        if (decodeLinkReport(packet, report)) radio.telemetry().recordReport(sender_id, report);
+        return;
+    }
+    Serial.printf(">>> [Radio RX] From #%d: [%s]\n", sender_id, describePacket(packet).c_str());
     switch(current_mode) {
         case MODE_IDLE:
-            if (payload.startsWith("Channel Test")) Serial.printf("   ↳ [PIPE TEST] OK!\n");
+            if (packet.opcode == OP_CHANNEL_TEST) Serial.printf("   ↳ [PIPE TEST] OK!\n");
             else Serial.printf("   ↳ [IDLE] Unsolicited packet.\n");
             break;
         case MODE_GAME_RUNNING:
             if (currentGameMode) {
-                String command_to_send = currentGameMode->handlePacket(payload, sender_id);
-                if (command_to_send.length() > 0) {
-                    Serial.printf("   ↳ [Game Logic] Broadcasting command: %s\n", command_to_send.c_str());
-                    radio.broadcastPacket(command_to_send, 3);
+                Packet reply;
+                if (currentGameMode->handlePacket(packet, sender_id, reply)) {
+                    Serial.printf("   ↳ [Game Logic] Broadcasting command: %s\n", protocolOpcodeName(reply.opcode));
+                    sendToSlaves(reply);
                 }
             }
             break;
@@ -139,6 +205,52 @@ void handleRadioPacket(const String& payload, uint8_t pipeNum) {
     }
 }
 
+/**
+ * @brief 送出指令給從機：發現模式下從機無法回覆 ACK，只能盲目廣播；
+ *        其他模式一律使用序號 + ACK 的可靠傳送
+ */
+bool sendToSlaves(const Packet& packet) {
+    if (current_mode == MODE_DISCOVERY) {
+        return radio.broadcastPacket(packet);
+    }
+    return radio.sendCommand(packet, discovered_slaves);
+}
+
+/**
+ * @brief 將上行封包轉成與舊字串格式相同的文字，方便 UI 與序列埠日誌閱讀
+ */
+String describePacket(const Packet& packet) {
+    switch (packet.opcode) {
+        case OP_READ_RESULT: {
+            uint8_t uid[READ_RESULT_MAX_UID];
+            uint8_t uid_len = 0;
+            uint32_t latency_us = 0;
+            if (!decodeReadResult(packet, uid, uid_len, latency_us)) return "Malformed READ_RESULT";
+            String text = "Read UID:";
+            for (uint8_t i = 0; i < uid_len; i++) {
+                if (uid[i] < 0x10) text += '0';
+                text += String(uid[i], HEX);
+            }
+            text.toUpperCase();
+            // 從機量測的 感應 -> 上行 延遲
+            text += " (tap->uplink " + String(latency_us) + " us)";
+            return text;
+        }
+        case OP_ENCOUNTER: {
+            PeerInfo peer;
+            uint32_t latency_us = 0;
+            if (!decodeEncounter(packet, peer, latency_us)) return "Malformed ENCOUNTER";
+            // 【新增】: 讀卡方已解析對方的 peer record，一個封包就包含雙方
+            return "Encounter #" + String(peer.device_id) + " (session " + String(peer.session_token, HEX) +
+                   ", score " + String(peer.score) + ", tap->uplink " + String(latency_us) + " us)";
+        }
+        case OP_READ_TIMEOUT:  return "Reader Timed Out";
+        case OP_EMULATOR_ACK:  return "Emulator Stopped ACK";
+        case OP_CHANNEL_TEST:  return "Channel Test from #" + String(packet.source);
+        default:               return protocolOpcodeName(packet.opcode);
+    }
+}
+
 void handleDiscoveryState() {
     uint8_t new_device_id = 0;
     if (radio.listenForDiscovery(new_device_id)) {
@@ -150,24 +262,28 @@ void handleDiscoveryState() {
         if (!is_already_known) {
             discovered_slaves.push_back(new_device_id);
             std::sort(discovered_slaves.begin(), discovered_slaves.end());
-            Serial.printf("[DISCOVERY] New slave joined! ID: %d. Total: %d\n", new_device_id, discovered_slaves.size());
+            Serial.printf("[DISCOVERY] New slave joined! ID: %d. Total: %u\n", new_device_id, (unsigned)discovered_slaves.size());
         } else {
             Serial.printf("[DISCOVERY] Known slave #%d re-confirmed its presence.\n", new_device_id);
         }
         slave_last_heartbeat[new_device_id] = millis();
-        char ack_cmd[2] = {(char)new_device_id, 0};
-        radio.broadcastPacket(String(ack_cmd), 3);
+        uint8_t slot = assignSlot(new_device_id);
+        if (slot == 0) {
+            Serial.printf("[DISCOVERY] WARN: no free uplink slot for #%d (max %d).\n", new_device_id, MAX_SLOTS - 1);
+        }
+        Packet join_ack(OP_JOIN_ACK, TargetMask::single(new_device_id));
+        join_ack.setPayload(&slot, 1);
+        radio.broadcastPacket(join_ack, 3);
         // 受信後は対象IDへ STOP を送って5秒点灯→消灯させ、IDLEへ
-        String stop_cmd = "*STOP_" + String(new_device_id) + "#";
-        radio.broadcastPacket(stop_cmd, 3);
+        radio.broadcastPacket(Packet(OP_STOP, TargetMask::single(new_device_id)), 3);
     }
 }
 
 void processSerialCommand(const String& command) {
     Serial.printf("[COMMAND] Received: %s\n", command.c_str());
-    else if (command == "*STOP_ALL#") {
+    if (command == "*STOP_ALL#") {
         Serial.println("====== EMERGENCY STOP received from UI! ======");
-        radio.broadcastPacket("*STOP_ALL#");
+        sendToSlaves(Packet(OP_STOP));
         delay(100); 
         switchToIdleMode();
     } 
@@ -181,14 +297,18 @@ void processSerialCommand(const String& command) {
             id_to_name[id] = name_part;
             Serial.printf("[debug] Register name: id=%u, name=%s\n", id, name_part.c_str());
             // NAME_ 自体をフォワード（子機側で自身の名前ログに使う）
-            radio.broadcastPacket(command, 3);
-            String blink_cmd = "*BLINK_WHITE_" + id_part + "#";
-            radio.broadcastPacket(blink_cmd, 3);
+            Packet name_packet(OP_NAME, TargetMask::single(id));
+            name_packet.setText(name_part.c_str());
+            sendToSlaves(name_packet);
+            sendToSlaves(Packet(OP_BLINK_WHITE, TargetMask::single(id)));
         }
     }
+    else if (command.startsWith("*ROSTER_")) {
+        sendRoster(command.substring(8, command.length() - 1));
+    }
     else if (command.startsWith("*REMOVEJOIN_")) {
         Serial.printf("[SYSTEM] Broadcasting kick command: %s\n", command.c_str());
-        radio.broadcastPacket(command);
+        forwardSerialCommand(command);
     }
     else if (command == "*DISCOVERY_01#") {
         switchToDiscoveryMode();
@@ -198,15 +318,113 @@ void processSerialCommand(const String& command) {
         switchToIdleMode();
         if (!discovered_slaves.empty()) {
             Serial.println("[SYSTEM] Broadcasting pipe test command to all slaves...");
-            radio.broadcastPacket("*TESTPIPE_ALL#");
+            sendToSlaves(Packet(OP_TEST_PIPE));
         }
     } 
-    else if (command == "*SCENARIO1_START#") {
-        Serial.println("[INFO] Scenario 1 not implemented yet.");
+    else if (const GameModeEntry* game = findGameMode(command)) {
+        startGameMode(*game);
+    }
+    else if (!forwardSerialCommand(command)) {
+        Serial.printf("[WARN] Unknown command: %s\n", command.c_str());
+    }
+}
+
+/**
+ * @brief 解析 "ALL" 或 "1-2-3" 形式的 ID 列表
+ */
+bool parseTargetList(const String& ids_str, TargetMask& targets) {
+    String ids = ids_str;
+    if (ids.startsWith("_")) ids = ids.substring(1);
+    targets.clear();
+    if (ids.length() == 0 || ids == "ALL") {
+        targets.setAll();
+        return true;
+    }
+    int current_pos = 0;
+    while (current_pos < (int)ids.length()) {
+        int separator_pos = ids.indexOf('-', current_pos);
+        if (separator_pos == -1) separator_pos = ids.length();
+        long id = ids.substring(current_pos, separator_pos).toInt();
+        if (id <= 0 || id > 255) return false;
+        targets.add((uint8_t)id);
+        current_pos = separator_pos + 1;
     }
-    else if (command == "*SCENARIO2_START#") {
-        Serial.println("[INFO] Scenario 2 not implemented yet.");
+    return !targets.isEmpty();
+}
+
+/**
+ * @brief 【新增】: 一次登錄多台從機的名稱 ("1=Alice;2=Bob;...")。
+ * 所有 OP_NAME 以一次批次傳送送出，不逐台等待 ACK，也不觸發 BLINK_WHITE
+ */
+void sendRoster(const String& list) {
+    static Packet names[MAX_SLOTS];
+    uint8_t count = 0;
+    int current_pos = 0;
+    while (current_pos < (int)list.length() && count < MAX_SLOTS) {
+        int separator_pos = list.indexOf(';', current_pos);
+        if (separator_pos == -1) separator_pos = list.length();
+        String entry = list.substring(current_pos, separator_pos);
+        current_pos = separator_pos + 1;
+        int eq_pos = entry.indexOf('=');
+        long id = eq_pos > 0 ? entry.substring(0, eq_pos).toInt() : 0;
+        if (id <= 0 || id > 255) continue;
+        String name = entry.substring(eq_pos + 1);
+        id_to_name[(uint8_t)id] = name;
+        names[count] = Packet(OP_NAME, TargetMask::single((uint8_t)id));
+        names[count].setText(name.c_str());
+        count++;
     }
+    Serial.printf("[debug] Register roster: %u names\n", count);
+    if (count > 0) radio.sendBatch(names, count);
+}
+
+/**
+ * @brief 依照 SERIAL_COMMAND_MAP 將 UI 的文字指令轉成二進位封包並廣播
+ * @return 若指令可辨識並已送出則回傳 true
+ */
+bool forwardSerialCommand(const String& command) {
+    for (const SerialCommandMapping& mapping : SERIAL_COMMAND_MAP) {
+        if (!command.startsWith(mapping.prefix)) continue;
+        String ids_str = command.substring(strlen(mapping.prefix), command.length() - 1);
+        TargetMask targets;
+        if (!parseTargetList(ids_str, targets)) {
+            Serial.printf("[WARN] Invalid target list in command: %s\n", command.c_str());
+            return false;
+        }
+        sendToSlaves(Packet(mapping.opcode, targets));
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 指派上行時槽 (已加入過的從機沿用原本的時槽)
+ * @return 時槽編號 1..MAX_SLOTS-1；0 表示已無空槽 (從機會退回非同步傳送)
+ */
+uint8_t assignSlot(uint8_t id) {
+    auto it = slave_slot.find(id);
+    if (it != slave_slot.end()) return it->second;
+    bool used[MAX_SLOTS] = { false };
+    for (auto const& [slave_id, slot] : slave_slot) used[slot] = true;
+    for (uint8_t slot = 1; slot < MAX_SLOTS; ++slot) {
+        if (!used[slot]) {
+            slave_slot[id] = slot;
+            updateSlotCount();
+            return slot;
+        }
+    }
+    return 0;
+}
+
+void releaseSlot(uint8_t id) {
+    slave_slot.erase(id);
+    updateSlotCount();
+}
+
+void updateSlotCount() {
+    uint8_t slot_count = 1;
+    for (auto const& [slave_id, slot] : slave_slot) slot_count = std::max<uint8_t>(slot_count, slot + 1);
+    radio.setSlotCount(slot_count);
 }
 
 void removeSlave(uint8_t id_to_remove) {
@@ -214,7 +432,9 @@ void removeSlave(uint8_t id_to_remove) {
     if (it != discovered_slaves.end()) {
         discovered_slaves.erase(it, discovered_slaves.end());
         slave_last_heartbeat.erase(id_to_remove);
-        Serial.printf("[SYSTEM] Device #%d removed. Total devices: %d\n", id_to_remove, discovered_slaves.size());
+        releaseSlot(id_to_remove);
+        radio.telemetry().forget(id_to_remove);
+        Serial.printf("[SYSTEM] Device #%d removed. Total devices: %u\n", id_to_remove, (unsigned)discovered_slaves.size());
         if(current_mode == MODE_GAME_RUNNING) {
             Serial.println("[SYSTEM] A device disconnected during the game. Returning to Idle.");
             switchToIdleMode(); 
@@ -238,33 +458,46 @@ void checkSlaveTimeouts() {
             // 仕様変更: タイムアウト時はログのみ残し、接続は維持する
             Serial.printf("[TIMEOUT] Slave #%d has timed out. Keeping connection (no removal).\n", id);
         }
+        uint32_t rx_overflows = radio.rxOverflowCount();
+        if (rx_overflows != lastReportedRxOverflows) {
+            Serial.printf("[WARN] RX ring overflow: %u packets dropped so far.\n", rx_overflows);
+            lastReportedRxOverflows = rx_overflows;
+        }
         lastTimeoutCheckTime = millis();
     }
 }
 void switchToIdleMode() {
     Serial.println("\n[STATUS] System switching to Idle Mode.");
-    if (currentGameMode) {
-        delete currentGameMode;
-        currentGameMode = nullptr;
-    }
+    currentGameMode = nullptr; // 【修改】: 遊戲模式為預先配置的實體，不需釋放
     if (discovered_slaves.size() < MIN_DEVICES_REQUIRED) {
-        Serial.printf("Not enough devices. (%d/%d found). Returning to Discovery Mode.\n", discovered_slaves.size(), MIN_DEVICES_REQUIRED);
+        Serial.printf("Not enough devices. (%u/%d found). Returning to Discovery Mode.\n", (unsigned)discovered_slaves.size(), MIN_DEVICES_REQUIRED);
         switchToDiscoveryMode();
     } else {
-        Serial.printf("Ready for UI commands. %d devices are online.\n", discovered_slaves.size());
+        Serial.printf("Ready for UI commands. %u devices are online.\n", (unsigned)discovered_slaves.size());
         current_mode = MODE_IDLE;
         radio.switchToOperationMode(discovered_slaves);
         masterLed.setIdleMode();
         masterMatrix.showIdleDisplay();
     }
 }
+/**
+ * @brief 【新增】: 由 Idle 模式開始遊戲；配對等邏輯全部在主機上執行，不經過 UI
+ */
+void startGameMode(const GameModeEntry& game) {
+    if (current_mode != MODE_IDLE) {
+        Serial.printf("[WARN] %s can only start from Idle Mode.\n", game.name);
+        return;
+    }
+    Serial.printf("[GAME] Starting %s with %u devices.\n", game.name, (unsigned)discovered_slaves.size());
+    currentGameMode = game.mode;
+    current_mode = MODE_GAME_RUNNING;
+    currentGameMode->start(radio, discovered_slaves);
+}
 void switchToDiscoveryMode() {
     Serial.println("\n[STATUS] System now in Discovery Mode. Waiting for slaves to join...");
-    if (currentGameMode) {
-        delete currentGameMode;
-        currentGameMode = nullptr;
-    }
+    currentGameMode = nullptr; // 【修改】: 遊戲模式為預先配置的實體，不需釋放
     current_mode = MODE_DISCOVERY;
+    channels.returnToRendezvous();
     radio.switchToDiscoveryMode();
     masterLed.startDiscoveryMode();
     masterMatrix.showWelcomeMessage();
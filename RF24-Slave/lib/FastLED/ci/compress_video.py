@@ -0,0 +1,175 @@
+"""
+Converts a raw .rgb video (3 bytes per pixel, frame after frame) into the
+compressed, seekable .rgbz container that fx/video/pixel_stream reads.
+
+The format is described in src/fx/video/video_codec.h; this produces the same
+bytes as fl::VideoEncoder.
+
+    uv run ci/compress_video.py data/video.rgb --pixels 1024
+"""
+
+import argparse
+import struct
+import sys
+from pathlib import Path
+
+MAGIC = b"RGBZ"
+VERSION = 1
+HEADER_SIZE = 24
+INDEX_ENTRY_SIZE = 8
+
+KEYFRAME = 0
+DELTA = 1
+
+SKIP = 0
+LITERAL = 1
+FILL = 2
+
+SHORT_COUNT = 63
+MAX_COUNT = SHORT_COUNT + 0xFFFF + 1
+
+
+def _put_op(out: bytearray, kind: int, count: int) -> None:
+    n = count - 1
+    if n < SHORT_COUNT:
+        out.append((kind << 6) | n)
+        return
+    out.append((kind << 6) | SHORT_COUNT)
+    out += struct.pack("<H", n - SHORT_COUNT)
+
+
+def _pixel(frame: bytes, i: int) -> bytes:
+    return frame[i * 3 : i * 3 + 3]
+
+
+def encode_ops(cur: bytes, prev: bytes | None, n: int) -> bytearray:
+    """Run ops for one frame, against prev or as a keyframe."""
+    out = bytearray()
+    px = [_pixel(cur, i) for i in range(n)]
+    old = [_pixel(prev, i) for i in range(n)] if prev is not None else None
+    i = 0
+    while i < n:
+        j = i + 1
+        if old is not None and px[i] == old[i]:
+            while j < n and px[j] == old[j]:
+                j += 1
+            for k in range(i, j, MAX_COUNT):
+                _put_op(out, SKIP, min(MAX_COUNT, j - k))
+            i = j
+            continue
+        while j < n and px[j] == px[i]:
+            j += 1
+        if j - i >= 2:
+            for k in range(i, j, MAX_COUNT):
+                _put_op(out, FILL, min(MAX_COUNT, j - k))
+                out += px[i]
+            i = j
+            continue
+        j = i + 1
+        while (
+            j < n
+            and not (old is not None and px[j] == old[j])
+            and not (j + 1 < n and px[j + 1] == px[j])
+        ):
+            j += 1
+        for k in range(i, j, MAX_COUNT):
+            count = min(MAX_COUNT, j - k)
+            _put_op(out, LITERAL, count)
+            out += cur[k * 3 : (k + count) * 3]
+        i = j
+    return out
+
+
+def encode(raw: bytes, pixels: int, keyframe_interval: int) -> tuple[bytes, int]:
+    """Returns the .rgbz bytes and the number of keyframes."""
+    frame_bytes = pixels * 3
+    frames = len(raw) // frame_bytes
+    keyframe_interval = max(1, keyframe_interval)
+    records = bytearray()
+    offsets: list[int] = []
+    keyframes: list[int] = []
+    last_keyframe = 0
+    keyframe_count = 0
+    prev: bytes | None = None
+    for f in range(frames):
+        cur = raw[f * frame_bytes : (f + 1) * frame_bytes]
+        is_key = f == 0 or f - last_keyframe >= keyframe_interval
+        if not is_key:
+            ops = encode_ops(cur, prev, pixels)
+            key = encode_ops(cur, None, pixels)
+            if len(key) <= len(ops):
+                # a scene cut: the delta saves nothing
+                is_key = True
+                ops = key
+        else:
+            ops = encode_ops(cur, None, pixels)
+        if is_key:
+            last_keyframe = f
+            keyframe_count += 1
+        offsets.append(len(records))
+        keyframes.append(last_keyframe)
+        records.append(KEYFRAME if is_key else DELTA)
+        records += ops
+        prev = cur
+
+    index_offset = HEADER_SIZE
+    data_offset = index_offset + frames * INDEX_ENTRY_SIZE
+    out = bytearray(MAGIC)
+    out += struct.pack(
+        "<BBHIIII",
+        VERSION,
+        HEADER_SIZE,
+        keyframe_interval,
+        pixels,
+        frames,
+        index_offset,
+        data_offset,
+    )
+    for offset, keyframe in zip(offsets, keyframes):
+        out += struct.pack("<II", data_offset + offset, keyframe)
+    out += records
+    return bytes(out), keyframe_count
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Compress a raw .rgb video into an .rgbz file"
+    )
+    parser.add_argument("input", type=Path, help="Raw .rgb video")
+    parser.add_argument(
+        "--pixels", type=int, required=True, help="Pixels per frame"
+    )
+    parser.add_argument(
+        "--keyframe-interval",
+        type=int,
+        default=30,
+        help="Frames between keyframes (default 30)",
+    )
+    parser.add_argument(
+        "-o", "--output", type=Path, help="Output file (default: input.rgbz)"
+    )
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    raw = args.input.read_bytes()
+    frame_bytes = args.pixels * 3
+    if args.pixels <= 0 or len(raw) < frame_bytes:
+        print(f"{args.input} holds less than one frame of {args.pixels} pixels")
+        return 1
+    if len(raw) % frame_bytes:
+        print(f"Warning: ignoring {len(raw) % frame_bytes} trailing bytes")
+    data, keyframes = encode(raw, args.pixels, args.keyframe_interval)
+    output = args.output or args.input.with_suffix(".rgbz")
+    output.write_bytes(data)
+    frames = len(raw) // frame_bytes
+    print(
+        f"{output}: {frames} frames, {keyframes} keyframes, "
+        f"{len(raw)} -> {len(data)} bytes ({len(data) / len(raw):.1%})"
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
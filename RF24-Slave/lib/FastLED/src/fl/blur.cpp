@@ -7,6 +7,7 @@
 
 #include "crgb.h"
 #include "fl/blur.h"
+#include "fl/blur_batch.h"
 #include "fl/colorutils_misc.h"
 #include "fl/deprecated.h"
 #include "fl/unused.h"
@@ -36,6 +37,20 @@ uint16_t xy_legacy_wrapper(uint16_t x, uint16_t y, uint16_t width,
     FASTLED_UNUSED(height);
     return XY(x, y);
 }
+
+// Rows of the map are contiguous in leds: line by line, or serpentine (a
+// reversed row blurs the same, the kernel is symmetric)
+bool rowsAreContiguous(const XYMap &xyMap, uint8_t width, uint8_t height) {
+    return width && height && xyMap.isSerpentineOrLineByLine() &&
+           xyMap.getWidth() == width && xyMap.getHeight() >= height;
+}
+
+// Columns can be blurred row by row when the rows are also in order
+bool columnsAreStrided(const XYMap &xyMap, uint8_t width, uint8_t height) {
+    return width && height && xyMap.isLineByLine() &&
+           xyMap.getWidth() == width && xyMap.getHeight() >= height;
+}
+
 } // namespace
 
 // blur1d: one-dimensional blur filter. Spreads light to 2 line neighbors.
@@ -52,20 +67,7 @@ uint16_t xy_legacy_wrapper(uint16_t x, uint16_t y, uint16_t width,
 //         eventually all the way to black; this is by design so that
 //         it can be used to (slowly) clear the LEDs to black.
 void blur1d(CRGB *leds, uint16_t numLeds, fract8 blur_amount) {
-    uint8_t keep = 255 - blur_amount;
-    uint8_t seep = blur_amount >> 1;
-    CRGB carryover = CRGB::Black;
-    for (uint16_t i = 0; i < numLeds; ++i) {
-        CRGB cur = leds[i];
-        CRGB part = cur;
-        part.nscale8(seep);
-        cur.nscale8(keep);
-        cur += carryover;
-        if (i)
-            leds[i - 1] += part;
-        leds[i] = cur;
-        carryover = part;
-    }
+    blur_batch::blurRow(leds, numLeds, blur_amount);
 }
 
 void blur2d(CRGB *leds, uint8_t width, uint8_t height, fract8 blur_amount,
@@ -88,6 +90,13 @@ void blurRows(CRGB *leds, uint8_t width, uint8_t height, fract8 blur_amount,
             blur1d( rowbase, width, blur_amount);
         }
     */
+    if (rowsAreContiguous(xyMap, width, height)) {
+        CRGB *base = leds + xyMap.mapToIndex(0, 0);
+        for (uint8_t row = 0; row < height; row++) {
+            blur_batch::blurRow(base + row * width, width, blur_amount);
+        }
+        return;
+    }
     // blur rows same as columns, for irregular matrix
     uint8_t keep = 255 - blur_amount;
     uint8_t seep = blur_amount >> 1;
@@ -110,6 +119,11 @@ void blurRows(CRGB *leds, uint8_t width, uint8_t height, fract8 blur_amount,
 // blurColumns: perform a blur1d on each column of a rectangular matrix
 void blurColumns(CRGB *leds, uint8_t width, uint8_t height, fract8 blur_amount,
                  const XYMap &xyMap) {
+    if (columnsAreStrided(xyMap, width, height)) {
+        blur_batch::blurColumns(leds + xyMap.mapToIndex(0, 0), width, height,
+                                blur_amount);
+        return;
+    }
     // blur columns
     uint8_t keep = 255 - blur_amount;
     uint8_t seep = blur_amount >> 1;
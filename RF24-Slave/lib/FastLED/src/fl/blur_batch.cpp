@@ -0,0 +1,314 @@
+#include <stdint.h>
+#include <string.h>
+
+#define FASTLED_INTERNAL
+#include "FastLED.h"
+
+#include "fl/blur_batch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FL_BLUR_HAS_SSE2 1
+#else
+#define FL_BLUR_HAS_SSE2 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FL_BLUR_HAS_NEON 1
+#else
+#define FL_BLUR_HAS_NEON 0
+#endif
+
+namespace fl {
+namespace blur_batch {
+
+namespace {
+
+// nscale8() as a multiply and a shift: x * mult >> 8. mult is at most 256,
+// so every product fits in 16 bits.
+uint16_t multiplier(uint8_t scale) {
+#if (FASTLED_SCALE8_FIXED == 1)
+    return uint16_t(scale) + 1;
+#else
+    return scale;
+#endif
+}
+
+// --- scalar ---------------------------------------------------------------
+
+void scaleScalar(const uint8_t *in, uint8_t *out, size_t n, uint16_t mult) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = uint8_t((in[i] * mult) >> 8);
+    }
+}
+
+void blendScalar(const uint8_t *prev, uint8_t *cur, const uint8_t *next,
+                 size_t n, uint16_t mult) {
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t kept = uint8_t((cur[i] * mult) >> 8);
+        cur[i] = qadd8(qadd8(kept, prev[i]), next[i]);
+    }
+}
+
+// --- SWAR: four bytes in a uint32_t ---------------------------------------
+
+inline uint32_t load32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void store32(uint8_t *p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+
+// Bytes 0 and 2 are scaled in the low halves of two 16-bit lanes, bytes 1
+// and 3 in the high halves; a lane never carries into its neighbour.
+inline uint32_t scale32(uint32_t v, uint32_t mult) {
+    uint32_t even = ((v & 0x00FF00FFu) * mult >> 8) & 0x00FF00FFu;
+    uint32_t odd = (((v >> 8) & 0x00FF00FFu) * mult) & 0xFF00FF00u;
+    return even | odd;
+}
+
+// Per-byte saturating add: add the low 7 bits, fix up the top bit, then
+// turn every byte that overflowed into 0xFF.
+inline uint32_t qadd32(uint32_t a, uint32_t b) {
+    uint32_t low = (a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu);
+    uint32_t sum = low ^ ((a ^ b) & 0x80808080u);
+    uint32_t overflow = ((a & b) | ((a | b) & ~sum)) & 0x80808080u;
+    return sum | ((overflow >> 7) * 0xFFu);
+}
+
+void scaleSwar(const uint8_t *in, uint8_t *out, size_t n, uint16_t mult) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        store32(out + i, scale32(load32(in + i), mult));
+    }
+    scaleScalar(in + i, out + i, n - i, mult);
+}
+
+void blendSwar(const uint8_t *prev, uint8_t *cur, const uint8_t *next,
+               size_t n, uint16_t mult) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t kept = scale32(load32(cur + i), mult);
+        store32(cur + i,
+                qadd32(qadd32(kept, load32(prev + i)), load32(next + i)));
+    }
+    blendScalar(prev + i, cur + i, next + i, n - i, mult);
+}
+
+// --- SSE2 -----------------------------------------------------------------
+
+#if FL_BLUR_HAS_SSE2
+inline __m128i scale128(__m128i v, __m128i mult) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), mult);
+    __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), mult);
+    return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+void scaleSse2(const uint8_t *in, uint8_t *out, size_t n, uint16_t mult) {
+    const __m128i m = _mm_set1_epi16(short(mult));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), scale128(v, m));
+    }
+    scaleSwar(in + i, out + i, n - i, mult);
+}
+
+void blendSse2(const uint8_t *prev, uint8_t *cur, const uint8_t *next,
+               size_t n, uint16_t mult) {
+    const __m128i m = _mm_set1_epi16(short(mult));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + i));
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + i));
+        __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i *>(next + i));
+        __m128i out = _mm_adds_epu8(_mm_adds_epu8(scale128(c, m), p), q);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(cur + i), out);
+    }
+    blendSwar(prev + i, cur + i, next + i, n - i, mult);
+}
+#endif
+
+// --- NEON -----------------------------------------------------------------
+
+#if FL_BLUR_HAS_NEON
+inline uint8x16_t scale128(uint8x16_t v, uint16x8_t mult) {
+    uint16x8_t lo = vmulq_u16(vmovl_u8(vget_low_u8(v)), mult);
+    uint16x8_t hi = vmulq_u16(vmovl_u8(vget_high_u8(v)), mult);
+    return vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+}
+
+void scaleNeon(const uint8_t *in, uint8_t *out, size_t n, uint16_t mult) {
+    const uint16x8_t m = vdupq_n_u16(mult);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(out + i, scale128(vld1q_u8(in + i), m));
+    }
+    scaleSwar(in + i, out + i, n - i, mult);
+}
+
+void blendNeon(const uint8_t *prev, uint8_t *cur, const uint8_t *next,
+               size_t n, uint16_t mult) {
+    const uint16x8_t m = vdupq_n_u16(mult);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t kept = scale128(vld1q_u8(cur + i), m);
+        vst1q_u8(cur + i, vqaddq_u8(vqaddq_u8(kept, vld1q_u8(prev + i)),
+                                    vld1q_u8(next + i)));
+    }
+    blendSwar(prev + i, cur + i, next + i, n - i, mult);
+}
+#endif
+
+uint8_t *bytes(CRGB *leds) { return reinterpret_cast<uint8_t *>(leds); }
+
+} // namespace
+
+Path defaultPath() {
+#if FL_BLUR_HAS_SSE2
+    return kSse2;
+#elif FL_BLUR_HAS_NEON
+    return kNeon;
+#elif defined(__AVR__)
+    // no hardware 32-bit multiply, the byte loop is faster
+    return kScalar;
+#else
+    return kSwar;
+#endif
+}
+
+bool isAvailable(Path path) {
+    switch (path) {
+    case kScalar:
+    case kSwar:
+        return true;
+    case kSse2:
+        return FL_BLUR_HAS_SSE2;
+    case kNeon:
+        return FL_BLUR_HAS_NEON;
+    }
+    return false;
+}
+
+const char *pathName(Path path) {
+    switch (path) {
+    case kScalar:
+        return "scalar";
+    case kSwar:
+        return "swar";
+    case kSse2:
+        return "sse2";
+    case kNeon:
+        return "neon";
+    }
+    return "?";
+}
+
+void scaleBytes(const uint8_t *in, uint8_t *out, size_t n, uint8_t scale,
+                Path path) {
+    uint16_t mult = multiplier(scale);
+#if FL_BLUR_HAS_SSE2
+    if (path == kSse2) {
+        scaleSse2(in, out, n, mult);
+        return;
+    }
+#endif
+#if FL_BLUR_HAS_NEON
+    if (path == kNeon) {
+        scaleNeon(in, out, n, mult);
+        return;
+    }
+#endif
+    if (path == kSwar) {
+        scaleSwar(in, out, n, mult);
+        return;
+    }
+    scaleScalar(in, out, n, mult);
+}
+
+void blendBytes(const uint8_t *prev, uint8_t *cur, const uint8_t *next,
+                size_t n, uint8_t keep, Path path) {
+    uint16_t mult = multiplier(keep);
+#if FL_BLUR_HAS_SSE2
+    if (path == kSse2) {
+        blendSse2(prev, cur, next, n, mult);
+        return;
+    }
+#endif
+#if FL_BLUR_HAS_NEON
+    if (path == kNeon) {
+        blendNeon(prev, cur, next, n, mult);
+        return;
+    }
+#endif
+    if (path == kSwar) {
+        blendSwar(prev, cur, next, n, mult);
+        return;
+    }
+    blendScalar(prev, cur, next, n, mult);
+}
+
+void blurRow(CRGB *leds, uint16_t numLeds, fract8 blur_amount, Path path) {
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+    // [part of the pixel before the tile][parts of the tile][part after]
+    uint8_t parts[3 + kTilePixels * 3 + 3];
+    memset(parts, 0, 3);
+    for (uint16_t start = 0; start < numLeds; start += kTilePixels) {
+        uint16_t count = numLeds - start < kTilePixels
+                             ? uint16_t(numLeds - start)
+                             : uint16_t(kTilePixels);
+        size_t n = size_t(count) * 3;
+        uint8_t *tile = bytes(leds + start);
+        scaleBytes(tile, parts + 3, n, seep, path);
+        if (start + count < numLeds) {
+            scaleBytes(tile + n, parts + 3 + n, 3, seep, path);
+        } else {
+            memset(parts + 3 + n, 0, 3);
+        }
+        // the last pixel's part seeps into the next tile
+        uint8_t carry[3];
+        memcpy(carry, parts + n, 3);
+        blendBytes(parts, tile, parts + 6, n, keep, path);
+        memcpy(parts, carry, 3);
+    }
+}
+
+void blurColumns(CRGB *leds, uint16_t width, uint16_t height,
+                 fract8 blur_amount, Path path) {
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+    // parts of the rows above, at and below the one being blurred
+    uint8_t buffers[3][kTilePixels * 3];
+    for (uint16_t x = 0; x < width; x += kTilePixels) {
+        uint16_t count = width - x < kTilePixels ? uint16_t(width - x)
+                                                 : uint16_t(kTilePixels);
+        size_t n = size_t(count) * 3;
+        uint8_t *prev = buffers[0];
+        uint8_t *cur = buffers[1];
+        uint8_t *next = buffers[2];
+        memset(prev, 0, n);
+        if (height) {
+            scaleBytes(bytes(leds + x), cur, n, seep, path);
+        }
+        for (uint16_t y = 0; y < height; ++y) {
+            uint8_t *row = bytes(leds + size_t(y) * width + x);
+            if (y + 1 < height) {
+                scaleBytes(row + size_t(width) * 3, next, n, seep, path);
+            } else {
+                memset(next, 0, n);
+            }
+            blendBytes(prev, row, next, n, keep, path);
+            uint8_t *done = prev;
+            prev = cur;
+            cur = next;
+            next = done;
+        }
+    }
+}
+
+} // namespace blur_batch
+} // namespace fl
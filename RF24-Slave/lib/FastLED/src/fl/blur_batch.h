@@ -0,0 +1,61 @@
+#pragma once
+
+/*
+Batch engine behind blur1d(), blurRows() and blurColumns().
+
+The blur kernel treats every color channel the same way, so a run of CRGB
+pixels is processed as a run of bytes: each output byte is
+
+    qadd8(qadd8(scale(c, keep), scale(left, seep)), scale(right, seep))
+
+where left/right are the same channel of the neighbouring pixel (3 bytes
+away in a row, one row away in a column) before blurring. The scale is
+nscale8()'s, so the result is bit-exact with the per-pixel kernels.
+
+Rows and column strips are processed in tiles of kTilePixels pixels with a
+few hundred bytes of stack, so nothing is allocated.
+
+Paths:
+  - SSE2 (x86 hosts), NEON (ARM Linux hosts): 16 bytes per step
+  - SWAR: 4 bytes per step in 32-bit registers, for Xtensa (ESP32) and any
+    other target with a fast 32-bit multiply
+  - scalar: the reference, and the default on AVR
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "crgb.h"
+
+namespace fl {
+namespace blur_batch {
+
+enum Path { kScalar = 0, kSwar, kSse2, kNeon };
+
+// pixels per tile; the stack cost is about 3 * 3 * kTilePixels bytes
+enum { kTilePixels = 64 };
+
+// The fastest path compiled in for this target
+Path defaultPath();
+// Whether a path is compiled in (the SIMD ones depend on the target)
+bool isAvailable(Path path);
+const char *pathName(Path path);
+
+// out[i] = nscale8 of in[i] by scale. in and out may be the same buffer.
+void scaleBytes(const uint8_t *in, uint8_t *out, size_t n, uint8_t scale,
+                Path path = defaultPath());
+
+// cur[i] = qadd8(qadd8(scale(cur[i], keep), prev[i]), next[i])
+void blendBytes(const uint8_t *prev, uint8_t *cur, const uint8_t *next,
+                size_t n, uint8_t keep, Path path = defaultPath());
+
+// blur1d() of a contiguous run of pixels
+void blurRow(CRGB *leds, uint16_t numLeds, fract8 blur_amount,
+             Path path = defaultPath());
+
+// blurColumns() of a matrix stored row after row, `width` pixels per row
+void blurColumns(CRGB *leds, uint16_t width, uint16_t height,
+                 fract8 blur_amount, Path path = defaultPath());
+
+} // namespace blur_batch
+} // namespace fl
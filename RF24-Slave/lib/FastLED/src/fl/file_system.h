@@ -8,6 +8,7 @@
 #include "fl/namespace.h"
 #include "fl/ptr.h"
 #include "fl/str.h"
+#include "fl/unused.h"
 #include "fx/video.h"
 
 namespace fl {
@@ -73,6 +74,14 @@ class FileHandle : public Referent {
     virtual bool seek(size_t pos) = 0;
     virtual void close() = 0;
     virtual bool valid() const = 0;
+    // Memory-mapped handles return len bytes at pos in place, valid for as
+    // long as the handle is referenced. Everyone else returns nullptr and
+    // callers fall back to read().
+    virtual const uint8_t *view(size_t pos, size_t len) {
+        FASTLED_UNUSED(pos);
+        FASTLED_UNUSED(len);
+        return nullptr;
+    }
 
     // convenience functions
     size_t readCRGB(CRGB *dst, size_t n) {
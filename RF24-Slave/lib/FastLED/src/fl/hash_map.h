@@ -488,88 +488,45 @@ class HashMap {
     }
 
     void rehash_inline_no_resize() {
-        // filter out tombstones and compact
-        size_t cap = _buckets.size();
-        size_t pos = 0;
-        // compact live elements to the left.
+        // Drop the tombstones and re-place every live entry in the same
+        // buckets. Entries not placed yet are tracked in `pending`; placing
+        // an entry either lands in a free bucket or displaces a pending
+        // entry, which is placed next. Every step finalizes one bucket.
+        const size_t cap = _buckets.size();
+        fl::bitset<1024> pending = _occupied;
         for (size_t i = 0; i < cap; ++i) {
-            if (is_occupied(i)) {
-                if (pos != i) {
-                    _buckets[pos] = _buckets[i];
-                    mark_empty(i);
-                    mark_occupied(pos);
-                }
-                ++pos;
-            } else if (is_deleted(i)) {
-                mark_empty(i);
-            }
+            mark_empty(i);
         }
+        _tombstones = 0;
 
-        fl::bitset<1024> occupied; // Preallocate a bitset of size 1024
-        // swap the components, this will happen at most N times,
-        // use the occupied bitset to track which entries are occupied
-        // in the array rather than just copied in.
-        fl::optional<Entry> tmp;
-        for (size_t i = 0; i < _size; ++i) {
-            const bool already_finished = occupied.test(i);
-            if (already_finished) {
-                continue;
-            }
-            auto &e = _buckets[i];
-            // FASTLED_ASSERT(e.state == EntryState::Occupied,
-            //                "HashMap::rehash_inline_no_resize: invalid
-            //                state");
-
-            size_t idx = find_unoccupied_index_using_bitset(e.key, occupied);
-            if (idx == npos) {
-                // no more space
-                FASTLED_ASSERT(
-                    false, "HashMap::rehash_inline_no_resize: invalid index at "
-                               << idx << " which is " << npos);
-                return;
-            }
-            // if idx < pos then we are moving the entry to a new location
-            FASTLED_ASSERT(!tmp,
-                           "HashMap::rehash_inline_no_resize: invalid tmp");
-            if (idx >= _size) {
-                // directly copy it now
-                _buckets[idx] = e;
+        for (size_t i = 0; i < cap; ++i) {
+            if (!pending.test(i)) {
                 continue;
             }
-            tmp = e;
-            occupied.set(idx);
-            _buckets[idx] = *tmp.ptr();
-            while (!tmp.empty()) {
-                // we have to find a place for temp.
-                // find new position for tmp.
-                auto key = tmp.ptr()->key;
-                size_t new_idx =
-                    find_unoccupied_index_using_bitset(key, occupied);
-                if (new_idx == npos) {
-                    // no more space
+            pending.reset(i);
+            Entry tmp = _buckets[i];
+            while (true) {
+                size_t idx = find_unoccupied_index_using_bitset(tmp.key,
+                                                                _occupied);
+                if (idx == npos) {
+                    // cannot happen: there are as many buckets as before
                     FASTLED_ASSERT(
                         false,
                         "HashMap::rehash_inline_no_resize: invalid index at "
-                            << new_idx << " which is " << npos);
+                            << idx << " which is " << npos);
                     return;
                 }
-                occupied.set(new_idx);
-                if (new_idx < _size) {
-                    // we have to swap the entry at new_idx with tmp
-                    optional<Entry> tmp2 = _buckets[new_idx];
-                    _buckets[new_idx] = *tmp.ptr();
-                    tmp = tmp2;
-                } else {
-                    // we can just move tmp to new_idx
-                    _buckets[new_idx] = *tmp.ptr();
-                    tmp.reset();
+                mark_occupied(idx);
+                if (!pending.test(idx)) {
+                    _buckets[idx] = tmp;
+                    break;
                 }
+                // the bucket still holds an entry that is not placed yet
+                pending.reset(idx);
+                Entry displaced = _buckets[idx];
+                _buckets[idx] = tmp;
+                tmp = displaced;
             }
-            FASTLED_ASSERT(
-                occupied.test(i),
-                "HashMap::rehash_inline_no_resize: invalid occupied at " << i);
-            FASTLED_ASSERT(
-                !tmp, "HashMap::rehash_inline_no_resize: invalid tmp at " << i);
         }
     }
 
@@ -4,10 +4,21 @@
 LRU (Least Recently Used) HashMap that is optimized for embedded devices.
 This hashmap has a maximum size and will automatically evict the least
 recently used items when it reaches capacity.
+
+Entries live in a node array threaded by an intrusive doubly-linked list in
+recency order (head = most recently used, tail = least recently used). The
+hash map only stores the node index, so find, insert and evict are all O(1):
+a hit moves its node to the head and eviction drops the tail. Freed nodes are
+kept on a free list and reused, so a full cache that keeps churning does not
+allocate.
+
+Pointers returned by find_value() / operator[] stay valid until the next
+insertion of a new key or the next removal.
 */
 
 #include "fl/hash_map.h"
 #include "fl/type_traits.h"
+#include "fl/vector.h"
 
 namespace fl {
 
@@ -16,25 +27,31 @@ template <typename Key, typename T, typename Hash = Hash<Key>,
           int INLINED_COUNT = FASTLED_HASHMAP_INLINED_COUNT>
 class HashMapLru {
   private:
-    // Wrapper for values that includes access time tracking
-    struct ValueWithTimestamp {
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    // A cache entry and its links in the recency list (or the free list,
+    // which only uses next)
+    struct Node {
+        Key key;
         T value;
-        uint32_t last_access_time;
+        uint32_t prev;
+        uint32_t next;
 
-        ValueWithTimestamp() : last_access_time(0) {}
-        ValueWithTimestamp(const T &v, uint32_t time)
-            : value(v), last_access_time(time) {}
+        Node() : key(), value(), prev(kNone), next(kNone) {}
     };
 
   public:
-    HashMapLru(size_t max_size) : mMaxSize(max_size), mCurrentTime(0) {
+    HashMapLru(size_t max_size)
+        : mMaxSize(max_size), mHead(kNone), mTail(kNone), mFree(kNone) {
         // Ensure max size is at least 1
         if (mMaxSize < 1)
             mMaxSize = 1;
     }
 
     void setMaxSize(size_t max_size) {
-        while (mMaxSize < max_size) {
+        if (max_size < 1)
+            max_size = 1;
+        while (size() > max_size) {
             // Evict oldest items until we reach the new max size
             evictOldest();
         }
@@ -42,121 +59,162 @@ class HashMapLru {
     }
 
     void swap(HashMapLru &other) {
-        fl::swap(mMap, other.mMap);
+        fl::swap(mIndex, other.mIndex);
+        mNodes.swap(other.mNodes);
         fl::swap(mMaxSize, other.mMaxSize);
-        fl::swap(mCurrentTime, other.mCurrentTime);
+        fl::swap(mHead, other.mHead);
+        fl::swap(mTail, other.mTail);
+        fl::swap(mFree, other.mFree);
     }
 
     // Insert or update a key-value pair
     void insert(const Key &key, const T &value) {
-        // Only evict if we're at capacity AND this is a new key
-        const ValueWithTimestamp *existing = mMap.find_value(key);
-
-        auto curr = mCurrentTime++;
-
+        const uint32_t *existing = mIndex.find_value(key);
         if (existing) {
-            // Update the value and access time
-            ValueWithTimestamp &vwt =
-                const_cast<ValueWithTimestamp &>(*existing);
-            vwt.value = value;
-            vwt.last_access_time = curr;
+            // Update the value and mark it most recently used
+            mNodes[*existing].value = value;
+            touch(*existing);
             return;
         }
-        if (mMap.size() >= mMaxSize) {
+        // Only evict if we're at capacity AND this is a new key
+        if (size() >= mMaxSize) {
             evictOldest();
         }
-
-        // Insert or update the value with current timestamp
-        ValueWithTimestamp vwt(value, mCurrentTime);
-        mMap.insert(key, vwt);
+        mNodes[newNode(key)].value = value;
     }
 
     // Get value for key, returns nullptr if not found
     T *find_value(const Key &key) {
-        ValueWithTimestamp *vwt = mMap.find_value(key);
-        if (vwt) {
-            // Update access time
-            auto curr = mCurrentTime++;
-            vwt->last_access_time = curr;
-            return &vwt->value;
+        const uint32_t *index = mIndex.find_value(key);
+        if (!index) {
+            return nullptr;
         }
-        return nullptr;
+        touch(*index);
+        return &mNodes[*index].value;
     }
 
-    // Get value for key, returns nullptr if not found (const version)
+    // Get value for key, returns nullptr if not found (const version, does
+    // not count as a use)
     const T *find_value(const Key &key) const {
-        const ValueWithTimestamp *vwt = mMap.find_value(key);
-        return vwt ? &vwt->value : nullptr;
+        const uint32_t *index = mIndex.find_value(key);
+        return index ? &mNodes[*index].value : nullptr;
     }
 
     // Access operator - creates entry if not exists
     T &operator[](const Key &key) {
-        // If we're at capacity and this is a new key, evict oldest
-        auto curr = mCurrentTime++;
-
-        auto entry = mMap.find_value(key);
-        if (entry) {
-            // Update access time
-            entry->last_access_time = curr;
-            return entry->value;
+        const uint32_t *existing = mIndex.find_value(key);
+        if (existing) {
+            touch(*existing);
+            return mNodes[*existing].value;
         }
-
-        if (mMap.size() >= mMaxSize) {
+        // If we're at capacity and this is a new key, evict oldest
+        if (size() >= mMaxSize) {
             evictOldest();
         }
-
-        // Get or create entry and update timestamp
-        // mCurrentTime++;
-        ValueWithTimestamp &vwt = mMap[key];
-        vwt.last_access_time = curr;
-        return vwt.value;
+        return mNodes[newNode(key)].value;
     }
 
     // Remove a key
-    bool remove(const Key &key) { return mMap.remove(key); }
+    bool remove(const Key &key) {
+        const uint32_t *found = mIndex.find_value(key);
+        if (!found) {
+            return false;
+        }
+        uint32_t index = *found;
+        mIndex.remove(key);
+        unlink(index);
+        freeNode(index);
+        return true;
+    }
 
     // Clear the map
     void clear() {
-        mMap.clear();
-        mCurrentTime = 0;
+        mIndex.clear();
+        mNodes.clear();
+        mHead = mTail = mFree = kNone;
     }
 
     // Size accessors
-    size_t size() const { return mMap.size(); }
-    bool empty() const { return mMap.empty(); }
+    size_t size() const { return mIndex.size(); }
+    bool empty() const { return mIndex.empty(); }
     size_t capacity() const { return mMaxSize; }
 
   private:
     // Evict the least recently used item
     void evictOldest() {
-        if (mMap.empty())
+        if (mTail == kNone)
             return;
+        uint32_t index = mTail;
+        mIndex.remove(mNodes[index].key);
+        unlink(index);
+        freeNode(index);
+    }
 
-        // Find the entry with the oldest timestamp
-        Key oldest_key;
-        uint32_t oldest_time = UINT32_MAX;
-        bool found = false;
+    // Take a node from the free list (or grow the array), index it and put
+    // it at the head
+    uint32_t newNode(const Key &key) {
+        uint32_t index;
+        if (mFree != kNone) {
+            index = mFree;
+            mFree = mNodes[index].next;
+        } else {
+            index = static_cast<uint32_t>(mNodes.size());
+            mNodes.push_back(Node());
+        }
+        mNodes[index].key = key;
+        mIndex.insert(key, index);
+        linkFront(index);
+        return index;
+    }
 
-        for (auto it = mMap.begin(); it != mMap.end(); ++it) {
-            const auto &entry = *it;
-            const ValueWithTimestamp &vwt = entry.second;
+    // Release what the entry holds right away (an evicted FFT plan, a
+    // string key) and put the node on the free list
+    void freeNode(uint32_t index) {
+        Node &node = mNodes[index];
+        node.key = Key();
+        node.value = T();
+        node.prev = kNone;
+        node.next = mFree;
+        mFree = index;
+    }
 
-            if (vwt.last_access_time < oldest_time) {
-                oldest_time = vwt.last_access_time;
-                oldest_key = entry.first;
-                found = true;
-            }
-        }
+    void touch(uint32_t index) {
+        if (index == mHead)
+            return;
+        unlink(index);
+        linkFront(index);
+    }
 
-        // Remove the oldest entry
-        if (found) {
-            mMap.remove(oldest_key);
-        }
+    void linkFront(uint32_t index) {
+        Node &node = mNodes[index];
+        node.prev = kNone;
+        node.next = mHead;
+        if (mHead != kNone)
+            mNodes[mHead].prev = index;
+        mHead = index;
+        if (mTail == kNone)
+            mTail = index;
+    }
+
+    void unlink(uint32_t index) {
+        Node &node = mNodes[index];
+        if (node.prev != kNone)
+            mNodes[node.prev].next = node.next;
+        else
+            mHead = node.next;
+        if (node.next != kNone)
+            mNodes[node.next].prev = node.prev;
+        else
+            mTail = node.prev;
+        node.prev = node.next = kNone;
     }
 
-    HashMap<Key, ValueWithTimestamp, Hash, KeyEqual, INLINED_COUNT> mMap;
+    HashMap<Key, uint32_t, Hash, KeyEqual, INLINED_COUNT> mIndex;
+    fl::vector<Node> mNodes;
     size_t mMaxSize;
-    uint32_t mCurrentTime;
+    uint32_t mHead; // most recently used
+    uint32_t mTail; // least recently used, evicted first
+    uint32_t mFree; // first reusable node
 };
 
 } // namespace fl
@@ -23,16 +23,37 @@ Frame::~Frame() {
     // Vector will handle memory cleanup automatically
 }
 
+CRGB *Frame::rgb() {
+    if (mView) {
+        memcpy(mRgb.data(), mView, mPixelsCount * sizeof(CRGB));
+        mView = nullptr;
+        mViewOwner.reset();
+    }
+    return mRgb.data();
+}
+
+CRGB *Frame::ownPixels() {
+    mView = nullptr;
+    mViewOwner.reset();
+    return mRgb.data();
+}
+
+void Frame::setView(const CRGB *pixels, fl::Ptr<fl::Referent> owner) {
+    mView = pixels;
+    mViewOwner = owner;
+}
+
 void Frame::draw(CRGB *leds, DrawMode draw_mode) const {
     if (!mRgb.empty()) {
+        const CRGB *pixels = rgb();
         switch (draw_mode) {
         case DRAW_MODE_OVERWRITE: {
-            memcpy(leds, mRgb.data(), mPixelsCount * sizeof(CRGB));
+            memcpy(leds, pixels, mPixelsCount * sizeof(CRGB));
             break;
         }
         case DRAW_MODE_BLEND_BY_MAX_BRIGHTNESS: {
             for (size_t i = 0; i < mPixelsCount; ++i) {
-                leds[i] = CRGB::blendAlphaMaxChannel(mRgb[i], leds[i]);
+                leds[i] = CRGB::blendAlphaMaxChannel(pixels[i], leds[i]);
             }
             break;
         }
@@ -43,6 +64,7 @@ void Frame::draw(CRGB *leds, DrawMode draw_mode) const {
 void Frame::drawXY(CRGB *leds, const XYMap &xyMap, DrawMode draw_mode) const {
     const uint16_t width = xyMap.getWidth();
     const uint16_t height = xyMap.getHeight();
+    const CRGB *pixels = rgb();
     uint32_t count = 0;
     for (uint16_t h = 0; h < height; ++h) {
         for (uint16_t w = 0; w < width; ++w) {
@@ -60,12 +82,12 @@ void Frame::drawXY(CRGB *leds, const XYMap &xyMap, DrawMode draw_mode) const {
             }
             switch (draw_mode) {
             case DRAW_MODE_OVERWRITE: {
-                leds[out_idx] = mRgb[in_idx];
+                leds[out_idx] = pixels[in_idx];
                 break;
             }
             case DRAW_MODE_BLEND_BY_MAX_BRIGHTNESS: {
                 leds[out_idx] =
-                    CRGB::blendAlphaMaxChannel(mRgb[in_idx], leds[in_idx]);
+                    CRGB::blendAlphaMaxChannel(pixels[in_idx], leds[in_idx]);
                 break;
             }
             }
@@ -73,7 +95,7 @@ void Frame::drawXY(CRGB *leds, const XYMap &xyMap, DrawMode draw_mode) const {
     }
 }
 
-void Frame::clear() { memset(mRgb.data(), 0, mPixelsCount * sizeof(CRGB)); }
+void Frame::clear() { memset(ownPixels(), 0, mPixelsCount * sizeof(CRGB)); }
 
 void Frame::interpolate(const Frame &frame1, const Frame &frame2,
                         uint8_t amountofFrame2, CRGB *pixels) {
@@ -101,7 +123,9 @@ void Frame::interpolate(const Frame &frame1, const Frame &frame2,
         FASTLED_DBG("Frames must have the same size");
         return; // Frames must have the same size
     }
-    interpolate(frame1, frame2, amountOfFrame2, mRgb.data());
+    // writing over a view of this frame's own input has to copy it first
+    bool input = &frame1 == this || &frame2 == this;
+    interpolate(frame1, frame2, amountOfFrame2, input ? rgb() : ownPixels());
 }
 
 } // namespace fl
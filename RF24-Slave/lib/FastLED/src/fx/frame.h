@@ -27,8 +27,14 @@ class Frame : public fl::Referent {
     // blocks.
     explicit Frame(int pixels_per_frame);
     ~Frame() override;
-    CRGB *rgb() { return mRgb.data(); }
-    const CRGB *rgb() const { return mRgb.data(); }
+    // Mutable access copies a view (see setView) into the frame's own
+    // buffer first.
+    CRGB *rgb();
+    const CRGB *rgb() const { return mView ? mView : mRgb.data(); }
+    // Shows pixels owned by someone else (a memory-mapped file) instead of
+    // copying them. owner is kept alive while the view is in use.
+    void setView(const CRGB *pixels, fl::Ptr<fl::Referent> owner);
+    bool isView() const { return mView != nullptr; }
     size_t size() const { return mPixelsCount; }
     void copy(const Frame &other);
     void interpolate(const Frame &frame1, const Frame &frame2,
@@ -41,12 +47,17 @@ class Frame : public fl::Referent {
     void clear();
 
   private:
+    // The own buffer, for writing it whole: the view is dropped, not copied
+    CRGB *ownPixels();
+
     const size_t mPixelsCount;
     fl::vector<CRGB, fl::allocator_psram<CRGB>> mRgb;
+    const CRGB *mView = nullptr;
+    fl::Ptr<fl::Referent> mViewOwner;
 };
 
 inline void Frame::copy(const Frame &other) {
-    memcpy(mRgb.data(), other.mRgb.data(), other.mPixelsCount * sizeof(CRGB));
+    memcpy(ownPixels(), other.rgb(), other.mPixelsCount * sizeof(CRGB));
 }
 
 } // namespace fl
@@ -24,7 +24,9 @@ FASTLED_SMART_PTR(ByteStreamMemory);
 
 // Video represents a video file that can be played back on a LED strip.
 // The video file is expected to be a sequence of frames. You can either use
-// a file handle or a byte stream to read the video data.
+// a file handle or a byte stream to read the video data. A file handle may
+// also point at a compressed .rgbz file (see fx/video/video_codec.h and
+// ci/compress_video.py).
 class Video : public Fx1d { // Fx1d because video can be irregular.
   public:
     static size_t DefaultFrameHistoryCount() {
@@ -23,6 +23,12 @@ bool PixelStream::begin(FileHandlePtr h) {
     close();
     mFileHandle = h;
     mUsingByteStream = false;
+    if (mFileHandle && video_codec::isCompressed(*mFileHandle)) {
+        // A decoder that failed to begin stays, so a bad .rgbz file plays
+        // as an empty video instead of as raw pixels.
+        mDecoder = VideoDecoderPtr::New(mbytesPerFrame / 3);
+        return mDecoder->begin(mFileHandle) && !mDecoder->atEnd();
+    }
     return mFileHandle->available();
 }
 
@@ -38,6 +44,7 @@ void PixelStream::close() {
         mFileHandle.reset();
     }
     mByteStream.reset();
+    mDecoder.reset();
     mFileHandle.reset();
 }
 
@@ -54,6 +61,9 @@ bool PixelStream::readPixel(CRGB *dst) {
 }
 
 bool PixelStream::available() const {
+    if (mDecoder) {
+        return !mDecoder->atEnd();
+    }
     if (mUsingByteStream) {
         return mByteStream->available(mbytesPerFrame);
     } else {
@@ -62,6 +72,9 @@ bool PixelStream::available() const {
 }
 
 bool PixelStream::atEnd() const {
+    if (mDecoder) {
+        return mDecoder->atEnd();
+    }
     if (mUsingByteStream) {
         return false;
     } else {
@@ -73,10 +86,16 @@ bool PixelStream::readFrame(Frame *frame) {
     if (!frame) {
         return false;
     }
+    if (mDecoder) {
+        return mDecoder->decodeNext(frame->rgb());
+    }
     if (!mUsingByteStream) {
         if (!framesRemaining()) {
             return false;
         }
+        if (viewFrame(mFileHandle->pos(), frame)) {
+            return true;
+        }
         size_t n = mFileHandle->readCRGB(frame->rgb(), mbytesPerFrame / 3);
         DBG("pos: " << mFileHandle->pos());
         return n * 3 == size_t(mbytesPerFrame);
@@ -90,6 +109,8 @@ bool PixelStream::hasFrame(uint32_t frameNumber) {
         // ByteStream doesn't support seeking
         DBG("Not implemented and therefore always returns true");
         return true;
+    } else if (mDecoder) {
+        return frameNumber < mDecoder->frameCount();
     } else {
         size_t total_bytes = mFileHandle->size();
         return frameNumber * mbytesPerFrame < total_bytes;
@@ -102,12 +123,17 @@ bool PixelStream::readFrameAt(uint32_t frameNumber, Frame *frame) {
         // ByteStream doesn't support seeking
         FASTLED_DBG("ByteStream doesn't support seeking");
         return false;
+    } else if (mDecoder) {
+        return mDecoder->decode(frameNumber, frame->rgb());
     } else {
         // DBG("mbytesPerFrame: " << mbytesPerFrame);
         mFileHandle->seek(frameNumber * mbytesPerFrame);
         if (mFileHandle->bytesLeft() == 0) {
             return false;
         }
+        if (viewFrame(frameNumber * mbytesPerFrame, frame)) {
+            return true;
+        }
         size_t read =
             mFileHandle->readCRGB(frame->rgb(), mbytesPerFrame / 3) * 3;
         // DBG("read: " << read);
@@ -123,6 +149,17 @@ bool PixelStream::readFrameAt(uint32_t frameNumber, Frame *frame) {
     }
 }
 
+bool PixelStream::viewFrame(size_t pos, Frame *frame) {
+    const uint8_t *pixels = mFileHandle->view(pos, mbytesPerFrame);
+    if (!pixels) {
+        return false;
+    }
+    // no copy: the frame shows the mapped file and keeps it referenced
+    frame->setView(reinterpret_cast<const CRGB *>(pixels), mFileHandle);
+    mFileHandle->seek(pos + mbytesPerFrame);
+    return true;
+}
+
 int32_t PixelStream::framesRemaining() const {
     if (mbytesPerFrame == 0)
         return 0;
@@ -138,6 +175,8 @@ int32_t PixelStream::framesDisplayed() const {
         // ByteStream doesn't have a concept of total size, so we can't
         // calculate this
         return -1;
+    } else if (mDecoder) {
+        return mDecoder->nextFrame();
     } else {
         int32_t bytes_played = mFileHandle->pos();
         return bytes_played / mbytesPerFrame;
@@ -147,6 +186,11 @@ int32_t PixelStream::framesDisplayed() const {
 int32_t PixelStream::bytesRemaining() const {
     if (mUsingByteStream) {
         return INT32_MAX;
+    } else if (mDecoder) {
+        // decoded bytes, so that framesRemaining() matches a raw file
+        uint32_t frames = mDecoder->frameCount() - mDecoder->nextFrame();
+        uint64_t bytes = uint64_t(frames) * mbytesPerFrame;
+        return bytes > INT32_MAX ? INT32_MAX : int32_t(bytes);
     } else {
         return mFileHandle->bytesLeft();
     }
@@ -160,6 +204,9 @@ bool PixelStream::rewind() {
     if (mUsingByteStream) {
         // ByteStream doesn't support rewinding
         return false;
+    } else if (mDecoder) {
+        mDecoder->rewind();
+        return true;
     } else {
         mFileHandle->seek(0);
         return true;
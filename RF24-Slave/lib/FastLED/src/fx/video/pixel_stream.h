@@ -6,9 +6,11 @@
 #include "fl/namespace.h"
 #include "fl/ptr.h"
 #include "fx/frame.h"
+#include "fx/video/video_codec.h"
 namespace fl {
 FASTLED_SMART_PTR(FileHandle);
 FASTLED_SMART_PTR(ByteStream);
+FASTLED_SMART_PTR(VideoDecoder);
 } // namespace fl
 
 namespace fl {
@@ -17,7 +19,9 @@ FASTLED_SMART_PTR(PixelStream);
 
 // PixelStream takes either a file handle or a byte stream
 // and reads frames from it in order to serve data to the
-// video system.
+// video system. A file may hold raw RGB frames or the compressed .rgbz
+// container (see fx/video/video_codec.h); begin() tells them apart by the
+// header and the frame api works the same for both.
 class PixelStream : public fl::Referent {
   public:
     enum Type {
@@ -31,6 +35,7 @@ class PixelStream : public fl::Referent {
     bool beginStream(fl::ByteStreamPtr s);
     void close();
     int32_t bytesPerFrame();
+    // Raw access to the underlying bytes, not decoded for .rgbz files.
     bool readPixel(CRGB *dst); // Convenience function to read a pixel
     size_t readBytes(uint8_t *dst, size_t len);
 
@@ -48,11 +53,16 @@ class PixelStream : public fl::Referent {
     rewind(); // Returns false on failure, which can happen for streaming mode.
     Type getType()
         const; // Returns the type of the video stream (kStreaming or kFile)
+    bool isCompressed() const { return bool(mDecoder); }
 
   private:
+    // Points frame at the bytes of a memory-mapped file, if it is one
+    bool viewFrame(size_t pos, Frame *frame);
+
     int32_t mbytesPerFrame;
     fl::FileHandlePtr mFileHandle;
     fl::ByteStreamPtr mByteStream;
+    fl::VideoDecoderPtr mDecoder; // set for .rgbz files
     bool mUsingByteStream;
 
   protected:
@@ -0,0 +1,390 @@
+#include <string.h>
+
+#include "fx/video/video_codec.h"
+
+#include "fl/dbg.h"
+#include "fl/math_macros.h"
+#include "fl/namespace.h"
+#include "fl/warn.h"
+
+#define DBG FASTLED_DBG
+
+namespace fl {
+
+namespace {
+
+const uint8_t kMagic[4] = {'R', 'G', 'B', 'Z'};
+// count - 1 above this is stored in a u16 after the op byte
+const uint32_t kShortCount = 63;
+const uint32_t kMaxCount = kShortCount + 0xFFFF + 1;
+
+uint16_t le16(const uint8_t *p) { return uint16_t(p[0] | (p[1] << 8)); }
+
+uint32_t le32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+           (uint32_t(p[3]) << 24);
+}
+
+void putLe16(fl::vector<uint8_t> *out, uint16_t v) {
+    out->push_back(uint8_t(v));
+    out->push_back(uint8_t(v >> 8));
+}
+
+void putLe32(fl::vector<uint8_t> *out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out->push_back(uint8_t(v >> (8 * i)));
+    }
+}
+
+void putPixels(fl::vector<uint8_t> *out, const CRGB *pixels, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        out->push_back(pixels[i].r);
+        out->push_back(pixels[i].g);
+        out->push_back(pixels[i].b);
+    }
+}
+
+// One op covering count pixels, count <= kMaxCount
+void putOp(fl::vector<uint8_t> *out, uint8_t kind, uint32_t count) {
+    uint32_t n = count - 1;
+    if (n < kShortCount) {
+        out->push_back(uint8_t((kind << 6) | n));
+        return;
+    }
+    out->push_back(uint8_t((kind << 6) | kShortCount));
+    putLe16(out, uint16_t(n - kShortCount));
+}
+
+// Encodes cur as run ops against prev, or as a keyframe when prev is null
+void encodeOps(const CRGB *cur, const CRGB *prev, uint32_t n,
+               fl::vector<uint8_t> *out) {
+    uint32_t i = 0;
+    while (i < n) {
+        uint32_t j = i + 1;
+        if (prev && cur[i] == prev[i]) {
+            while (j < n && cur[j] == prev[j]) {
+                ++j;
+            }
+            for (uint32_t k = i; k < j; k += kMaxCount) {
+                putOp(out, video_codec::kSkip, MIN(kMaxCount, j - k));
+            }
+            i = j;
+            continue;
+        }
+        while (j < n && cur[j] == cur[i]) {
+            ++j;
+        }
+        if (j - i >= 2) {
+            // a repeat of two already beats two literal pixels
+            for (uint32_t k = i; k < j; k += kMaxCount) {
+                putOp(out, video_codec::kFill, MIN(kMaxCount, j - k));
+                putPixels(out, &cur[i], 1);
+            }
+            i = j;
+            continue;
+        }
+        // literal up to the next unchanged pixel or the next repeat
+        j = i + 1;
+        while (j < n && !(prev && cur[j] == prev[j]) &&
+               !(j + 1 < n && cur[j + 1] == cur[j])) {
+            ++j;
+        }
+        for (uint32_t k = i; k < j; k += kMaxCount) {
+            uint32_t count = MIN(kMaxCount, j - k);
+            putOp(out, video_codec::kLiteral, count);
+            putPixels(out, &cur[k], count);
+        }
+        i = j;
+    }
+}
+
+} // namespace
+
+namespace video_codec {
+
+bool isCompressed(FileHandle &file) {
+    uint8_t magic[4] = {};
+    bool ok = file.seek(0) && file.read(magic, 4) == 4;
+    file.seek(0);
+    return ok && memcmp(magic, kMagic, 4) == 0;
+}
+
+} // namespace video_codec
+
+VideoDecoder::VideoDecoder(size_t pixelsPerFrame)
+    : mPixelsPerFrame(pixelsPerFrame) {}
+
+VideoDecoder::~VideoDecoder() { close(); }
+
+bool VideoDecoder::begin(FileHandlePtr file) {
+    close();
+    if (!file || !video_codec::isCompressed(*file)) {
+        return false;
+    }
+    uint8_t header[video_codec::kHeaderSize];
+    if (file->read(header, sizeof(header)) != sizeof(header)) {
+        FASTLED_WARN("rgbz: truncated header");
+        return false;
+    }
+    if (header[4] != video_codec::kVersion ||
+        header[5] != video_codec::kHeaderSize) {
+        FASTLED_WARN("rgbz: unsupported version " << header[4]);
+        return false;
+    }
+    uint32_t pixels = le32(header + 8);
+    uint32_t frames = le32(header + 12);
+    uint32_t indexOffset = le32(header + 16);
+    if (pixels != mPixelsPerFrame) {
+        FASTLED_WARN("rgbz: " << pixels << " pixels per frame, expected "
+                              << mPixelsPerFrame);
+        return false;
+    }
+    if (indexOffset + size_t(frames) * video_codec::kIndexEntrySize >
+        file->size()) {
+        FASTLED_WARN("rgbz: index runs past the end of the file");
+        return false;
+    }
+    mFile = file;
+    mKeyframeInterval = le16(header + 6);
+    mFrameCount = frames;
+    mIndexOffset = indexOffset;
+    mReference = FramePtr::New(int(mPixelsPerFrame));
+    return true;
+}
+
+void VideoDecoder::close() {
+    mFile.reset();
+    mFrameCount = 0;
+    mNextFrame = 0;
+    mReferenceNumber = -1;
+    mStreamFrame = -1;
+    mBufferPos = mBufferLen = 0;
+}
+
+bool VideoDecoder::decode(uint32_t frameNumber, CRGB *dst) {
+    if (!mFile) {
+        return false;
+    }
+    if (frameNumber >= mFrameCount) {
+        mNextFrame = mFrameCount;
+        return false;
+    }
+    if (mReferenceNumber != int32_t(frameNumber)) {
+        uint32_t start = frameNumber;
+        bool fromKeyframe = false;
+        if (mReferenceNumber + 1 != int32_t(frameNumber) ||
+            mStreamFrame != int32_t(frameNumber)) {
+            // Not the record right after the last one: find where to start
+            uint32_t offset = 0, keyframe = 0;
+            if (!readIndex(frameNumber, &offset, &keyframe)) {
+                return false;
+            }
+            if (mReferenceNumber >= 0 &&
+                uint32_t(mReferenceNumber) < frameNumber &&
+                uint32_t(mReferenceNumber) >= keyframe) {
+                start = mReferenceNumber + 1;
+            } else {
+                start = keyframe;
+                fromKeyframe = true;
+            }
+            if (start != frameNumber && !readIndex(start, &offset, nullptr)) {
+                return false;
+            }
+            if (!seekData(offset)) {
+                return false;
+            }
+            mStreamFrame = start;
+        }
+        for (uint32_t f = start; f <= frameNumber; ++f) {
+            if (!decodeRecord(fromKeyframe && f == start)) {
+                DBG("rgbz: bad record for frame " << f);
+                mReferenceNumber = -1;
+                mStreamFrame = -1;
+                return false;
+            }
+            mReferenceNumber = f;
+            mStreamFrame = f + 1;
+        }
+    }
+    memcpy(dst, mReference->rgb(), mPixelsPerFrame * sizeof(CRGB));
+    mNextFrame = frameNumber + 1;
+    return true;
+}
+
+bool VideoDecoder::readIndex(uint32_t frameNumber, uint32_t *offset,
+                             uint32_t *keyframe) {
+    uint8_t entry[video_codec::kIndexEntrySize];
+    mStreamFrame = -1;
+    if (!seekData(mIndexOffset + frameNumber * video_codec::kIndexEntrySize) ||
+        !read(entry, sizeof(entry))) {
+        return false;
+    }
+    *offset = le32(entry);
+    if (keyframe) {
+        *keyframe = le32(entry + 4);
+    }
+    return true;
+}
+
+bool VideoDecoder::seekData(uint32_t offset) {
+    mBufferPos = mBufferLen = 0;
+    return mFile->seek(offset);
+}
+
+bool VideoDecoder::decodeRecord(bool needKeyframe) {
+    uint8_t type = 0;
+    if (!readByte(&type) || type > video_codec::kDelta) {
+        return false;
+    }
+    if (needKeyframe && type != video_codec::kKeyframe) {
+        return false;
+    }
+    CRGB *pixels = mReference->rgb();
+    uint32_t pos = 0;
+    while (pos < mPixelsPerFrame) {
+        uint8_t op = 0;
+        uint32_t count = 0;
+        if (!readByte(&op) || !readCount(op, &count) ||
+            pos + count > mPixelsPerFrame) {
+            return false;
+        }
+        switch (op >> 6) {
+        case video_codec::kSkip:
+            // a keyframe has nothing to skip to
+            if (type == video_codec::kKeyframe) {
+                return false;
+            }
+            break;
+        case video_codec::kLiteral:
+            if (!read(reinterpret_cast<uint8_t *>(pixels + pos), count * 3)) {
+                return false;
+            }
+            break;
+        case video_codec::kFill: {
+            uint8_t rgb[3];
+            if (!read(rgb, 3)) {
+                return false;
+            }
+            for (uint32_t i = pos; i < pos + count; ++i) {
+                pixels[i] = CRGB(rgb[0], rgb[1], rgb[2]);
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+        pos += count;
+    }
+    return true;
+}
+
+bool VideoDecoder::readCount(uint8_t op, uint32_t *count) {
+    uint32_t n = op & kShortCount;
+    if (n == kShortCount) {
+        uint8_t ext[2];
+        if (!read(ext, 2)) {
+            return false;
+        }
+        n += le16(ext);
+    }
+    *count = n + 1;
+    return true;
+}
+
+bool VideoDecoder::readByte(uint8_t *out) {
+    if (mBufferPos == mBufferLen) {
+        mBufferPos = 0;
+        mBufferLen = mFile->read(mBuffer, sizeof(mBuffer));
+        if (mBufferLen == 0) {
+            return false;
+        }
+    }
+    *out = mBuffer[mBufferPos++];
+    return true;
+}
+
+bool VideoDecoder::read(uint8_t *dst, size_t len) {
+    size_t buffered = MIN(len, mBufferLen - mBufferPos);
+    memcpy(dst, mBuffer + mBufferPos, buffered);
+    mBufferPos += buffered;
+    dst += buffered;
+    len -= buffered;
+    if (len == 0) {
+        return true;
+    }
+    if (len >= sizeof(mBuffer)) {
+        return mFile->read(dst, len) == len;
+    }
+    mBufferPos = 0;
+    mBufferLen = mFile->read(mBuffer, sizeof(mBuffer));
+    if (mBufferLen < len) {
+        return false;
+    }
+    memcpy(dst, mBuffer, len);
+    mBufferPos = len;
+    return true;
+}
+
+VideoEncoder::VideoEncoder(size_t pixelsPerFrame, uint16_t keyframeInterval)
+    : mPixelsPerFrame(pixelsPerFrame),
+      mKeyframeInterval(keyframeInterval ? keyframeInterval : 1) {}
+
+void VideoEncoder::addFrame(const CRGB *pixels) {
+    uint32_t frameNumber = mOffsets.size();
+    uint32_t n = mPixelsPerFrame;
+    bool keyframe =
+        frameNumber == 0 || frameNumber - mLastKeyframe >= mKeyframeInterval;
+    fl::vector<uint8_t> ops;
+    if (!keyframe) {
+        encodeOps(pixels, mPrevious.data(), n, &ops);
+        fl::vector<uint8_t> key;
+        encodeOps(pixels, nullptr, n, &key);
+        if (key.size() <= ops.size()) {
+            // a scene cut: the delta saves nothing
+            keyframe = true;
+            ops.swap(key);
+        }
+    } else {
+        encodeOps(pixels, nullptr, n, &ops);
+    }
+    if (keyframe) {
+        mLastKeyframe = frameNumber;
+        ++mKeyframeCount;
+    }
+    mOffsets.push_back(mRecords.size());
+    mKeyframes.push_back(mLastKeyframe);
+    mRecords.push_back(keyframe ? video_codec::kKeyframe : video_codec::kDelta);
+    for (size_t i = 0; i < ops.size(); ++i) {
+        mRecords.push_back(ops[i]);
+    }
+    mPrevious.resize(n);
+    memcpy(mPrevious.data(), pixels, n * sizeof(CRGB));
+}
+
+fl::vector<uint8_t> VideoEncoder::finish() const {
+    uint32_t frames = mOffsets.size();
+    uint32_t indexOffset = video_codec::kHeaderSize;
+    uint32_t dataOffset = indexOffset + frames * video_codec::kIndexEntrySize;
+    fl::vector<uint8_t> out;
+    out.reserve(dataOffset + mRecords.size());
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(kMagic[i]);
+    }
+    out.push_back(video_codec::kVersion);
+    out.push_back(video_codec::kHeaderSize);
+    putLe16(&out, mKeyframeInterval);
+    putLe32(&out, mPixelsPerFrame);
+    putLe32(&out, frames);
+    putLe32(&out, indexOffset);
+    putLe32(&out, dataOffset);
+    for (uint32_t i = 0; i < frames; ++i) {
+        putLe32(&out, dataOffset + mOffsets[i]);
+        putLe32(&out, mKeyframes[i]);
+    }
+    for (size_t i = 0; i < mRecords.size(); ++i) {
+        out.push_back(mRecords[i]);
+    }
+    return out;
+}
+
+} // namespace fl
@@ -0,0 +1,146 @@
+#pragma once
+
+/*
+Compressed, seekable video container (".rgbz") for PixelStream.
+
+A raw .rgb video is 3 bytes per pixel per frame. An .rgbz file holds the same
+frames losslessly as keyframes plus deltas against the previous frame:
+
+    header    24 bytes, little endian
+                "RGBZ", u8 version (1), u8 header size (24),
+                u16 keyframe interval, u32 pixels per frame, u32 frame count,
+                u32 index offset, u32 data offset
+    index     frame count x { u32 record offset, u32 keyframe number }
+    records   u8 type (0 = keyframe, 1 = delta), then run ops until the
+              frame's pixels are covered
+
+A run op is one byte: the top two bits are the kind, the low six bits the
+count - 1. A count field of 63 is followed by a u16 that is added to it, so a
+run covers 1..65599 pixels.
+
+    skip     pixels unchanged from the previous frame (deltas only)
+    literal  count x RGB follow
+    fill     one RGB follows, repeated count times
+
+Seeking to frame n reads its index entry, then decodes from its keyframe (or
+from the last decoded frame, when that is closer) up to n. Playing forwards
+reads one record per frame. PixelStream recognises the header, so an .rgbz
+file works anywhere a raw .rgb file does.
+
+ci/compress_video.py converts a raw .rgb file on the host. VideoEncoder below
+produces the same bytes.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crgb.h"
+#include "fl/file_system.h"
+#include "fl/namespace.h"
+#include "fl/ptr.h"
+#include "fl/vector.h"
+#include "fx/frame.h"
+
+namespace fl {
+
+FASTLED_SMART_PTR(FileHandle);
+FASTLED_SMART_PTR(VideoDecoder);
+
+namespace video_codec {
+
+enum {
+    kVersion = 1,
+    kHeaderSize = 24,
+    kIndexEntrySize = 8,
+    kDefaultKeyframeInterval = 30,
+};
+
+enum RecordType { kKeyframe = 0, kDelta = 1 };
+enum OpKind { kSkip = 0, kLiteral = 1, kFill = 2 };
+
+// True if the file starts with the .rgbz magic. Leaves the file at 0.
+bool isCompressed(FileHandle &file);
+
+} // namespace video_codec
+
+// Decodes frames of an .rgbz file. Keeps the last decoded frame as the
+// reference for the next delta.
+class VideoDecoder : public fl::Referent {
+  public:
+    explicit VideoDecoder(size_t pixelsPerFrame);
+
+    // Reads and checks the header. Fails if the file is not an .rgbz file or
+    // its frames are not pixelsPerFrame pixels.
+    bool begin(fl::FileHandlePtr file);
+    void close();
+
+    // Decodes frame n into dst. Frames past the end fail and leave the
+    // decoder at the end.
+    bool decode(uint32_t frameNumber, CRGB *dst);
+    // Decodes the next frame in order
+    bool decodeNext(CRGB *dst) { return decode(mNextFrame, dst); }
+
+    uint32_t frameCount() const { return mFrameCount; }
+    uint32_t nextFrame() const { return mNextFrame; }
+    uint16_t keyframeInterval() const { return mKeyframeInterval; }
+    void rewind() { mNextFrame = 0; }
+    bool atEnd() const { return mNextFrame >= mFrameCount; }
+
+  protected:
+    ~VideoDecoder() override;
+
+  private:
+    bool readIndex(uint32_t frameNumber, uint32_t *offset, uint32_t *keyframe);
+    bool seekData(uint32_t offset);
+    bool decodeRecord(bool needKeyframe);
+    bool readCount(uint8_t op, uint32_t *count);
+    bool readByte(uint8_t *out);
+    bool read(uint8_t *dst, size_t len);
+
+    fl::FileHandlePtr mFile;
+    size_t mPixelsPerFrame;
+    uint32_t mFrameCount = 0;
+    uint32_t mIndexOffset = 0;
+    uint16_t mKeyframeInterval = 0;
+    uint32_t mNextFrame = 0;
+    // Last decoded frame, -1 when there is none
+    int32_t mReferenceNumber = -1;
+    // Frame whose record the file is positioned at, -1 when unknown
+    int32_t mStreamFrame = -1;
+    FramePtr mReference;
+    // Small read-ahead so op headers do not cost a file read each; literal
+    // runs larger than what is buffered are read straight into the frame.
+    uint8_t mBuffer[64];
+    size_t mBufferPos = 0;
+    size_t mBufferLen = 0;
+};
+
+// Builds an .rgbz file in memory. Used on the host and by the tests; the
+// firmware only needs VideoDecoder.
+class VideoEncoder {
+  public:
+    explicit VideoEncoder(
+        size_t pixelsPerFrame,
+        uint16_t keyframeInterval = video_codec::kDefaultKeyframeInterval);
+
+    // A frame becomes a keyframe every keyframeInterval frames, or sooner
+    // when its delta would not be smaller than a keyframe.
+    void addFrame(const CRGB *pixels);
+    // Returns the whole file: header, index and records.
+    fl::vector<uint8_t> finish() const;
+
+    uint32_t frameCount() const { return mOffsets.size(); }
+    uint32_t keyframeCount() const { return mKeyframeCount; }
+
+  private:
+    size_t mPixelsPerFrame;
+    uint16_t mKeyframeInterval;
+    fl::vector<CRGB> mPrevious;
+    fl::vector<uint8_t> mRecords;
+    fl::vector<uint32_t> mOffsets;   // into mRecords
+    fl::vector<uint32_t> mKeyframes; // keyframe number of each frame
+    uint32_t mLastKeyframe = 0;
+    uint32_t mKeyframeCount = 0;
+};
+
+} // namespace fl
@@ -0,0 +1,221 @@
+#if defined(FASTLED_STUB_IMPL) && !defined(__EMSCRIPTEN__)
+
+#include "platforms/stub/fs_stub.h"
+
+#if __has_include(<sys/mman.h>)
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fl/math_macros.h"
+#include "fl/str.h"
+#include "fl/warn.h"
+
+namespace fl {
+
+namespace {
+// Bytes ahead of the playback position the kernel is asked to fetch
+const size_t kReadAhead = 1024 * 1024;
+} // namespace
+
+FASTLED_SMART_PTR(MmapFileHandle);
+FASTLED_SMART_PTR(StdioFileHandle);
+FASTLED_SMART_PTR(FsImplHost);
+
+class MmapFileHandle : public FileHandle {
+  public:
+    explicit MmapFileHandle(const char *path) : mPath(path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            mOpen = true;
+            if (st.st_size > 0) {
+                void *map = mmap(nullptr, size_t(st.st_size), PROT_READ,
+                                 MAP_PRIVATE, fd, 0);
+                if (map != MAP_FAILED) {
+                    mData = static_cast<const uint8_t *>(map);
+                    mSize = size_t(st.st_size);
+                    madvise(map, mSize, MADV_SEQUENTIAL);
+                } else {
+                    mOpen = false;
+                }
+            }
+        }
+        // the mapping stays valid without the descriptor
+        ::close(fd);
+    }
+
+    ~MmapFileHandle() override {
+        if (mData) {
+            munmap(const_cast<uint8_t *>(mData), mSize);
+        }
+    }
+
+    bool available() const override { return mOpen && mPos < mSize; }
+    size_t size() const override { return mSize; }
+    size_t read(uint8_t *dst, size_t bytesToRead) override {
+        if (!available()) {
+            return 0;
+        }
+        size_t n = MIN(bytesToRead, mSize - mPos);
+        adviseAround(mPos, n);
+        memcpy(dst, mData + mPos, n);
+        mPos += n;
+        return n;
+    }
+    size_t pos() const override { return mPos; }
+    const char *path() const override { return mPath.c_str(); }
+    bool seek(size_t pos) override {
+        mPos = pos;
+        return mOpen;
+    }
+    // Frames handed out by view() may still be on screen, so the mapping
+    // lives until the last reference goes away, not until close().
+    void close() override { mOpen = false; }
+    bool valid() const override { return mOpen; }
+
+    const uint8_t *view(size_t pos, size_t len) override {
+        if (!mOpen || pos > mSize || len > mSize - pos) {
+            return nullptr;
+        }
+        adviseAround(pos, len);
+        return mData + pos;
+    }
+
+  private:
+    // Keeps a WILLNEED window of kReadAhead bytes in front of the reader,
+    // renewed when the reader gets halfway through it or jumps out of it
+    void adviseAround(size_t pos, size_t len) {
+        if (pos >= mAdvisedBegin && pos + len + kReadAhead / 2 <= mAdvisedEnd) {
+            return;
+        }
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t begin = pos - pos % page;
+        size_t end = MIN(mSize, pos + len + kReadAhead);
+        madvise(const_cast<uint8_t *>(mData) + begin, end - begin,
+                MADV_WILLNEED);
+        mAdvisedBegin = begin;
+        mAdvisedEnd = end;
+    }
+
+    fl::Str mPath;
+    const uint8_t *mData = nullptr;
+    size_t mSize = 0;
+    size_t mPos = 0;
+    size_t mAdvisedBegin = 0;
+    size_t mAdvisedEnd = 0;
+    bool mOpen = false;
+};
+
+class StdioFileHandle : public FileHandle {
+  public:
+    explicit StdioFileHandle(const char *path)
+        : mPath(path), mFile(fopen(path, "rb")) {
+        if (mFile && fseek(mFile, 0, SEEK_END) == 0) {
+            long end = ftell(mFile);
+            mSize = end > 0 ? size_t(end) : 0;
+            fseek(mFile, 0, SEEK_SET);
+        }
+    }
+    ~StdioFileHandle() override { close(); }
+
+    bool available() const override { return mFile && mPos < mSize; }
+    size_t size() const override { return mSize; }
+    size_t read(uint8_t *dst, size_t bytesToRead) override {
+        if (!mFile) {
+            return 0;
+        }
+        size_t n = fread(dst, 1, bytesToRead, mFile);
+        mPos += n;
+        return n;
+    }
+    size_t pos() const override { return mPos; }
+    const char *path() const override { return mPath.c_str(); }
+    bool seek(size_t pos) override {
+        if (!mFile || fseek(mFile, long(pos), SEEK_SET) != 0) {
+            return false;
+        }
+        mPos = pos;
+        return true;
+    }
+    void close() override {
+        if (mFile) {
+            fclose(mFile);
+            mFile = nullptr;
+        }
+    }
+    bool valid() const override { return mFile != nullptr; }
+
+  private:
+    fl::Str mPath;
+    FILE *mFile;
+    size_t mSize = 0;
+    size_t mPos = 0;
+};
+
+class FsImplHost : public FsImpl {
+  public:
+    FsImplHost(const char *root, HostFileAccess access)
+        : mRoot(root ? root : ""), mAccess(access) {}
+
+    bool begin() override { return true; }
+    void end() override {}
+    void close(FileHandlePtr file) override {
+        if (file) {
+            file->close();
+        }
+    }
+
+    FileHandlePtr openRead(const char *path) override {
+        fl::Str full = mRoot;
+        if (!full.empty() && path[0] != '/') {
+            full.append("/");
+        }
+        full.append(path);
+        FileHandlePtr out;
+        switch (mAccess) {
+        case kHostFileMmap:
+            out = MmapFileHandlePtr::New(full.c_str());
+            break;
+        case kHostFileStdio:
+            out = StdioFileHandlePtr::New(full.c_str());
+            break;
+        }
+        if (!out || !out->valid()) {
+            FASTLED_WARN("Could not open " << full.c_str());
+            return FileHandlePtr();
+        }
+        return out;
+    }
+
+  private:
+    fl::Str mRoot;
+    HostFileAccess mAccess;
+};
+
+FsImplPtr make_host_filesystem(const char *root_dir, HostFileAccess access) {
+    return FsImplHostPtr::New(root_dir, access);
+}
+
+} // namespace fl
+
+#else // no <sys/mman.h>
+
+namespace fl {
+FsImplPtr make_host_filesystem(const char *root_dir, HostFileAccess access) {
+    FASTLED_UNUSED(root_dir);
+    FASTLED_UNUSED(access);
+    return make_sdcard_filesystem(0);
+}
+} // namespace fl
+
+#endif // __has_include(<sys/mman.h>)
+
+#endif // FASTLED_STUB_IMPL && !__EMSCRIPTEN__
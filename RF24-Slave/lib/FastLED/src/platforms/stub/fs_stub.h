@@ -0,0 +1,27 @@
+#pragma once
+
+// Host file system for native builds (the stub platform on Linux and macOS):
+// plays videos and reads screen maps straight from a directory.
+//
+// kHostFileMmap maps each file read-only. FileHandle::view() then hands out
+// frames in place, so PixelStream shows them without a per-frame copy, and
+// the kernel is told the access is sequential with a read-ahead window that
+// follows the playback position (madvise). kHostFileStdio reads through
+// stdio like an SD card driver would, mostly to compare against.
+
+#include "fl/file_system.h"
+#include "fl/namespace.h"
+
+namespace fl {
+
+enum HostFileAccess {
+    kHostFileMmap,
+    kHostFileStdio,
+};
+
+// Paths passed to openRead() are relative to root_dir. Returns a null
+// file system on platforms without <sys/mman.h>.
+FsImplPtr make_host_filesystem(const char *root_dir,
+                               HostFileAccess access = kHostFileMmap);
+
+} // namespace fl
@@ -0,0 +1,132 @@
+// Checks the fixed-point Animartrix back-end (Animartrix::setFixedPoint)
+// against the float one for every animation, and prints frames per second
+// of both.
+
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+#include "test.h"
+
+#include "FastLED.h"
+#include "fx/2d/animartrix.hpp"
+
+using namespace fl;
+
+namespace {
+
+struct Diff {
+    double mean = 0;     // mean absolute difference per channel
+    double outliers = 0; // fraction of channels off by more than 16
+};
+
+Diff compare(const std::vector<CRGB> &a, const std::vector<CRGB> &b) {
+    Diff d;
+    size_t total = 0, over = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            int e = abs(int(a[i].raw[c]) - int(b[i].raw[c]));
+            total += e;
+            over += e > 16;
+        }
+    }
+    d.mean = double(total) / (a.size() * 3);
+    d.outliers = double(over) / (a.size() * 3);
+    return d;
+}
+
+} // namespace
+
+TEST_CASE("fixed-point Animartrix matches the float renderer") {
+    const uint16_t width = 32, height = 32;
+    XYMap xy = XYMap::constructRectangularGrid(width, height);
+    Animartrix reference(xy, RGB_BLOBS5);
+    Animartrix fixed(xy, RGB_BLOBS5);
+    fixed.setFixedPoint(true);
+    std::vector<CRGB> a(width * height), b(width * height);
+
+    double worstMean = 0, totalMean = 0;
+    std::string worst;
+    for (int anim = 0; anim < NUM_ANIMATIONS; ++anim) {
+        reference.fxSet(anim);
+        fixed.fxSet(anim);
+        Diff sum;
+        int frames = 0;
+        for (uint32_t now : {1000u, 7000u, 20000u, 60000u}) {
+            reference.draw(Fx::DrawContext(now, a.data()));
+            fixed.draw(Fx::DrawContext(now, b.data()));
+            Diff d = compare(a, b);
+            sum.mean += d.mean;
+            sum.outliers += d.outliers;
+            ++frames;
+        }
+        sum.mean /= frames;
+        sum.outliers /= frames;
+        INFO(std::string(ANIMATION_TABLE[anim].name) << " mean " << sum.mean
+                                        << " outliers " << sum.outliers);
+        CHECK(sum.mean < 0.25);
+        CHECK(sum.outliers < 0.002);
+        totalMean += sum.mean;
+        if (sum.mean > worstMean) {
+            worstMean = sum.mean;
+            worst = ANIMATION_TABLE[anim].name;
+        }
+    }
+    MESSAGE("mean channel error " << totalMean / NUM_ANIMATIONS << ", worst "
+                                  << worst << " " << worstMean);
+}
+
+TEST_CASE("Animartrix on a non-square matrix") {
+    // taller than wide, and switching animations keeps the polar tables
+    const uint16_t width = 12, height = 20;
+    XYMap xy = XYMap::constructRectangularGrid(width, height);
+    Animartrix reference(xy, CHASING_SPIRALS);
+    Animartrix fixed(xy, CHASING_SPIRALS);
+    fixed.setFixedPoint(true);
+    std::vector<CRGB> a(width * height), b(width * height);
+    for (int anim : {CHASING_SPIRALS, WATER, MODULE_EXPERIMENT_SM10}) {
+        reference.fxSet(anim);
+        fixed.fxSet(anim);
+        reference.draw(Fx::DrawContext(5000, a.data()));
+        fixed.draw(Fx::DrawContext(5000, b.data()));
+        CHECK(compare(a, b).mean < 0.25);
+    }
+}
+
+TEST_CASE("Animartrix frames per second") {
+    typedef std::chrono::steady_clock Clock;
+    const uint16_t width = 32, height = 32;
+    XYMap xy = XYMap::constructRectangularGrid(width, height);
+    std::vector<CRGB> leds(width * height);
+
+    // best of a few frames, each at its own time so the animation moves
+    auto fps = [&](Animartrix &fx) {
+        double best = 1e9;
+        for (uint32_t frame = 0; frame < 8; ++frame) {
+            Clock::time_point start = Clock::now();
+            fx.draw(Fx::DrawContext(1000 + frame * 33, leds.data()));
+            double s =
+                std::chrono::duration<double>(Clock::now() - start).count();
+            best = s < best ? s : best;
+        }
+        return 1 / best;
+    };
+
+    double floatTotal = 0, fixedTotal = 0;
+    for (int anim = 0; anim < NUM_ANIMATIONS; ++anim) {
+        Animartrix reference(xy, AnimartrixAnim(anim));
+        Animartrix fixed(xy, AnimartrixAnim(anim));
+        fixed.setFixedPoint(true);
+        double f = fps(reference);
+        double q = fps(fixed);
+        floatTotal += 1 / f;
+        fixedTotal += 1 / q;
+        MESSAGE(std::string(ANIMATION_TABLE[anim].name) << ": float " << int(f)
+                                           << " fps, fixed " << int(q)
+                                           << " fps, 32x32");
+    }
+    MESSAGE("all animations: float " << NUM_ANIMATIONS / floatTotal
+                                     << " fps, fixed "
+                                     << NUM_ANIMATIONS / fixedTotal
+                                     << " fps on average");
+}
@@ -0,0 +1,180 @@
+// Checks the batch blur engine (fl/blur_batch.h) against the per-pixel
+// kernels it replaced, on every compiled-in path, and prints the throughput.
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+#include "fl/blur.h"
+#include "fl/blur_batch.h"
+#include "fl/xymap.h"
+
+using namespace fl;
+
+namespace {
+
+// The per-pixel kernel blur1d/blurRows/blurColumns used before the batch
+// engine, with an arbitrary index function
+template <typename Index>
+void referenceBlur(CRGB *leds, uint16_t count, fract8 blur_amount,
+                   Index index) {
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+    CRGB carryover = CRGB::Black;
+    for (uint16_t i = 0; i < count; ++i) {
+        CRGB cur = leds[index(i)];
+        CRGB part = cur;
+        part.nscale8(seep);
+        cur.nscale8(keep);
+        cur += carryover;
+        if (i)
+            leds[index(i - 1)] += part;
+        leds[index(i)] = cur;
+        carryover = part;
+    }
+}
+
+void referenceBlur2d(CRGB *leds, uint8_t width, uint8_t height,
+                     fract8 blur_amount, const XYMap &xyMap) {
+    for (uint8_t row = 0; row < height; ++row) {
+        referenceBlur(leds, width, blur_amount, [&](uint16_t i) {
+            return xyMap.mapToIndex(i, row);
+        });
+    }
+    for (uint8_t col = 0; col < width; ++col) {
+        referenceBlur(leds, height, blur_amount, [&](uint16_t i) {
+            return xyMap.mapToIndex(col, i);
+        });
+    }
+}
+
+std::vector<CRGB> randomLeds(std::mt19937 &rng, size_t count) {
+    std::vector<CRGB> leds(count);
+    for (auto &led : leds) {
+        // mostly bright, so the saturating adds get exercised
+        led = CRGB(rng() % 4 ? 200 + rng() % 56 : rng() % 256,
+                   rng() % 256, rng() % 2 ? 255 : 0);
+    }
+    return leds;
+}
+
+bool sameLeds(const std::vector<CRGB> &a, const std::vector<CRGB> &b) {
+    return a.size() == b.size() &&
+           (a.empty() || memcmp(a.data(), b.data(), a.size() * 3) == 0);
+}
+
+std::vector<blur_batch::Path> availablePaths() {
+    std::vector<blur_batch::Path> paths;
+    const blur_batch::Path all[] = {blur_batch::kScalar, blur_batch::kSwar,
+                                    blur_batch::kSse2, blur_batch::kNeon};
+    for (blur_batch::Path path : all) {
+        if (blur_batch::isAvailable(path)) {
+            paths.push_back(path);
+        }
+    }
+    return paths;
+}
+
+uint16_t identity(uint16_t i) { return i; }
+
+} // namespace
+
+TEST_CASE("blur_batch rows and columns match the per-pixel kernel") {
+    std::mt19937 rng(0x626c7572); // "blur"
+    const uint16_t lengths[] = {0, 1, 2, 3, 5, 15, 16, 17, 63, 64, 65, 130, 300};
+    for (blur_batch::Path path : availablePaths()) {
+        INFO("path " << std::string(blur_batch::pathName(path)));
+        for (int amount = 0; amount < 256; amount += 3) {
+            for (uint16_t length : lengths) {
+                std::vector<CRGB> leds = randomLeds(rng, length);
+                std::vector<CRGB> expected = leds;
+                referenceBlur(expected.data(), length, amount, identity);
+                blur_batch::blurRow(leds.data(), length, amount, path);
+                REQUIRE(sameLeds(leds, expected));
+            }
+
+            uint16_t width = 1 + rng() % 140;
+            uint16_t height = 1 + rng() % 12;
+            std::vector<CRGB> leds = randomLeds(rng, width * height);
+            std::vector<CRGB> expected = leds;
+            for (uint16_t col = 0; col < width; ++col) {
+                referenceBlur(expected.data(), height, amount,
+                              [&](uint16_t i) { return i * width + col; });
+            }
+            blur_batch::blurColumns(leds.data(), width, height, amount, path);
+            REQUIRE(sameLeds(leds, expected));
+        }
+    }
+}
+
+TEST_CASE("blur2d is bit-exact for every XYMap type") {
+    std::mt19937 rng(1);
+    static uint16_t lut[70 * 9];
+    for (uint16_t i = 0; i < 70 * 9; ++i) {
+        lut[i] = (i * 7) % (70 * 9); // 7 is coprime with 630: a permutation
+    }
+    const uint8_t width = 70, height = 9;
+    XYMap maps[] = {
+        XYMap::constructRectangularGrid(width, height),
+        XYMap::constructSerpentine(width, height),
+        XYMap::constructRectangularGrid(width, height, 5),
+        XYMap::constructWithLookUpTable(width, height, lut),
+    };
+    for (const XYMap &xyMap : maps) {
+        for (int amount : {0, 1, 64, 128, 172, 200, 255}) {
+            std::vector<CRGB> leds = randomLeds(rng, width * height + 5);
+            std::vector<CRGB> expected = leds;
+            referenceBlur2d(expected.data(), width, height, amount, xyMap);
+            blur2d(leds.data(), width, height, amount, xyMap);
+            CHECK(sameLeds(leds, expected));
+
+            leds = randomLeds(rng, width * height + 5);
+            expected = leds;
+            referenceBlur(expected.data(), leds.size(), amount, identity);
+            blur1d(leds.data(), leds.size(), amount);
+            CHECK(sameLeds(leds, expected));
+        }
+    }
+}
+
+TEST_CASE("blur2d throughput") {
+    typedef std::chrono::steady_clock Clock;
+    const uint8_t width = 128, height = 128;
+    const int frames = 20;
+    std::mt19937 rng(2);
+    std::vector<CRGB> source = randomLeds(rng, width * height);
+    XYMap xyMap = XYMap::constructRectangularGrid(width, height);
+
+    auto mpixels = [&](Clock::time_point start) {
+        double seconds =
+            std::chrono::duration<double>(Clock::now() - start).count();
+        return double(width) * height * frames / seconds / 1e6;
+    };
+
+    std::vector<CRGB> leds = source;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        referenceBlur2d(leds.data(), width, height, 172, xyMap);
+    }
+    MESSAGE("blur2d 128x128 per-pixel kernel: " << mpixels(start)
+                                                << " Mpixel/s");
+    std::vector<CRGB> expected = leds;
+
+    for (blur_batch::Path path : availablePaths()) {
+        leds = source;
+        start = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            for (uint8_t row = 0; row < height; ++row) {
+                blur_batch::blurRow(leds.data() + row * width, width, 172,
+                                    path);
+            }
+            blur_batch::blurColumns(leds.data(), width, height, 172, path);
+        }
+        std::string name = blur_batch::pathName(path);
+        MESSAGE("blur2d 128x128 " << name << ": " << mpixels(start)
+                                  << " Mpixel/s");
+        CHECK(sameLeds(leds, expected));
+    }
+}
@@ -0,0 +1,129 @@
+// Benchmarks the LRU-backed FFT plan cache (fl::FFT) and the HashMapLru
+// underneath it. Timings are printed; the checks only assert that the cache
+// behaves and that eviction cost does not grow with the cache size.
+
+#include <chrono>
+
+#include "test.h"
+
+#include "fl/fft.h"
+#include "fl/fft_impl.h"
+#include "fl/hash_map_lru.h"
+#include "fl/math.h"
+
+using namespace fl;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count();
+}
+
+// Best of three runs of a full cache taking `ops` new keys (one eviction each)
+double churnNsPerInsert(size_t capacity, int ops) {
+    double best = 1e30;
+    for (int round = 0; round < 3; ++round) {
+        HashMapLru<int, int> lru(capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+            lru.insert(int(i), int(i));
+        }
+        int key = int(capacity);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < ops; ++i, ++key) {
+            lru.insert(key, key);
+            // keep a hot key alive so hits and evictions interleave
+            lru.find_value(key - 1);
+        }
+        double ns = elapsedNs(start) / ops;
+        REQUIRE(lru.size() == capacity);
+        REQUIRE(lru.find_value(key - 1) != nullptr);
+        best = ns < best ? ns : best;
+    }
+    return best;
+}
+
+FFT_Args configFor(int i) {
+    // 3 sample sizes x 4 band counts x 3 frequency ranges = 36 plans
+    static const int samples[] = {128, 256, 512};
+    static const int bands[] = {8, 12, 16, 24};
+    static const float fmax[] = {2000.0f, 4698.3f, 8000.0f};
+    return FFT_Args(samples[i % 3], bands[(i / 3) % 4],
+                    FFT_Args::DefaultMinFrequency(), fmax[(i / 12) % 3]);
+}
+
+// Runs every config in turn, `passes` times; returns the mean time per run
+double runConfigs(FFT &fft, const int16_t *buffer, int configs, int passes,
+                  size_t cache_size) {
+    Clock::time_point start = Clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (int i = 0; i < configs; ++i) {
+            FFT_Args args = configFor(i);
+            FFTBins out(args.bands);
+            fft.run(Slice<const int16_t>(buffer, args.samples), &out, args);
+            REQUIRE(out.bins_raw.size() == size_t(args.bands));
+            REQUIRE(fft.size() <= cache_size);
+        }
+    }
+    return elapsedNs(start) / (configs * passes);
+}
+
+} // namespace
+
+TEST_CASE("HashMapLru eviction cost does not depend on capacity") {
+    const int ops = 100000;
+    double small = churnNsPerInsert(8, ops);
+    double large = churnNsPerInsert(4096, ops);
+    MESSAGE("HashMapLru insert+evict: capacity 8 = " << small
+            << " ns, capacity 4096 = " << large << " ns");
+    // A scan over every entry would be hundreds of times slower at 4096
+    CHECK(large < small * 32);
+}
+
+TEST_CASE("FFT plan cache under churn") {
+    int16_t buffer[512];
+    for (int i = 0; i < 512; ++i) {
+        float rot = fl::map_range<float, float>(i, 0, 511, 0, 2 * PI * 10);
+        buffer[i] = int16_t(32767 * sin(rot));
+    }
+
+    const size_t cache_size = 8;
+    const int passes = 4;
+    FFT fft;
+    fft.setFFTCacheSize(cache_size);
+
+    // working set fits: after the first pass every run is a cache hit
+    runConfigs(fft, buffer, 6, 1, cache_size);
+    double hits = runConfigs(fft, buffer, 6, passes, cache_size);
+    // 36 configs cycling through 8 slots: every run builds a new plan
+    double churn = runConfigs(fft, buffer, 36, passes, cache_size);
+    CHECK(fft.size() == cache_size);
+
+    // a cache that holds the whole working set stops the churn again
+    fft.setFFTCacheSize(36);
+    runConfigs(fft, buffer, 36, 1, 36);
+    double resized = runConfigs(fft, buffer, 36, passes, 36);
+    CHECK(fft.size() == 36);
+
+    // shrinking evicts down to the new size
+    fft.setFFTCacheSize(4);
+    CHECK(fft.size() == 4);
+
+    MESSAGE("FFT run, 6 configs / 8 slots (hits): " << hits / 1000 << " us");
+    MESSAGE("FFT run, 36 configs / 8 slots (churn): " << churn / 1000 << " us");
+    MESSAGE("FFT run, 36 configs / 36 slots (hits): " << resized / 1000
+            << " us");
+
+    // a cached plan gives the same bins as a freshly built one
+    FFT_Args args = configFor(7);
+    FFTBins cached(args.bands), fresh(args.bands);
+    fft.run(Slice<const int16_t>(buffer, args.samples), &cached, args);
+    FFTImpl impl(args);
+    impl.run(Slice<const int16_t>(buffer, args.samples), &fresh);
+    REQUIRE(cached.bins_raw.size() == fresh.bins_raw.size());
+    for (size_t i = 0; i < fresh.bins_raw.size(); ++i) {
+        CHECK(cached.bins_raw[i] == fresh.bins_raw[i]);
+    }
+}
@@ -0,0 +1,154 @@
+// Checks the host file system (platforms/stub/fs_stub.h): mmap and stdio
+// handles read the same bytes, memory-mapped videos play without copying
+// frames, and prints playback throughput for both.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "test.h"
+
+#include "crgb.h"
+#include "fl/file_system.h"
+#include "fx/frame.h"
+#include "fx/video.h"
+#include "fx/video/pixel_stream.h"
+#include "platforms/stub/fs_stub.h"
+
+using namespace fl;
+
+namespace {
+
+const int kPixels = 64 * 64;
+
+// A temporary raw video, removed again when the test is done
+struct TempVideo {
+    explicit TempVideo(int frames) {
+        char path[] = "/tmp/fastled_fs_stub_XXXXXX";
+        int fd = mkstemp(path);
+        REQUIRE(fd >= 0);
+        this->path = path;
+        std::vector<CRGB> frame(kPixels);
+        FILE *f = fdopen(fd, "wb");
+        for (int n = 0; n < frames; ++n) {
+            for (int i = 0; i < kPixels; ++i) {
+                frame[i] = CRGB(uint8_t(n), uint8_t(i), uint8_t(i >> 8));
+            }
+            fwrite(frame.data(), sizeof(CRGB), kPixels, f);
+            pixels.insert(pixels.end(), frame.begin(), frame.end());
+        }
+        fclose(f);
+    }
+    ~TempVideo() { unlink(path.c_str()); }
+
+    std::string path;
+    std::vector<CRGB> pixels;
+};
+
+} // namespace
+
+TEST_CASE("host file system: mmap and stdio handles agree") {
+    TempVideo video(10);
+    FsImplPtr mmapFs = make_host_filesystem("", kHostFileMmap);
+    FsImplPtr stdioFs = make_host_filesystem("", kHostFileStdio);
+    FileHandlePtr a = mmapFs->openRead(video.path.c_str());
+    FileHandlePtr b = stdioFs->openRead(video.path.c_str());
+    REQUIRE(a);
+    REQUIRE(b);
+    CHECK(a->size() == b->size());
+    CHECK(a->size() == size_t(10 * kPixels * 3));
+    CHECK(a->view(0, 16) != nullptr);
+    CHECK(b->view(0, 16) == nullptr);
+    CHECK(a->view(a->size() - 1, 2) == nullptr);
+
+    for (size_t pos : {size_t(0), size_t(7), size_t(5 * kPixels * 3 + 1)}) {
+        REQUIRE(a->seek(pos));
+        REQUIRE(b->seek(pos));
+        uint8_t x[300], y[300];
+        REQUIRE(a->read(x, sizeof(x)) == sizeof(x));
+        REQUIRE(b->read(y, sizeof(y)) == sizeof(y));
+        CHECK(memcmp(x, y, sizeof(x)) == 0);
+        CHECK(memcmp(x, a->view(pos, sizeof(x)), sizeof(x)) == 0);
+        CHECK(a->pos() == pos + sizeof(x));
+        CHECK(a->bytesLeft() == b->bytesLeft());
+    }
+    CHECK_FALSE(mmapFs->openRead("/nonexistent/video.rgb"));
+    CHECK_FALSE(stdioFs->openRead("/nonexistent/video.rgb"));
+}
+
+TEST_CASE("memory-mapped frames are views") {
+    TempVideo video(4);
+    FsImplPtr fs = make_host_filesystem("", kHostFileMmap);
+    PixelStreamPtr stream = PixelStreamPtr::New(kPixels * 3);
+    REQUIRE(stream->begin(fs->openRead(video.path.c_str())));
+    FramePtr frame = FramePtr::New(kPixels);
+    REQUIRE(stream->readFrameAt(2, frame.get()));
+    CHECK(frame->isView());
+    CHECK(stream->framesRemaining() == 1);
+    const Frame &view = *frame;
+    CHECK(memcmp(view.rgb(), &video.pixels[2 * kPixels], kPixels * 3) == 0);
+
+    // the frame keeps the mapping alive after the stream lets go of it
+    stream.reset();
+    std::vector<CRGB> leds(kPixels);
+    frame->draw(leds.data());
+    CHECK(memcmp(leds.data(), &video.pixels[2 * kPixels], kPixels * 3) == 0);
+
+    // writing copies the view into the frame's own pixels first
+    CRGB *own = frame->rgb();
+    CHECK_FALSE(frame->isView());
+    CHECK(own[5] == video.pixels[2 * kPixels + 5]);
+    own[5] = CRGB::Red;
+    CHECK(video.pixels[2 * kPixels + 5] != CRGB(CRGB::Red));
+}
+
+TEST_CASE("Video plays memory-mapped and stdio files the same") {
+    TempVideo clip(45);
+    FileSystem mmapFs, stdioFs;
+    REQUIRE(mmapFs.begin(make_host_filesystem("", kHostFileMmap)));
+    REQUIRE(stdioFs.begin(make_host_filesystem("", kHostFileStdio)));
+    Video a = mmapFs.openVideo(clip.path.c_str(), kPixels, 30, 2);
+    Video b = stdioFs.openVideo(clip.path.c_str(), kPixels, 30, 2);
+    std::vector<CRGB> x(kPixels), y(kPixels);
+    for (uint32_t now = 0; now < 4000; now += 13) {
+        bool ok = a.draw(now, x.data());
+        REQUIRE(ok == b.draw(now, y.data()));
+        REQUIRE(memcmp(x.data(), y.data(), kPixels * 3) == 0);
+    }
+}
+
+TEST_CASE("host file system playback throughput") {
+    typedef std::chrono::steady_clock Clock;
+    const int frames = 600; // 64x64, 7 MB
+    TempVideo clip(frames);
+
+    auto run = [&](HostFileAccess access, const char *name) {
+        FsImplPtr fs = make_host_filesystem("", access);
+        PixelStreamPtr stream = PixelStreamPtr::New(kPixels * 3);
+        REQUIRE(stream->begin(fs->openRead(clip.path.c_str())));
+        FramePtr frame = FramePtr::New(kPixels);
+        std::vector<CRGB> leds(kPixels);
+        double best = 0;
+        for (int round = 0; round < 3; ++round) {
+            Clock::time_point start = Clock::now();
+            for (int f = 0; f < frames; ++f) {
+                REQUIRE(stream->readFrameAt(f, frame.get()));
+                frame->draw(leds.data());
+            }
+            double seconds =
+                std::chrono::duration<double>(Clock::now() - start).count();
+            double fps = frames / seconds;
+            best = fps > best ? fps : best;
+        }
+        REQUIRE(memcmp(leds.data(), &clip.pixels[size_t(frames - 1) * kPixels],
+                       kPixels * 3) == 0);
+        std::string label = name;
+        MESSAGE(label << ": " << best << " frames/s ("
+                      << best * kPixels * 3 / 1e6 << " MB/s), 64x64");
+    };
+    // draw() copies into the leds either way; mmap saves the read copy
+    run(kHostFileStdio, "stdio readFrameAt + draw");
+    run(kHostFileMmap, "mmap readFrameAt + draw");
+}
@@ -4,6 +4,8 @@
 #include <vector>
 #include <set>
 #include <unordered_map>
+#include <list>
+#include <random>
 
 #include "fl/hash_map_lru.h"
 #include "fl/str.h"
@@ -148,4 +150,96 @@ TEST_CASE("Test HashMapLRU") {
         CHECK(*lru.find_value(3) == 300);
         CHECK(*lru.find_value(4) == 400);
     }
+    
+    SUBCASE("Shrinking and growing the capacity") {
+        HashMapLru<int, int> lru(4);
+        for (int i = 1; i <= 4; ++i) {
+            lru.insert(i, i * 100);
+        }
+        lru.find_value(1);
+
+        // Shrinking evicts the least recently used entries
+        lru.setMaxSize(2);
+        CHECK(lru.size() == 2);
+        CHECK(lru.capacity() == 2);
+        CHECK(*lru.find_value(1) == 100);
+        CHECK(*lru.find_value(4) == 400);
+        CHECK(lru.find_value(2) == nullptr);
+
+        // Growing keeps everything
+        lru.setMaxSize(8);
+        CHECK(lru.size() == 2);
+        CHECK(lru.capacity() == 8);
+        lru.insert(5, 500);
+        CHECK(lru.size() == 3);
+    }
+
+    SUBCASE("Matches a reference LRU under random churn") {
+        // Reference model: front = most recently used
+        const size_t capacity = 16;
+        HashMapLru<int, int> lru(capacity);
+        std::list<std::pair<int, int>> model;
+        auto model_find = [&](int key) {
+            for (auto it = model.begin(); it != model.end(); ++it) {
+                if (it->first == key) {
+                    return it;
+                }
+            }
+            return model.end();
+        };
+
+        std::mt19937 rng(1234);
+        for (int step = 0; step < 20000; ++step) {
+            int key = rng() % 48;
+            int value = rng() % 1000;
+            auto it = model_find(key);
+            switch (rng() % 4) {
+            case 0: // insert
+                if (it != model.end()) {
+                    model.erase(it);
+                } else if (model.size() >= capacity) {
+                    model.pop_back();
+                }
+                model.push_front({key, value});
+                lru.insert(key, value);
+                break;
+            case 1: { // find
+                int *found = lru.find_value(key);
+                REQUIRE((found != nullptr) == (it != model.end()));
+                if (found) {
+                    CHECK(*found == it->second);
+                    model.splice(model.begin(), model, it);
+                }
+                break;
+            }
+            case 2: // operator[]
+                if (it != model.end()) {
+                    CHECK(lru[key] == it->second);
+                    model.splice(model.begin(), model, it);
+                } else {
+                    if (model.size() >= capacity) {
+                        model.pop_back();
+                    }
+                    model.push_front({key, 0});
+                    CHECK(lru[key] == 0);
+                }
+                break;
+            default: // remove
+                CHECK(lru.remove(key) == (it != model.end()));
+                if (it != model.end()) {
+                    model.erase(it);
+                }
+                break;
+            }
+            REQUIRE(lru.size() == model.size());
+        }
+
+        // Every surviving entry is present with its value
+        const HashMapLru<int, int> &const_lru = lru;
+        for (const auto &entry : model) {
+            const int *found = const_lru.find_value(entry.first);
+            REQUIRE(found != nullptr);
+            CHECK(*found == entry.second);
+        }
+    }
 }
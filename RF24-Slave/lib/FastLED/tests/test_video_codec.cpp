@@ -0,0 +1,278 @@
+// Checks the .rgbz video container (fx/video/video_codec.h): round trips,
+// seeking, playback through Video against the raw format, and prints decode
+// throughput next to raw reads.
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "test.h"
+
+#include "crgb.h"
+#include "fl/file_system.h"
+#include "fx/video.h"
+#include "fx/video/pixel_stream.h"
+#include "fx/video/video_codec.h"
+
+using namespace fl;
+
+namespace {
+
+FASTLED_SMART_PTR(MemoryFileHandle);
+
+class MemoryFileHandle : public FileHandle {
+  public:
+    explicit MemoryFileHandle(std::vector<uint8_t> bytes)
+        : data(std::move(bytes)) {}
+    bool available() const override { return mPos < data.size(); }
+    size_t size() const override { return data.size(); }
+    bool valid() const override { return true; }
+    size_t read(uint8_t *dst, size_t bytesToRead) override {
+        size_t n = mPos < data.size() ? data.size() - mPos : 0;
+        n = n < bytesToRead ? n : bytesToRead;
+        memcpy(dst, data.data() + mPos, n);
+        mPos += n;
+        bytesRead += n;
+        ++reads;
+        return n;
+    }
+    size_t pos() const override { return mPos; }
+    const char *path() const override { return "memory"; }
+    bool seek(size_t pos) override {
+        mPos = pos;
+        return true;
+    }
+    void close() override {}
+
+    std::vector<uint8_t> data;
+    size_t mPos = 0;
+    size_t bytesRead = 0;
+    size_t reads = 0;
+};
+
+const uint16_t kWidth = 64;
+const uint16_t kHeight = 8;
+const uint16_t kPixels = kWidth * kHeight;
+
+// A 64x8 clip: a gradient background that changes hue every 300 frames (a
+// scene cut) with a sprite moving over it
+std::vector<CRGB> makeClip(uint32_t frames) {
+    std::vector<CRGB> clip(size_t(frames) * kPixels);
+    for (uint32_t f = 0; f < frames; ++f) {
+        CRGB *frame = &clip[size_t(f) * kPixels];
+        uint8_t hue = uint8_t((f / 300) * 40);
+        for (uint16_t y = 0; y < kHeight; ++y) {
+            for (uint16_t x = 0; x < kWidth; ++x) {
+                frame[y * kWidth + x] = CHSV(hue + x, 255, 64 + y * 16);
+            }
+        }
+        uint16_t sx = (f / 2) % (kWidth - 6);
+        uint16_t sy = (f / 16) % (kHeight - 3);
+        for (uint16_t y = sy; y < sy + 3; ++y) {
+            for (uint16_t x = sx; x < sx + 6; ++x) {
+                frame[y * kWidth + x] = CRGB(255, 255, uint8_t(f));
+            }
+        }
+    }
+    return clip;
+}
+
+std::vector<uint8_t> encode(const std::vector<CRGB> &clip, size_t pixels,
+                            uint16_t keyframeInterval = 30) {
+    VideoEncoder encoder(pixels, keyframeInterval);
+    for (size_t i = 0; i < clip.size(); i += pixels) {
+        encoder.addFrame(&clip[i]);
+    }
+    fl::vector<uint8_t> bytes = encoder.finish();
+    return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+std::vector<uint8_t> rawBytes(const std::vector<CRGB> &clip) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(clip.data());
+    return std::vector<uint8_t>(p, p + clip.size() * 3);
+}
+
+bool sameFrame(const CRGB *a, const CRGB *b, size_t pixels) {
+    return memcmp(a, b, pixels * 3) == 0;
+}
+
+} // namespace
+
+TEST_CASE("rgbz round trip and seeking") {
+    const uint32_t frames = 700;
+    std::vector<CRGB> clip = makeClip(frames);
+    MemoryFileHandlePtr file = MemoryFileHandlePtr::New(encode(clip, kPixels));
+    MESSAGE("rgbz 64x8, " << frames << " frames: " << file->size()
+                          << " bytes, raw " << clip.size() * 3);
+    CHECK(file->size() * 8 < clip.size() * 3);
+
+    PixelStreamPtr stream = PixelStreamPtr::New(kPixels * 3);
+    REQUIRE(stream->begin(file));
+    REQUIRE(stream->isCompressed());
+    CHECK(stream->framesRemaining() == int32_t(frames));
+
+    Frame frame(kPixels);
+    for (uint32_t f = 0; f < frames; ++f) {
+        REQUIRE(stream->readFrame(&frame));
+        REQUIRE(sameFrame(frame.rgb(), &clip[size_t(f) * kPixels], kPixels));
+        REQUIRE(stream->framesRemaining() == int32_t(frames - f - 1));
+    }
+    CHECK(stream->atEnd());
+    CHECK_FALSE(stream->readFrame(&frame));
+    CHECK_FALSE(stream->hasFrame(frames));
+    CHECK(stream->hasFrame(frames - 1));
+
+    std::mt19937 rng(7);
+    for (int i = 0; i < 300; ++i) {
+        // mostly small steps either way, sometimes a jump
+        uint32_t f = i % 5 ? (stream->framesDisplayed() + frames + rng() % 9 -
+                              4) % frames
+                           : rng() % frames;
+        REQUIRE(stream->readFrameAt(f, &frame));
+        REQUIRE(sameFrame(frame.rgb(), &clip[size_t(f) * kPixels], kPixels));
+        REQUIRE(stream->framesDisplayed() == int32_t(f + 1));
+    }
+    CHECK_FALSE(stream->readFrameAt(frames, &frame));
+    CHECK(stream->atEnd());
+    REQUIRE(stream->rewind());
+    REQUIRE(stream->readFrame(&frame));
+    CHECK(sameFrame(frame.rgb(), clip.data(), kPixels));
+}
+
+TEST_CASE("rgbz edge cases") {
+    SUBCASE("long runs, noise and repeated frames") {
+        // runs longer than one op can hold
+        const size_t pixels = 70000;
+        std::mt19937 rng(3);
+        std::vector<CRGB> clip(pixels * 5, CRGB(1, 2, 3));
+        for (size_t i = pixels; i < 2 * pixels; ++i) {
+            clip[i] = CRGB(rng(), rng(), rng()); // noise: a scene cut
+        }
+        // frame 2 repeats frame 1, frame 3 changes two pixels of it
+        memcpy(&clip[2 * pixels], &clip[pixels], pixels * 3);
+        memcpy(&clip[3 * pixels], &clip[pixels], pixels * 3);
+        clip[3 * pixels + 5] = CRGB::Red;
+        clip[4 * pixels - 1] = CRGB::Red;
+        // frame 4 is solid again
+
+        VideoEncoder encoder(pixels, 100);
+        for (int f = 0; f < 5; ++f) {
+            encoder.addFrame(&clip[f * pixels]);
+        }
+        CHECK(encoder.keyframeCount() == 3); // frames 0, 1 and 4
+        fl::vector<uint8_t> bytes = encoder.finish();
+        MemoryFileHandlePtr file = MemoryFileHandlePtr::New(
+            std::vector<uint8_t>(bytes.begin(), bytes.end()));
+        PixelStreamPtr stream = PixelStreamPtr::New(pixels * 3);
+        REQUIRE(stream->begin(file));
+        Frame frame(pixels);
+        for (int f : {0, 1, 2, 3, 4, 3, 0, 4, 2}) {
+            REQUIRE(stream->readFrameAt(f, &frame));
+            REQUIRE(sameFrame(frame.rgb(), &clip[f * pixels], pixels));
+        }
+    }
+
+    SUBCASE("wrong frame size or truncated file") {
+        std::vector<CRGB> clip = makeClip(10);
+        std::vector<uint8_t> bytes = encode(clip, kPixels);
+        PixelStreamPtr stream = PixelStreamPtr::New((kPixels + 1) * 3);
+        CHECK_FALSE(stream->begin(MemoryFileHandlePtr::New(bytes)));
+        Frame frame(kPixels + 1);
+        CHECK_FALSE(stream->readFrameAt(0, &frame));
+        CHECK(stream->atEnd());
+
+        // a cut short record fails instead of reading past the end
+        bytes.resize(bytes.size() - 10);
+        stream = PixelStreamPtr::New(kPixels * 3);
+        REQUIRE(stream->begin(MemoryFileHandlePtr::New(bytes)));
+        Frame small(kPixels);
+        CHECK(stream->readFrameAt(0, &small));
+        CHECK_FALSE(stream->readFrameAt(9, &small));
+    }
+
+    SUBCASE("raw files still play as raw") {
+        std::vector<CRGB> clip = makeClip(3);
+        PixelStreamPtr stream = PixelStreamPtr::New(kPixels * 3);
+        REQUIRE(stream->begin(MemoryFileHandlePtr::New(rawBytes(clip))));
+        CHECK_FALSE(stream->isCompressed());
+        Frame frame(kPixels);
+        REQUIRE(stream->readFrameAt(2, &frame));
+        CHECK(sameFrame(frame.rgb(), &clip[2 * kPixels], kPixels));
+    }
+}
+
+TEST_CASE("Video plays rgbz and raw files the same") {
+    const uint32_t frames = 90;
+    std::vector<CRGB> clip = makeClip(frames);
+    for (size_t history : {size_t(1), size_t(2)}) {
+        Video raw(kPixels, 30, history);
+        Video compressed(kPixels, 30, history);
+        raw.begin(MemoryFileHandlePtr::New(rawBytes(clip)));
+        compressed.begin(MemoryFileHandlePtr::New(encode(clip, kPixels)));
+        CHECK(raw.durationMicros() == compressed.durationMicros());
+        CRGB a[kPixels], b[kPixels];
+        // forwards past the end (wraps around), then backwards
+        for (uint32_t now = 0; now < 4000; now += 17) {
+            bool ok = raw.draw(now, a);
+            REQUIRE(ok == compressed.draw(now, b));
+            REQUIRE(sameFrame(a, b, kPixels));
+        }
+        raw.setTimeScale(-1.0f);
+        compressed.setTimeScale(-1.0f);
+        for (uint32_t now = 4000; now < 5000; now += 23) {
+            bool ok = raw.draw(now, a);
+            REQUIRE(ok == compressed.draw(now, b));
+            REQUIRE(sameFrame(a, b, kPixels));
+        }
+    }
+}
+
+TEST_CASE("rgbz decode throughput") {
+    typedef std::chrono::steady_clock Clock;
+    const uint32_t frames = 1800; // one minute at 30 fps
+    std::vector<CRGB> clip = makeClip(frames);
+    MemoryFileHandlePtr compressed =
+        MemoryFileHandlePtr::New(encode(clip, kPixels));
+    MemoryFileHandlePtr raw = MemoryFileHandlePtr::New(rawBytes(clip));
+    MESSAGE("one minute of 64x8 at 30 fps: raw " << raw->size()
+                                                 << " bytes, rgbz "
+                                                 << compressed->size());
+    CHECK(compressed->size() * 8 < raw->size());
+
+    auto run = [&](MemoryFileHandlePtr file, const char *name) {
+        PixelStreamPtr stream = PixelStreamPtr::New(kPixels * 3);
+        REQUIRE(stream->begin(file));
+        file->bytesRead = file->reads = 0;
+        Frame frame(kPixels);
+        Clock::time_point start = Clock::now();
+        for (uint32_t f = 0; f < frames; ++f) {
+            REQUIRE(stream->readFrameAt(f, &frame));
+        }
+        double seconds =
+            std::chrono::duration<double>(Clock::now() - start).count();
+        std::string label = name;
+        MESSAGE(label << ": " << double(frames) * kPixels / seconds / 1e6
+                      << " Mpixel/s, " << file->bytesRead / frames
+                      << " bytes and " << double(file->reads) / frames
+                      << " reads per frame");
+        return file->bytesRead;
+    };
+    size_t rawRead = run(raw, "raw readFrameAt");
+    size_t compressedRead = run(compressed, "rgbz readFrameAt");
+    CHECK(compressedRead * 8 < rawRead);
+
+    // random access: each seek decodes from the nearest keyframe
+    PixelStreamPtr stream = PixelStreamPtr::New(kPixels * 3);
+    REQUIRE(stream->begin(compressed));
+    std::mt19937 rng(11);
+    Frame frame(kPixels);
+    Clock::time_point start = Clock::now();
+    const int seeks = 300;
+    for (int i = 0; i < seeks; ++i) {
+        REQUIRE(stream->readFrameAt(rng() % frames, &frame));
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start)
+                    .count() /
+                seeks;
+    MESSAGE("rgbz random seek: " << us << " us");
+}
@@ -1,9 +1,11 @@
 #include <MifareUltralight.h>
 
 #define ULTRALIGHT_PAGE_SIZE 4
-#define ULTRALIGHT_READ_SIZE 4 // we should be able to read 16 bytes at a time
+#define ULTRALIGHT_READ_SIZE 16 // READ returns 4 pages at a time
 
+#define ULTRALIGHT_CC_PAGE 3
 #define ULTRALIGHT_DATA_START_PAGE 4
+#define ULTRALIGHT_HEADER_DATA_SIZE 12 // data area bytes that come with the capability container
 #define ULTRALIGHT_MESSAGE_LENGTH_INDEX 1
 #define ULTRALIGHT_DATA_START_INDEX 2
 #define ULTRALIGHT_MAX_PAGE 63
@@ -15,6 +17,7 @@ MifareUltralight::MifareUltralight(PN532& nfcShield)
     nfc = &nfcShield;
     ndefStartIndex = 0;
     messageLength = 0;
+    headerRead = false;
 }
 
 MifareUltralight::~MifareUltralight()
@@ -41,22 +44,19 @@ NfcTag MifareUltralight::read(byte * uid, unsigned int uidLength)
         return NfcTag(uid, uidLength, NFC_FORUM_TAG_TYPE_2, message);
     }
 
-    boolean success;
-    uint8_t page;
-    uint8_t index = 0;
-    byte buffer[bufferSize];
-    for (page = ULTRALIGHT_DATA_START_PAGE; page < ULTRALIGHT_MAX_PAGE; page++)
+    // the first bytes came with the header, the rest is read 4 pages at a time
+    unsigned int readSize = ULTRALIGHT_HEADER_DATA_SIZE;
+    while (readSize < bufferSize)
     {
-        // read the data
-        success = nfc->mifareultralight_ReadPage(page, &buffer[index]);
-        if (success)
-        {
-            #ifdef MIFARE_ULTRALIGHT_DEBUG
-            Serial.print(F("Page "));Serial.print(page);Serial.print(" ");
-            nfc->PrintHexChar(&buffer[index], ULTRALIGHT_PAGE_SIZE);
-            #endif
-        }
-        else
+        readSize += ULTRALIGHT_READ_SIZE;
+    }
+    byte buffer[readSize];
+    memcpy(buffer, &header[ULTRALIGHT_PAGE_SIZE], ULTRALIGHT_HEADER_DATA_SIZE);
+
+    uint8_t page = ULTRALIGHT_DATA_START_PAGE + ULTRALIGHT_HEADER_DATA_SIZE / ULTRALIGHT_PAGE_SIZE;
+    for (unsigned int index = ULTRALIGHT_HEADER_DATA_SIZE; index < bufferSize; index += ULTRALIGHT_READ_SIZE)
+    {
+        if (page > ULTRALIGHT_MAX_PAGE || !nfc->mifareultralight_ReadPages(page, &buffer[index]))
         {
 #ifdef NDEF_USE_SERIAL
             Serial.print(F("Read failed "));Serial.println(page);
@@ -65,13 +65,11 @@ NfcTag MifareUltralight::read(byte * uid, unsigned int uidLength)
             messageLength = 0;
             break;
         }
-
-        if (index >= (messageLength + ndefStartIndex))
-        {
-            break;
-        }
-
-        index += ULTRALIGHT_PAGE_SIZE;
+        #ifdef MIFARE_ULTRALIGHT_DEBUG
+        Serial.print(F("Pages "));Serial.print(page);Serial.print(" ");
+        nfc->PrintHexChar(&buffer[index], ULTRALIGHT_READ_SIZE);
+        #endif
+        page += ULTRALIGHT_READ_SIZE / ULTRALIGHT_PAGE_SIZE;
     }
 
     NdefMessage ndefMessage = NdefMessage(&buffer[ndefStartIndex], messageLength);
@@ -79,19 +77,32 @@ NfcTag MifareUltralight::read(byte * uid, unsigned int uidLength)
 
 }
 
+// one READ returns the capability container (page 3) and pages 4-6,
+// enough for isUnformatted(), readCapabilityContainer() and findNdefMessage()
+boolean MifareUltralight::readHeader()
+{
+    if (!headerRead)
+    {
+        headerRead = nfc->mifareultralight_ReadPages(ULTRALIGHT_CC_PAGE, header);
+        #ifdef MIFARE_ULTRALIGHT_DEBUG
+        Serial.print(F("Pages 3-6 - "));
+        nfc->PrintHexChar(header, ULTRALIGHT_READ_SIZE);
+        #endif
+    }
+    return headerRead;
+}
+
 boolean MifareUltralight::isUnformatted()
 {
-    uint8_t page = 4;
-    byte data[ULTRALIGHT_READ_SIZE];
-    boolean success = nfc->mifareultralight_ReadPage (page, data);
-    if (success)
+    if (readHeader())
     {
+        byte *data = &header[ULTRALIGHT_PAGE_SIZE]; // page 4
         return (data[0] == 0xFF && data[1] == 0xFF && data[2] == 0xFF && data[3] == 0xFF);
     }
     else
     {
 #ifdef NDEF_USE_SERIAL
-        Serial.print(F("Error. Failed read page "));Serial.println(page);
+        Serial.print(F("Error. Failed read page "));Serial.println(ULTRALIGHT_DATA_START_PAGE);
 #endif
         return false;
     }
@@ -100,12 +111,10 @@ boolean MifareUltralight::isUnformatted()
 // page 3 has tag capabilities
 void MifareUltralight::readCapabilityContainer()
 {
-    byte data[ULTRALIGHT_PAGE_SIZE];
-    int success = nfc->mifareultralight_ReadPage (3, data);
-    if (success)
+    if (readHeader())
     {
         // See AN1303 - different rules for Mifare Family byte2 = (additional data + 48)/8
-        tagCapacity = data[2] * 8;
+        tagCapacity = header[2] * 8;
         #ifdef MIFARE_ULTRALIGHT_DEBUG
         Serial.print(F("Tag capacity "));Serial.print(tagCapacity);Serial.println(F(" bytes"));
         #endif
@@ -117,24 +126,9 @@ void MifareUltralight::readCapabilityContainer()
 // read enough of the message to find the ndef message length
 void MifareUltralight::findNdefMessage()
 {
-    int page;
-    byte data[12]; // 3 pages
-    byte* data_ptr = &data[0];
-
-    // the nxp read command reads 4 pages, unfortunately adafruit give me one page at a time
-    boolean success = true;
-    for (page = 4; page < 6; page++)
-    {
-        success = success && nfc->mifareultralight_ReadPage(page, data_ptr);
-        #ifdef MIFARE_ULTRALIGHT_DEBUG
-        Serial.print(F("Page "));Serial.print(page);Serial.print(F(" - "));
-        nfc->PrintHexChar(data_ptr, 4);
-        #endif
-        data_ptr += ULTRALIGHT_PAGE_SIZE;
-    }
-
-    if (success)
+    if (readHeader())
     {
+        byte *data = &header[ULTRALIGHT_PAGE_SIZE]; // pages 4-6
         if (data[0] == 0x03)
         {
             messageLength = data[1];
@@ -161,10 +155,10 @@ void MifareUltralight::calculateBufferSize()
     // TLV terminator 0xFE is 1 byte
     bufferSize = messageLength + ndefStartIndex + 1;
 
-    if (bufferSize % ULTRALIGHT_READ_SIZE != 0)
+    if (bufferSize % ULTRALIGHT_PAGE_SIZE != 0)
     {
         // buffer must be an increment of page size
-        bufferSize = ((bufferSize / ULTRALIGHT_READ_SIZE) + 1) * ULTRALIGHT_READ_SIZE;
+        bufferSize = ((bufferSize / ULTRALIGHT_PAGE_SIZE) + 1) * ULTRALIGHT_PAGE_SIZE;
     }
 }
 
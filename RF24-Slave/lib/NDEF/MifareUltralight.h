@@ -19,6 +19,9 @@ class MifareUltralight
         unsigned int messageLength;
         unsigned int bufferSize;
         unsigned int ndefStartIndex;
+        byte header[16]; // pages 3-6: capability container + start of the data area
+        boolean headerRead;
+        boolean readHeader();
         boolean isUnformatted();
         void readCapabilityContainer();
         void findNdefMessage();
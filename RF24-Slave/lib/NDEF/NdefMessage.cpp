@@ -15,68 +15,36 @@ NdefMessage::NdefMessage(const byte * data, const int numBytes)
 
     _recordCount = 0;
 
-    int index = 0;
-
-    while (index <= numBytes)
+    // NdefReader bounds-checks every length against numBytes; each record is
+    // then copied once, straight into its slot
+    NdefReader reader(data, numBytes > 0 ? numBytes : 0);
+    NdefRecordView view;
+    while (reader.next(view))
     {
-
-        // decode tnf - first byte is tnf with bit flags
-        // see the NFDEF spec for more info
-        byte tnf_byte = data[index];
-        // bool mb = tnf_byte & 0x80;
-        bool me = tnf_byte & 0x40;
-        // bool cf = tnf_byte & 0x20;
-        bool sr = tnf_byte & 0x10;
-        bool il = tnf_byte & 0x8;
-        byte tnf = (tnf_byte & 0x7);
-
-        NdefRecord record = NdefRecord();
-        record.setTnf(tnf);
-
-        index++;
-        int typeLength = data[index];
-
-        uint32_t payloadLength = 0;
-        if (sr)
-        {
-            index++;
-            payloadLength = data[index];
-        }
-        else
+        if (_recordCount == MAX_NDEF_RECORDS)
         {
-            payloadLength =
-                  (static_cast<uint32_t>(data[index])   << 24)
-                | (static_cast<uint32_t>(data[index+1]) << 16)
-                | (static_cast<uint32_t>(data[index+2]) << 8)
-                |  static_cast<uint32_t>(data[index+3]);
-            index += 4;
-        }
-
-        int idLength = 0;
-        if (il)
-        {
-            index++;
-            idLength = data[index];
+#ifdef NDEF_USE_SERIAL
+            Serial.println(F("WARNING: Too many records. Increase MAX_NDEF_RECORDS."));
+#endif
+            break;
         }
 
-        index++;
-        record.setType(&data[index], typeLength);
-        index += typeLength;
-
-        if (il)
+        NdefRecord& record = _records[_recordCount++];
+        record.setTnf(view.tnf);
+        record.setType(view.type, view.typeLength);
+        if (view.idLength)
         {
-            record.setId(&data[index], idLength);
-            index += idLength;
+            record.setId(view.id, view.idLength);
         }
-
-        record.setPayload(&data[index], payloadLength);
-        index += payloadLength;
-
-        addRecord(record);
-
-        if (me) break; // last message
+        record.setPayload(view.payload, view.payloadLength);
     }
 
+#ifdef NDEF_USE_SERIAL
+    if (reader.error())
+    {
+        Serial.println(F("WARNING: Malformed NDEF message, decoding stopped."));
+    }
+#endif
 }
 
 NdefMessage::NdefMessage(const NdefMessage& rhs)
@@ -197,8 +165,8 @@ void NdefMessage::addTextRecord(String text, String encoding)
     NdefRecord r = NdefRecord();
     r.setTnf(TNF_WELL_KNOWN);
 
-    uint8_t RTD_TEXT[1] = { 0x54 }; // TODO this should be a constant or preprocessor
-    r.setType(RTD_TEXT, sizeof(RTD_TEXT));
+    uint8_t type[1] = { NDEF_RTD_TEXT };
+    r.setType(type, sizeof(type));
 
     // X is a placeholder for encoding length
     // TODO is it more efficient to build w/o string concatenation?
@@ -217,11 +185,11 @@ void NdefMessage::addTextRecord(String text, String encoding)
 
 void NdefMessage::addUriRecord(String uri)
 {
-    NdefRecord* r = new NdefRecord();
-    r->setTnf(TNF_WELL_KNOWN);
+    NdefRecord r = NdefRecord();
+    r.setTnf(TNF_WELL_KNOWN);
 
-    uint8_t RTD_URI[1] = { 0x55 }; // TODO this should be a constant or preprocessor
-    r->setType(RTD_URI, sizeof(RTD_URI));
+    uint8_t type[1] = { NDEF_RTD_URI };
+    r.setType(type, sizeof(type));
 
     // X is a placeholder for identifier code
     String payloadString = "X" + uri;
@@ -232,18 +200,16 @@ void NdefMessage::addUriRecord(String uri)
     // add identifier code 0x0, meaning no prefix substitution
     payload[0] = 0x0;
 
-    r->setPayload(payload, payloadString.length());
+    r.setPayload(payload, payloadString.length());
 
-    addRecord(*r);
-    delete(r);
+    addRecord(r);
 }
 
 void NdefMessage::addEmptyRecord()
 {
-    NdefRecord* r = new NdefRecord();
-    r->setTnf(TNF_EMPTY);
-    addRecord(*r);
-    delete(r);
+    NdefRecord r = NdefRecord();
+    r.setTnf(TNF_EMPTY);
+    addRecord(r);
 }
 
 NdefRecord NdefMessage::getRecord(int index)
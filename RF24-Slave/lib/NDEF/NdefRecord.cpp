@@ -166,9 +166,11 @@ void NdefRecord::encode(byte *data, bool firstRecord, bool lastRecord)
         data_ptr += 1;
     }
 
-    //Serial.println(2);
-    memcpy(data_ptr, _type, _typeLength);
-    data_ptr += _typeLength;
+    if (_typeLength)
+    {
+        memcpy(data_ptr, _type, _typeLength);
+        data_ptr += _typeLength;
+    }
 
     if (_idLength)
     {
@@ -176,8 +178,11 @@ void NdefRecord::encode(byte *data, bool firstRecord, bool lastRecord)
         data_ptr += _idLength;
     }
     
-    memcpy(data_ptr, _payload, _payloadLength);
-    data_ptr += _payloadLength;
+    if (_payloadLength)
+    {
+        memcpy(data_ptr, _payload, _payloadLength);
+        data_ptr += _payloadLength;
+    }
 }
 
 byte NdefRecord::getTnfByte(bool firstRecord, bool lastRecord)
@@ -236,7 +241,10 @@ unsigned int NdefRecord::getIdLength()
 String NdefRecord::getType()
 {
     char type[_typeLength + 1];
-    memcpy(type, _type, _typeLength);
+    if (_typeLength)
+    {
+        memcpy(type, _type, _typeLength);
+    }
     type[_typeLength] = '\0'; // null terminate
     return String(type);
 }
@@ -244,7 +252,10 @@ String NdefRecord::getType()
 // this assumes the caller created type correctly
 void NdefRecord::getType(uint8_t* type)
 {
-    memcpy(type, _type, _typeLength);
+    if (_typeLength)
+    {
+        memcpy(type, _type, _typeLength);
+    }
 }
 
 void NdefRecord::setType(const byte * type, const unsigned int numBytes)
@@ -254,15 +265,22 @@ void NdefRecord::setType(const byte * type, const unsigned int numBytes)
         free(_type);
     }
 
-    _type = (uint8_t*)malloc(numBytes);
-    memcpy(_type, type, numBytes);
+    // zero-length fields stay NULL; the destructor only frees non-empty ones
+    _type = numBytes ? (uint8_t*)malloc(numBytes) : (uint8_t*)NULL;
+    if (numBytes)
+    {
+        memcpy(_type, type, numBytes);
+    }
     _typeLength = numBytes;
 }
 
 // assumes the caller sized payload properly
 void NdefRecord::getPayload(byte *payload)
 {
-    memcpy(payload, _payload, _payloadLength);
+    if (_payloadLength)
+    {
+        memcpy(payload, _payload, _payloadLength);
+    }
 }
 
 void NdefRecord::setPayload(const byte * payload, const int numBytes)
@@ -272,22 +290,31 @@ void NdefRecord::setPayload(const byte * payload, const int numBytes)
         free(_payload);
     }
 
-    _payload = (byte*)malloc(numBytes);
-    memcpy(_payload, payload, numBytes);
+    _payload = numBytes ? (byte*)malloc(numBytes) : (byte*)NULL;
+    if (numBytes)
+    {
+        memcpy(_payload, payload, numBytes);
+    }
     _payloadLength = numBytes;
 }
 
 String NdefRecord::getId()
 {
     char id[_idLength + 1];
-    memcpy(id, _id, _idLength);
+    if (_idLength)
+    {
+        memcpy(id, _id, _idLength);
+    }
     id[_idLength] = '\0'; // null terminate
     return String(id);
 }
 
 void NdefRecord::getId(byte *id)
 {
-    memcpy(id, _id, _idLength);
+    if (_idLength)
+    {
+        memcpy(id, _id, _idLength);
+    }
 }
 
 void NdefRecord::setId(const byte * id, const unsigned int numBytes)
@@ -297,8 +324,11 @@ void NdefRecord::setId(const byte * id, const unsigned int numBytes)
         free(_id);
     }
 
-    _id = (byte*)malloc(numBytes);
-    memcpy(_id, id, numBytes);
+    _id = numBytes ? (byte*)malloc(numBytes) : (byte*)NULL;
+    if (numBytes)
+    {
+        memcpy(_id, id, numBytes);
+    }
     _idLength = numBytes;
 }
 #ifdef NDEF_USE_SERIAL
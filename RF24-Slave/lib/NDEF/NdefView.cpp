@@ -0,0 +1,215 @@
+#include "NdefView.h"
+#include <string.h>
+
+#define NDEF_FLAG_MB 0x80
+#define NDEF_FLAG_ME 0x40
+#define NDEF_FLAG_SR 0x10
+#define NDEF_FLAG_IL 0x08
+#define NDEF_NO_RECORD ((size_t)-1)
+
+NdefReader::NdefReader(const uint8_t *data, size_t length)
+{
+    _data = data;
+    _length = data ? length : 0;
+    _index = 0;
+    _done = false;
+    _error = false;
+}
+
+bool NdefReader::next(NdefRecordView &record)
+{
+    if (_done || _error)
+    {
+        return false;
+    }
+
+    if (_index == _length)
+    {
+        // no ME flag, but the data ends cleanly on a record boundary
+        _done = true;
+        return false;
+    }
+
+    size_t index = _index;
+    size_t remaining = _length - index;
+
+    // flags + type length, then payload length (1 or 4 bytes), then optional id length
+    uint8_t flags = _data[index];
+    size_t headerLength = 2 + ((flags & NDEF_FLAG_SR) ? 1 : 4) + ((flags & NDEF_FLAG_IL) ? 1 : 0);
+    if (remaining < headerLength)
+    {
+        _error = true;
+        return false;
+    }
+    index++;
+
+    record.tnf = flags & 0x7;
+    record.messageBegin = flags & NDEF_FLAG_MB;
+    record.messageEnd = flags & NDEF_FLAG_ME;
+    record.typeLength = _data[index++];
+
+    if (flags & NDEF_FLAG_SR)
+    {
+        record.payloadLength = _data[index++];
+    }
+    else
+    {
+        record.payloadLength =
+              (static_cast<uint32_t>(_data[index])     << 24)
+            | (static_cast<uint32_t>(_data[index + 1]) << 16)
+            | (static_cast<uint32_t>(_data[index + 2]) << 8)
+            |  static_cast<uint32_t>(_data[index + 3]);
+        index += 4;
+    }
+
+    record.idLength = (flags & NDEF_FLAG_IL) ? _data[index++] : 0;
+
+    // compare against what is left instead of summing, so a huge payload length cannot wrap
+    remaining = _length - index;
+    size_t fields = (size_t)record.typeLength + record.idLength;
+    if (fields > remaining || record.payloadLength > remaining - fields)
+    {
+        _error = true;
+        return false;
+    }
+
+    record.type = &_data[index];
+    index += record.typeLength;
+    record.id = record.idLength ? &_data[index] : NULL;
+    index += record.idLength;
+    record.payload = &_data[index];
+    index += record.payloadLength;
+
+    _index = index;
+    _done = record.messageEnd;
+    return true;
+}
+
+NdefWriter::NdefWriter(uint8_t *buffer, size_t capacity)
+{
+    _buffer = buffer;
+    _capacity = buffer ? capacity : 0;
+    _size = 0;
+    _last = NDEF_NO_RECORD;
+    _overflow = false;
+}
+
+size_t NdefWriter::encodedSize(uint8_t typeLength, uint32_t payloadLength, uint8_t idLength)
+{
+    size_t size = 2; // tnf + typeLength
+    size += (payloadLength > 0xFF) ? 4 : 1;
+    if (idLength)
+    {
+        size += 1;
+    }
+    return size + typeLength + idLength + payloadLength;
+}
+
+bool NdefWriter::beginRecord(uint8_t tnf, const uint8_t *type, uint8_t typeLength,
+                             uint32_t payloadLength, const uint8_t *id, uint8_t idLength)
+{
+    if (payloadLength > _capacity || encodedSize(typeLength, payloadLength, idLength) > _capacity - _size)
+    {
+        _overflow = true;
+        return false;
+    }
+
+    uint8_t flags = (tnf & 0x7) | NDEF_FLAG_ME;
+    if (_last == NDEF_NO_RECORD)
+    {
+        flags |= NDEF_FLAG_MB;
+    }
+    else
+    {
+        _buffer[_last] &= ~NDEF_FLAG_ME; // the previous record is no longer the last one
+    }
+    if (payloadLength <= 0xFF)
+    {
+        flags |= NDEF_FLAG_SR;
+    }
+    if (idLength)
+    {
+        flags |= NDEF_FLAG_IL;
+    }
+
+    _last = _size;
+    _buffer[_size++] = flags;
+    _buffer[_size++] = typeLength;
+    if (payloadLength <= 0xFF)
+    {
+        _buffer[_size++] = payloadLength;
+    }
+    else
+    {
+        _buffer[_size++] = (payloadLength >> 24) & 0xFF;
+        _buffer[_size++] = (payloadLength >> 16) & 0xFF;
+        _buffer[_size++] = (payloadLength >> 8) & 0xFF;
+        _buffer[_size++] = payloadLength & 0xFF;
+    }
+    if (idLength)
+    {
+        _buffer[_size++] = idLength;
+    }
+    put(type, typeLength);
+    put(id, idLength);
+    return true;
+}
+
+void NdefWriter::put(const void *data, size_t length)
+{
+    if (length)
+    {
+        memcpy(&_buffer[_size], data, length);
+        _size += length;
+    }
+}
+
+bool NdefWriter::addRecord(uint8_t tnf, const uint8_t *type, uint8_t typeLength,
+                           const uint8_t *payload, uint32_t payloadLength,
+                           const uint8_t *id, uint8_t idLength)
+{
+    if (!beginRecord(tnf, type, typeLength, payloadLength, id, idLength))
+    {
+        return false;
+    }
+    put(payload, payloadLength);
+    return true;
+}
+
+bool NdefWriter::addTextRecord(const char *text, const char *encoding)
+{
+    // payload: status byte (encoding length), encoding, text
+    static const uint8_t type[1] = { NDEF_RTD_TEXT };
+    size_t encodingLength = strlen(encoding) & 0x3F;
+    size_t textLength = strlen(text);
+    uint8_t status = encodingLength;
+
+    if (!beginRecord(TNF_WELL_KNOWN, type, sizeof(type), 1 + encodingLength + textLength, NULL, 0))
+    {
+        return false;
+    }
+    put(&status, 1);
+    put(encoding, encodingLength);
+    put(text, textLength);
+    return true;
+}
+
+bool NdefWriter::addUriRecord(const char *uri, uint8_t prefix)
+{
+    // payload: identifier code, rest of the URI
+    static const uint8_t type[1] = { NDEF_RTD_URI };
+    size_t uriLength = strlen(uri);
+
+    if (!beginRecord(TNF_WELL_KNOWN, type, sizeof(type), 1 + uriLength, NULL, 0))
+    {
+        return false;
+    }
+    put(&prefix, 1);
+    put(uri, uriLength);
+    return true;
+}
+
+bool NdefWriter::addEmptyRecord()
+{
+    return addRecord(TNF_EMPTY, NULL, 0, NULL, 0);
+}
@@ -0,0 +1,97 @@
+#ifndef NdefView_h
+#define NdefView_h
+
+/* Zero-allocation NDEF encoding and decoding.
+
+   NdefReader walks the records of a message in a buffer it borrows from the
+   caller and hands out NdefRecordView pointers into that buffer; NdefWriter
+   encodes records straight into a caller-provided buffer. Neither allocates
+   or copies record data, and every length read from the input is checked
+   against the buffer. This header has no Arduino dependency so the codec can
+   be tested on the host (see tests/NdefViewHostTest).
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TNF_EMPTY 0x0
+#define TNF_WELL_KNOWN 0x01
+#define TNF_MIME_MEDIA 0x02
+#define TNF_ABSOLUTE_URI 0x03
+#define TNF_EXTERNAL_TYPE 0x04
+#define TNF_UNKNOWN 0x05
+#define TNF_UNCHANGED 0x06
+#define TNF_RESERVED 0x07
+
+#define NDEF_RTD_TEXT 0x54 // "T"
+#define NDEF_RTD_URI 0x55  // "U"
+
+// A record inside a borrowed buffer; valid only as long as that buffer is
+struct NdefRecordView
+{
+    uint8_t tnf;
+    bool messageBegin;
+    bool messageEnd;
+    const uint8_t *type;
+    uint8_t typeLength;
+    const uint8_t *id;
+    uint8_t idLength;
+    const uint8_t *payload;
+    uint32_t payloadLength;
+};
+
+class NdefReader
+{
+    public:
+        NdefReader(const uint8_t *data, size_t length);
+
+        // Decode the next record; false after the last record (ME flag or end of
+        // data) or when the input is malformed, in which case error() is set
+        bool next(NdefRecordView &record);
+
+        bool error() const { return _error; }
+        // bytes consumed so far, i.e. the encoded size once next() returned false
+        size_t offset() const { return _index; }
+
+    private:
+        const uint8_t *_data;
+        size_t _length;
+        size_t _index;
+        bool _done;
+        bool _error;
+};
+
+class NdefWriter
+{
+    public:
+        NdefWriter(uint8_t *buffer, size_t capacity);
+
+        // Each add*() either appends a whole record or leaves the buffer
+        // untouched and returns false (overflow() is then set)
+        bool addRecord(uint8_t tnf, const uint8_t *type, uint8_t typeLength,
+                       const uint8_t *payload, uint32_t payloadLength,
+                       const uint8_t *id = NULL, uint8_t idLength = 0);
+        bool addTextRecord(const char *text, const char *encoding = "en");
+        // prefix is the URI identifier code (0 = none, 0x04 = "https://", ...)
+        bool addUriRecord(const char *uri, uint8_t prefix = 0);
+        bool addEmptyRecord();
+
+        const uint8_t *data() const { return _buffer; }
+        size_t size() const { return _size; }
+        bool overflow() const { return _overflow; }
+
+        static size_t encodedSize(uint8_t typeLength, uint32_t payloadLength, uint8_t idLength);
+
+    private:
+        bool beginRecord(uint8_t tnf, const uint8_t *type, uint8_t typeLength,
+                         uint32_t payloadLength, const uint8_t *id, uint8_t idLength);
+        void put(const void *data, size_t length);
+
+        uint8_t *_buffer;
+        size_t _capacity;
+        size_t _size;
+        size_t _last; // header offset of the record carrying the ME flag
+        bool _overflow;
+};
+
+#endif
@@ -152,6 +152,11 @@ NfcTag NfcAdapter::read()
 
 }
 
+NfcTagHandle NfcAdapter::identify()
+{
+    return NfcTagHandle(*shield, uid, uidLength, guessTagType());
+}
+
 boolean NfcAdapter::write(NdefMessage& ndefMessage)
 {
     boolean success;
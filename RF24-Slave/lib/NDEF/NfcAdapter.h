@@ -4,19 +4,13 @@
 #include <PN532Interface.h>
 #include <PN532.h>
 #include <NfcTag.h>
+#include <NfcTagHandle.h> // TAG_TYPE_* constants
 #include <Ndef.h>
 
 // Drivers
 #include <MifareClassic.h>
 #include <MifareUltralight.h>
 
-#define TAG_TYPE_MIFARE_CLASSIC (0)
-#define TAG_TYPE_1 (1)
-#define TAG_TYPE_2 (2)
-#define TAG_TYPE_3 (3)
-#define TAG_TYPE_4 (4)
-#define TAG_TYPE_UNKNOWN (99)
-
 #define IRQ   (2)
 #define RESET (3)  // Not connected by default on the NFC Shield
 
@@ -28,6 +22,8 @@ class NfcAdapter {
         void begin(boolean verbose=true);
         boolean tagPresent(unsigned long timeout=0); // tagAvailable
         NfcTag read();
+        // UID right away, NDEF records read from the tag only when asked for
+        NfcTagHandle identify();
         boolean write(NdefMessage& ndefMessage);
         // erase tag by writing an empty NDEF record
         boolean erase();
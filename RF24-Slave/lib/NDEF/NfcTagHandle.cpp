@@ -0,0 +1,360 @@
+#include <NfcTagHandle.h>
+
+#define TYPE2_CC_PAGE 3
+#define TYPE2_DATA_START_PAGE 4
+#define TYPE2_READ_SIZE 16    // READ always returns 4 pages
+#define TYPE2_SMALL_TAG 48    // Ultralight-sized data area, not worth probing for FAST_READ
+
+#define CLASSIC_BLOCK_SIZE 16
+#define CLASSIC_MAX_SECTOR 15 // 1K layout, sector 0 holds the MAD
+
+#define TLV_NULL 0x00
+#define TLV_NDEF 0x03
+#define TLV_TERMINATOR 0xFE
+
+#define CAPACITY_UNKNOWN 0xFFFF
+
+NfcTagHandle::NfcTagHandle(PN532& nfcShield, const byte *uid, unsigned int uidLength, unsigned int tagType)
+{
+    _nfc = &nfcShield;
+    _uidLength = uidLength < sizeof(_uid) ? uidLength : sizeof(_uid);
+    memcpy(_uid, uid, _uidLength);
+    _tagType = tagType;
+
+    _cached = 0;
+    _capacity = CAPACITY_UNKNOWN;
+    _fastRead = -1;
+#ifdef NDEF_SUPPORT_MIFARE_CLASSIC
+    _authSector = -1;
+#endif
+    _tlvState = -1;
+    _ndefStart = 0;
+    _ndefLength = 0;
+    _recordOffset = 0;
+    _recordsDone = false;
+    _error = false;
+}
+
+void NfcTagHandle::getUid(byte *uid, unsigned int uidLength)
+{
+    memcpy(uid, _uid, _uidLength < uidLength ? _uidLength : uidLength);
+}
+
+boolean NfcTagHandle::hasNdefMessage()
+{
+    if (_tlvState < 0)
+    {
+        findNdefTlv();
+    }
+    return _tlvState == 1;
+}
+
+unsigned int NfcTagHandle::getNdefMessageLength()
+{
+    return hasNdefMessage() ? _ndefLength : 0;
+}
+
+// Walk the TLVs at the start of the data area up to the NDEF TLV,
+// skipping NULL, Lock Control, Memory Control and proprietary TLVs
+boolean NfcTagHandle::findNdefTlv()
+{
+    _tlvState = 0;
+    unsigned int i = 0;
+    while (fetch(i + 1))
+    {
+        byte type = _cache[i];
+        if (type == TLV_NULL)
+        {
+            i++;
+            continue;
+        }
+        if (type == TLV_TERMINATOR || !fetch(i + 2))
+        {
+            return false;
+        }
+
+        unsigned int length = _cache[i + 1];
+        unsigned int header = 2;
+        if (length == 0xFF)
+        {
+            if (!fetch(i + 4))
+            {
+                return false;
+            }
+            length = (_cache[i + 2] << 8) | _cache[i + 3];
+            header = 4;
+        }
+
+        if (type == TLV_NDEF)
+        {
+            _ndefStart = i + header;
+            _ndefLength = length;
+            _tlvState = 1;
+            return true;
+        }
+        i += header + length;
+    }
+    return false;
+}
+
+boolean NfcTagHandle::readRecord(NdefRecordView& record)
+{
+    if (_recordsDone || !hasNdefMessage())
+    {
+        return false;
+    }
+    if (_recordOffset >= _ndefLength)
+    {
+        _recordsDone = true;
+        return false;
+    }
+
+    unsigned int start = _ndefStart + _recordOffset;
+    unsigned int remaining = _ndefLength - _recordOffset;
+
+    // the header says how far the record reaches; fetch it first, then the rest
+    if (!fetch(start + 1))
+    {
+        _error = true;
+        return false;
+    }
+    byte flags = _cache[start];
+    unsigned int headerLength = 2 + ((flags & 0x10) ? 1 : 4) + ((flags & 0x08) ? 1 : 0);
+    if (headerLength > remaining || !fetch(start + headerLength))
+    {
+        _error = true;
+        return false;
+    }
+
+    const byte *header = &_cache[start];
+    uint32_t payloadLength = (flags & 0x10)
+        ? header[2]
+        : ((uint32_t)header[2] << 24) | ((uint32_t)header[3] << 16) | ((uint32_t)header[4] << 8) | header[5];
+    unsigned int fields = header[1] + ((flags & 0x08) ? header[headerLength - 1] : 0);
+    if (payloadLength > remaining || headerLength + fields + payloadLength > remaining)
+    {
+        _error = true;
+        return false;
+    }
+
+    unsigned int recordLength = headerLength + fields + payloadLength;
+    if (!fetch(start + recordLength))
+    {
+        _error = true;
+        return false;
+    }
+
+    NdefReader reader(&_cache[start], recordLength);
+    if (!reader.next(record))
+    {
+        _error = true;
+        return false;
+    }
+    _recordOffset += recordLength;
+    _recordsDone = record.messageEnd;
+    return true;
+}
+
+NdefMessage NfcTagHandle::getNdefMessage()
+{
+    NdefMessage message = NdefMessage();
+    if (!hasNdefMessage())
+    {
+        return message;
+    }
+    if (_ndefLength == 0) // data is 0x03 0x00 0xFE
+    {
+        message.addEmptyRecord();
+        return message;
+    }
+    if (!fetch(_ndefStart + _ndefLength))
+    {
+#ifdef NDEF_USE_SERIAL
+        Serial.println(F("Error. NDEF message does not fit NFC_TAG_HANDLE_CACHE_SIZE."));
+#endif
+        _error = true;
+        return message;
+    }
+    return NdefMessage(&_cache[_ndefStart], _ndefLength);
+}
+
+// make sure data area bytes [0, length) are in the cache
+boolean NfcTagHandle::fetch(unsigned int length)
+{
+    if (length <= _cached)
+    {
+        return true;
+    }
+    if (_error || length > NFC_TAG_HANDLE_CACHE_SIZE)
+    {
+        return false;
+    }
+
+    if (_tagType == TAG_TYPE_2)
+    {
+        return fetchType2(length);
+    }
+#ifdef NDEF_SUPPORT_MIFARE_CLASSIC
+    if (_tagType == TAG_TYPE_MIFARE_CLASSIC)
+    {
+        return fetchClassic(length);
+    }
+#endif
+    return false;
+}
+
+boolean NfcTagHandle::fetchType2(unsigned int length)
+{
+    byte data[NTAG_FAST_READ_MAX_PAGES * 4];
+
+    if (_capacity == CAPACITY_UNKNOWN)
+    {
+        // pages 3-6: the capability container and the first 12 bytes of the data area
+        if (!_nfc->mifareultralight_ReadPages(TYPE2_CC_PAGE, data))
+        {
+            _error = true;
+            return false;
+        }
+        if (data[0] != 0xE1) // no NDEF magic number: not formatted
+        {
+            _capacity = 0;
+            return false;
+        }
+        _capacity = data[2] * 8;
+        _cached = TYPE2_READ_SIZE - 4;
+        memcpy(_cache, data + 4, _cached);
+        if (length <= _cached)
+        {
+            return true;
+        }
+    }
+
+    unsigned int limit = _capacity < NFC_TAG_HANDLE_CACHE_SIZE ? _capacity : NFC_TAG_HANDLE_CACHE_SIZE;
+    if (length > limit)
+    {
+        return false;
+    }
+
+    // GET_VERSION costs one command on an NTAG and two on a tag that NAKs it,
+    // so only probe once FAST_READ would save at least that many READs
+    if (_fastRead < 0 && length - _cached > 2 * TYPE2_READ_SIZE && _capacity > TYPE2_SMALL_TAG)
+    {
+        byte version[8];
+        if (_nfc->ntag2xx_GetVersion(version))
+        {
+            // NXP NTAG21x (product type 4) or Ultralight EV1 (3)
+            _fastRead = (version[1] == 0x04 && (version[2] == 0x03 || version[2] == 0x04)) ? 1 : 0;
+        }
+        else
+        {
+            // the NAK sent the tag back to IDLE, select it again
+            _fastRead = 0;
+            byte uid[7];
+            uint8_t uidLength;
+            if (!_nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 100, true))
+            {
+                _error = true;
+                return false;
+            }
+        }
+    }
+
+    while (_cached < length)
+    {
+        uint8_t page = TYPE2_DATA_START_PAGE + _cached / 4;
+        unsigned int bytes;
+        boolean success;
+        if (_fastRead == 1)
+        {
+            // what is still needed, but never less than a READ would return
+            unsigned int pages = (length - _cached + 3) / 4;
+            unsigned int room = (limit - _cached + 3) / 4;
+            if (pages < TYPE2_READ_SIZE / 4)
+            {
+                pages = TYPE2_READ_SIZE / 4;
+            }
+            if (pages > room)
+            {
+                pages = room;
+            }
+            if (pages > NTAG_FAST_READ_MAX_PAGES)
+            {
+                pages = NTAG_FAST_READ_MAX_PAGES;
+            }
+            bytes = pages * 4;
+            success = _nfc->ntag2xx_FastRead(page, page + pages - 1, data);
+        }
+        else
+        {
+            bytes = TYPE2_READ_SIZE;
+            success = _nfc->mifareultralight_ReadPages(page, data);
+        }
+
+        if (!success)
+        {
+#ifdef NDEF_USE_SERIAL
+            Serial.print(F("Read failed "));Serial.println(page);
+#endif
+            _error = true;
+            return false;
+        }
+        if (bytes > NFC_TAG_HANDLE_CACHE_SIZE - _cached)
+        {
+            bytes = NFC_TAG_HANDLE_CACHE_SIZE - _cached;
+        }
+        memcpy(&_cache[_cached], data, bytes);
+        _cached += bytes;
+    }
+    return true;
+}
+
+#ifdef NDEF_SUPPORT_MIFARE_CLASSIC
+boolean NfcTagHandle::fetchClassic(unsigned int length)
+{
+    uint8_t key[6] = { 0xD3, 0xF7, 0xD3, 0xF7, 0xD3, 0xF7 }; // NFC Forum public key A
+
+    while (_cached < length)
+    {
+        // data blocks are the first 3 blocks of sectors 1..15
+        unsigned int dataBlock = _cached / CLASSIC_BLOCK_SIZE;
+        int sector = 1 + dataBlock / 3;
+        if (sector > CLASSIC_MAX_SECTOR)
+        {
+            return false;
+        }
+        uint8_t block = sector * 4 + dataBlock % 3;
+
+        if (sector != _authSector)
+        {
+            if (!_nfc->mifareclassic_AuthenticateBlock(_uid, _uidLength, block, 0, key))
+            {
+#ifdef NDEF_USE_SERIAL
+                Serial.print(F("Error. Block Authentication failed for "));Serial.println(block);
+#endif
+                _error = true;
+                return false;
+            }
+            _authSector = sector;
+        }
+
+        byte data[CLASSIC_BLOCK_SIZE];
+        if (!_nfc->mifareclassic_ReadDataBlock(block, data))
+        {
+#ifdef NDEF_USE_SERIAL
+            Serial.print(F("Read failed "));Serial.println(block);
+#endif
+            _error = true;
+            return false;
+        }
+
+        unsigned int bytes = CLASSIC_BLOCK_SIZE;
+        if (bytes > NFC_TAG_HANDLE_CACHE_SIZE - _cached)
+        {
+            bytes = NFC_TAG_HANDLE_CACHE_SIZE - _cached;
+        }
+        memcpy(&_cache[_cached], data, bytes);
+        _cached += bytes;
+    }
+    return true;
+}
+#endif
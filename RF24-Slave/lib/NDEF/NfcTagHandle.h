@@ -0,0 +1,92 @@
+#ifndef NfcTagHandle_h
+#define NfcTagHandle_h
+
+/* A tag that has been detected but not read yet.
+
+   The UID is known as soon as the tag is detected, so it is available
+   without any tag I/O. The NDEF TLV and the records are fetched from the
+   tag the first time they are asked for, and only as many pages or blocks
+   as the requested record needs:
+
+   - Type 2 (Ultralight/NTAG): one READ returns 4 pages (16 bytes). When a
+     record needs more than that, NTAG21x tags are read with FAST_READ
+     instead (up to NTAG_FAST_READ_MAX_PAGES pages per command).
+   - Mifare Classic: one block per read, authenticating each sector once.
+
+   Fetched bytes are kept in the handle (NFC_TAG_HANDLE_CACHE_SIZE bytes of
+   the data area), so record views stay valid as long as the handle does.
+*/
+
+#include <PN532.h>
+#include <Ndef.h>
+#include <NdefView.h>
+#include <NdefMessage.h>
+#include <MifareClassic.h>
+
+#define TAG_TYPE_MIFARE_CLASSIC (0)
+#define TAG_TYPE_1 (1)
+#define TAG_TYPE_2 (2)
+#define TAG_TYPE_3 (3)
+#define TAG_TYPE_4 (4)
+#define TAG_TYPE_UNKNOWN (99)
+
+// bytes of the tag's data area a handle can hold; records past it cannot be read lazily
+#ifndef NFC_TAG_HANDLE_CACHE_SIZE
+#define NFC_TAG_HANDLE_CACHE_SIZE 256
+#endif
+
+class NfcTagHandle
+{
+    public:
+        NfcTagHandle(PN532& nfcShield, const byte *uid, unsigned int uidLength, unsigned int tagType);
+
+        // no tag I/O
+        uint8_t getUidLength() { return _uidLength; }
+        void getUid(byte *uid, unsigned int uidLength);
+        unsigned int getTagType() { return _tagType; }
+
+        // Locate the NDEF TLV (a single READ on Type 2 tags)
+        boolean hasNdefMessage();
+        unsigned int getNdefMessageLength();
+
+        // Decode the next record, reading only the pages it covers. The view
+        // points into the handle. False after the last record or on an error.
+        boolean readRecord(NdefRecordView& record);
+        // start again from the first record (nothing is read twice)
+        void rewind() { _recordOffset = 0; _recordsDone = false; }
+
+        // Read the rest of the message and decode it the usual way
+        NdefMessage getNdefMessage();
+
+        boolean error() { return _error; }
+
+    private:
+        boolean findNdefTlv();
+        boolean fetch(unsigned int length);
+        boolean fetchType2(unsigned int length);
+#ifdef NDEF_SUPPORT_MIFARE_CLASSIC
+        boolean fetchClassic(unsigned int length);
+#endif
+
+        PN532* _nfc;
+        byte _uid[7];
+        uint8_t _uidLength;
+        unsigned int _tagType;
+
+        byte _cache[NFC_TAG_HANDLE_CACHE_SIZE]; // data area bytes [0, _cached)
+        unsigned int _cached;
+        unsigned int _capacity;  // size of the data area, from the capability container
+        int8_t _fastRead;        // -1 = not probed yet, 0 = READ only, 1 = FAST_READ
+#ifdef NDEF_SUPPORT_MIFARE_CLASSIC
+        int _authSector;         // sector authenticated last, -1 = none
+#endif
+
+        int8_t _tlvState;        // -1 = not looked for yet, 0 = no NDEF message, 1 = found
+        unsigned int _ndefStart;
+        unsigned int _ndefLength;
+        unsigned int _recordOffset;
+        boolean _recordsDone;
+        boolean _error;
+};
+
+#endif
@@ -0,0 +1,100 @@
+// Encode/decode cost of the slave's emulated tag contents (URL + name Text
+// record): NdefMessage/NdefRecord versus NdefWriter/NdefReader.
+// Reports nanoseconds and heap allocations per operation.
+
+#include <NdefMessage.h>
+#include <NdefView.h>
+
+#include <stdio.h>
+#include <chrono>
+#include <new>
+
+HardwareSerial Serial;
+
+// count every operator new and malloc made by the code under test
+static unsigned long allocations = 0;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size)
+{
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = __libc_malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static const char *URL = "https://socialtag.io/user/42";
+static const char *NAME = "Alice Example";
+static const int ITERATIONS = 200000;
+static volatile size_t sink;
+
+template <typename F>
+static void run(const char *name, F body)
+{
+    body(); // warm up
+    unsigned long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        body();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("  %-34s %8.1f ns/op %6.2f allocs/op\n", name, elapsed / ITERATIONS,
+           (double)(allocations - before) / ITERATIONS);
+}
+
+int main()
+{
+    uint8_t encoded[128];
+    NdefWriter reference(encoded, sizeof(encoded));
+    reference.addUriRecord(URL);
+    reference.addTextRecord(NAME);
+    size_t encodedSize = reference.size();
+
+    printf("NDEF message: URI + Text record, %u bytes, %d iterations\n", (unsigned)encodedSize, ITERATIONS);
+
+    printf("encode\n");
+    run("NdefMessage add*Record + encode", [&] {
+        uint8_t buffer[128];
+        NdefMessage message;
+        message.addUriRecord(URL);
+        message.addTextRecord(NAME);
+        message.encode(buffer);
+        sink = buffer[message.getEncodedSize() - 1];
+    });
+    run("NdefWriter add*Record", [&] {
+        uint8_t buffer[128];
+        NdefWriter writer(buffer, sizeof(buffer));
+        writer.addUriRecord(URL);
+        writer.addTextRecord(NAME);
+        sink = buffer[writer.size() - 1];
+    });
+
+    printf("decode + read the URL payload\n");
+    run("NdefMessage(bytes) + getRecord", [&] {
+        NdefMessage message(encoded, encodedSize);
+        NdefRecord record = message.getRecord(0);
+        uint8_t payload[64];
+        record.getPayload(payload);
+        sink = payload[record.getPayloadLength() - 1];
+    });
+    run("NdefReader::next", [&] {
+        NdefReader reader(encoded, encodedSize);
+        NdefRecordView view;
+        reader.next(view);
+        sink = view.payload[view.payloadLength - 1];
+    });
+    return 0;
+}
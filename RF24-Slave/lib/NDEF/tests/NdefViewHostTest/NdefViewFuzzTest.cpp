@@ -0,0 +1,292 @@
+// Round-trip and fuzz tests for NdefReader/NdefWriter, plus the legacy
+// NdefMessage decoder that now sits on top of NdefReader.
+// Built with AddressSanitizer: reading outside a buffer aborts the test.
+
+#include <NdefMessage.h>
+#include <NdefView.h>
+
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+HardwareSerial Serial;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+    do                                                                        \
+    {                                                                         \
+        if (!(cond))                                                          \
+        {                                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                       \
+        }                                                                     \
+    } while (0)
+
+struct Record
+{
+    uint8_t tnf;
+    std::vector<uint8_t> type, id, payload;
+};
+
+static std::vector<uint8_t> randomBytes(std::mt19937 &rng, size_t length)
+{
+    std::vector<uint8_t> bytes(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        bytes[i] = rng() & 0xFF;
+    }
+    return bytes;
+}
+
+static Record randomRecord(std::mt19937 &rng)
+{
+    Record r;
+    r.tnf = rng() % 7;
+    r.type = randomBytes(rng, rng() % 8);
+    r.id = randomBytes(rng, (rng() % 3 == 0) ? rng() % 6 : 0);
+    // mostly short records, sometimes past the 255-byte short-record limit
+    r.payload = randomBytes(rng, (rng() % 8 == 0) ? 256 + rng() % 300 : rng() % 40);
+    return r;
+}
+
+static bool sameBytes(const std::vector<uint8_t> &expected, const uint8_t *actual, size_t length)
+{
+    return expected.size() == length && (length == 0 || memcmp(expected.data(), actual, length) == 0);
+}
+
+// NdefWriter output must decode back to the same records and match the legacy encoder byte for byte
+static void testRoundTrip(std::mt19937 &rng)
+{
+    for (int iteration = 0; iteration < 2000; iteration++)
+    {
+        std::vector<Record> records(1 + rng() % MAX_NDEF_RECORDS);
+        for (auto &r : records)
+        {
+            r = randomRecord(rng);
+        }
+
+        std::vector<uint8_t> buffer(4096);
+        NdefWriter writer(buffer.data(), buffer.size());
+        NdefMessage legacy;
+        for (auto &r : records)
+        {
+            CHECK(writer.addRecord(r.tnf, r.type.data(), r.type.size(), r.payload.data(), r.payload.size(),
+                                   r.id.data(), r.id.size()));
+            NdefRecord record;
+            record.setTnf(r.tnf);
+            record.setType(r.type.data(), r.type.size());
+            record.setPayload(r.payload.data(), r.payload.size());
+            if (!r.id.empty())
+            {
+                record.setId(r.id.data(), r.id.size());
+            }
+            legacy.addRecord(record);
+        }
+        CHECK(!writer.overflow());
+
+        std::vector<uint8_t> encoded(legacy.getEncodedSize());
+        legacy.encode(encoded.data());
+        CHECK(sameBytes(encoded, writer.data(), writer.size()));
+
+        NdefReader reader(writer.data(), writer.size());
+        NdefRecordView view;
+        size_t count = 0;
+        while (reader.next(view))
+        {
+            CHECK(count < records.size());
+            if (count >= records.size())
+            {
+                break;
+            }
+            const Record &r = records[count];
+            CHECK(view.tnf == r.tnf);
+            CHECK(view.messageBegin == (count == 0));
+            CHECK(view.messageEnd == (count + 1 == records.size()));
+            CHECK(sameBytes(r.type, view.type, view.typeLength));
+            CHECK(sameBytes(r.id, view.id, view.idLength));
+            CHECK(sameBytes(r.payload, view.payload, view.payloadLength));
+            count++;
+        }
+        CHECK(!reader.error());
+        CHECK(count == records.size());
+        CHECK(reader.offset() == writer.size());
+
+        NdefMessage decoded(writer.data(), writer.size());
+        CHECK(decoded.getRecordCount() == records.size());
+    }
+}
+
+// the helpers must produce exactly what NdefMessage's String-based helpers produce
+static void testHelpers()
+{
+    uint8_t buffer[128];
+    NdefWriter writer(buffer, sizeof(buffer));
+    CHECK(writer.addUriRecord("https://socialtag.io/user/7"));
+    CHECK(writer.addTextRecord("Alice"));
+    CHECK(writer.addEmptyRecord());
+
+    NdefMessage legacy;
+    legacy.addUriRecord("https://socialtag.io/user/7");
+    legacy.addTextRecord("Alice");
+    legacy.addEmptyRecord();
+    std::vector<uint8_t> encoded(legacy.getEncodedSize());
+    legacy.encode(encoded.data());
+    CHECK(sameBytes(encoded, writer.data(), writer.size()));
+}
+
+// every capacity either fits the record whole or leaves the buffer as it was
+static void testOverflow()
+{
+    uint8_t full[64];
+    NdefWriter reference(full, sizeof(full));
+    reference.addUriRecord("https://example.com/");
+    reference.addTextRecord("hello");
+    size_t uriSize = NdefWriter::encodedSize(1, 1 + strlen("https://example.com/"), 0);
+    size_t textSize = reference.size() - uriSize;
+
+    for (size_t capacity = 0; capacity <= reference.size(); capacity++)
+    {
+        std::vector<uint8_t> buffer(capacity + 8, 0xA5);
+        NdefWriter writer(buffer.data(), capacity);
+        bool uri = writer.addUriRecord("https://example.com/");
+        bool text = writer.addTextRecord("hello");
+        CHECK(uri == (capacity >= uriSize));
+        CHECK(text == (capacity - (uri ? uriSize : 0) >= textSize));
+        CHECK(writer.overflow() == !(uri && text));
+        CHECK(writer.size() == (uri ? uriSize : 0) + (text ? textSize : 0));
+        for (size_t i = writer.size(); i < buffer.size(); i++)
+        {
+            CHECK(buffer[i] == 0xA5);
+        }
+        // whatever fit is still a well-formed message
+        NdefReader reader(buffer.data(), writer.size());
+        NdefRecordView view;
+        while (reader.next(view))
+        {
+        }
+        CHECK(!reader.error());
+    }
+
+    uint8_t small[8];
+    NdefWriter writer(small, sizeof(small));
+    CHECK(!writer.addRecord(TNF_UNKNOWN, NULL, 0, small, 0xFFFFFFFFu));
+    CHECK(writer.size() == 0);
+}
+
+// views returned for arbitrary input must lie inside it; ASan catches any stray read
+static void checkDecode(const uint8_t *data, size_t length)
+{
+    NdefReader reader(data, length);
+    NdefRecordView view;
+    int records = 0;
+    while (reader.next(view))
+    {
+        CHECK(view.type >= data && view.type + view.typeLength <= data + length);
+        CHECK(view.payload >= data && view.payloadLength <= (size_t)(data + length - view.payload));
+        if (view.idLength)
+        {
+            CHECK(view.id >= data && view.id + view.idLength <= data + length);
+        }
+        records++;
+    }
+    CHECK(reader.offset() <= length);
+    CHECK(records <= (int)length); // every record takes at least 3 bytes
+
+    NdefMessage legacy(data, (int)length);
+    CHECK(legacy.getRecordCount() <= MAX_NDEF_RECORDS);
+}
+
+static void testFuzz(std::mt19937 &rng)
+{
+    // random bytes, each in an exactly sized heap block so ASan sees the edge
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        std::vector<uint8_t> bytes = randomBytes(rng, rng() % 64);
+        uint8_t *data = new uint8_t[bytes.size() ? bytes.size() : 1];
+        if (!bytes.empty())
+        {
+            memcpy(data, bytes.data(), bytes.size());
+        }
+        checkDecode(data, bytes.size());
+        delete[] data;
+    }
+
+    // valid messages with flipped, truncated or overwritten bytes
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        uint8_t buffer[512];
+        NdefWriter writer(buffer, sizeof(buffer));
+        int count = 1 + rng() % 3;
+        for (int i = 0; i < count; i++)
+        {
+            Record r = randomRecord(rng);
+            writer.addRecord(r.tnf, r.type.data(), r.type.size(), r.payload.data(), r.payload.size(),
+                             r.id.data(), r.id.size());
+        }
+        size_t length = writer.size();
+        if (length == 0)
+        {
+            continue;
+        }
+        switch (rng() % 3)
+        {
+        case 0:
+            buffer[rng() % length] ^= 1 << (rng() % 8);
+            break;
+        case 1:
+            length = rng() % length;
+            break;
+        default:
+            buffer[rng() % length] = rng() & 0xFF;
+            break;
+        }
+        uint8_t *data = new uint8_t[length ? length : 1];
+        memcpy(data, buffer, length);
+        checkDecode(data, length);
+        delete[] data;
+    }
+}
+
+static void testEdges()
+{
+    // the old decoder's `index <= numBytes` loop read past these
+    const uint8_t noEnd[] = { 0x91, 0x01, 0x01, 0x54, 0x00 };        // MB|SR without ME
+    const uint8_t truncated[] = { 0xD1, 0x01, 0x05, 0x54, 0x00 };     // payload length 5, 1 byte left
+    const uint8_t hugeLength[] = { 0xC1, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x54 }; // 4 GB payload
+    NdefRecordView view;
+
+    NdefReader a(noEnd, sizeof(noEnd));
+    CHECK(a.next(view) && !a.next(view) && !a.error());
+
+    NdefReader b(truncated, sizeof(truncated));
+    CHECK(!b.next(view) && b.error());
+
+    NdefReader c(hugeLength, sizeof(hugeLength));
+    CHECK(!c.next(view) && c.error());
+
+    NdefReader d(NULL, 10);
+    CHECK(!d.next(view) && !d.error());
+
+    checkDecode(noEnd, sizeof(noEnd));
+    checkDecode(truncated, sizeof(truncated));
+    checkDecode(hugeLength, sizeof(hugeLength));
+}
+
+int main()
+{
+    std::mt19937 rng(0x4e444546); // "NDEF"
+    testHelpers();
+    testEdges();
+    testOverflow();
+    testRoundTrip(rng);
+    testFuzz(rng);
+
+    if (failures)
+    {
+        printf("ndef_view_fuzz: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ndef_view_fuzz: all checks passed\n");
+    return 0;
+}
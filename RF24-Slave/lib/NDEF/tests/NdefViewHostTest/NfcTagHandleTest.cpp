@@ -0,0 +1,407 @@
+// NfcTagHandle against a PN532 that answers at the command level with the
+// memory of an NTAG215, a Mifare Ultralight C and a Mifare Classic 1K.
+// Checks that records come back intact and counts the commands each read
+// costs, next to the full NfcAdapter::read().
+
+#include <NfcAdapter.h>
+
+#include <stdio.h>
+#include <vector>
+
+HardwareSerial Serial;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+    do                                                                        \
+    {                                                                         \
+        if (!(cond))                                                          \
+        {                                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                       \
+        }                                                                     \
+    } while (0)
+
+enum TagKind
+{
+    NTAG215,      // GET_VERSION + FAST_READ
+    ULTRALIGHT_C, // NAKs GET_VERSION and drops back to IDLE until selected again
+    CLASSIC_1K
+};
+
+class FakePN532 : public PN532Interface
+{
+    public:
+        TagKind kind;
+        uint8_t uid[7];
+        uint8_t uidLength;
+        uint8_t memory[1024]; // Type 2: pages, Classic: blocks
+        unsigned int memorySize;
+        bool idle;
+        int authenticatedSector;
+        unsigned int commands;
+
+        void begin() {}
+        void wakeup() {}
+
+        int8_t writeCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0)
+        {
+            std::vector<uint8_t> frame(header, header + hlen);
+            if (blen)
+            {
+                frame.insert(frame.end(), body, body + blen);
+            }
+            commands++;
+            respond(frame);
+            return 0;
+        }
+
+        int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout = 1000)
+        {
+            if (_response.size() > len)
+            {
+                return PN532_NO_SPACE;
+            }
+            memcpy(buf, _response.data(), _response.size());
+            return _response.size();
+        }
+
+    private:
+        std::vector<uint8_t> _response;
+
+        void fail() { _response.assign(1, 0x01); } // status: timeout
+
+        void respond(const std::vector<uint8_t> &frame)
+        {
+            _response.clear();
+            switch (frame[0])
+            {
+            case PN532_COMMAND_INLISTPASSIVETARGET:
+                idle = false;
+                authenticatedSector = -1;
+                _response = { 1, 1, 0x00, (uint8_t)(kind == CLASSIC_1K ? 0x04 : 0x44),
+                              (uint8_t)(kind == CLASSIC_1K ? 0x08 : 0x00), uidLength };
+                _response.insert(_response.end(), uid, uid + uidLength);
+                return;
+            case PN532_COMMAND_INDATAEXCHANGE:
+                dataExchange(frame[2], &frame[3]);
+                return;
+            case PN532_COMMAND_INCOMMUNICATETHRU:
+                communicateThru(frame[1], &frame[2]);
+                return;
+            default:
+                _response.assign(1, 0x00);
+                return;
+            }
+        }
+
+        void dataExchange(uint8_t command, const uint8_t *args)
+        {
+            if (idle)
+            {
+                fail();
+                return;
+            }
+            if (kind == CLASSIC_1K)
+            {
+                if (command == MIFARE_CMD_AUTH_A)
+                {
+                    authenticatedSector = args[0] / 4;
+                    _response.assign(1, 0x00);
+                }
+                else if (command == MIFARE_CMD_READ && args[0] / 4 == authenticatedSector)
+                {
+                    _response.assign(1, 0x00);
+                    _response.insert(_response.end(), &memory[args[0] * 16], &memory[args[0] * 16 + 16]);
+                }
+                else
+                {
+                    fail();
+                }
+                return;
+            }
+            if (command == MIFARE_CMD_READ)
+            {
+                // 4 pages, wrapping around at the end of memory
+                _response.assign(1, 0x00);
+                for (int i = 0; i < 16; i++)
+                {
+                    _response.push_back(memory[(args[0] * 4 + i) % memorySize]);
+                }
+            }
+            else
+            {
+                fail();
+            }
+        }
+
+        void communicateThru(uint8_t command, const uint8_t *args)
+        {
+            if (idle || kind == CLASSIC_1K)
+            {
+                fail();
+                return;
+            }
+            if (kind == ULTRALIGHT_C)
+            {
+                // unsupported command: NAK, tag falls back to IDLE
+                idle = true;
+                fail();
+                return;
+            }
+            if (command == NTAG_CMD_GET_VERSION)
+            {
+                _response = { 0x00, 0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x11, 0x03 };
+            }
+            else if (command == NTAG_CMD_FAST_READ && args[0] <= args[1] && (args[1] + 1) * 4u <= memorySize)
+            {
+                _response.assign(1, 0x00);
+                _response.insert(_response.end(), &memory[args[0] * 4], &memory[(args[1] + 1) * 4]);
+            }
+            else
+            {
+                fail();
+            }
+        }
+};
+
+static const uint8_t TAG_UID[7] = { 0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0x80 };
+
+// NDEF TLV at the start of the data area; Ultralight C gets the Lock Control TLV it ships with
+static std::vector<uint8_t> dataArea(TagKind kind, const uint8_t *message, size_t length)
+{
+    std::vector<uint8_t> data;
+    if (kind == ULTRALIGHT_C)
+    {
+        data = { 0x01, 0x03, 0xA0, 0x10, 0x44 };
+    }
+    data.push_back(0x03);
+    if (length < 0xFF)
+    {
+        data.push_back(length);
+    }
+    else
+    {
+        data.push_back(0xFF);
+        data.push_back(length >> 8);
+        data.push_back(length & 0xFF);
+    }
+    data.insert(data.end(), message, message + length);
+    data.push_back(0xFE);
+    return data;
+}
+
+static void loadTag(FakePN532 &pn532, TagKind kind, const uint8_t *message, size_t length, bool formatted = true)
+{
+    pn532.kind = kind;
+    memcpy(pn532.uid, TAG_UID, 7);
+    pn532.uidLength = kind == CLASSIC_1K ? 4 : 7;
+    memset(pn532.memory, 0, sizeof(pn532.memory));
+    pn532.idle = false;
+    pn532.authenticatedSector = -1;
+    pn532.commands = 0;
+
+    std::vector<uint8_t> data = dataArea(kind, message, length);
+    if (kind == CLASSIC_1K)
+    {
+        pn532.memorySize = 1024;
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            size_t block = i / 16;
+            pn532.memory[((1 + block / 3) * 4 + block % 3) * 16 + i % 16] = data[i];
+        }
+        return;
+    }
+
+    uint8_t size = kind == NTAG215 ? 0x3E : 0x12; // data area / 8
+    pn532.memorySize = (4 + size * 2) * 4 + 20;
+    uint8_t cc[4] = { 0xE1, 0x10, size, 0x00 };
+    if (!formatted)
+    {
+        memset(cc, 0, sizeof(cc));
+        memset(&pn532.memory[16], 0xFF, 16);
+    }
+    memcpy(&pn532.memory[12], cc, 4);
+    if (formatted)
+    {
+        memcpy(&pn532.memory[16], data.data(), data.size());
+    }
+}
+
+static std::vector<uint8_t> makePayload(size_t length, uint8_t seed)
+{
+    std::vector<uint8_t> payload(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        payload[i] = seed + i * 7;
+    }
+    return payload;
+}
+
+static bool sameBytes(const std::vector<uint8_t> &expected, const uint8_t *actual, size_t length)
+{
+    return expected.size() == length && (length == 0 || memcmp(expected.data(), actual, length) == 0);
+}
+
+// the "tap another player" case: an emulated slave tag, URL + name
+static void testFirstRecord()
+{
+    uint8_t message[96];
+    NdefWriter writer(message, sizeof(message));
+    writer.addUriRecord("socialtag.io/user/42", NDEF_URIPREFIX_HTTPS);
+    writer.addTextRecord("Alice Example");
+
+    const TagKind kinds[] = { NTAG215, ULTRALIGHT_C, CLASSIC_1K };
+    const char *names[] = { "NTAG215", "Ultralight C", "Classic 1K" };
+    printf("URI + Text message (%u bytes): PN532 commands\n", (unsigned)writer.size());
+    for (int k = 0; k < 3; k++)
+    {
+        FakePN532 pn532;
+        loadTag(pn532, kinds[k], message, writer.size());
+        NfcAdapter adapter(pn532);
+
+        CHECK(adapter.tagPresent());
+        pn532.commands = 0;
+        NfcTagHandle tag = adapter.identify();
+        byte uid[7];
+        tag.getUid(uid, sizeof(uid));
+        CHECK(tag.getUidLength() == pn532.uidLength && memcmp(uid, TAG_UID, tag.getUidLength()) == 0);
+        unsigned int uidCommands = pn532.commands;
+
+        NdefRecordView record;
+        CHECK(tag.readRecord(record));
+        CHECK(record.tnf == TNF_WELL_KNOWN && record.typeLength == 1 && record.type[0] == NDEF_RTD_URI);
+        CHECK(record.payloadLength == 21 && record.payload[0] == NDEF_URIPREFIX_HTTPS &&
+              memcmp(record.payload + 1, "socialtag.io/user/42", 20) == 0);
+        unsigned int firstCommands = pn532.commands;
+
+        CHECK(tag.readRecord(record));
+        CHECK(record.type[0] == NDEF_RTD_TEXT && record.messageEnd);
+        CHECK(!tag.readRecord(record) && !tag.error());
+        unsigned int allCommands = pn532.commands;
+
+        // what NfcAdapter::read() costs for the same tag
+        CHECK(adapter.tagPresent());
+        pn532.commands = 0;
+        NfcTag full = adapter.read();
+        CHECK(full.hasNdefMessage() && full.getNdefMessage().getRecordCount() == 2);
+        printf("  %-13s UID %u, first record %u, all records %u | NfcAdapter::read() %u\n", names[k],
+               uidCommands, firstCommands, allCommands, pn532.commands);
+        CHECK(uidCommands == 0);
+        CHECK(firstCommands <= allCommands && allCommands <= pn532.commands);
+    }
+}
+
+// several records, some spanning many pages; each must come back byte for byte
+static void testManyRecords()
+{
+    std::vector<std::vector<uint8_t>> payloads = { makePayload(10, 1), makePayload(90, 2), makePayload(3, 3),
+                                                   makePayload(120, 4) };
+    uint8_t message[300];
+    NdefWriter writer(message, sizeof(message));
+    for (auto &p : payloads)
+    {
+        CHECK(writer.addRecord(TNF_MIME_MEDIA, (const uint8_t *)"a/b", 3, p.data(), p.size()));
+    }
+
+    const TagKind kinds[] = { NTAG215, ULTRALIGHT_C, CLASSIC_1K };
+    for (TagKind kind : kinds)
+    {
+        if (kind == ULTRALIGHT_C && writer.size() > 0x12 * 8 - 8)
+        {
+            continue; // does not fit the tag
+        }
+        FakePN532 pn532;
+        loadTag(pn532, kind, message, writer.size());
+        PN532 shield(pn532);
+        NfcTagHandle tag(shield, TAG_UID, kind == CLASSIC_1K ? 4 : 7, kind == CLASSIC_1K ? TAG_TYPE_MIFARE_CLASSIC : TAG_TYPE_2);
+
+        CHECK(tag.hasNdefMessage() && tag.getNdefMessageLength() == writer.size());
+        NdefRecordView record;
+        size_t count = 0;
+        while (tag.readRecord(record))
+        {
+            CHECK(count < payloads.size() && sameBytes(payloads[count], record.payload, record.payloadLength));
+            count++;
+        }
+        CHECK(!tag.error() && count == payloads.size());
+        if (kind == NTAG215)
+        {
+            // GET_VERSION + FAST_READs beat one READ per 16 bytes
+            CHECK(pn532.commands < (writer.size() + 16) / 16);
+        }
+
+        // nothing is fetched twice
+        unsigned int commands = pn532.commands;
+        tag.rewind();
+        CHECK(tag.readRecord(record) && sameBytes(payloads[0], record.payload, record.payloadLength));
+        NdefMessage decoded = tag.getNdefMessage();
+        CHECK(decoded.getRecordCount() == payloads.size());
+        CHECK(pn532.commands == commands);
+    }
+}
+
+static void testSmallTagNoProbe()
+{
+    // no GET_VERSION (which would knock an Ultralight C back to IDLE) for a couple of READs
+    uint8_t message[32];
+    NdefWriter writer(message, sizeof(message));
+    writer.addTextRecord("hi");
+    FakePN532 pn532;
+    loadTag(pn532, ULTRALIGHT_C, message, writer.size());
+    PN532 shield(pn532);
+    NfcTagHandle tag(shield, TAG_UID, 7, TAG_TYPE_2);
+    NdefRecordView record;
+    CHECK(tag.readRecord(record) && record.type[0] == NDEF_RTD_TEXT);
+    CHECK(pn532.commands == 2 && !pn532.idle);
+}
+
+static void testUnformattedAndBroken()
+{
+    FakePN532 pn532;
+    loadTag(pn532, NTAG215, NULL, 0, false);
+    PN532 shield(pn532);
+    NfcTagHandle blank(shield, TAG_UID, 7, TAG_TYPE_2);
+    NdefRecordView record;
+    CHECK(!blank.hasNdefMessage() && !blank.readRecord(record) && !blank.error());
+    CHECK(blank.getNdefMessage().getRecordCount() == 0);
+
+    // empty NDEF TLV, as left by a fresh format
+    loadTag(pn532, NTAG215, NULL, 0);
+    NfcTagHandle empty(shield, TAG_UID, 7, TAG_TYPE_2);
+    CHECK(empty.hasNdefMessage() && empty.getNdefMessageLength() == 0 && !empty.readRecord(record));
+    CHECK(empty.getNdefMessage().getRecordCount() == 1);
+
+    // a record claiming more payload than the TLV holds
+    const uint8_t lying[] = { 0xD1, 0x01, 0xF0, 0x54, 0x02, 'e', 'n' };
+    loadTag(pn532, NTAG215, lying, sizeof(lying));
+    NfcTagHandle liar(shield, TAG_UID, 7, TAG_TYPE_2);
+    CHECK(liar.hasNdefMessage() && !liar.readRecord(record) && liar.error());
+
+    // a message past NFC_TAG_HANDLE_CACHE_SIZE: the records that fit still read
+    std::vector<uint8_t> small = makePayload(20, 9), big = makePayload(NFC_TAG_HANDLE_CACHE_SIZE, 10);
+    uint8_t message[NFC_TAG_HANDLE_CACHE_SIZE + 64];
+    NdefWriter writer(message, sizeof(message));
+    writer.addRecord(TNF_UNKNOWN, NULL, 0, small.data(), small.size());
+    writer.addRecord(TNF_UNKNOWN, NULL, 0, big.data(), big.size());
+    loadTag(pn532, NTAG215, message, writer.size());
+    NfcTagHandle large(shield, TAG_UID, 7, TAG_TYPE_2);
+    CHECK(large.readRecord(record) && sameBytes(small, record.payload, record.payloadLength));
+    CHECK(!large.readRecord(record) && large.error());
+}
+
+int main()
+{
+    testFirstRecord();
+    testManyRecords();
+    testSmallTagNoProbe();
+    testUnformattedAndBroken();
+
+    if (failures)
+    {
+        printf("nfc_tag_handle_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("nfc_tag_handle_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Just enough of Arduino.h to build the NDEF and PN532 libraries on the
+// host: String, byte/boolean and a Serial that discards everything.
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define F(s) (s)
+
+class String
+{
+    public:
+        String(const char *s = "") : _s(s ? s : "") {}
+        String(const std::string &s) : _s(s) {}
+        String(unsigned int value, unsigned char base)
+        {
+            char buf[16];
+            snprintf(buf, sizeof(buf), base == HEX ? "%x" : "%u", value);
+            _s = buf;
+        }
+        unsigned int length() const { return _s.length(); }
+        const char *c_str() const { return _s.c_str(); }
+        bool equals(const char *s) const { return _s == s; }
+        String &operator+=(const String &rhs) { _s += rhs._s; return *this; }
+        void toUpperCase()
+        {
+            for (auto &c : _s) c = toupper(c);
+        }
+        void getBytes(unsigned char *buf, unsigned int size) const
+        {
+            if (!size) return;
+            unsigned int n = _s.length() < size - 1 ? _s.length() : size - 1;
+            memcpy(buf, _s.data(), n);
+            buf[n] = 0;
+        }
+        friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+        friend String operator+(const char *a, const String &b) { return String(std::string(a) + b._s); }
+
+    private:
+        std::string _s;
+};
+
+class HardwareSerial
+{
+    public:
+        template <typename T> void print(const T &) {}
+        template <typename T> void print(const T &, int) {}
+        template <typename T> void println(const T &) {}
+        template <typename T> void println(const T &, int) {}
+        void println() {}
+};
+
+extern HardwareSerial Serial;
+
+#endif
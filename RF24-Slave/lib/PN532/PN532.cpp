@@ -16,6 +16,9 @@
 PN532::PN532(PN532Interface &interface)
 {
     _interface = &interface;
+    _pendingCommand = 0;
+    _ackPending = false;
+    _ackFailed = false;
 }
 
 /**************************************************************************/
@@ -564,7 +567,7 @@ uint8_t PN532::mifareclassic_WriteNDEFURI (uint8_t sectorNumber, uint8_t uriIden
     // in NDEF records
 
     // Setup the sector buffer (w/pre-formatted TLV wrapper and NDEF message)
-    uint8_t sectorbuffer1[16] = {0x00, 0x00, 0x03, len + 5, 0xD1, 0x01, len + 1, 0x55, uriIdentifier, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t sectorbuffer1[16] = {0x00, 0x00, 0x03, (uint8_t)(len + 5), 0xD1, 0x01, (uint8_t)(len + 1), 0x55, uriIdentifier, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
     uint8_t sectorbuffer2[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
     uint8_t sectorbuffer3[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
     uint8_t sectorbuffer4[16] = {0xD3, 0xF7, 0xD3, 0xF7, 0xD3, 0xF7, 0x7F, 0x07, 0x88, 0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
@@ -680,6 +683,108 @@ uint8_t PN532::mifareultralight_WritePage (uint8_t page, uint8_t *buffer)
     return (0 < HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer)));
 }
 
+/**************************************************************************/
+/*!
+    Reads four consecutive pages (16 bytes) with a single READ command,
+    which is what the tag returns anyway. Reading past the last page
+    wraps around to page 0 on the tag.
+
+    @param  page        The first page number
+    @param  buffer      Pointer to a 16-byte array for the retrieved data
+
+    @returns 1 if everything executed properly, 0 for an error
+*/
+/**************************************************************************/
+uint8_t PN532::mifareultralight_ReadPages (uint8_t page, uint8_t *buffer)
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_INDATAEXCHANGE;
+    pn532_packetbuffer[1] = 1;                   /* Card number */
+    pn532_packetbuffer[2] = MIFARE_CMD_READ;     /* Mifare Read command = 0x30 */
+    pn532_packetbuffer[3] = page;
+
+    if (HAL(writeCommand)(pn532_packetbuffer, 4)) {
+        return 0;
+    }
+
+    /* status byte + 16 data bytes */
+    int16_t length = HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer));
+    if (length < 17 || pn532_packetbuffer[0] != 0x00) {
+        return 0;
+    }
+
+    memcpy (buffer, pn532_packetbuffer + 1, 16);
+    return 1;
+}
+
+/***** NTAG21x Functions ******/
+
+/**************************************************************************/
+/*!
+    Sends GET_VERSION. NTAG21x and Ultralight EV1 answer with 8 bytes
+    (vendor, product type, ..., storage size); tags without the command
+    NAK it and fall back to IDLE, so the caller has to select them again.
+
+    @param  version     Pointer to an 8-byte array for the version data
+
+    @returns 1 if the tag answered, 0 otherwise
+*/
+/**************************************************************************/
+uint8_t PN532::ntag2xx_GetVersion (uint8_t *version)
+{
+    /* 0x60 is also MIFARE AUTH A, so bypass the PN532's MIFARE handling */
+    pn532_packetbuffer[0] = PN532_COMMAND_INCOMMUNICATETHRU;
+    pn532_packetbuffer[1] = NTAG_CMD_GET_VERSION;
+
+    if (HAL(writeCommand)(pn532_packetbuffer, 2)) {
+        return 0;
+    }
+
+    int16_t length = HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer));
+    if (length != 9 || (pn532_packetbuffer[0] & 0x3f) != 0) {
+        return 0;
+    }
+
+    memcpy (version, pn532_packetbuffer + 1, 8);
+    return 1;
+}
+
+/**************************************************************************/
+/*!
+    Reads pages startPage..endPage (inclusive) with one FAST_READ.
+    At most NTAG_FAST_READ_MAX_PAGES pages per call.
+
+    @param  startPage   First page to read
+    @param  endPage     Last page to read
+    @param  buffer      Pointer to (endPage - startPage + 1) * 4 bytes
+
+    @returns 1 if everything executed properly, 0 for an error
+*/
+/**************************************************************************/
+uint8_t PN532::ntag2xx_FastRead (uint8_t startPage, uint8_t endPage, uint8_t *buffer)
+{
+    if (endPage < startPage || endPage - startPage + 1 > NTAG_FAST_READ_MAX_PAGES) {
+        return 0;
+    }
+    uint8_t bytes = (endPage - startPage + 1) * 4;
+
+    pn532_packetbuffer[0] = PN532_COMMAND_INCOMMUNICATETHRU;
+    pn532_packetbuffer[1] = NTAG_CMD_FAST_READ;
+    pn532_packetbuffer[2] = startPage;
+    pn532_packetbuffer[3] = endPage;
+
+    if (HAL(writeCommand)(pn532_packetbuffer, 4)) {
+        return 0;
+    }
+
+    int16_t length = HAL(readResponse)(pn532_packetbuffer, sizeof(pn532_packetbuffer));
+    if (length != 1 + bytes || (pn532_packetbuffer[0] & 0x3f) != 0) {
+        return 0;
+    }
+
+    memcpy (buffer, pn532_packetbuffer + 1, bytes);
+    return 1;
+}
+
 /**************************************************************************/
 /*!
     @brief  Exchanges an APDU with the currently inlisted peer
@@ -692,8 +797,6 @@ uint8_t PN532::mifareultralight_WritePage (uint8_t page, uint8_t *buffer)
 /**************************************************************************/
 bool PN532::inDataExchange(uint8_t *send, uint8_t sendLength, uint8_t *response, uint8_t *responseLength)
 {
-    uint8_t i;
-
     pn532_packetbuffer[0] = 0x40; // PN532_COMMAND_INDATAEXCHANGE;
     pn532_packetbuffer[1] = inListedTag;
 
@@ -726,6 +829,277 @@ bool PN532::inDataExchange(uint8_t *send, uint8_t sendLength, uint8_t *response,
     return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Starts waiting for an ISO14443A target without blocking.
+            The PN532 keeps polling (MxRtyPassiveActivation) until a card
+            enters the field; collect it with readDetectedPassiveTargetID()
+            once isResponseReady() returns true.
+
+    @param  cardbaudrate  Baud rate of the card
+
+    @returns true if the command was sent
+*/
+/**************************************************************************/
+bool PN532::startPassiveTargetIDDetection(uint8_t cardbaudrate)
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+    pn532_packetbuffer[1] = 1;  // max 1 cards at once
+    pn532_packetbuffer[2] = cardbaudrate;
+
+    return startCommand(pn532_packetbuffer, 3);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts InAutoPoll without blocking.
+
+    @param  pollNr  number of polling rounds (0xFF = endless)
+    @param  period  polling period in units of 150 ms
+    @param  type    target type to poll for, e.g. PN532_AUTOPOLL_MIFARE_106
+
+    @returns true if the command was sent
+*/
+/**************************************************************************/
+bool PN532::startAutoPoll(uint8_t pollNr, uint8_t period, uint8_t type)
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_INAUTOPOLL;
+    pn532_packetbuffer[1] = pollNr;
+    pn532_packetbuffer[2] = period;
+    pn532_packetbuffer[3] = type;
+
+    return startCommand(pn532_packetbuffer, 4);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends a command without waiting for the PN532 to acknowledge
+            it. Poll isResponseReady(), then fetch the result with
+            readCommandResponse() or one of the read*() helpers.
+
+    @returns true if the command was sent
+*/
+/**************************************************************************/
+bool PN532::startCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body, uint8_t blen)
+{
+    int8_t status = HAL(sendCommand)(header, hlen, body, blen);
+    if (status < 0) {
+        _pendingCommand = 0;
+        return false;
+    }
+    _pendingCommand = header[0];
+    _ackPending = (status == 1);
+    _ackFailed = false;
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks without blocking whether the pending command finished.
+            The PN532 signals ready for the ACK first; that is read here
+            and the call returns false until the response itself is ready.
+*/
+/**************************************************************************/
+bool PN532::isResponseReady()
+{
+    if (_pendingCommand == 0) {
+        return false;
+    }
+    if (_ackPending) {
+        if (!HAL(isResponseReady)()) {
+            return false;
+        }
+        _ackPending = false;
+        if (HAL(readAck)()) {
+            DMSG("Invalid ACK\n");
+            _ackFailed = true;
+            return true;    // readCommandResponse() reports the failure
+        }
+    }
+    return HAL(isResponseReady)();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the response of the command started with startCommand().
+            Call only after isResponseReady(); the command is finished
+            afterwards either way.
+
+    @returns the response length (status byte included), <0 on failure
+*/
+/**************************************************************************/
+int16_t PN532::readCommandResponse(uint8_t *buf, uint8_t len)
+{
+    bool failed = _pendingCommand == 0 || _ackPending || _ackFailed;
+    _pendingCommand = 0;
+    _ackPending = false;
+    _ackFailed = false;
+    if (failed) {
+        return PN532_INVALID_ACK;
+    }
+    return HAL(readResponse)(buf, len, PN532_ACK_WAIT_TIME);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the result of startPassiveTargetIDDetection() or
+            startAutoPoll(). Call only after isResponseReady().
+
+    @param  uid           Pointer to the array that will be populated
+                          with the card's UID (up to 7 bytes)
+    @param  uidLength     Pointer to the variable that will hold the
+                          length of the card's UID.
+    @param  selRes        Optional, receives SEL_RES (SAK); bit 0x20 set
+                          means the target speaks ISO14443-4 (Type 4 tag)
+
+    @returns true if a target was found; the detection is finished either way
+*/
+/**************************************************************************/
+bool PN532::readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength, uint8_t *selRes)
+{
+    uint8_t command = _pendingCommand;
+
+    int16_t length = readCommandResponse(pn532_packetbuffer, sizeof(pn532_packetbuffer));
+    if (length < 1 || pn532_packetbuffer[0] < 1) {
+        return false;
+    }
+
+    /* InListPassiveTarget: NbTg, Tg, SENS_RES(2), SEL_RES, NFCIDLength, NFCID
+       InAutoPoll:          NbTg, Type, DataLength, Tg, SENS_RES(2), SEL_RES, NFCIDLength, NFCID */
+    uint8_t offset = (command == PN532_COMMAND_INAUTOPOLL) ? 3 : 1;
+    uint8_t idLength = pn532_packetbuffer[offset + 4];
+    if (idLength > sizeof(_uid) || offset + 5 + idLength > length) {
+        return false;
+    }
+
+    *uidLength = idLength;
+    memcpy(uid, pn532_packetbuffer + offset + 5, idLength);
+    inListedTag = pn532_packetbuffer[offset];
+    if (selRes) {
+        *selRes = pn532_packetbuffer[offset + 3];
+    }
+
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Aborts a pending split-phase command
+*/
+/**************************************************************************/
+void PN532::abortCommand()
+{
+    if (_pendingCommand != 0) {
+        HAL(abortCommand)();
+        _pendingCommand = 0;
+        _ackPending = false;
+        _ackFailed = false;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Split-phase inDataExchange(): sends the data to the inlisted
+            target and returns; collect the answer with readDataExchange()
+*/
+/**************************************************************************/
+bool PN532::startDataExchange(const uint8_t *send, uint8_t sendLength)
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_INDATAEXCHANGE;
+    pn532_packetbuffer[1] = inListedTag;
+
+    return startCommand(pn532_packetbuffer, 2, send, sendLength);
+}
+
+/**************************************************************************/
+/*!
+    @param  response        Buffer for the target's answer
+    @param  responseLength  In: size of response, out: bytes received
+
+    @returns true if the target answered without error
+*/
+/**************************************************************************/
+bool PN532::readDataExchange(uint8_t *response, uint8_t *responseLength)
+{
+    int16_t status = readCommandResponse(response, *responseLength);
+    if (status < 1 || (response[0] & 0x3f) != 0) {
+        return false;
+    }
+
+    uint8_t length = status - 1;
+    memmove(response, response + 1, length);
+    *responseLength = length;
+
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Split-phase tgGetData(): waits (inside the PN532) for the next
+            frame from the initiator; collect it with readTgGetData()
+*/
+/**************************************************************************/
+bool PN532::startTgGetData()
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_TGGETDATA;
+
+    return startCommand(pn532_packetbuffer, 1);
+}
+
+/**************************************************************************/
+/*!
+    @returns the length of the frame copied to buf, <0 on failure
+             (e.g. the initiator left the field)
+*/
+/**************************************************************************/
+int16_t PN532::readTgGetData(uint8_t *buf, uint8_t len)
+{
+    int16_t status = readCommandResponse(buf, len);
+    if (status < 1) {
+        return status < 0 ? status : PN532_INVALID_FRAME;
+    }
+
+    if (buf[0] != 0) {
+        DMSG("status is not ok\n");
+        return -5;
+    }
+
+    memmove(buf, buf + 1, status - 1);
+    return status - 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Split-phase tgSetData(): sends a frame to the initiator;
+            check the outcome with readTgSetData()
+*/
+/**************************************************************************/
+bool PN532::startTgSetData(const uint8_t *data, uint8_t len)
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_TGSETDATA;
+
+    return startCommand(pn532_packetbuffer, 1, data, len);
+}
+
+bool PN532::readTgSetData()
+{
+    int16_t status = readCommandResponse(pn532_packetbuffer, sizeof(pn532_packetbuffer));
+    return status >= 1 && pn532_packetbuffer[0] == 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Split-phase inRelease(); finish it with readCommandResponse()
+*/
+/**************************************************************************/
+bool PN532::startInRelease(const uint8_t relevantTarget)
+{
+    pn532_packetbuffer[0] = PN532_COMMAND_INRELEASE;
+    pn532_packetbuffer[1] = relevantTarget;
+
+    return startCommand(pn532_packetbuffer, 2);
+}
+
 /**************************************************************************/
 /*!
     @brief  'InLists' a passive target. PN532 acting as reader/initiator,
@@ -876,8 +1250,6 @@ int16_t PN532::inRelease(const uint8_t relevantTarget){
 
 uint8_t PN532::ntag21x_auth(const uint8_t *key)
 {
-    uint8_t i;
-
     // Prepare the authentication command //
     pn532_packetbuffer[0] = 0x42;
     pn532_packetbuffer[1] = 0x1B;
@@ -48,10 +48,14 @@
 
 #define PN532_RESPONSE_INDATAEXCHANGE       (0x41)
 #define PN532_RESPONSE_INLISTPASSIVETARGET  (0x4B)
+#define PN532_RESPONSE_INAUTOPOLL           (0x61)
 
 
 #define PN532_MIFARE_ISO14443A              (0x00)
 
+// InAutoPoll target types
+#define PN532_AUTOPOLL_MIFARE_106           (0x10)
+
 // Mifare Commands
 #define MIFARE_CMD_AUTH_A                   (0x60)
 #define MIFARE_CMD_AUTH_B                   (0x61)
@@ -63,6 +67,12 @@
 #define MIFARE_CMD_INCREMENT                (0xC1)
 #define MIFARE_CMD_STORE                    (0xC2)
 
+// NTAG21x / Ultralight EV1 commands (sent with InCommunicateThru)
+#define NTAG_CMD_GET_VERSION                (0x60)
+#define NTAG_CMD_FAST_READ                  (0x3A)
+// pages one FAST_READ may return so the response still fits pn532_packetbuffer
+#define NTAG_FAST_READ_MAX_PAGES            (15)
+
 // Prefixes for NDEF Records (to identify record type)
 #define NDEF_URIPREFIX_NONE                 (0x00)
 #define NDEF_URIPREFIX_HTTP_WWWDOT          (0x01)
@@ -143,6 +153,28 @@ public:
     bool readPassiveTargetID(uint8_t cardbaudrate, uint8_t *uid, uint8_t *uidLength, uint16_t timeout = 1000, bool inlist = false);
     bool inDataExchange(uint8_t *send, uint8_t sendLength, uint8_t *response, uint8_t *responseLength);
 
+    // Split-phase commands: start the command, poll isResponseReady() (also
+    // once the IRQ pin went low, it collects the ACK first), then read the
+    // result without blocking in between. One command can be in flight.
+    bool startCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0);
+    bool isCommandPending() { return _pendingCommand != 0; }
+    bool isResponseReady();
+    int16_t readCommandResponse(uint8_t *buf, uint8_t len);
+    void abortCommand();
+
+    bool startPassiveTargetIDDetection(uint8_t cardbaudrate);
+    bool startAutoPoll(uint8_t pollNr, uint8_t period, uint8_t type);
+    bool readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength, uint8_t *selRes = 0);
+
+    bool startDataExchange(const uint8_t *send, uint8_t sendLength);
+    bool readDataExchange(uint8_t *response, uint8_t *responseLength);
+
+    bool startTgGetData();
+    int16_t readTgGetData(uint8_t *buf, uint8_t len);
+    bool startTgSetData(const uint8_t *data, uint8_t len);
+    bool readTgSetData();
+    bool startInRelease(const uint8_t relevantTarget = 0);
+
     // Mifare Classic functions
     bool mifareclassic_IsFirstBlock (uint32_t uiBlock);
     bool mifareclassic_IsTrailerBlock (uint32_t uiBlock);
@@ -155,6 +187,11 @@ public:
     // Mifare Ultralight functions
     uint8_t mifareultralight_ReadPage (uint8_t page, uint8_t *buffer);
     uint8_t mifareultralight_WritePage (uint8_t page, uint8_t *buffer);
+    uint8_t mifareultralight_ReadPages (uint8_t page, uint8_t *buffer);
+
+    // NTAG21x functions
+    uint8_t ntag2xx_GetVersion (uint8_t *version);
+    uint8_t ntag2xx_FastRead (uint8_t startPage, uint8_t endPage, uint8_t *buffer);
 
     uint8_t ntag21x_auth(const uint8_t *key);
 
@@ -172,6 +209,9 @@ private:
     uint8_t _uidLen;  // uid len
     uint8_t _key[6];  // Mifare Classic key
     uint8_t inListedTag; // Tg number of inlisted tag.
+    uint8_t _pendingCommand; // split-phase command waiting for its response (0 = none)
+    bool _ackPending;        // its ACK has not been read yet
+    bool _ackFailed;         // its ACK was invalid, the response will never come
 
     uint8_t pn532_packetbuffer[64];
 
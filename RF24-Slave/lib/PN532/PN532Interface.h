@@ -41,6 +41,25 @@ public:
     */
     virtual int8_t writeCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0) = 0;
 
+    /**
+    * @brief    write a command without waiting for its ACK (split-phase commands)
+    * @return   0       sent and ACK already checked (the interface cannot split them)
+    *           1       sent, ACK pending: call readAck() once isResponseReady()
+    *           <0      failed
+    */
+    virtual int8_t sendCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0)
+    {
+        int8_t status = writeCommand(header, hlen, body, blen);
+        return status < 0 ? status : 0;
+    }
+
+    /**
+    * @brief    read the ACK of a command sent with sendCommand()
+    * @return   0       valid ACK
+    *           not 0   failed
+    */
+    virtual int8_t readAck() { return 0; }
+
     /**
     * @brief    read the response of a command, strip prefix and suffix
     * @param    buf     to contain the response data
@@ -50,6 +69,18 @@ public:
     *           <0      failed to read response
     */
     virtual int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout = 1000) = 0;
+
+    /**
+    * @brief    check without blocking whether a response is waiting to be read
+    * @return   true    a response is ready (or the interface cannot tell cheaply,
+    *                   in which case readResponse() should be called with a short timeout)
+    */
+    virtual bool isResponseReady() { return true; }
+
+    /**
+    * @brief    abort the command that is currently being processed (host sends an ACK frame)
+    */
+    virtual void abortCommand() {}
 };
 
 #endif
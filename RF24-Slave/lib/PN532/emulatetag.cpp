@@ -68,166 +68,259 @@ void EmulateTag::setUid(uint8_t* uid){
   uidPtr = uid;
 }
 
-bool EmulateTag::emulate(const uint16_t tgInitAsTargetTimeout){
-
-  // http://www.nxp.com/documents/application_note/AN133910.pdf
-  uint8_t command[] = {
-      PN532_COMMAND_TGINITASTARGET,
-      0x05,                  // MODE: PICC only, Passive only
-
-      0x04, 0x00,         // SENS_RES
-      0x00, 0x00, 0x00,   // NFCID1
-      0x20,               // SEL_RES
-
-      0x01, 0xFE,         // Parameters to build POL_RES
-      0xA2, 0xA3, 0xA4,
-      0xA5, 0xA6, 0xA7,
-      0xC0, 0xC1, 0xC2,
-      0xC3, 0xC4, 0xC5,
-      0xC6, 0xC7, 0xFF,
-      0xFF,
-      0xAA, 0x99, 0x88, //NFCID3t (10 bytes)
-      0x77, 0x66, 0x55, 0x44,
-      0x33, 0x22, 0x11,
-
-      0, // length of general bytes
-      0  // length of historical bytes
-  };
+// http://www.nxp.com/documents/application_note/AN133910.pdf
+static const uint8_t tg_init_as_target[] = {
+    PN532_COMMAND_TGINITASTARGET,
+    0x05,                  // MODE: PICC only, Passive only
+
+    0x04, 0x00,         // SENS_RES
+    0x00, 0x00, 0x00,   // NFCID1
+    0x20,               // SEL_RES
+
+    0x01, 0xFE,         // Parameters to build POL_RES
+    0xA2, 0xA3, 0xA4,
+    0xA5, 0xA6, 0xA7,
+    0xC0, 0xC1, 0xC2,
+    0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xFF,
+    0xFF,
+    0xAA, 0x99, 0x88, //NFCID3t (10 bytes)
+    0x77, 0x66, 0x55, 0x44,
+    0x33, 0x22, 0x11,
+
+    0, // length of general bytes
+    0  // length of historical bytes
+};
+
+static const uint8_t compatibility_container_template[] = {
+  0, 0x0F,
+  0x20,
+  0, 0x54,
+  0, 0xFF,
+  0x04,       // T
+  0x06,       // L
+  0xE1, 0x04, // File identifier
+  ((NDEF_MAX_LENGTH & 0xFF00) >> 8), (NDEF_MAX_LENGTH & 0xFF), // maximum NDEF file size
+  0x00,       // read access 0x0 = granted
+  0x00        // write access 0x0 = granted | 0xFF = deny
+};
+
+// pollEmulation() steps
+enum { STEP_INIT, STEP_GETDATA, STEP_SETDATA, STEP_RELEASE };
+
+void EmulateTag::buildInitCommand(uint8_t* command){
+  memcpy(command, tg_init_as_target, sizeof(tg_init_as_target));
 
   if(uidPtr != 0){  // if uid is set copy 3 bytes to nfcid1
     memcpy(command + 4, uidPtr, 3);
   }
+}
 
-  if(1 != pn532.tgInitAsTarget(command,sizeof(command), tgInitAsTargetTimeout)){
-    DMSG("tgInitAsTarget failed or timed out!");
-    return false;
-  }
-
-  uint8_t compatibility_container[] = {
-    0, 0x0F,
-    0x20,
-    0, 0x54,
-    0, 0xFF,
-    0x04,       // T
-    0x06,       // L
-    0xE1, 0x04, // File identifier
-    ((NDEF_MAX_LENGTH & 0xFF00) >> 8), (NDEF_MAX_LENGTH & 0xFF), // maximum NDEF file size
-    0x00,       // read access 0x0 = granted
-    0x00        // write access 0x0 = granted | 0xFF = deny
-  };
-
+void EmulateTag::beginSession(){
+  memcpy(compatibility_container, compatibility_container_template, sizeof(compatibility_container));
   if(tagWriteable == false){
     compatibility_container[14] = 0xFF;
   }
 
   tagWrittenByInitiator = false;
+  currentFile = NONE;
+}
 
-  uint8_t rwbuf[128];
-  uint8_t sendlen;
-  int16_t status;
-  tag_file currentFile = NONE;
-  uint16_t cc_size = sizeof(compatibility_container);
-  bool runLoop = true;
+bool EmulateTag::emulate(const uint16_t tgInitAsTargetTimeout){
 
-  while(runLoop){
-    status = pn532.tgGetData(rwbuf, sizeof(rwbuf));
+  uint8_t command[sizeof(tg_init_as_target)];
+  buildInitCommand(command);
+
+  if(1 != pn532.tgInitAsTarget(command,sizeof(command), tgInitAsTargetTimeout)){
+    DMSG("tgInitAsTarget failed or timed out!");
+    return false;
+  }
+
+  beginSession();
+
+  while(true){
+    int16_t status = pn532.tgGetData(rwbuf, sizeof(rwbuf));
     if(status < 0){
       DMSG("tgGetData failed!\n");
       pn532.inRelease();
       return true;
     }
 
-    uint8_t p1 = rwbuf[C_APDU_P1];
-    uint8_t p2 = rwbuf[C_APDU_P2];
-    uint8_t lc = rwbuf[C_APDU_LC];
-    uint16_t p1p2_length = ((int16_t) p1 << 8) + p2;
-
-    switch(rwbuf[C_APDU_INS]){
-    case ISO7816_SELECT_FILE:
-      switch(p1){
-      case C_APDU_P1_SELECT_BY_ID:
-	if(p2 != 0x0c){
-	  DMSG("C_APDU_P2 != 0x0c\n");
-	  setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
-	} else if(lc == 2 && rwbuf[C_APDU_DATA] == 0xE1 && (rwbuf[C_APDU_DATA+1] == 0x03 || rwbuf[C_APDU_DATA+1] == 0x04)){
-	  setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
-	  if(rwbuf[C_APDU_DATA+1] == 0x03){
-	    currentFile = CC;
-	  } else if(rwbuf[C_APDU_DATA+1] == 0x04){
-	    currentFile = NDEF;
-	  }
-	} else {
-	  setResponse(TAG_NOT_FOUND, rwbuf, &sendlen);
-	}
-	break;
-      case C_APDU_P1_SELECT_BY_NAME: 
-        const uint8_t ndef_tag_application_name_v2[] = {0, 0x7, 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01 };
-	if(0 == memcmp(ndef_tag_application_name_v2, rwbuf + C_APDU_P2, sizeof(ndef_tag_application_name_v2))){
-	  setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
-	} else{
-	  DMSG("function not supported\n");
-	  setResponse(FUNCTION_NOT_SUPPORTED, rwbuf, &sendlen);
-	} 
-	break;
-      }
+    uint8_t sendlen = processApdu();
+    if(!pn532.tgSetData(rwbuf, sendlen)){
+      DMSG("tgSetData failed\n!");
+      pn532.inRelease();
+      return true;
+    }
+  }
+}
+
+bool EmulateTag::startEmulation(){
+  uint8_t command[sizeof(tg_init_as_target)];
+  buildInitCommand(command);
+
+  step = STEP_INIT;
+  if(!pn532.startCommand(command, sizeof(command))){
+    DMSG("tgInitAsTarget failed!");
+    state = EMULATION_IDLE;
+    return false;
+  }
+  state = EMULATION_WAITING;
+  return true;
+}
+
+emulationState EmulateTag::pollEmulation(){
+  if((state != EMULATION_WAITING && state != EMULATION_ACTIVE) || !pn532.isResponseReady()){
+    return state;
+  }
+
+  switch(step){
+  case STEP_INIT:
+    if(pn532.readCommandResponse(rwbuf, sizeof(rwbuf)) <= 0){
+      DMSG("tgInitAsTarget failed!");
+      state = EMULATION_FINISHED;
       break;
-    case ISO7816_READ_BINARY:
-      switch(currentFile){
-      case NONE:
-	setResponse(TAG_NOT_FOUND, rwbuf, &sendlen);
-	break;
-      case CC:
-	if( p1p2_length > NDEF_MAX_LENGTH){
-	  setResponse(END_OF_FILE_BEFORE_REACHED_LE_BYTES, rwbuf, &sendlen);
-	}else {
-	  memcpy(rwbuf,compatibility_container + p1p2_length, lc);
-	  setResponse(COMMAND_COMPLETE, rwbuf + lc, &sendlen, lc);
-	}
-	break;
-      case NDEF:
-	if( p1p2_length > NDEF_MAX_LENGTH){
-	  setResponse(END_OF_FILE_BEFORE_REACHED_LE_BYTES, rwbuf, &sendlen);
-	}else {
-	  memcpy(rwbuf, ndef_file + p1p2_length, lc);
-	  setResponse(COMMAND_COMPLETE, rwbuf + lc, &sendlen, lc);
-	}
-	break;
-      }
-      break;    
-    case ISO7816_UPDATE_BINARY:
-      if(!tagWriteable){
-	  setResponse(FUNCTION_NOT_SUPPORTED, rwbuf, &sendlen);
-      } else{      
-	if( p1p2_length > NDEF_MAX_LENGTH){
-	  setResponse(MEMORY_FAILURE, rwbuf, &sendlen);
+    }
+    beginSession();
+    state = EMULATION_ACTIVE;
+    step = STEP_GETDATA;
+    if(!pn532.startTgGetData()){
+      release();
+    }
+    break;
+  case STEP_GETDATA:
+    if(pn532.readTgGetData(rwbuf, sizeof(rwbuf)) < 0){
+      DMSG("tgGetData failed!\n");
+      release();
+      break;
+    }
+    step = STEP_SETDATA;
+    if(!pn532.startTgSetData(rwbuf, processApdu())){
+      release();
+    }
+    break;
+  case STEP_SETDATA:
+    if(!pn532.readTgSetData()){
+      DMSG("tgSetData failed\n!");
+      release();
+      break;
+    }
+    step = STEP_GETDATA;
+    if(!pn532.startTgGetData()){
+      release();
+    }
+    break;
+  case STEP_RELEASE:
+    pn532.readCommandResponse(rwbuf, sizeof(rwbuf));
+    state = EMULATION_FINISHED;
+    break;
+  }
+  return state;
+}
+
+void EmulateTag::stopEmulation(){
+  if(state == EMULATION_WAITING || state == EMULATION_ACTIVE){
+    pn532.abortCommand();
+  }
+  state = EMULATION_IDLE;
+}
+
+void EmulateTag::release(){
+  step = STEP_RELEASE;
+  if(!pn532.startInRelease()){
+    state = EMULATION_FINISHED;
+  }
+}
+
+// Answers the C-APDU in rwbuf in place, returns the length of the R-APDU
+uint8_t EmulateTag::processApdu(){
+  uint8_t sendlen = 0;
+  uint8_t p1 = rwbuf[C_APDU_P1];
+  uint8_t p2 = rwbuf[C_APDU_P2];
+  uint8_t lc = rwbuf[C_APDU_LC];
+  uint16_t p1p2_length = ((int16_t) p1 << 8) + p2;
+
+  switch(rwbuf[C_APDU_INS]){
+  case ISO7816_SELECT_FILE:
+    switch(p1){
+    case C_APDU_P1_SELECT_BY_ID:
+      if(p2 != 0x0c){
+	DMSG("C_APDU_P2 != 0x0c\n");
+	setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
+      } else if(lc == 2 && rwbuf[C_APDU_DATA] == 0xE1 && (rwbuf[C_APDU_DATA+1] == 0x03 || rwbuf[C_APDU_DATA+1] == 0x04)){
+	setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
+	if(rwbuf[C_APDU_DATA+1] == 0x03){
+	  currentFile = CC;
+	} else if(rwbuf[C_APDU_DATA+1] == 0x04){
+	  currentFile = NDEF;
 	}
-	else{
-	  memcpy(ndef_file + p1p2_length, rwbuf + C_APDU_DATA, lc);
-	  setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
-	  tagWrittenByInitiator = true;
-      
-      uint16_t ndef_length = (ndef_file[0] << 8) + ndef_file[1];
-      if ((ndef_length > 0) && (updateNdefCallback != 0)) {
-        updateNdefCallback(ndef_file + 2, ndef_length);
+      } else {
+	setResponse(TAG_NOT_FOUND, rwbuf, &sendlen);
       }
-	}
+      break;
+    case C_APDU_P1_SELECT_BY_NAME: {
+      const uint8_t ndef_tag_application_name_v2[] = {0, 0x7, 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01 };
+      if(0 == memcmp(ndef_tag_application_name_v2, rwbuf + C_APDU_P2, sizeof(ndef_tag_application_name_v2))){
+	setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
+      } else{
+	DMSG("function not supported\n");
+	setResponse(FUNCTION_NOT_SUPPORTED, rwbuf, &sendlen);
       }
       break;
+    }
     default:
-      DMSG("Command not supported!");
-      DMSG_HEX(rwbuf[C_APDU_INS]);
-      DMSG("\n");
       setResponse(FUNCTION_NOT_SUPPORTED, rwbuf, &sendlen);
     }
-    status = pn532.tgSetData(rwbuf, sendlen);
-    if(status < 0){
-      DMSG("tgSetData failed\n!");
-      pn532.inRelease();
-      return true;
+    break;
+  case ISO7816_READ_BINARY:
+    switch(currentFile){
+    case NONE:
+      setResponse(TAG_NOT_FOUND, rwbuf, &sendlen);
+      break;
+    case CC:
+      if( p1p2_length > NDEF_MAX_LENGTH){
+	setResponse(END_OF_FILE_BEFORE_REACHED_LE_BYTES, rwbuf, &sendlen);
+      }else {
+	memcpy(rwbuf,compatibility_container + p1p2_length, lc);
+	setResponse(COMMAND_COMPLETE, rwbuf + lc, &sendlen, lc);
+      }
+      break;
+    case NDEF:
+      if( p1p2_length > NDEF_MAX_LENGTH){
+	setResponse(END_OF_FILE_BEFORE_REACHED_LE_BYTES, rwbuf, &sendlen);
+      }else {
+	memcpy(rwbuf, ndef_file + p1p2_length, lc);
+	setResponse(COMMAND_COMPLETE, rwbuf + lc, &sendlen, lc);
+      }
+      break;
+    }
+    break;
+  case ISO7816_UPDATE_BINARY:
+    if(!tagWriteable){
+      setResponse(FUNCTION_NOT_SUPPORTED, rwbuf, &sendlen);
+    } else{
+      if( p1p2_length > NDEF_MAX_LENGTH){
+	setResponse(MEMORY_FAILURE, rwbuf, &sendlen);
+      }
+      else{
+	memcpy(ndef_file + p1p2_length, rwbuf + C_APDU_DATA, lc);
+	setResponse(COMMAND_COMPLETE, rwbuf, &sendlen);
+	tagWrittenByInitiator = true;
+
+	uint16_t ndef_length = (ndef_file[0] << 8) + ndef_file[1];
+	if ((ndef_length > 0) && (updateNdefCallback != 0)) {
+	  updateNdefCallback(ndef_file + 2, ndef_length);
+	}
+      }
     }
+    break;
+  default:
+    DMSG("Command not supported!");
+    DMSG_HEX(rwbuf[C_APDU_INS]);
+    DMSG("\n");
+    setResponse(FUNCTION_NOT_SUPPORTED, rwbuf, &sendlen);
   }
-  pn532.inRelease();
-  return true;
+  return sendlen;
 }
 
 void EmulateTag::setResponse(responseCommand cmd, uint8_t* buf, uint8_t* sendlen, uint8_t sendlenOffset){
@@ -15,16 +15,31 @@
 
 #define NDEF_MAX_LENGTH 128  // altough ndef can handle up to 0xfffe in size, arduino cannot.
 typedef enum {COMMAND_COMPLETE, TAG_NOT_FOUND, FUNCTION_NOT_SUPPORTED, MEMORY_FAILURE, END_OF_FILE_BEFORE_REACHED_LE_BYTES} responseCommand;
+typedef enum {EMULATION_IDLE, EMULATION_WAITING, EMULATION_ACTIVE, EMULATION_FINISHED} emulationState;
 
 class EmulateTag{
 
 public:
-EmulateTag(PN532Interface &interface) : pn532(interface), uidPtr(0), tagWrittenByInitiator(false), tagWriteable(true), updateNdefCallback(0) { }
+EmulateTag(PN532Interface &interface) : pn532(interface), uidPtr(0), tagWrittenByInitiator(false), tagWriteable(true), updateNdefCallback(0), state(EMULATION_IDLE), step(0), currentFile(0) { }
   
   bool init();
 
   bool emulate(const uint16_t tgInitAsTargetTimeout = 0);
 
+  /*
+   * Non-blocking emulate(): startEmulation() arms the PN532 as a target and
+   * returns; each pollEmulation() call then advances the exchange by at most
+   * one PN532 command, so it never waits for the initiator. Call it from the
+   * main loop until it returns EMULATION_FINISHED (the initiator left and the
+   * target was released). stopEmulation() abandons the pending command.
+   */
+  bool startEmulation();
+  emulationState pollEmulation();
+  void stopEmulation();
+  emulationState getEmulationState(){
+    return state;
+  }
+
   /*
    * @param uid pointer to byte array of length 3 (uid is 4 bytes - first byte is fixed) or zero for uid 
    */
@@ -65,6 +80,16 @@ private:
   bool tagWriteable;
   void (*updateNdefCallback)(uint8_t *ndef, uint16_t length);
 
+  emulationState state;
+  uint8_t step;                       // PN532 command pollEmulation() waits for
+  uint8_t currentFile;
+  uint8_t compatibility_container[15];
+  uint8_t rwbuf[128];
+
+  void buildInitCommand(uint8_t* command);
+  void beginSession();
+  uint8_t processApdu();
+  void release();
   void setResponse(responseCommand cmd, uint8_t* buf, uint8_t* sendlen, uint8_t sendlenOffset = 0);
 };
 
@@ -44,9 +44,8 @@ void PN532_SPI::wakeup()
 
 int8_t PN532_SPI::writeCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body, uint8_t blen)
 {
-    command = header[0];
-    writeFrame(header, hlen, body, blen);
-    
+    sendCommand(header, hlen, body, blen);
+
     uint8_t timeout = PN532_ACK_WAIT_TIME;
     while (!isReady()) {
         delay(1);
@@ -56,13 +55,21 @@ int8_t PN532_SPI::writeCommand(const uint8_t *header, uint8_t hlen, const uint8_
             return -2;
         }
     }
-    if (readAckFrame()) {
+    if (readAck()) {
         DMSG("Invalid ACK\n");
         return PN532_INVALID_ACK;
     }
     return 0;
 }
 
+// the ACK shows up as a ready status like any response; PN532::isResponseReady() collects it
+int8_t PN532_SPI::sendCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body, uint8_t blen)
+{
+    command = header[0];
+    writeFrame(header, hlen, body, blen);
+    return 1;
+}
+
 int16_t PN532_SPI::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
 {
     uint16_t time = 0;
@@ -142,6 +149,21 @@ int16_t PN532_SPI::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout)
     return result;
 }
 
+void PN532_SPI::abortCommand()
+{
+    const uint8_t PN532_ACK[] = {0, 0, 0xFF, 0, 0xFF, 0};
+
+    digitalWrite(_ss, LOW);
+    delay(2);               // wake up PN532
+
+    write(DATA_WRITE);
+    for (uint8_t i = 0; i < sizeof(PN532_ACK); i++) {
+        write(PN532_ACK[i]);
+    }
+
+    digitalWrite(_ss, HIGH);
+}
+
 bool PN532_SPI::isReady()
 {
     digitalWrite(_ss, LOW);
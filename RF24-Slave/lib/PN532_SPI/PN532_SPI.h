@@ -14,6 +14,12 @@ public:
     int8_t writeCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0);
 
     int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout);
+
+    int8_t sendCommand(const uint8_t *header, uint8_t hlen, const uint8_t *body = 0, uint8_t blen = 0);
+    int8_t readAck() { return readAckFrame(); }
+
+    bool isResponseReady() { return isReady(); }
+    void abortCommand();
     
 private:
     SPIClass* _spi;
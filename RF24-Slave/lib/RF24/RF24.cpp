@@ -403,6 +403,12 @@ void RF24::write_payload(const void* buf, uint8_t data_len, const uint8_t writeT
 
 void RF24::read_payload(void* buf, uint8_t data_len)
 {
+#if defined(RF24_SPIDEV)
+    beginTransaction();
+    queue_read_payload(buf, data_len);
+    _SPI.flush();
+    endTransaction();
+#else // !defined(RF24_SPIDEV)
     uint8_t* current = reinterpret_cast<uint8_t*>(buf);
 
     uint8_t blank_len = 0;
@@ -476,12 +482,47 @@ void RF24::read_payload(void* buf, uint8_t data_len)
     endTransaction();
 
 #endif // !defined(RF24_LINUX) && !defined(RF24_RP2)
+#endif // !defined(RF24_SPIDEV)
 }
 
 /****************************************************************************/
 
+#if defined(RF24_SPIDEV)
+void RF24::queue_read_payload(void* buf, uint8_t data_len)
+{
+    uint8_t blank_len = 0;
+    if (!dynamic_payloads_enabled) {
+        data_len = rf24_min(data_len, payload_size);
+        blank_len = static_cast<uint8_t>(payload_size - data_len);
+    }
+    else {
+        data_len = rf24_min(data_len, static_cast<uint8_t>(32));
+    }
+
+    IF_SERIAL_DEBUG(printf("[Reading %u bytes %u blanks]\n", data_len, blank_len););
+
+    // The FIFO entry is popped when CSN rises, so the payload is only valid for this one frame
+    rx_pl_wid = 0xFF;
+
+    // command byte, then payload bytes straight into the caller's buffer, then padding (discarded)
+    spi_txbuff[0] = R_RX_PAYLOAD;
+    _SPI.queue(spi_txbuff, &status, 1, !data_len && !blank_len);
+    if (data_len) {
+        _SPI.queue(NULL, buf, data_len, !blank_len);
+    }
+    if (blank_len) {
+        _SPI.queue(NULL, NULL, blank_len);
+    }
+}
+#endif // defined(RF24_SPIDEV)
+
+/****************************************************************************/
+
 uint8_t RF24::flush_rx(void)
 {
+#if defined(RF24_SPIDEV)
+    rx_pl_wid = 0xFF;
+#endif
     write_register(FLUSH_RX, RF24_NOP, true);
     return status;
 }
@@ -1502,7 +1543,12 @@ void RF24::maskIRQ(bool tx, bool fail, bool rx)
 
 uint8_t RF24::getDynamicPayloadSize(void)
 {
+#if defined(RF24_SPIDEV)
+    // available() already fetched the width in the same SPI message as STATUS
+    uint8_t result = rx_pl_wid != 0xFF ? rx_pl_wid : read_register(R_RX_PL_WID);
+#else
     uint8_t result = read_register(R_RX_PL_WID);
+#endif
 
     if (result > 32) {
         flush_rx();
@@ -1523,8 +1569,16 @@ bool RF24::available(void)
 
 bool RF24::available(uint8_t* pipe_num)
 {
+#if defined(RF24_SPIDEV)
+    // R_RX_PL_WID returns STATUS as its first byte, so one transfer answers both
+    // available() and the getDynamicPayloadSize() call that usually follows it
+    uint8_t width = read_register(R_RX_PL_WID);
+    uint8_t pipe = (status >> RX_P_NO) & 0x07;
+    rx_pl_wid = pipe > 5 ? 0xFF : width;
+#else
     // get implied RX FIFO empty flag from status byte
     uint8_t pipe = (get_status() >> RX_P_NO) & 0x07;
+#endif
     if (pipe > 5)
         return 0;
 
@@ -1539,12 +1593,24 @@ bool RF24::available(uint8_t* pipe_num)
 
 void RF24::read(void* buf, uint8_t len)
 {
+#if defined(RF24_SPIDEV)
+    // Fetch the payload and clear RX_DR with a single SPI_IOC_MESSAGE
+    beginTransaction();
+    queue_read_payload(buf, len);
+    spi_txbuff[1] = W_REGISTER | NRF_STATUS;
+    spi_txbuff[2] = _BV(RX_DR);
+    _SPI.queue(spi_txbuff + 1, spi_rxbuff, 2);
+    _SPI.flush();
+    status = spi_rxbuff[0];
+    endTransaction();
+#else
 
     // Fetch the payload
     read_payload(buf, len);
 
     //Clear the only applicable interrupt flags
     write_register(NRF_STATUS, _BV(RX_DR));
+#endif
 }
 
 /****************************************************************************/
@@ -1868,6 +1934,13 @@ uint8_t RF24::getARC(void)
 
 /****************************************************************************/
 
+uint8_t RF24::getPLOS(void)
+{
+    return read_register(OBSERVE_TX) >> PLOS_CNT;
+}
+
+/****************************************************************************/
+
 bool RF24::setDataRate(rf24_datarate_e speed)
 {
     bool result = false;
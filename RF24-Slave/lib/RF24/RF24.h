@@ -144,6 +144,9 @@ private:
     uint8_t config_reg;               /* For storing the value of the NRF_CONFIG register */
     bool _is_p_variant;               /* For storing the result of testing the toggleFeatures() affect */
     bool _is_p0_rx;                   /* For keeping track of pipe 0's usage in user-triggered RX mode. */
+#if defined(RF24_SPIDEV)
+    uint8_t rx_pl_wid = 0xFF; /* R_RX_PL_WID fetched alongside STATUS by available(); 0xFF when stale */
+#endif
 
 protected:
     /**
@@ -174,6 +177,16 @@ protected:
      */
     void read_register(uint8_t reg, uint8_t* buf, uint8_t len);
 
+#if defined(RF24_SPIDEV)
+    /**
+     * Queue an R_RX_PAYLOAD command on the SPIDEV batch without submitting it.
+     *
+     * The payload is shifted straight into @p buf, so no copy through spi_rxbuff is needed.
+     * The caller submits the batch with SPI::flush().
+     */
+    void queue_read_payload(void* buf, uint8_t len);
+#endif
+
     /**
      * Read single byte from a register
      *
@@ -1644,6 +1657,16 @@ public:
      */
     uint8_t getARC(void);
 
+    /**
+     * Returns the lost packet count (PLOS_CNT)
+     *
+     * Counts the transmissions that reached the maximum number of retries.
+     * Saturates at 15 and resets when the channel is written with setChannel().
+     *
+     * @return Returns values from 0 to 15.
+     */
+    uint8_t getPLOS(void);
+
     /**
      * Set the transmission @ref Datarate
      *
@@ -0,0 +1,115 @@
+/*
+ * See documentation at https://nRF24.github.io/RF24
+ * See License information at root directory of this library
+ */
+
+/**
+ * A microbenchmark of the receive path's SPI cost.
+ *
+ * Times a polling cycle the way a receiver runs it: available(), and only
+ * when that reports a payload, getDynamicPayloadSize() + read(). Cycles
+ * that find the RX FIFO empty and cycles that read a payload cost
+ * different SPI traffic, so the microseconds and (with the SPIDEV driver)
+ * the number of SPI ioctl() syscalls are reported for each case
+ * separately. The empty case needs no second node; for the payload case
+ * run a transmitter on address "1Node" (e.g. gettingStarted in the TX
+ * role) while the benchmark runs.
+ *
+ * Usage: spidevBenchmark [cycles]
+ */
+#include <cstdlib>     // atoi()
+#include <iostream>    // cout, endl
+#include <time.h>      // CLOCK_MONOTONIC_RAW, timespec, clock_gettime()
+#include <RF24/RF24.h> // RF24, RF24_PA_LOW
+
+using namespace std;
+
+/****************** Linux ***********************/
+// Radio CE Pin, CSN Pin, SPI Speed
+// CE Pin uses GPIO number with BCM and SPIDEV drivers, other platforms use their own pin numbering
+// CS Pin addresses the SPI bus number at /dev/spidev<a>.<b>
+// ie: RF24 radio(<ce_pin>, <a>*10+<b>); spidev1.0 is 10, spidev1.1 is 11 etc..
+
+// Generic:
+RF24 radio(22, 0);
+/****************** Linux (BBB,x86,etc) ***********************/
+// See http://nRF24.github.io/RF24/pages.html for more information on usage
+// See https://www.kernel.org/doc/Documentation/spi/spidev for more information on SPIDEV
+
+uint64_t getNanos(); // prototype to read the monotonic clock in nanoseconds
+
+int main(int argc, char** argv)
+{
+    unsigned int cycles = argc > 1 ? atoi(argv[1]) : 10000;
+    if (!cycles) {
+        cycles = 1;
+    }
+
+    // perform hardware check
+    if (!radio.begin()) {
+        cout << "radio hardware is not responding!!" << endl;
+        return 0; // quit now
+    }
+
+    uint8_t address[6] = "1Node";
+    radio.setPALevel(RF24_PA_LOW);
+    radio.enableDynamicPayloads();
+    radio.openReadingPipe(1, address);
+    radio.startListening();
+
+    uint8_t buffer[32];
+    // [0]: RX FIFO empty, [1]: a payload was read
+    unsigned int count[2] = {0, 0};
+    uint64_t nanos[2] = {0, 0};
+#if defined(RF24_SPIDEV)
+    uint32_t calls[2] = {0, 0};
+#endif
+
+    for (unsigned int i = 0; i < cycles; ++i) {
+#if defined(RF24_SPIDEV)
+        uint32_t first_call = SPI::syscalls();
+#endif
+        uint64_t start = getNanos();
+        bool payload = radio.available();
+        if (payload) {
+            uint8_t len = radio.getDynamicPayloadSize();
+            if (len) {
+                radio.read(buffer, len);
+            }
+        }
+        nanos[payload] += getNanos() - start;
+#if defined(RF24_SPIDEV)
+        calls[payload] += SPI::syscalls() - first_call;
+#endif
+        count[payload]++;
+    }
+
+    radio.stopListening();
+    radio.powerDown();
+
+    cout << cycles << " polling cycles" << endl;
+    const char* names[2] = {"RX FIFO empty", "payload read"};
+    for (int c = 0; c < 2; ++c) {
+        cout << "  " << names[c] << ": " << count[c] << " cycles";
+        if (!count[c]) {
+            cout << (c ? " (no transmitter running?)" : "") << endl;
+            continue;
+        }
+        cout << ", " << (nanos[c] / 1000.0) / count[c] << " us per cycle";
+#if defined(RF24_SPIDEV)
+        cout << ", " << static_cast<double>(calls[c]) / count[c] << " SPI syscalls per cycle";
+#endif
+        cout << endl;
+    }
+#if !defined(RF24_SPIDEV)
+    cout << "  (SPI syscall counter is only available with the SPIDEV driver)" << endl;
+#endif
+    return 0;
+}
+
+uint64_t getNanos()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
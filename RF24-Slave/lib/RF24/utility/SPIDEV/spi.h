@@ -12,9 +12,13 @@
 
 #include <inttypes.h>
 #include <stdexcept>
+#include <linux/spi/spidev.h>
 
 #include "../../RF24_config.h" // This is cyclical and should be fixed
 
+/** Maximum number of transfers that can be queued into one SPI_IOC_MESSAGE(n) */
+#define RF24_SPIDEV_BATCH_MAX 4
+
 /** Specific excpetion for SPI errors */
 class SPIException : public std::runtime_error
 {
@@ -39,13 +43,35 @@ public:
 
     void transfern(char* buf, uint32_t len);
 
+    /**
+     * Queue one transfer to be submitted later by flush().
+     *
+     * Buffers are used in place (nothing is copied), so they must stay valid until flush() returns.
+     * @param tbuf Bytes to shift out, or NULL to shift out zeros
+     * @param rbuf Where to store the bytes shifted in, or NULL to discard them
+     * @param len Number of bytes
+     * @param cs_change Release CS after this transfer, ending one command frame.
+     * Pass false to continue the same frame with the next queued transfer.
+     */
+    void queue(const void* tbuf, void* rbuf, uint32_t len, bool cs_change = true);
+
+    /** Submit every queued transfer with a single SPI_IOC_MESSAGE(n) ioctl */
+    void flush();
+
+    /** Number of SPI message ioctls issued by all instances (for benchmarking) */
+    static uint32_t syscalls() { return _syscalls; }
+
     ~SPI();
 
 private:
     int fd;
     uint32_t _spi_speed;
     bool spiIsInitialized = false;
+    struct spi_ioc_transfer _batch[RF24_SPIDEV_BATCH_MAX];
+    uint8_t _batch_len = 0;
+    static uint32_t _syscalls;
     void init(uint32_t spi_speed = RF24_SPI_SPEED);
+    void submit(struct spi_ioc_transfer* tr, uint8_t count);
 };
 
 #endif // RF24_UTILITY_SPIDEV_SPI_H_
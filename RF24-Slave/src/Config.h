@@ -4,7 +4,11 @@
 #include <Arduino.h>
 
 // --- 1. 選擇設備 ID (數字 ID) ---
-#ifndef DEVICE_ID
+#if defined(NATIVE_SIM)
+    // 【新增】: 主機端模擬 (Simulator/) 以同一個執行檔執行 N 台從機，ID 在執行時指定
+    #include <sim_hw.h>
+    #define DEVICE_ID ((uint8_t)sim::deviceId())
+#elif !defined(DEVICE_ID)
     #define DEVICE_ID 1 // 預設為從機 1
 #endif
 
@@ -14,6 +18,7 @@
 #define PN532_MISO (25)
 #define PN532_MOSI (33)
 #define PN532_SS   (32)
+#define PN532_IRQ  (-1)   // 【新增】: PN532 的 IRQ 腳位 (-1 = 未接線，改以 SPI 狀態位元輪詢)
 
 // 【VSPI for NRF24L01】
 #define NRF_SCK  (18)
@@ -32,12 +37,15 @@
 // --- 3. NRF 通訊位址 ---
 const uint8_t command_pipe[6] = "CMD01";    // 主機 -> 從機 的通用指令頻道
 const uint8_t discovery_pipe[6] = "DISC1";  // 從機 -> 主機 的專用發現/加入頻道
+const uint8_t uplink_pipe[6] = "UPLNK";     // 從機 -> 主機 的共用上行頻道 (發送者 ID 在封包內)
 
 // --- 4. NFC 模擬器設定 ---
 const char* const NDEF_BASE_URL = "https://socialtag.io/user/";
 
 // UID 仍然根據 DEVICE_ID 不同，以便物理上區分
-#if DEVICE_ID == 1
+#if defined(NATIVE_SIM)
+    const uint8_t my_uid[3] = { DEVICE_ID, DEVICE_ID, DEVICE_ID };
+#elif DEVICE_ID == 1
     const uint8_t my_uid[3] = { 0x01, 0x01, 0x01 };
 #elif DEVICE_ID == 2
     const uint8_t my_uid[3] = { 0x02, 0x02, 0x02 };
@@ -46,10 +54,18 @@ const char* const NDEF_BASE_URL = "https://socialtag.io/user/";
 #elif DEVICE_ID == 4
     const uint8_t my_uid[3] = { 0x04, 0x04, 0x04 };
 #else // 其他 ID 的預設值
-    const uint8_t my_uid[3] = { 0xDE, 0xAD, 0xBE };
+    const uint8_t my_uid[3] = { DEVICE_ID, DEVICE_ID, DEVICE_ID }; // 【更新】: 被感應的從機改由 NDEF 中的 peer record 辨識
 #endif
 
 
+// 讀卡機偵測方式: false = InListPassiveTarget (PN532 內部連續輪詢，延遲最低)；
+// true = InAutoPoll (輪詢週期以 150 ms 為單位，較省電但延遲較高)
+const bool NFC_USE_AUTOPOLL = false;
+const uint8_t NFC_AUTOPOLL_PERIOD = 1;   // x 150 ms
+
+// 【新增】: 讀到 ISO14443-4 目標後讀取對方 peer record 的時限；逾時則只回報 UID
+const unsigned long NFC_PEER_TIMEOUT_MS = 300;
+
 // --- 5. 系統狀態與超時 ---
 /**
  * @brief 【已修改】: 新增 MODE_SPOTLIGHT 狀態
@@ -57,7 +73,6 @@ const char* const NDEF_BASE_URL = "https://socialtag.io/user/";
 enum SystemMode {
     MODE_JOINING,          // 加入模式 (開機後的初始狀態)
     MODE_CONFIRM_BLINKING, // 已加入確認模式 (閃爍紅燈的短暫狀態)
-    MODE_CHANNEL_TEST,
     MODE_IDLE,             // 閒置模式
     MODE_READER,           // 讀卡機模式
     MODE_EMULATOR,         // 模擬卡模式
@@ -65,7 +80,40 @@ enum SystemMode {
     MODE_SPOTLIGHT,         // 團隊抽籤中，被選中模式 (彩虹)
     MODE_SCORE_EMULATOR,   // 積分模式下的預設狀態 (模擬卡)
     MODE_SCORE_READER,     // 積分模式下，按下按鈕1後的狀態 (讀卡機)
-    MODE_COOLDOWN          // 積分模式下的冷卻狀態
+    MODE_COOLDOWN,         // 積分模式下的冷卻狀態
+    MODE_STOP_HOLD,        // 【新增】: 收到 STOP 後亮紅燈 5 秒再回到閒置
+    MODE_NAME_BLINK,       // 【新增】: 收到 BLINK_WHITE 後閃白燈 5 秒再回到閒置
+    MODE_COUNT             // 狀態數量 (狀態表大小)，不是實際狀態
 };
 
-const unsigned long TASK_TIMEOUT_MS = 20000;
\ No newline at end of file
+const unsigned long TASK_TIMEOUT_MS = 20000;
+
+// --- 6. 指令去重 ---
+// 超過此時間沒有收到主機封包時，序號紀錄視為失效 (例如主機重新開機後序號從 0 開始)
+const unsigned long SEQ_DEDUP_WINDOW_MS = 3000;
+const uint8_t SEQ_DEDUP_HISTORY = 8;             // 與最近幾個序號比對
+
+// --- 7. 上行 TDMA ---
+const unsigned long ACK_SPACING_US = 1000;    // 必須與主機相同
+const unsigned long SYNC_TIMEOUT_MS = 3000;   // 超過此時間沒收到信標則退回立即傳送
+const uint8_t UPLINK_QUEUE_LENGTH = 8;
+const unsigned long POLL_TIMEOUT_MS = 1000;   // 超過此時間沒被輪詢則退回自行傳送上行封包
+const unsigned long LINK_REPORT_INTERVAL_MS = 10000;  // 鏈路統計 (OP_LINK_STATS) 的回報間隔
+
+// --- 7b. 跳頻 ---
+// 不在會合頻道上且超過 LINK_LOST_MS 沒聽到主機 (主機每秒至少送一次同步信標) 時開始尋找主機：
+// 會合頻道 (主機每 2 秒回來送一次跳頻信標) 與 HOP_CHANNELS 中的其他頻道/速率輪流
+const unsigned long LINK_LOST_MS = 3000;
+const unsigned long RENDEZVOUS_DWELL_MS = 4500;   // 至少涵蓋兩次會合頻道信標
+const unsigned long SEARCH_DWELL_MS = 1200;       // 至少涵蓋一次同步信標
+
+// --- 8. 燈效 ---
+const unsigned long LED_TICK_MS = 10;             // main_logic_task 的迴圈週期 (燈效更新間隔)
+const unsigned long JOIN_REQUEST_INTERVAL_MS = 500;
+const unsigned long STOP_HOLD_MS = 5000;
+const unsigned long NAME_BLINK_MS = 5000;
+const unsigned long CONFIRM_BLINK_MS = 2000;
+
+// --- 9. 狀態機事件佇列 ---
+const uint8_t EVENT_QUEUE_LENGTH = 16;
+const unsigned long EVENT_POST_TIMEOUT_MS = 10;   // 佇列滿時 nrf_task 最多等待的時間
@@ -7,6 +7,15 @@ LedModule::LedModule(uint16_t num_pixels, int8_t pin) {
     _num_pixels = num_pixels;
     _leds = new CRGB[_num_pixels];
     _rainbow_hue = 0;
+    _effect = EFFECT_NONE;
+    _color = CRGB::Black;
+    _color2 = CRGB::Black;
+    _period_ms = 0;
+    _duration_ms = 0;
+    _start_time = 0;
+    _last_frame_time = 0;
+    _last_lit = 0;
+    _dirty = false;
     FastLED.addLeds<NEOPIXEL, LED_STRIP_PIN>(_leds, _num_pixels);
 }
 
@@ -15,59 +24,147 @@ void LedModule::begin() {
     turnOff();
 }
 
-void LedModule::showJoiningMode() {
-    fill_rainbow(_leds, _num_pixels, _rainbow_hue++, 7);
+// --- 燈效引擎 ---
+
+void LedModule::startEffect(LedEffect effect, const CRGB& color, const CRGB& color2,
+                            uint16_t period_ms, uint32_t duration_ms) {
+    if (_effect == effect && _color == color && _color2 == color2 &&
+        _period_ms == period_ms && _duration_ms == duration_ms) {
+        return; // 同一效果仍在執行中
+    }
+    _effect = effect;
+    _color = color;
+    _color2 = color2;
+    _period_ms = period_ms;
+    _duration_ms = duration_ms;
+    _start_time = millis();
+    _last_frame_time = 0;
+    _dirty = true;
+    tick(); // 立即顯示第一個畫面
+}
+
+void LedModule::setSolid(const CRGB& color, uint32_t duration_ms) {
+    startEffect(EFFECT_SOLID, color, CRGB::Black, 0, duration_ms);
+}
+
+void LedModule::startBlink(const CRGB& color, uint16_t half_period_ms, uint32_t duration_ms) {
+    startEffect(EFFECT_BLINK, color, CRGB::Black, half_period_ms, duration_ms);
+}
+
+void LedModule::startRainbow(uint32_t duration_ms) {
+    startEffect(EFFECT_RAINBOW, CRGB::Black, CRGB::Black, 20, duration_ms);
+}
+
+void LedModule::startFade(const CRGB& from, const CRGB& to, uint32_t duration_ms) {
+    startEffect(EFFECT_FADE, from, to, 20, duration_ms);
+}
+
+void LedModule::startCountdown(const CRGB& color, uint32_t duration_ms) {
+    startEffect(EFFECT_COUNTDOWN, color, CRGB::Black, 0, duration_ms);
+}
+
+bool LedModule::isEffectActive() const {
+    return _effect != EFFECT_NONE;
+}
+
+void LedModule::tick() {
+    if (_effect == EFFECT_NONE) return;
+
+    unsigned long now = millis();
+    uint32_t elapsed = now - _start_time;
+    if (_duration_ms > 0 && elapsed >= _duration_ms) {
+        // 有時限的效果結束後熄燈
+        _effect = EFFECT_NONE;
+        fill_solid(_leds, _num_pixels, CRGB::Black);
+        FastLED.show();
+        return;
+    }
+
+    // 動畫效果以 _period_ms 為最小更新間隔，避免不必要的 FastLED.show()
+    if (!_dirty && _period_ms > 0 && now - _last_frame_time < _period_ms) return;
+    render(elapsed);
+    _last_frame_time = now;
+}
+
+void LedModule::render(uint32_t elapsed) {
+    switch (_effect) {
+        case EFFECT_SOLID:
+            if (!_dirty) return; // 靜態畫面只需顯示一次
+            fill_solid(_leds, _num_pixels, _color);
+            break;
+        case EFFECT_BLINK: {
+            bool on = ((elapsed / _period_ms) % 2) == 0;
+            fill_solid(_leds, _num_pixels, on ? _color : CRGB::Black);
+            break;
+        }
+        case EFFECT_RAINBOW:
+            fill_rainbow(_leds, _num_pixels, _rainbow_hue++, 7);
+            break;
+        case EFFECT_FADE: {
+            uint8_t amount = (uint8_t)((uint64_t)elapsed * 255 / _duration_ms);
+            fill_solid(_leds, _num_pixels, blend(_color, _color2, amount));
+            break;
+        }
+        case EFFECT_COUNTDOWN: {
+            uint32_t remaining = _duration_ms - elapsed;
+            uint16_t lit = (uint16_t)(((uint64_t)remaining * _num_pixels + _duration_ms - 1) / _duration_ms);
+            if (!_dirty && lit == _last_lit) return;
+            _last_lit = lit;
+            for (uint16_t i = 0; i < _num_pixels; i++) {
+                _leds[i] = (i < lit) ? _color : CRGB::Black;
+            }
+            break;
+        }
+        case EFFECT_NONE:
+            return;
+    }
+    _dirty = false;
     FastLED.show();
 }
 
+// --- 各模式的燈號 ---
+
+void LedModule::showJoiningMode() {
+    startRainbow();
+}
+
 void LedModule::showSolidRed() {
-    fill_solid(_leds, _num_pixels, CRGB::Red);
-    FastLED.show();
+    setSolid(CRGB::Red);
 }
 
 void LedModule::showReaderMode() {
-    fill_solid(_leds, _num_pixels, CRGB::Red); 
-    FastLED.show();
+    setSolid(CRGB::Red);
 }
 
 void LedModule::showEmulatorMode() {
-    fill_solid(_leds, _num_pixels, CRGB::Green);
-    FastLED.show();
+    setSolid(CRGB::Green);
 }
 
 void LedModule::showWaitingMode() {
-    fill_solid(_leds, _num_pixels, CRGB::Yellow);
-    FastLED.show();
+    setSolid(CRGB::Yellow);
 }
 
 /**
  * @brief 【新增】: 顯示彩虹抽籤燈 (效果同 Joining)
  */
 void LedModule::showSpotlightMode() {
-    fill_rainbow(_leds, _num_pixels, _rainbow_hue++, 7);
-    FastLED.show();
+    startRainbow();
 }
 
+/**
+ * @brief 【修改】: 不再阻塞；閃爍結束後 isEffectActive() 變為 false
+ */
 void LedModule::blinkWhiteForSeconds(uint16_t seconds) {
-    unsigned long end_time = millis() + (unsigned long)seconds * 1000UL;
-    bool on = false;
-    while (millis() < end_time) {
-        if (on) {
-            fill_solid(_leds, _num_pixels, CRGB::White);
-        } else {
-            fill_solid(_leds, _num_pixels, CRGB::Black);
-        }
-        FastLED.show();
-        on = !on;
-        delay(250);
-    }
-    turnOff();
+    startBlink(CRGB::White, 250, (uint32_t)seconds * 1000UL);
 }
 
 
 void LedModule::turnOff() {
+    _effect = EFFECT_NONE;
+    _color = CRGB::Black;
+    _duration_ms = 0;
     fill_solid(_leds, _num_pixels, CRGB::Black);
     FastLED.show();
     pinMode(LED_STRIP_PIN, OUTPUT);
     digitalWrite(LED_STRIP_PIN, LOW);
-}
\ No newline at end of file
+}
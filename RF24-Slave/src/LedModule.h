@@ -3,10 +3,35 @@
 #pragma once
 #include <FastLED.h>
 
+/**
+ * @brief 【新增】: 以時間為基礎的燈效。效果只記錄起始時間與參數，
+ * 由 tick() 依 millis() 計算目前畫面，從不 delay。
+ */
+enum LedEffect {
+    EFFECT_NONE,
+    EFFECT_SOLID,
+    EFFECT_BLINK,
+    EFFECT_RAINBOW,
+    EFFECT_FADE,
+    EFFECT_COUNTDOWN   // 燈條隨剩餘時間逐顆熄滅
+};
+
 class LedModule {
 public:
     LedModule(uint16_t num_pixels, int8_t pin);
     void begin();
+
+    // --- 燈效引擎 (duration_ms = 0 表示持續到下一個效果) ---
+    // 參數與目前效果相同時不會重新開始，因此可以在每個迴圈重複呼叫
+    void setSolid(const CRGB& color, uint32_t duration_ms = 0);
+    void startBlink(const CRGB& color, uint16_t half_period_ms, uint32_t duration_ms = 0);
+    void startRainbow(uint32_t duration_ms = 0);
+    void startFade(const CRGB& from, const CRGB& to, uint32_t duration_ms);
+    void startCountdown(const CRGB& color, uint32_t duration_ms);
+    void tick();                  // 推進目前效果，只在畫面改變時呼叫 FastLED.show()
+    bool isEffectActive() const;  // 有時限的效果結束後回傳 false
+
+    // --- 各模式的燈號 (皆為非阻塞) ---
     void showJoiningMode();
     void showSolidRed();
     void showReaderMode();
@@ -17,7 +42,21 @@ public:
     void turnOff();
 
 private:
+    void startEffect(LedEffect effect, const CRGB& color, const CRGB& color2,
+                     uint16_t period_ms, uint32_t duration_ms);
+    void render(uint32_t elapsed);
+
     uint16_t _num_pixels;
     CRGB* _leds;
     uint8_t _rainbow_hue;
-};
\ No newline at end of file
+
+    LedEffect _effect;
+    CRGB _color;
+    CRGB _color2;
+    uint16_t _period_ms;
+    uint32_t _duration_ms;
+    unsigned long _start_time;
+    unsigned long _last_frame_time;
+    uint16_t _last_lit;            // 倒數效果目前亮著的顆數
+    bool _dirty;
+};
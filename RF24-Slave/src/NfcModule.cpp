@@ -1,8 +1,8 @@
 #include "NfcModule.h"
 #include "Config.h"
-#include "NdefMessage.h"
+#include "NdefView.h"
 
-// begin() 函式保持不變
+// 【更新】: begin() 另外設定無限重試，並在 IRQ 有接線時掛上中斷
 bool NfcModule::begin(SPIClass& spi, uint8_t ss) {
     PN532_SPI* pn532_spi_interface = new PN532_SPI(spi, ss);
     _nfc = new PN532(*pn532_spi_interface);
@@ -11,57 +11,288 @@ bool NfcModule::begin(SPIClass& spi, uint8_t ss) {
     _nfcAdapter->begin();
     uint32_t versiondata = _nfc->getFirmwareVersion();
     if (!versiondata) return false;
+    // 被動偵測無限重試：PN532 會自行輪詢直到卡片進入感應區
+    _nfc->setPassiveActivationRetries(0xFF);
+    if (PN532_IRQ >= 0) {
+        pinMode(PN532_IRQ, INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(PN532_IRQ), onIrq, FALLING);
+    }
     return true;
 }
 
+volatile uint32_t NfcModule::_irq_time_us = 0;
+
+void IRAM_ATTR NfcModule::onIrq() {
+    if (_irq_time_us == 0) _irq_time_us = micros();
+}
+
 /**
- * @brief 【最終策略更新】: 恢復為一個簡單且極度可靠的 UID 讀取器。
- * 此函式現在只會讀取標籤的 UID 並回報。所有複雜的 NDEF 解析都已移除。
+ * @brief 【更新】: 送出偵測指令後立即返回，PN532 在內部連續輪詢。
+ * 不再每 50 ms 重送 InListPassiveTarget，也不會在輪詢間隙錯過短暫的感應。
  */
-bool NfcModule::runReaderTask(String& result) {
-    uint8_t uid[7] = {0};
-    uint8_t uidLength;
-
-    // 1. 偵測標籤並讀取其 UID
-    if (_nfc->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 50)) {
-        
-        // 2. 將 UID 格式化為一個標準的字串 (例如 "UID:08020202")
-        String uid_str = "UID:";
-        for (uint8_t i = 0; i < uidLength; i++) {
-            if(uid[i] < 0x10) uid_str += '0'; // 如果需要，補上前面的 0
-            uid_str += String(uid[i], HEX);
-        }
-        uid_str.toUpperCase(); // 確保十六進位字母為大寫，方便主機解析
-        result = uid_str;
+bool NfcModule::startReader() {
+    if (_reader_armed) return true;
+    if (!releaseDone()) return false; // pollReader() 稍後再試
+    _irq_time_us = 0;
+    bool ok = NFC_USE_AUTOPOLL
+        ? _nfc->startAutoPoll(0xFF, NFC_AUTOPOLL_PERIOD, PN532_AUTOPOLL_MIFARE_106)
+        : _nfc->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+    if (!ok) {
+        Serial.println("[NFC] WARN: failed to start target detection");
+        return false;
+    }
+    _reader_armed = true;
+    _armed_time_us = micros();
+    return true;
+}
+
+/**
+ * @brief IRQ 有接線時先讀 GPIO，拉低才讀 SPI 狀態位元
+ */
+bool NfcModule::responseReady() {
+    // 【更新】: 指令不再阻塞等待 ACK，IRQ 第一次拉低的是 ACK，交給 isResponseReady() 讀掉
+    if (PN532_IRQ >= 0 && digitalRead(PN532_IRQ) != LOW) return false;
+    if (_nfc->isResponseReady()) return true;
+    if (PN532_IRQ >= 0) _irq_time_us = 0; // 剛才的下降沿屬於 ACK，改記錄回應的下降沿
+    return false;
+}
+
+/**
+ * @brief 不阻塞地檢查偵測結果，以二進位回報 UID，字串格式化由主機負責。
+ * 【更新】: SEL_RES 表示 ISO14443-4 時 (可能是模擬中的從機) 先讀取對方的 peer record 再回報
+ */
+bool NfcModule::pollReader(NfcReadResult& result) {
+    if (_peer_step != PEER_NONE) return pollPeer(result);
+    if (!_reader_armed && !startReader()) return false;
+    if (!responseReady()) return false;
+
+    // IRQ 有接線時以中斷時間為準，否則以發現就緒的時間為準
+    result.capture_us = (PN532_IRQ >= 0 && _irq_time_us != 0) ? _irq_time_us : micros();
+    result.is_peer = false;
+    _reader_armed = false;
+    _irq_time_us = 0;
+    uint8_t sel_res = 0;
+    if (!_nfc->readDetectedPassiveTargetID(result.uid, &result.uid_length, &sel_res)) {
+        return false; // 無效回應：下一次 pollReader() 會重新開始偵測
+    }
+    Serial.printf("[NFC] Tag detected %lu ms after arming\n", (unsigned long)((result.capture_us - _armed_time_us) / 1000));
+    if ((sel_res & 0x20) && startPeerStep(PEER_SELECT_APP)) {
+        _peer_read = result;
+        _peer_start_ms = millis();
+        return false;
+    }
+    return true;
+}
+
+// NFC Forum Type 4 Tag 的 C-APDU (與 EmulateTag 的回應對應)
+static const uint8_t APDU_SELECT_NDEF_APP[] = { 0x00, 0xA4, 0x04, 0x00, 0x07, 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01, 0x00 };
+static const uint8_t APDU_SELECT_NDEF_FILE[] = { 0x00, 0xA4, 0x00, 0x0C, 0x02, 0xE1, 0x04 };
+// 不先讀 CC：從 offset 0 一次讀完 NLEN 與整個訊息 (模擬卡的 NDEF 檔最多 NDEF_MAX_LENGTH bytes)
+static const uint8_t APDU_READ_NDEF_FILE[] = { 0x00, 0xB0, 0x00, 0x00, NDEF_MAX_LENGTH - 2 };
+
+bool NfcModule::startPeerStep(PeerStep step) {
+    bool ok = false;
+    switch (step) {
+        case PEER_SELECT_APP:  ok = _nfc->startDataExchange(APDU_SELECT_NDEF_APP, sizeof(APDU_SELECT_NDEF_APP)); break;
+        case PEER_SELECT_FILE: ok = _nfc->startDataExchange(APDU_SELECT_NDEF_FILE, sizeof(APDU_SELECT_NDEF_FILE)); break;
+        case PEER_READ:        ok = _nfc->startDataExchange(APDU_READ_NDEF_FILE, sizeof(APDU_READ_NDEF_FILE)); break;
+        default: break;
+    }
+    _peer_step = ok ? step : PEER_NONE;
+    return ok;
+}
+
+/**
+ * @brief 每次最多處理一個 R-APDU。交換結束 (成功、失敗或逾時) 時回傳 true，
+ * 不是本局從機的目標仍以 UID 回報，由主機決定如何處理
+ * 【更新】: 交換結束後先分段送出 InRelease (PEER_RELEASE)，release 完成或逾時才回報結果
+ */
+bool NfcModule::pollPeer(NfcReadResult& result) {
+    if (_peer_step == PEER_RELEASE) {
+        if (!releaseDone()) return false;
+        _peer_step = PEER_NONE;
+        result = _peer_read;
         return true;
     }
-    
+
+    bool timed_out = millis() - _peer_start_ms >= NFC_PEER_TIMEOUT_MS;
+    if (!timed_out && !responseReady()) return false;
+
+    bool ok = false;
+    if (timed_out) {
+        _nfc->abortCommand();
+    } else {
+        uint8_t response[NDEF_MAX_LENGTH + 2];   // 資料 + SW1 SW2
+        uint8_t length = sizeof(response);
+        ok = _nfc->readDataExchange(response, &length) && length >= 2 &&
+             response[length - 2] == 0x90 && response[length - 1] == 0x00;
+        if (ok && _peer_step != PEER_READ) {
+            if (startPeerStep((PeerStep)(_peer_step + 1))) return false;
+            ok = false;
+        }
+        if (ok) ok = parsePeerFile(response, length - 2, _peer_read.peer);
+    }
+    finishPeerRead(ok, timed_out);
+    _peer_step = PEER_RELEASE;
+    startRelease(); // 讓對方的模擬卡結束這次 session
+    return false;
+}
+
+/**
+ * @brief 【新增】: 交換結束時決定要回報 peer record 還是 UID (結果暫存在 _peer_read)
+ */
+void NfcModule::finishPeerRead(bool ok, bool timed_out) {
+    unsigned long elapsed_ms = millis() - _peer_start_ms;
+    if (!ok) {
+        Serial.printf("[NFC] No peer record (%s after %lu ms), reporting UID\n", timed_out ? "timeout" : "failed", elapsed_ms);
+        return;
+    }
+    if (_session_token != 0 && _peer_read.peer.session_token != _session_token) {
+        Serial.printf("[NFC] Peer #%u is from another session (%04X), reporting UID\n",
+                      _peer_read.peer.device_id, _peer_read.peer.session_token);
+        return;
+    }
+    _peer_read.is_peer = true;
+    _score++;
+    _ndef_dirty = true;
+    Serial.printf("[NFC] Peer #%u read in %lu ms (session %04X, score %u)\n",
+                  _peer_read.peer.device_id, elapsed_ms, _peer_read.peer.session_token, _peer_read.peer.score);
+}
+
+/**
+ * @brief NDEF 檔 = [NLEN (big endian, 2 bytes)][NDEF 訊息]，在訊息中找 peer record
+ */
+bool NfcModule::parsePeerFile(const uint8_t* file, uint8_t length, PeerInfo& peer) {
+    if (length < 2) return false;
+    uint16_t message_length = (file[0] << 8) | file[1];
+    if (message_length > length - 2) return false;
+
+    NdefReader reader(file + 2, message_length);
+    NdefRecordView record;
+    const size_t type_length = strlen(PEER_RECORD_TYPE);
+    while (reader.next(record)) {
+        if (record.tnf == TNF_EXTERNAL_TYPE && record.typeLength == type_length &&
+            memcmp(record.type, PEER_RECORD_TYPE, type_length) == 0) {
+            return decodePeerRecord(record.payload, record.payloadLength, peer);
+        }
+    }
     return false;
 }
 
-// initEmulator() 函式保持不變。它仍然會模擬 NDEF，但這不影響讀卡機只讀取 UID
+void NfcModule::stopReader() {
+    if (_peer_step != PEER_NONE) {
+        if (_peer_step != PEER_RELEASE) {
+            _nfc->abortCommand();
+            startRelease();
+        }
+        _peer_step = PEER_NONE; // release 進行中時由 releaseDone() 收尾
+    }
+    if (!_reader_armed) return;
+    _nfc->abortCommand();
+    _reader_armed = false;
+}
+
+/**
+ * @brief 【更新】: 只在第一次或內容改變時重建 NDEF 檔；PN532 的初始化也只做一次。
+ * 之後每次進入模擬模式只剩下 TgInitAsTarget，讀卡/模擬之間的切換只需幾 ms
+ */
 void NfcModule::initEmulator(uint8_t deviceId) {
-    NdefMessage message = NdefMessage();
-    String full_url = String(NDEF_BASE_URL) + String(deviceId);
-    Serial.printf("[NFC EMU] Emulating NDEF URL: %s\n", full_url.c_str());
-    message.addUriRecord(full_url);
-    int messageSize = message.getEncodedSize();
-    if (messageSize > 120) {
+    if (_ndef_dirty || deviceId != _ndef_device_id) {
+        if (!rebuildNdef(deviceId)) return;
+    }
+    if (!_emulator_ready) {
+        _emulator->setUid((uint8_t*)my_uid);
+        // NDEF 檔跨 session 重複使用，不允許手機寫入改掉快取內容
+        _emulator->setTagWriteable(false);
+        _emulator_ready = _emulator->init();
+    }
+}
+
+void NfcModule::setEmulatorName(const char* name) {
+    if (strncmp(name, _ndef_name, sizeof(_ndef_name)) == 0) return;
+    strncpy(_ndef_name, name, sizeof(_ndef_name) - 1);
+    _ndef_name[sizeof(_ndef_name) - 1] = '\0';
+    _ndef_dirty = true;
+}
+
+void NfcModule::setSession(uint16_t session_token) {
+    if (session_token == _session_token) return;
+    _session_token = session_token;
+    _score = 0;
+    _ndef_dirty = true;
+}
+
+bool NfcModule::rebuildNdef(uint8_t deviceId) {
+    char full_url[64];
+    snprintf(full_url, sizeof(full_url), "%s%u", NDEF_BASE_URL, deviceId);
+    Serial.printf("[NFC EMU] Building NDEF URL: %s\n", full_url);
+
+    // 【更新】: 直接編碼進堆疊上的緩衝區，不再經過 NdefMessage/NdefRecord 的 malloc 複製
+    uint8_t ndefBuf[NDEF_MAX_LENGTH - 2];
+    NdefWriter writer(ndefBuf, sizeof(ndefBuf));
+    writer.addUriRecord(full_url);
+    if (_ndef_name[0] != '\0') {
+        writer.addTextRecord(_ndef_name);
+    }
+    // 【新增】: 最後附上給其他從機讀取的 peer record (手機仍以第一筆 URL 為準)
+    PeerInfo self = { deviceId, _session_token, _score };
+    uint8_t peer_record[PEER_RECORD_SIZE];
+    encodePeerRecord(self, peer_record);
+    writer.addRecord(TNF_EXTERNAL_TYPE, (const uint8_t*)PEER_RECORD_TYPE, strlen(PEER_RECORD_TYPE),
+                     peer_record, sizeof(peer_record));
+    if (writer.overflow()) {
         Serial.println("[NFC EMU] Error: NDEF message too large!");
-        return;
+        return false;
     }
-    uint8_t ndefBuf[messageSize];
-    message.encode(ndefBuf);
-    _emulator->setNdefFile(ndefBuf, messageSize);
-    _emulator->setUid((uint8_t*)my_uid);
-    _emulator->init();
+    _emulator->setNdefFile(ndefBuf, writer.size());
+    _ndef_device_id = deviceId;
+    _ndef_dirty = false;
+    return true;
 }
 
-// emulateOneTick() 和 releaseEmulator() 函式保持不變
+/**
+ * @brief 【更新】: 不再呼叫阻塞的 emulate(50)。每個 tick 最多推進一個 PN532 指令
+ * (TgInitAsTarget → TgGetData ⇄ TgSetData → InRelease)，等待讀卡機時不佔用 main loop，
+ * LED 與無線電的處理不會被卡住。讀卡機離開後下一個 tick 重新等待。
+ */
 void NfcModule::emulateOneTick() {
-    _emulator->emulate(50);
+    if (!releaseDone()) return;
+    emulationState state = _emulator->getEmulationState();
+    if (state == EMULATION_IDLE || state == EMULATION_FINISHED) {
+        _emulator->startEmulation();
+    } else {
+        _emulator->pollEmulation();
+    }
 }
 
 void NfcModule::releaseEmulator() {
-    _nfc->inRelease();
-}
\ No newline at end of file
+    _emulator->stopEmulation();
+    startRelease();
+}
+
+/**
+ * @brief 【新增】: 送出 InRelease 後立即返回，回應由之後的 releaseDone() 取回，
+ * 切換模式時不必阻塞等待 PN532
+ */
+void NfcModule::startRelease() {
+    _release_pending = _nfc->startInRelease();
+    _release_start_ms = millis();
+}
+
+/**
+ * @brief 沒有進行中的 InRelease 時回傳 true。回應就緒時讀掉；
+ * 超過 NFC_PEER_TIMEOUT_MS 仍未就緒則放棄，不讓 PN532 卡住之後的指令
+ */
+bool NfcModule::releaseDone() {
+    if (!_release_pending) return true;
+    if (responseReady()) {
+        uint8_t response[4];
+        _nfc->readCommandResponse(response, sizeof(response));
+    } else if (millis() - _release_start_ms < NFC_PEER_TIMEOUT_MS) {
+        return false;
+    } else {
+        _nfc->abortCommand();
+    }
+    _release_pending = false;
+    return true;
+}
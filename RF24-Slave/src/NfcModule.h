@@ -4,18 +4,74 @@
 #include <PN532.h>
 #include <emulatetag.h>
 #include <NfcAdapter.h> // 【新增】: 引入 NfcAdapter 標頭檔
+#include "Protocol.h"
+
+// 【新增】: 讀卡結果。對方是本局中模擬卡的從機時 is_peer 為 true，peer 為它的 peer record
+struct NfcReadResult {
+    uint8_t uid[7];
+    uint8_t uid_length;
+    uint32_t capture_us;   // 偵測到卡片的時間 (micros)
+    bool is_peer;
+    PeerInfo peer;
+};
 
 class NfcModule {
 public:
     bool begin(SPIClass& spi, uint8_t ss); 
-    bool runReaderTask(String& result);
+
+    // 【修改】: 分段式讀卡。startReader() 只送出偵測指令，PN532 自行持續輪詢；
+    // pollReader() 不阻塞，偵測到卡片時回傳 true 並附上偵測時間。
+    // 【更新】: ISO14443-4 目標會先以 APDU 讀取對方的 NDEF 檔 (同樣分段進行) 才回傳
+    bool startReader();
+    bool pollReader(NfcReadResult& result);
+    void stopReader();
     
     void emulateOneTick(); 
     void initEmulator(uint8_t deviceId);
     void releaseEmulator();
 
+    // 【新增】: 登記名稱會以 Text record 附在 URL 之後；名稱改變時下次進入模擬模式才重建 NDEF
+    void setEmulatorName(const char* name);
+
+    // 【新增】: 本局的 session (主機隨 READ / EMULATE 送出)。改變時分數歸零；
+    // 模擬卡的 peer record 在下次進入模擬模式時更新
+    void setSession(uint16_t session_token);
+    uint16_t score() const { return _score; }
+
 private:
+    static void IRAM_ATTR onIrq();
+    static volatile uint32_t _irq_time_us;   // IRQ 下降沿的時間 (0 = 尚未觸發)
+
     PN532* _nfc;
+    bool _reader_armed = false;
+    uint32_t _armed_time_us = 0;
+    bool responseReady();
+
+    // 【新增】: 分段式 InRelease。進行中時其他 PN532 指令等它完成 (或逾時) 才開始
+    void startRelease();
+    bool releaseDone();
+    bool _release_pending = false;
+    unsigned long _release_start_ms = 0;
+
+    // 【新增】: 讀取對方 peer record 的 APDU 步驟 (SELECT 應用程式 -> SELECT NDEF 檔 -> READ BINARY)
+    // 【更新】: 最後一步 PEER_RELEASE 是分段式的 InRelease，完成後才回報結果
+    enum PeerStep : uint8_t { PEER_NONE, PEER_SELECT_APP, PEER_SELECT_FILE, PEER_READ, PEER_RELEASE };
+    bool startPeerStep(PeerStep step);
+    bool pollPeer(NfcReadResult& result);
+    void finishPeerRead(bool ok, bool timed_out);
+    bool parsePeerFile(const uint8_t* file, uint8_t length, PeerInfo& peer);
+    PeerStep _peer_step = PEER_NONE;
+    unsigned long _peer_start_ms = 0;
+    NfcReadResult _peer_read;          // 交換中的讀卡結果
+    uint16_t _session_token = 0;
+    uint16_t _score = 0;
     EmulateTag* _emulator;
+
+    // 【新增】: 已編碼的 NDEF 檔快取 (只有 URL 或名稱改變時才重建)
+    bool rebuildNdef(uint8_t deviceId);
+    uint8_t _ndef_device_id = 0;       // 0 = 尚未建立
+    char _ndef_name[PROTOCOL_MAX_PAYLOAD + 1] = "";
+    bool _ndef_dirty = true;
+    bool _emulator_ready = false;      // EmulateTag::init() 只需執行一次
     NfcAdapter* _nfcAdapter; // 【新增】: 用於高階 NDEF 讀取的物件
 };
\ No newline at end of file
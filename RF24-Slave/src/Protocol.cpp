@@ -0,0 +1,384 @@
+// Protocol.cpp (Shared by Master & Slave - keep both copies identical)
+
+#include "Protocol.h"
+#include <string.h>
+
+bool protocolIsKnownOpcode(uint8_t opcode) {
+    return (opcode >= OP_JOIN_ACK && opcode <= OP_HOP) ||
+           (opcode >= OP_JOIN_REQUEST && opcode <= OP_ENCOUNTER);
+}
+
+const char* protocolOpcodeName(uint8_t opcode) {
+    switch (opcode) {
+        case OP_JOIN_ACK:       return "JOIN_ACK";
+        case OP_STOP:           return "STOP";
+        case OP_REMOVE_JOIN:    return "REMOVEJOIN";
+        case OP_BLINK_WHITE:    return "BLINK_WHITE";
+        case OP_NAME:           return "NAME";
+        case OP_TEST_PIPE:      return "TESTPIPE";
+        case OP_READ:           return "READ";
+        case OP_EMULATE:        return "EMULATE";
+        case OP_TEAM_WAIT:      return "SETCOLOR_YELLOW";
+        case OP_SPOTLIGHT:      return "SETCOLOR_RAINBOW";
+        case OP_SCORE_START:    return "SCORE_MODE_START";
+        case OP_SCORE_STOP:     return "SCORE_MODE_STOP";
+        case OP_COOLDOWN_START: return "COOLDOWN_START";
+        case OP_COOLDOWN_END:   return "COOLDOWN_END";
+        case OP_SYNC:           return "SYNC";
+        case OP_POLL:           return "POLL";
+        case OP_HOP:            return "HOP";
+        case OP_JOIN_REQUEST:   return "JOIN";
+        case OP_HEARTBEAT:      return "HEARTBEAT";
+        case OP_CHANNEL_TEST:   return "CHANNEL_TEST";
+        case OP_READ_RESULT:    return "READ_RESULT";
+        case OP_READ_TIMEOUT:   return "READ_TIMEOUT";
+        case OP_EMULATOR_ACK:   return "EMULATOR_ACK";
+        case OP_CMD_ACK:        return "CMD_ACK";
+        case OP_LINK_STATS:     return "LINK_STATS";
+        case OP_ENCOUNTER:      return "ENCOUNTER";
+        default:                return "UNKNOWN";
+    }
+}
+
+// --- TargetMask ---
+
+TargetMask::TargetMask() {
+    clear();
+}
+
+TargetMask TargetMask::all() {
+    TargetMask mask;
+    mask.setAll();
+    return mask;
+}
+
+TargetMask TargetMask::single(uint8_t id) {
+    TargetMask mask;
+    mask.add(id);
+    return mask;
+}
+
+void TargetMask::clear() {
+    memset(_bits, 0, sizeof(_bits));
+    _all = false;
+}
+
+void TargetMask::setAll() {
+    memset(_bits, 0, sizeof(_bits));
+    _all = true;
+}
+
+void TargetMask::add(uint8_t id) {
+    _bits[id >> 3] |= (uint8_t)(1 << (id & 7));
+}
+
+void TargetMask::remove(uint8_t id) {
+    _bits[id >> 3] &= (uint8_t)~(1 << (id & 7));
+}
+
+bool TargetMask::contains(uint8_t id) const {
+    return _all || (_bits[id >> 3] & (1 << (id & 7)));
+}
+
+uint16_t TargetMask::rankOf(uint8_t id) const {
+    if (_all) return id;
+    uint16_t rank = 0;
+    for (uint16_t i = 0; i < id; ++i) {
+        if (_bits[i >> 3] & (1 << (i & 7))) ++rank;
+    }
+    return rank;
+}
+
+bool TargetMask::isEmpty() const {
+    if (_all) return false;
+    for (uint8_t i = 0; i < sizeof(_bits); ++i) {
+        if (_bits[i]) return false;
+    }
+    return true;
+}
+
+uint16_t TargetMask::count() const {
+    if (_all) return 256;
+    uint16_t n = 0;
+    for (uint8_t i = 0; i < sizeof(_bits); ++i) {
+        uint8_t b = _bits[i];
+        while (b) { b &= (uint8_t)(b - 1); ++n; }
+    }
+    return n;
+}
+
+// --- Packet ---
+
+Packet::Packet(uint8_t op, const TargetMask& to)
+    : opcode(op), seq(0), source(PROTOCOL_MASTER_ID), ack_requested(false), targets(to), payload_len(0) {}
+
+bool Packet::setPayload(const void* data, uint8_t len) {
+    if (len > PROTOCOL_MAX_PAYLOAD) return false;
+    if (len > 0) memcpy(payload, data, len);
+    payload_len = len;
+    return true;
+}
+
+void Packet::setText(const char* text) {
+    size_t len = strlen(text);
+    if (len > PROTOCOL_MAX_PAYLOAD) len = PROTOCOL_MAX_PAYLOAD;
+    setPayload(text, (uint8_t)len);
+}
+
+void Packet::getText(char* out, size_t out_size) const {
+    if (out_size == 0) return;
+    size_t len = payload_len < out_size - 1 ? payload_len : out_size - 1;
+    memcpy(out, payload, len);
+    out[len] = '\0';
+}
+
+// --- Encode / Decode ---
+
+uint8_t encodePacket(const Packet& packet, uint8_t* buf, uint8_t cap) {
+    if (cap < PROTOCOL_HEADER_SIZE || packet.payload_len > PROTOCOL_MAX_PAYLOAD) return 0;
+
+    const TargetMask& t = packet.targets;
+    uint8_t kind = TARGET_ALL;
+    uint8_t first = 0, last = 0;
+    if (!t.isAll()) {
+        // 只送出包含目標 ID 的最小遮罩範圍
+        bool found = false;
+        for (uint8_t i = 0; i < sizeof(t._bits); ++i) {
+            if (t._bits[i]) {
+                if (!found) first = i;
+                last = i;
+                found = true;
+            }
+        }
+        if (!found) return 0; // 沒有任何目標
+        kind = (t.count() == 1) ? TARGET_ONE : TARGET_MASK;
+    }
+
+    uint8_t target_size = 0;
+    if (kind == TARGET_ONE) target_size = 1;
+    else if (kind == TARGET_MASK) target_size = (uint8_t)(2 + last - first + 1);
+
+    uint8_t total = PROTOCOL_HEADER_SIZE + target_size + packet.payload_len;
+    if (total > cap || total > PROTOCOL_MAX_FRAME) return 0;
+
+    buf[0] = packet.opcode;
+    buf[1] = packet.seq;
+    buf[2] = packet.source;
+    buf[3] = (uint8_t)((kind << 6) | (packet.ack_requested ? PROTOCOL_FLAG_ACK : 0) |
+                       (packet.payload_len & PROTOCOL_LEN_MASK));
+    uint8_t pos = PROTOCOL_HEADER_SIZE;
+    if (kind == TARGET_ONE) {
+        uint8_t b = t._bits[first];
+        uint8_t bit = 0;
+        while (!(b & (1 << bit))) ++bit;
+        buf[pos++] = (uint8_t)((first << 3) | bit);
+    } else if (kind == TARGET_MASK) {
+        buf[pos++] = first;
+        buf[pos++] = (uint8_t)(last - first + 1);
+        memcpy(buf + pos, t._bits + first, last - first + 1);
+        pos += last - first + 1;
+    }
+    if (packet.payload_len > 0) {
+        memcpy(buf + pos, packet.payload, packet.payload_len);
+        pos += packet.payload_len;
+    }
+    return pos;
+}
+
+bool decodePacket(const uint8_t* buf, uint8_t len, Packet& packet) {
+    if (len < PROTOCOL_HEADER_SIZE || len > PROTOCOL_MAX_FRAME) return false;
+    if (!protocolIsKnownOpcode(buf[0])) return false;
+
+    packet.opcode = buf[0];
+    packet.seq = buf[1];
+    packet.source = buf[2];
+    uint8_t kind = buf[3] >> 6;
+    packet.ack_requested = (buf[3] & PROTOCOL_FLAG_ACK) != 0;
+    uint8_t payload_len = buf[3] & PROTOCOL_LEN_MASK;
+    uint8_t pos = PROTOCOL_HEADER_SIZE;
+
+    packet.targets.clear();
+    switch (kind) {
+        case TARGET_ALL:
+            packet.targets.setAll();
+            break;
+        case TARGET_ONE:
+            if (pos + 1 > len) return false;
+            packet.targets.add(buf[pos++]);
+            break;
+        case TARGET_MASK: {
+            if (pos + 2 > len) return false;
+            uint8_t first = buf[pos++];
+            uint8_t n = buf[pos++];
+            if (n == 0 || first + n > (int)sizeof(packet.targets._bits) || pos + n > len) return false;
+            memcpy(packet.targets._bits + first, buf + pos, n);
+            pos += n;
+            break;
+        }
+        default:
+            return false;
+    }
+
+    // 固定長度 payload 時，尾端多出的 0 會被忽略
+    if (payload_len > PROTOCOL_MAX_PAYLOAD || pos + payload_len > len) return false;
+    packet.payload_len = payload_len;
+    if (payload_len > 0) memcpy(packet.payload, buf + pos, payload_len);
+    return true;
+}
+
+// --- 讀卡結果 ---
+
+// 【更新】: 感應 -> 上行延遲以 TAP_LATENCY_UNIT_US 為單位 (四捨五入)，超過上限時固定為 0xFFFF
+static uint16_t encodeTapLatency(uint32_t tap_to_uplink_us) {
+    uint32_t units = (tap_to_uplink_us + TAP_LATENCY_UNIT_US / 2) / TAP_LATENCY_UNIT_US;
+    return units > 0xFFFF ? 0xFFFF : (uint16_t)units;
+}
+
+static uint32_t decodeTapLatency(uint16_t units) {
+    return (uint32_t)units * TAP_LATENCY_UNIT_US;
+}
+
+bool encodeReadResult(Packet& packet, const uint8_t* uid, uint8_t uid_len, uint32_t tap_to_uplink_us) {
+    if (uid_len > READ_RESULT_MAX_UID) return false;
+    uint16_t latency = encodeTapLatency(tap_to_uplink_us);
+    uint8_t data[1 + READ_RESULT_MAX_UID + 2];
+    data[0] = uid_len;
+    memcpy(data + 1, uid, uid_len);
+    data[1 + uid_len] = latency & 0xFF;
+    data[2 + uid_len] = latency >> 8;
+    return packet.setPayload(data, uid_len + 3);
+}
+
+bool decodeReadResult(const Packet& packet, uint8_t* uid, uint8_t& uid_len, uint32_t& tap_to_uplink_us) {
+    if (packet.payload_len < 3) return false;
+    uint8_t len = packet.payload[0];
+    if (len > READ_RESULT_MAX_UID || packet.payload_len != len + 3) return false;
+    uid_len = len;
+    memcpy(uid, packet.payload + 1, len);
+    tap_to_uplink_us = decodeTapLatency(packet.payload[1 + len] | (packet.payload[2 + len] << 8));
+    return true;
+}
+
+// --- 輪詢位址 ---
+
+void protocolPollAddress(uint8_t id, const uint8_t* command_address, uint8_t* out) {
+    memcpy(out, command_address, 5);
+    out[0] = 0x80 | id;
+}
+
+// --- 跳頻 ---
+
+bool encodeHop(Packet& packet, uint8_t channel, uint8_t data_rate, uint16_t switch_in_ms) {
+    uint8_t data[4] = { channel, data_rate, (uint8_t)(switch_in_ms & 0xFF), (uint8_t)(switch_in_ms >> 8) };
+    return packet.setPayload(data, sizeof(data));
+}
+
+bool decodeHop(const Packet& packet, uint8_t& channel, uint8_t& data_rate, uint16_t& switch_in_ms) {
+    if (packet.payload_len != 4) return false;
+    if (packet.payload[0] > 125 || packet.payload[1] > HOP_RATE_2MBPS) return false;
+    channel = packet.payload[0];
+    data_rate = packet.payload[1];
+    switch_in_ms = packet.payload[2] | (packet.payload[3] << 8);
+    return true;
+}
+
+const char* protocolDataRateName(uint8_t data_rate) {
+    switch (data_rate) {
+        case HOP_RATE_1MBPS: return "1 Mbps";
+        case HOP_RATE_2MBPS: return "2 Mbps";
+        default:             return "250 kbps";
+    }
+}
+
+// --- 鏈路統計 ---
+
+uint8_t linkArcBin(uint8_t arc) {
+    return arc < LINK_ARC_BINS ? arc : LINK_ARC_BINS - 1;
+}
+
+static uint8_t* putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static const uint8_t* getU16(const uint8_t* in, uint16_t& value) {
+    value = in[0] | (in[1] << 8);
+    return in + 2;
+}
+
+static const uint8_t LINK_REPORT_SIZE = 2 * (4 + LINK_ARC_BINS) + 1;
+
+bool encodeLinkReport(Packet& packet, const LinkReport& report) {
+    uint8_t data[LINK_REPORT_SIZE];
+    uint8_t* out = putU16(data, report.writes);
+    out = putU16(out, report.failed);
+    for (uint8_t i = 0; i < LINK_ARC_BINS; ++i) out = putU16(out, report.arc[i]);
+    out = putU16(out, report.rx);
+    out = putU16(out, report.rx_strong);
+    *out = report.lost;
+    return packet.setPayload(data, sizeof(data));
+}
+
+bool decodeLinkReport(const Packet& packet, LinkReport& report) {
+    if (packet.payload_len != LINK_REPORT_SIZE) return false;
+    const uint8_t* in = getU16(packet.payload, report.writes);
+    in = getU16(in, report.failed);
+    for (uint8_t i = 0; i < LINK_ARC_BINS; ++i) in = getU16(in, report.arc[i]);
+    in = getU16(in, report.rx);
+    in = getU16(in, report.rx_strong);
+    report.lost = *in;
+    return true;
+}
+
+// --- 從機之間的感應 ---
+
+void encodePeerRecord(const PeerInfo& peer, uint8_t* out) {
+    out[0] = PEER_RECORD_VERSION;
+    out[1] = peer.device_id;
+    out = putU16(out + 2, peer.session_token);
+    putU16(out, peer.score);
+}
+
+bool decodePeerRecord(const uint8_t* payload, uint32_t len, PeerInfo& peer) {
+    // 較新版本可在尾端附加欄位
+    if (len < PEER_RECORD_SIZE || payload[0] < PEER_RECORD_VERSION || payload[1] == PROTOCOL_MASTER_ID) return false;
+    peer.device_id = payload[1];
+    const uint8_t* in = getU16(payload + 2, peer.session_token);
+    getU16(in, peer.score);
+    return true;
+}
+
+static const uint8_t ENCOUNTER_SIZE = 7;
+
+bool encodeEncounter(Packet& packet, const PeerInfo& peer, uint32_t tap_to_uplink_us) {
+    uint8_t data[ENCOUNTER_SIZE];
+    data[0] = peer.device_id;
+    uint8_t* out = putU16(data + 1, peer.session_token);
+    out = putU16(out, peer.score);
+    putU16(out, encodeTapLatency(tap_to_uplink_us));
+    return packet.setPayload(data, sizeof(data));
+}
+
+bool decodeEncounter(const Packet& packet, PeerInfo& peer, uint32_t& tap_to_uplink_us) {
+    if (packet.payload_len != ENCOUNTER_SIZE || packet.payload[0] == PROTOCOL_MASTER_ID) return false;
+    peer.device_id = packet.payload[0];
+    const uint8_t* in = getU16(packet.payload + 1, peer.session_token);
+    in = getU16(in, peer.score);
+    uint16_t latency;
+    getU16(in, latency);
+    tap_to_uplink_us = decodeTapLatency(latency);
+    return true;
+}
+
+bool encodeSession(Packet& packet, uint16_t session_token) {
+    uint8_t data[2];
+    putU16(data, session_token);
+    return packet.setPayload(data, sizeof(data));
+}
+
+uint16_t decodeSession(const Packet& packet) {
+    uint16_t session_token = 0;
+    if (packet.payload_len >= 2) getU16(packet.payload, session_token);
+    return session_token;
+}
@@ -3,23 +3,40 @@
 #include "RadioModule.h"
 #include "Config.h"
 
+namespace {
+void bump(uint16_t& counter) {
+    if (counter < UINT16_MAX) counter++;
+}
+}
+
 // The 'begin' function and others not shown here are assumed to be the same as your original slave file.
 // If you need the full file, let me know. The key changes are in listenForCommand and sendResponse.
 
 void RadioModule::begin(SPIClass& spi, uint8_t ce, uint8_t csn) {
     // This assumes you are using the SPI library and a pointer to the radio object
     // as in your original structure.
+    _lock = xSemaphoreCreateMutex();
+    _uplink_queue = xQueueCreate(UPLINK_QUEUE_LENGTH, sizeof(UplinkItem));
     _radio = new RF24(ce, csn);
     if (!_radio->begin(&spi)) {
         Serial.println(F("Radio hardware not responding!!"));
         while (1) {} // Hold in infinite loop
     }
     _radio->setPALevel(RF24_PA_LOW);
-    _radio->setDataRate(RF24_1MBPS);
-    _radio->setChannel(76);
+    // 【修改】: 開機時在會合頻道，之後依主機的 OP_HOP 跳頻
+    _radio->setDataRate((rf24_datarate_e)_data_rate);
+    _radio->setChannel(_channel);
     _radio->setCRCLength(RF24_CRC_16);
     _radio->setAutoAck(true);
+    // 依 ID 錯開硬體重送間隔，多台從機同時回覆 ACK 時較不會一再碰撞
+    _radio->setRetries(DEVICE_ID % 15, 15);
+    // 【新增】: 封包長度隨內容變化；上行封包可預先放入 ACK payload，等主機輪詢時隨 ACK 送出
+    _radio->enableDynamicPayloads();
+    _radio->enableAckPayload();
     _radio->openReadingPipe(1, command_pipe); // Listen on the common command pipe
+    uint8_t poll_address[5];
+    protocolPollAddress(DEVICE_ID, command_pipe, poll_address);
+    _radio->openReadingPipe(POLL_PIPE, poll_address); // 主機只對這台從機送出的輪詢
     _radio->flush_rx();
     _radio->flush_tx();
     _radio->startListening();
@@ -29,51 +46,411 @@ void RadioModule::powerUp() {
     _radio->powerUp();
 }
 
-// 【修改】: 監聽並讀取完整的字串封包
-bool RadioModule::listenForCommand(String& command) {
+// 【修改】: 監聽並解碼二進位封包 (無法解碼的雜訊直接丟棄)
+bool RadioModule::listenForCommand(Packet& packet) {
+    uint8_t buffer[PROTOCOL_MAX_FRAME];
+    uint8_t len = 0;
+    bool strong = false;
+    xSemaphoreTake(_lock, portMAX_DELAY);
     if (_radio->available()) {
-        char buffer[32] = "";
-        _radio->read(&buffer, sizeof(buffer));
-        command = String(buffer);
-        // 清理可能存在的空字元
-        command.trim(); 
-        if (command.length() > 0) {
-            return true;
+        len = _radio->getDynamicPayloadSize(); // 長度錯誤時回傳 0 (RF24 已清除該封包)
+        if (len > 0) _radio->read(buffer, len);
+        strong = _radio->testRPD(); // 最近一個有效封包的訊號強度
+    }
+    xSemaphoreGive(_lock);
+    if (len == 0 || !decodePacket(buffer, len, packet)) return false;
+    if (packet.source == PROTOCOL_MASTER_ID) {
+        _last_master_rx = millis();
+        // _link 也由 main_logic_task 經 recordWrite() 更新 (持有 _lock)
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        bump(_link.rx);
+        if (strong) bump(_link.rx_strong);
+        xSemaphoreGive(_lock);
+        if (_searching) {
+            _searching = false;
+            Serial.printf("[NRF] Found master on channel %u (%s)\n", _channel, protocolDataRateName(_data_rate));
         }
     }
-    return false;
+    return true;
 }
 
 void RadioModule::sendJoinRequest(uint8_t deviceId) {
+    Packet packet(OP_JOIN_REQUEST, TargetMask::single(PROTOCOL_MASTER_ID));
+    packet.seq = _next_seq++;
+    packet.source = deviceId;
+    uint8_t buffer[PROTOCOL_MAX_FRAME];
+    uint8_t len = encodePacket(packet, buffer, sizeof(buffer));
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
     _radio->stopListening();
     _radio->openWritingPipe(discovery_pipe);
-    _radio->write(&deviceId, sizeof(deviceId));
+    bool acked = _radio->write(buffer, len);
+    if (!acked) _radio->flush_tx();
+    recordWrite(acked);
     _radio->startListening();
+    xSemaphoreGive(_lock);
 }
 
-// 【修改】: 發送字串格式的回應
-void RadioModule::sendResponse(const String& response) {
-    _radio->stopListening();
-    char pipe_name[6];
-    sprintf(pipe_name, "%dNODE", DEVICE_ID);
-    _radio->openWritingPipe((const uint8_t*)pipe_name);
+// 【修改】: 發送二進位格式的回應 (放入上行佇列)
+void RadioModule::sendResponse(uint8_t opcode, const uint8_t* payload, uint8_t payload_len) {
+    UplinkItem item;
+    item.packet = Packet(opcode, TargetMask::single(PROTOCOL_MASTER_ID));
+    item.packet.setPayload(payload, payload_len);
+    item.capture_us = 0;
+    item.uid_len = 0;
+    enqueueUplink(item);
+}
 
-    char buffer[32];
-    response.toCharArray(buffer, sizeof(buffer));
-    _radio->write(&buffer, sizeof(buffer));
+void RadioModule::sendTestPacket(uint8_t deviceId) {
+    sendResponse(OP_CHANNEL_TEST);
+}
 
-    _radio->startListening();
+void RadioModule::sendReadResult(const uint8_t* uid, uint8_t uid_len, uint32_t capture_us) {
+    UplinkItem item;
+    item.packet = Packet(OP_READ_RESULT, TargetMask::single(PROTOCOL_MASTER_ID));
+    item.uid_len = uid_len > READ_RESULT_MAX_UID ? READ_RESULT_MAX_UID : uid_len;
+    memcpy(item.uid, uid, item.uid_len);
+    item.capture_us = capture_us | 1; // 0 保留給「沒有偵測時間」
+    enqueueUplink(item);
 }
 
-void RadioModule::sendTestPacket(uint8_t deviceId) {
+void RadioModule::sendEncounter(const PeerInfo& peer, uint32_t capture_us) {
+    UplinkItem item;
+    item.packet = Packet(OP_ENCOUNTER, TargetMask::single(PROTOCOL_MASTER_ID));
+    item.uid_len = 0;
+    item.peer = peer;
+    item.capture_us = capture_us | 1;
+    enqueueUplink(item);
+}
+
+void RadioModule::enqueueUplink(const UplinkItem& item) {
+    if (xQueueSend(_uplink_queue, &item, 0) != pdTRUE) {
+        Serial.printf("[NRF] WARN: uplink queue full, dropping %s\n", protocolOpcodeName(item.packet.opcode));
+    }
+}
+
+void RadioModule::serviceUplink() {
+    reportLink();
+    if (pollingActive()) {
+        preloadNext();
+        return;
+    }
+    reclaimPreload();
+
+    UplinkItem item;
+    if (xQueuePeek(_uplink_queue, &item, 0) != pdTRUE) return;
+    if (isSlotted(item.packet.opcode) && !inMySlot()) return;
+    xQueueReceive(_uplink_queue, &item, 0);
+    finalizeReadResult(item);
+    writePacket(item.packet);
+}
+
+/**
+ * @brief 【新增】: 收到主機對本機的輪詢。ACK (連同預載的 payload) 已由硬體自動送出
+ */
+void RadioModule::handlePoll() {
+    _polled = true;
+    _last_poll_time = millis();
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    checkPreloadSent();
+    xSemaphoreGive(_lock);
+}
+
+bool RadioModule::pollingActive() const {
+    return _polled && millis() - _last_poll_time < POLL_TIMEOUT_MS;
+}
+
+/**
+ * @brief 一次只預載一個封包，TX FIFO 清空即代表已隨 ACK 送達主機。呼叫前需持有 _lock
+ */
+void RadioModule::checkPreloadSent() {
+    if (_preloaded && _radio->isFifo(true, true)) {
+        _preloaded = false;
+    }
+}
+
+/**
+ * @brief 把佇列中的下一個上行封包放進輪詢管道的 ACK payload。
+ * 輪詢模式下不需要 TDMA 時槽：主機一次只輪詢一台，上行不會互相碰撞
+ */
+void RadioModule::preloadNext() {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    checkPreloadSent();
+    xSemaphoreGive(_lock);
+    if (_preloaded) return;
+
+    UplinkItem item;
+    if (xQueueReceive(_uplink_queue, &item, 0) != pdTRUE) return;
+    _preloaded_item = item; // 保留原始項目 (含偵測時間)，被收回時可重新排入佇列
+    finalizeReadResult(item);
+    uint8_t buffer[PROTOCOL_MAX_FRAME];
+    uint8_t len = encodeUplink(item.packet, buffer);
+    if (len == 0) return;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _preloaded = _radio->writeAckPayload(POLL_PIPE, buffer, len);
+    xSemaphoreGive(_lock);
+}
+
+/**
+ * @brief 主機停止輪詢：收回尚未送出的 ACK payload，改由自己傳送 (stopListening 也會清除 TX FIFO)
+ */
+void RadioModule::reclaimPreload() {
+    if (!_preloaded) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool sent = _radio->isFifo(true, true);
+    _radio->flush_tx();
+    xSemaphoreGive(_lock);
+    _preloaded = false;
+    if (!sent) requeueFront(_preloaded_item);
+}
+
+void RadioModule::requeueFront(const UplinkItem& item) {
+    if (xQueueSendToFront(_uplink_queue, &item, 0) != pdTRUE) {
+        Serial.printf("[NRF] WARN: uplink queue full, dropping %s\n", protocolOpcodeName(item.packet.opcode));
+    }
+}
+
+/**
+ * @brief 讀卡結果 (與 OP_ENCOUNTER) 的 感應 -> 上行 延遲在送出 (或預載) 的當下計算。
+ * 輪詢模式下不含等待主機輪詢的時間 (最多一輪輪詢週期)
+ */
+void RadioModule::finalizeReadResult(UplinkItem& item) {
+    if (item.capture_us == 0) return;
+    uint32_t latency_us = micros() - item.capture_us;
+    if (item.packet.opcode == OP_ENCOUNTER) {
+        encodeEncounter(item.packet, item.peer, latency_us);
+    } else {
+        encodeReadResult(item.packet, item.uid, item.uid_len, latency_us);
+    }
+    Serial.printf("[NFC] Tap -> uplink latency: %lu us\n", (unsigned long)latency_us);
+}
+
+void RadioModule::sendCommandAck(const Packet& command) {
+    Packet ack(OP_CMD_ACK, TargetMask::single(PROTOCOL_MASTER_ID));
+    ack.setPayload(&command.seq, 1);
+
+    if (pollingActive()) {
+        // 【新增】: CMD_ACK 插隊預載，等主機輪詢取回，不需要依排序延遲
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        checkPreloadSent();
+        bool displaced = false;
+        if (_preloaded) {
+            if (_preloaded_item.packet.opcode == OP_CMD_ACK && _preloaded_item.packet.payload[0] == command.seq) {
+                xSemaphoreGive(_lock);
+                return; // 主機重送，但上一個 ACK 還沒被取走
+            }
+            _radio->flush_tx();
+            _preloaded = false;
+            displaced = true;
+        }
+        xSemaphoreGive(_lock);
+        if (displaced) requeueFront(_preloaded_item);
+        UplinkItem item;
+        item.packet = ack;
+        item.capture_us = 0;
+        item.uid_len = 0;
+        requeueFront(item);
+        preloadNext();
+        return;
+    }
+    reclaimPreload();
+
+    // 【更新】: 主機重送 (或已放棄上一個指令) 時以最新的封包與排序為準
+    uint16_t rank = command.targets.isAll() ? _slot : command.targets.rankOf(DEVICE_ID);
+    _ack_packet = ack;
+    _ack_due_us = micros() + (uint32_t)rank * ACK_SPACING_US;
+    _ack_pending = true;
+    serviceCommandAck();
+}
+
+/**
+ * @brief 【新增】: 排定的 CMD_ACK 到期就送出。剩下不到一個 ACK_SPACING_US 時在此忙等，
+ * 排序間隔才準確；更早的話交回 nrf_task，等待期間仍可清空 RX FIFO
+ */
+void RadioModule::serviceCommandAck() {
+    if (!_ack_pending) return;
+    int32_t remaining_us = (int32_t)(_ack_due_us - micros());
+    if (remaining_us > (int32_t)ACK_SPACING_US) return;
+    if (remaining_us > 0) delayMicroseconds(remaining_us);
+    _ack_pending = false;
+    writePacket(_ack_packet);
+}
+
+uint32_t RadioModule::commandAckDueInUs() const {
+    if (!_ack_pending) return UINT32_MAX;
+    int32_t remaining_us = (int32_t)(_ack_due_us - micros());
+    return remaining_us > 0 ? remaining_us : 0;
+}
+
+void RadioModule::setSlot(uint8_t slot) {
+    _slot = slot;
+    Serial.printf("[NRF] Assigned uplink slot %d\n", slot);
+}
+
+void RadioModule::handleSync(const Packet& beacon) {
+    if (beacon.payload_len < 2 || beacon.payload[0] == 0 || beacon.payload[1] == 0) return;
+    _slot_count = beacon.payload[0];
+    _slot_ms = beacon.payload[1];
+    _sync_time = millis();
+    _synced = true;
+    _last_tx_frame = UINT32_MAX;
+}
+
+/**
+ * @brief 【新增】: 主機的跳頻公告。每次公告都帶剩餘時間，以最後收到的為準
+ */
+void RadioModule::handleHop(const Packet& packet) {
+    uint8_t channel, data_rate;
+    uint16_t switch_in_ms;
+    if (!decodeHop(packet, channel, data_rate, switch_in_ms)) return;
+    _hop_channel = channel;
+    _hop_rate = data_rate;
+    _hop_time = millis() + switch_in_ms;
+    _hop_pending = true;
+    if (switch_in_ms == 0) serviceChannel();
+}
+
+void RadioModule::serviceChannel() {
+    unsigned long now = millis();
+    if (_hop_pending && (long)(now - _hop_time) >= 0) {
+        _hop_pending = false;
+        _searching = false;
+        _last_master_rx = now;
+        if (_hop_channel != _channel || _hop_rate != _data_rate) {
+            tune(_hop_channel, _hop_rate);
+            Serial.printf("[NRF] Hopped to channel %u (%s)\n", _channel, protocolDataRateName(_data_rate));
+        }
+    }
+
+    bool at_rendezvous = _channel == RENDEZVOUS_CHANNEL && _data_rate == HOP_RATE_1MBPS;
+    if (_searching) {
+        if (now - _search_step_time >= (at_rendezvous ? RENDEZVOUS_DWELL_MS : SEARCH_DWELL_MS)) nextSearchStep();
+        return;
+    }
+    // 會合頻道上不必尋找：主機不在時也會回來送信標或進入發現模式
+    if (!at_rendezvous && now - _last_master_rx > LINK_LOST_MS) {
+        Serial.printf("[NRF] Lost master on channel %u (%s), searching...\n", _channel, protocolDataRateName(_data_rate));
+        _searching = true;
+        _search_pair = 0;
+        tune(RENDEZVOUS_CHANNEL, HOP_RATE_1MBPS);
+        _search_step_time = now;
+    }
+}
+
+/**
+ * @brief 會合頻道與其他 (頻道, 速率) 組合輪流，大部分時間停在會合頻道
+ */
+void RadioModule::nextSearchStep() {
+    if (_channel != RENDEZVOUS_CHANNEL || _data_rate != HOP_RATE_1MBPS) {
+        tune(RENDEZVOUS_CHANNEL, HOP_RATE_1MBPS);
+    } else {
+        const uint8_t pair_count = HOP_CHANNEL_COUNT * 2;
+        uint8_t channel, data_rate;
+        do {
+            channel = HOP_CHANNELS[_search_pair / 2];
+            data_rate = (_search_pair % 2) ? HOP_RATE_2MBPS : HOP_RATE_1MBPS;
+            _search_pair = (_search_pair + 1) % pair_count;
+        } while (channel == RENDEZVOUS_CHANNEL && data_rate == HOP_RATE_1MBPS);
+        tune(channel, data_rate);
+    }
+    _search_step_time = millis();
+}
+
+/**
+ * @brief 切換頻道與速率。stopListening 會清除 TX FIFO，預載的 ACK payload 先收回
+ */
+void RadioModule::tune(uint8_t channel, uint8_t data_rate) {
+    reclaimPreload();
+    xSemaphoreTake(_lock, portMAX_DELAY);
     _radio->stopListening();
-    char pipe_name[6];
-    sprintf(pipe_name, "%dNODE", deviceId);
-    _radio->openWritingPipe((const uint8_t*)pipe_name);
+    _radio->setChannel(channel);
+    _radio->setDataRate((rf24_datarate_e)data_rate);
+    _radio->startListening();
+    _plos_base = 0; // 寫入 RF_CH 後 PLOS_CNT 從 0 重新計數
+    xSemaphoreGive(_lock);
+    _channel = channel;
+    _data_rate = data_rate;
+}
+
+/**
+ * @brief 記錄一次需要 ACK 的傳送 (呼叫前需持有 _lock)
+ */
+void RadioModule::recordWrite(bool acked) {
+    bump(_link.writes);
+    if (acked) bump(_link.arc[linkArcBin(_radio->getARC())]);
+    else bump(_link.failed);
+}
+
+/**
+ * @brief 【新增】: 加入 (被指派時槽) 後每 LINK_REPORT_INTERVAL_MS 排入一次鏈路統計
+ */
+void RadioModule::reportLink() {
+    if (_slot == 0 || millis() - _last_link_report < LINK_REPORT_INTERVAL_MS) return;
+    _last_link_report = millis();
+    // 【更新】: PLOS_CNT 是累計值 (寫入 RF_CH 時歸零)，只回報本期間的增量。
+    // 在 _lock 內取出並歸零，期間其他 task 的計數不會遺失
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    uint8_t plos = _radio->getPLOS();
+    _link.lost = plos >= _plos_base ? plos - _plos_base : plos;
+    _plos_base = plos;
+    LinkReport report = _link;
+    _link = {};
+    xSemaphoreGive(_lock);
+
+    UplinkItem item;
+    item.packet = Packet(OP_LINK_STATS, TargetMask::single(PROTOCOL_MASTER_ID));
+    encodeLinkReport(item.packet, report);
+    item.capture_us = 0;
+    item.uid_len = 0;
+    enqueueUplink(item);
+}
 
-    char text[32];
-    sprintf(text, "Channel Test from #%d", deviceId);
-    _radio->write(&text, sizeof(text));
+bool RadioModule::isSlotted(uint8_t opcode) const {
+    return opcode == OP_HEARTBEAT || opcode == OP_CHANNEL_TEST || opcode == OP_LINK_STATS;
+}
+
+/**
+ * @brief 目前是否位於自己的時槽內 (每個超框只送一次)。
+ * 尚未同步、沒有時槽或信標過期時退回立即傳送。
+ */
+bool RadioModule::inMySlot() {
+    unsigned long elapsed = millis() - _sync_time;
+    if (!_synced || _slot == 0 || _slot >= _slot_count || elapsed > SYNC_TIMEOUT_MS) return true;
+
+    unsigned long frame_ms = (unsigned long)_slot_count * _slot_ms;
+    uint32_t frame_no = elapsed / frame_ms;
+    unsigned long offset = elapsed % frame_ms;
+    if (offset < (unsigned long)_slot * _slot_ms || offset >= (unsigned long)(_slot + 1) * _slot_ms) return false;
+    if (frame_no == _last_tx_frame) return false;
+    _last_tx_frame = frame_no;
+    return true;
+}
+
+/**
+ * @brief 填入序號與來源後編碼，回傳實際長度 (0 = 失敗)
+ */
+uint8_t RadioModule::encodeUplink(const Packet& packet, uint8_t* buffer) {
+    Packet frame = packet;
+    frame.seq = _next_seq++;
+    frame.source = DEVICE_ID;
+    return encodePacket(frame, buffer, PROTOCOL_MAX_FRAME);
+}
+
+void RadioModule::writePacket(const Packet& packet) {
+    uint8_t buffer[PROTOCOL_MAX_FRAME];
+    uint8_t len = encodeUplink(packet, buffer);
+    if (len == 0) return;
 
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _radio->stopListening();
+    _radio->openWritingPipe(uplink_pipe);
+    bool acked = _radio->write(buffer, len);
+    if (!acked) {
+        // 逾時 (FAILURE_HANDLING) 時 RF24 不會清除 TX FIFO；留下的封包會讓預載判斷失準
+        _radio->flush_tx();
+    }
+    recordWrite(acked);
     _radio->startListening();
-}
\ No newline at end of file
+    xSemaphoreGive(_lock);
+}
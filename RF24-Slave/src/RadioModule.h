@@ -4,19 +4,106 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <RF24.h>
+#include "Protocol.h"
 
 class RadioModule {
 public:
     void begin(SPIClass& spi, uint8_t ce, uint8_t csn);
     void powerUp();
 
-    // 【修改】: 監聽字串封包
-    bool listenForCommand(String& command);
+    // 【修改】: 監聽並解碼二進位封包
+    bool listenForCommand(Packet& packet);
     
     void sendJoinRequest(uint8_t deviceId);
-    void sendResponse(const String& response);
+
+    // 【修改】: 上行封包先放入佇列，由 nrf_task 呼叫 serviceUplink() 送出。
+    // 心跳與通道測試等週期性封包只在自己的 TDMA 時槽送出；讀卡結果等則立即送出
+    void sendResponse(uint8_t opcode, const uint8_t* payload = nullptr, uint8_t payload_len = 0);
     void sendTestPacket(uint8_t deviceId);
+    // 【新增】: 讀卡結果。感應 -> 上行 的延遲在實際送出時才計算並寫入 payload
+    void sendReadResult(const uint8_t* uid, uint8_t uid_len, uint32_t capture_us);
+    // 【新增】: 讀到另一台從機 (OP_ENCOUNTER)，延遲的計算方式與讀卡結果相同
+    void sendEncounter(const PeerInfo& peer, uint32_t capture_us);
+    void serviceUplink();
+
+    // 回覆 OP_CMD_ACK (只在 nrf_task 中呼叫)：依自己在目標中的排序延遲，避免與其他從機碰撞
+    // 【更新】: 不在這裡等待，只排定送出時間；nrf_task 每輪呼叫 serviceCommandAck() 檢查是否到期
+    void sendCommandAck(const Packet& command);
+    void serviceCommandAck();
+    uint32_t commandAckDueInUs() const;   // 距離排定的 CMD_ACK 還有多久 (沒有時為 UINT32_MAX)
+
+    // 上行 TDMA 時槽
+    void setSlot(uint8_t slot);
+    void handleSync(const Packet& beacon);
+
+    // 【新增】: 主機輪詢 (OP_POLL)。輪詢期間上行封包預載為 ACK payload，不再自行切換到 TX
+    void handlePoll();
+    bool pollingActive() const;
+
+    // 【新增】: 跳頻 (OP_HOP)。公告的切換時間到時由 serviceChannel() 切換；
+    // 失聯時回到會合頻道並依序在 HOP_CHANNELS 上尋找主機 (只在 nrf_task 中呼叫)
+    void handleHop(const Packet& packet);
+    void serviceChannel();
 
 private:
+    struct UplinkItem {
+        Packet packet;
+        uint32_t capture_us;   // 非 0 時為 OP_READ_RESULT / OP_ENCOUNTER 的卡片偵測時間
+        uint8_t uid[READ_RESULT_MAX_UID];
+        uint8_t uid_len;
+        PeerInfo peer;         // OP_ENCOUNTER 的對方
+    };
+
+    void enqueueUplink(const UplinkItem& item);
+    void requeueFront(const UplinkItem& item);
+    void reclaimPreload();
+    void finalizeReadResult(UplinkItem& item);
+    void preloadNext();
+    void checkPreloadSent();
+    uint8_t encodeUplink(const Packet& packet, uint8_t* buffer);
+    void writePacket(const Packet& packet);
+    bool isSlotted(uint8_t opcode) const;
+    bool inMySlot();
+    void tune(uint8_t channel, uint8_t data_rate);
+    void recordWrite(bool acked);
+    void reportLink();
+    void nextSearchStep();
+
     RF24* _radio;
-};
\ No newline at end of file
+    uint8_t _next_seq = 0;
+    // nrf_task (收指令/上行) 與 main_logic_task (加入請求) 在不同核心上共用 SPI
+    SemaphoreHandle_t _lock = nullptr;
+    QueueHandle_t _uplink_queue = nullptr;
+
+    uint8_t _slot = 0;             // 0 = 尚未指派
+    uint8_t _slot_count = 0;
+    uint8_t _slot_ms = 0;
+    unsigned long _sync_time = 0;  // 最近一次收到同步信標的時間 (超框起點)
+    bool _synced = false;
+    uint32_t _last_tx_frame = UINT32_MAX;
+
+    bool _ack_pending = false;          // 【新增】: 排定中的 CMD_ACK (自行傳送時)
+    Packet _ack_packet;
+    uint32_t _ack_due_us = 0;
+
+    bool _polled = false;               // 曾收到主機輪詢
+    unsigned long _last_poll_time = 0;
+    bool _preloaded = false;            // TX FIFO 中有一個尚未被取走的 ACK payload
+    UplinkItem _preloaded_item;
+
+    uint8_t _channel = RENDEZVOUS_CHANNEL;
+    uint8_t _data_rate = HOP_RATE_1MBPS;
+    unsigned long _last_master_rx = 0;  // 最近一次收到主機封包的時間
+    bool _hop_pending = false;
+    uint8_t _hop_channel = RENDEZVOUS_CHANNEL;
+    uint8_t _hop_rate = HOP_RATE_1MBPS;
+    unsigned long _hop_time = 0;
+    bool _searching = false;
+    uint8_t _search_pair = 0;           // HOP_CHANNELS x 速率 中下一個要嘗試的組合
+    unsigned long _search_step_time = 0;
+
+    // 【新增】: 本期間的鏈路統計，每 LINK_REPORT_INTERVAL_MS 以 OP_LINK_STATS 回報後歸零
+    LinkReport _link = {};
+    unsigned long _last_link_report = 0;
+    uint8_t _plos_base = 0;             // 上次回報時的 PLOS_CNT
+};
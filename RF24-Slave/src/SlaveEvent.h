@@ -0,0 +1,25 @@
+// SlaveEvent.h
+
+#pragma once
+#include <Arduino.h>
+#include "Protocol.h"
+
+/**
+ * @brief 【新增】: main_logic_task 狀態機的輸入事件。
+ * nrf_task、按鈕與 NFC 都只把事件放入同一個 FreeRTOS 佇列，
+ * 由 main_logic_task 依到達順序逐一處理，不再共用 volatile 旗標。
+ */
+enum SlaveEventType : uint8_t {
+    EVT_COMMAND,    // 主機指令 (已去重，packet 為完整指令)
+    EVT_BUTTON1,
+    EVT_BUTTON2,
+    EVT_NFC_READ,   // 讀到卡片 (packet.payload 為 UID)
+    EVT_NFC_ENCOUNTER, // 【新增】: 讀到本局的另一台從機 (packet.payload 為對方的 peer record)
+    EVT_TIMEOUT     // 目前狀態的時限已到 (由狀態機自行產生)
+};
+
+struct SlaveEvent {
+    SlaveEventType type;
+    Packet packet;
+    uint32_t timestamp_us = 0;  // EVT_NFC_READ / EVT_NFC_ENCOUNTER: 偵測到卡片的時間 (micros)
+};
@@ -1,15 +1,18 @@
 /**
  * @file main.cpp
- * @brief NRF Slave Device (v3.1 - Logic & Parser Fix)
- * @details Fixes command prefix mismatch for Score Mode and corrects the main state machine logic.
+ * @brief NRF Slave Device (v3.2 - Event Driven State Machine)
+ * @details nrf_task, buttons and the NFC reader post typed events to one queue;
+ *          main_logic_task consumes them in order through table-driven transitions.
  */
 #include <Arduino.h>
 #include <SPI.h>
 #include <EasyButton.h> 
 #include "Config.h"
 #include "RadioModule.h"
+#include "Protocol.h"
 #include "NfcModule.h"
 #include "LedModule.h"
+#include "SlaveEvent.h"
 
 // --- Global Objects & State ---
 SPIClass hspi(HSPI);
@@ -17,23 +20,31 @@ SPIClass vspi(VSPI);
 RadioModule radio;
 NfcModule nfc;
 LedModule leds(LED_COUNT, LED_STRIP_PIN);
-SystemMode current_mode = MODE_JOINING;
 TaskHandle_t nrf_task_handle;
 TaskHandle_t main_logic_task_handle;
-volatile bool stop_signal = false;
-volatile bool blink_white_pending = false;
+// 【修改】: 兩個 task 之間只透過事件佇列溝通；以下狀態只在 main_logic_task 中存取
+QueueHandle_t event_queue;
+SystemMode current_mode = MODE_JOINING;
+unsigned long mode_enter_time = 0;
+unsigned long last_join_request_time = 0;
 String registered_name = "";
 
+// 【修改】: 最近收到的主機序號 (只在 nrf_task 中存取)。批次傳送的副本會與其他指令交錯
+uint8_t recent_seqs[SEQ_DEDUP_HISTORY];
+unsigned long recent_seq_times[SEQ_DEDUP_HISTORY];
+uint8_t recent_seq_count = 0;
+uint8_t recent_seq_next = 0;
+
 EasyButton button1(SCORE_MODE_BUTTON1_PIN);
 EasyButton button2(SCORE_MODE_BUTTON2_PIN);
-volatile bool button1_pressed = false;
-volatile bool button2_pressed = false;
 
 // --- Function Declarations ---
 void nrf_task(void* pvParameters);
 void main_logic_task(void* pvParameters);
-void resetToIdleState();
-bool parseAndCheckId(const String& command, const String& prefix);
+bool postEvent(SlaveEventType type, const Packet* packet = nullptr, TickType_t wait = 0, uint32_t timestamp_us = 0);
+void dispatchEvent(const SlaveEvent& event);
+void transitionTo(SystemMode next);
+bool isDuplicateCommand(uint8_t seq);
 void handleButton1Press();
 void handleButton2Press();
 void setupButtons();
@@ -46,8 +57,11 @@ void setup() {
     radio.begin(vspi, NRF_CE, NRF_CSN);
     if (!nfc.begin(hspi, PN532_SS)) {
         Serial.println("[WARN] PN532 not found. Continuing discovery/join anyway.");
+    } else {
+        nfc.initEmulator(DEVICE_ID); // 開機時先建好 NDEF 檔，第一次模擬不必等待
     }
     setupButtons();
+    event_queue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(SlaveEvent));
     Serial.printf("\n--- Slave Device #%d Booted Up ---\n", DEVICE_ID);
     xTaskCreatePinnedToCore(nrf_task, "NRF_Task", 4096, NULL, 1, &nrf_task_handle, 0);
     xTaskCreatePinnedToCore(main_logic_task, "MainLogic_Task", 4096, NULL, 1, &main_logic_task_handle, 1);
@@ -57,8 +71,8 @@ void loop() {
     vTaskDelay(portMAX_DELAY);
 }
 
-void handleButton1Press() { button1_pressed = true; }
-void handleButton2Press() { button2_pressed = true; }
+void handleButton1Press() { postEvent(EVT_BUTTON1); }
+void handleButton2Press() { postEvent(EVT_BUTTON2); }
 void setupButtons() {
     button1.begin();
     button2.begin();
@@ -66,79 +80,300 @@ void setupButtons() {
     button2.onPressed(handleButton2Press);
 }
 
-bool parseAndCheckId(const String& command, const String& prefix) {
-    if (!command.startsWith(prefix)) return false;
-    int start_index = prefix.length();
-    int end_index = command.length() - 1;
-    String ids_str = command.substring(start_index, end_index);
-    if (ids_str == "ALL") return true;
-    String my_id_str = String(DEVICE_ID);
-    int current_pos = 0;
-    while(current_pos < ids_str.length()){
-        int separator_pos = ids_str.indexOf('-', current_pos);
-        if(separator_pos == -1) separator_pos = ids_str.length();
-        String id_part = ids_str.substring(current_pos, separator_pos);
-        if(id_part == my_id_str) return true;
-        current_pos = separator_pos + 1;
-    }
-    return false;
-}
-
 void nrf_task(void* pvParameters) {
     radio.powerUp();
     for (;;) {
-        String received_packet;
-        if (radio.listenForCommand(received_packet)) {
-            Serial.printf("[NRF] Received packet: %s\n", received_packet.c_str());
-            
-            // --- 【關鍵修正】移除所有指令前綴中多餘的結尾底線 '_' ---
-            if (parseAndCheckId(received_packet, "*READ_")) {
-                current_mode = MODE_READER;
-            } else if (parseAndCheckId(received_packet, "*EMULATE_")) {
-                current_mode = MODE_EMULATOR;
-            } else if (parseAndCheckId(received_packet, "*TESTPIPE_")) {
-                current_mode = MODE_CHANNEL_TEST;
-            } else if (parseAndCheckId(received_packet, "*SETCOLOR_YELLOW_")) {
-                current_mode = MODE_TEAM_WAITING;
-            } else if (parseAndCheckId(received_packet, "*SETCOLOR_RAINBOW_")) {
-                current_mode = MODE_SPOTLIGHT;
-            } else if (parseAndCheckId(received_packet, "*SCORE_MODE_START")) { // 修正
-                current_mode = MODE_SCORE_EMULATOR;
-            } else if (parseAndCheckId(received_packet, "*SCORE_MODE_STOP")) { // 修正
-                resetToIdleState();
-            } else if (parseAndCheckId(received_packet, "*COOLDOWN_START_")) {
-                current_mode = MODE_COOLDOWN;
-            } else if (parseAndCheckId(received_packet, "*COOLDOWN_END_")) {
-                if (current_mode == MODE_COOLDOWN) {
-                    current_mode = MODE_SCORE_EMULATOR;
+        Packet packet;
+        // 【修改】: 一次清空 RX FIFO (只有 3 層)，主機的批次傳送才不會溢位
+        while (radio.listenForCommand(packet)) {
+            if (packet.opcode == OP_SYNC) {
+                radio.handleSync(packet);
+            } else if (packet.opcode == OP_POLL) {
+                if (packet.targets.contains(DEVICE_ID)) radio.handlePoll();
+            } else if (packet.opcode == OP_HOP) {
+                radio.handleHop(packet); // 公告會重複送出 (各自的序號)，不做去重
+            } else if (packet.targets.contains(DEVICE_ID)) {
+                bool duplicate = isDuplicateCommand(packet.seq);
+                // 重複封包也要再回一次 ACK：代表主機沒收到上一次的 ACK
+                if (packet.ack_requested) {
+                    radio.sendCommandAck(packet);
                 }
-            }
-
-            if(current_mode == MODE_JOINING && received_packet.length() > 0 && received_packet[0] == DEVICE_ID) {
-                current_mode = MODE_CONFIRM_BLINKING;
-            }
-            
-            if (parseAndCheckId(received_packet, "*STOP_")) {
-                stop_signal = true;
-            } else if (parseAndCheckId(received_packet, "*REMOVEJOIN_")) {
-                Serial.println("[SYSTEM] Kicked by master! Returning to JOINING mode.");
-                current_mode = MODE_JOINING;
-            } else if (parseAndCheckId(received_packet, "*BLINK_WHITE_")) {
-                blink_white_pending = true;
-            } else if (received_packet.startsWith("*NAME_")) {
-                int eq_pos = received_packet.indexOf('=');
-                int hash_pos = received_packet.lastIndexOf('#');
-                if (eq_pos > 0 && hash_pos > eq_pos) {
-                    String id_part = received_packet.substring(6, eq_pos);
-                    String name_part = received_packet.substring(eq_pos + 1, hash_pos);
-                    if (id_part == String(DEVICE_ID)) {
-                        registered_name = name_part;
-                        Serial.printf("[debug] Stored name for ID=%d: %s\n", DEVICE_ID, registered_name.c_str());
-                    }
+                if (duplicate) {
+                    Serial.printf("[NRF] Duplicate %s (seq=%u) ignored\n", protocolOpcodeName(packet.opcode), packet.seq);
+                } else {
+                    Serial.printf("[NRF] Received packet: %s (seq=%u)\n", protocolOpcodeName(packet.opcode), packet.seq);
+                    postEvent(EVT_COMMAND, &packet, EVENT_POST_TIMEOUT_MS / portTICK_PERIOD_MS);
                 }
             }
         }
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        radio.serviceCommandAck();
+        radio.serviceUplink();
+        radio.serviceChannel();
+        // 輪詢間隔需小於 SLOT_MS，才能對齊信標並趕上自己的時槽
+        // 【更新】: 排定的 CMD_ACK 快到期時提早醒來 (最後不到 1 ms 由 serviceCommandAck 忙等)
+        TickType_t wait = 2 / portTICK_PERIOD_MS;
+        uint32_t ack_in_us = radio.commandAckDueInUs();
+        if (ack_in_us < 2000) wait = (ack_in_us / 1000) / portTICK_PERIOD_MS;
+        vTaskDelay(wait > 0 ? wait : 1);
+    }
+}
+
+/**
+ * @brief 主機的每個指令只有一個序號 (重送與 burst 副本共用)，與最近 SEQ_DEDUP_HISTORY 個之一相同即為重複
+ */
+bool isDuplicateCommand(uint8_t seq) {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < recent_seq_count; ++i) {
+        if (recent_seqs[i] == seq && now - recent_seq_times[i] < SEQ_DEDUP_WINDOW_MS) {
+            recent_seq_times[i] = now;
+            return true;
+        }
+    }
+    recent_seqs[recent_seq_next] = seq;
+    recent_seq_times[recent_seq_next] = now;
+    recent_seq_next = (recent_seq_next + 1) % SEQ_DEDUP_HISTORY;
+    if (recent_seq_count < SEQ_DEDUP_HISTORY) recent_seq_count++;
+    return false;
+}
+
+/**
+ * @brief 【新增】: 將事件放入狀態機佇列。佇列滿時最多等待 wait，仍失敗則丟棄並記錄
+ */
+bool postEvent(SlaveEventType type, const Packet* packet, TickType_t wait, uint32_t timestamp_us) {
+    SlaveEvent event;
+    event.type = type;
+    if (packet) event.packet = *packet;
+    event.timestamp_us = timestamp_us;
+    if (xQueueSend(event_queue, &event, wait) != pdTRUE) {
+        Serial.printf("[EVENT] WARN: event queue full, dropping event %d\n", type);
+        return false;
+    }
+    return true;
+}
+
+// ==================================================================
+// --- 狀態機: 轉移動作 ---
+// ==================================================================
+void actionJoinAck(const SlaveEvent& event) {
+    if (event.packet.payload_len >= 1) {
+        radio.setSlot(event.packet.payload[0]);
+    }
+}
+
+void actionKicked(const SlaveEvent& event) {
+    Serial.println("[SYSTEM] Kicked by master! Returning to JOINING mode.");
+}
+
+void actionStoreName(const SlaveEvent& event) {
+    char name[PROTOCOL_MAX_PAYLOAD + 1];
+    event.packet.getText(name, sizeof(name));
+    registered_name = name;
+    nfc.setEmulatorName(name);
+    Serial.printf("[debug] Stored name for ID=%d: %s\n", DEVICE_ID, registered_name.c_str());
+}
+
+void actionChannelTest(const SlaveEvent& event) {
+    Serial.println("[STATE] ==> Performing Commanded Channel Test.");
+    radio.sendTestPacket(DEVICE_ID);
+}
+
+void actionEmulatorStopped(const SlaveEvent& event) { radio.sendResponse(OP_EMULATOR_ACK); }
+void actionSendReadResult(const SlaveEvent& event) { radio.sendReadResult(event.packet.payload, event.packet.payload_len, event.timestamp_us); }
+
+// 【新增】: 讀卡方已解析對方的 peer record，一個上行封包就描述了雙方，主機不必再對照 UID
+void actionSendEncounter(const SlaveEvent& event) {
+    PeerInfo peer;
+    if (decodePeerRecord(event.packet.payload, event.packet.payload_len, peer)) {
+        radio.sendEncounter(peer, event.timestamp_us);
+    }
+}
+
+// 【新增】: READ / EMULATE 帶有本局的 session，模擬卡的 peer record 與讀卡方的檢查都以它為準
+void actionJoinSession(const SlaveEvent& event) { nfc.setSession(decodeSession(event.packet)); }
+void actionSendReadTimeout(const SlaveEvent& event) { radio.sendResponse(OP_READ_TIMEOUT); }
+void actionReaderCancelled(const SlaveEvent& event) { Serial.println("[SYSTEM] Reader mode cancelled by Button 2."); }
+
+// ==================================================================
+// --- 狀態機: 進入 / 持續 / 離開 ---
+// ==================================================================
+void enterJoining() {
+    leds.showSolidRed();
+    last_join_request_time = millis() - JOIN_REQUEST_INTERVAL_MS; // 進入後立即送出第一次
+}
+
+void tickJoining() {
+    if (millis() - last_join_request_time < JOIN_REQUEST_INTERVAL_MS) return;
+    // 起動直後は赤点灯しJOIN送信（debugログ）
+    Serial.printf("[debug] ID=%d LED=RED sending JOIN\n", DEVICE_ID);
+    radio.sendJoinRequest(DEVICE_ID);
+    last_join_request_time = millis();
+}
+
+void enterConfirmBlinking() {
+    Serial.println("[STATE] ==> Entering Confirm Blinking.");
+    leds.startBlink(CRGB::Red, 200, CONFIRM_BLINK_MS);
+}
+
+void enterIdle() {
+    Serial.println("[STATE] ==> Resetting to IDLE state.");
+    leds.turnOff();
+}
+
+void enterReader() {
+    Serial.println("[STATE] ==> Entering Reader Mode (Standard).");
+    leds.startCountdown(CRGB::Red, TASK_TIMEOUT_MS); // 紅燈隨剩餘時間逐顆熄滅
+    nfc.startReader();
+}
+
+// 讀到卡片時只產生事件 (附偵測時間)，由轉移表決定要回報並切換到哪個狀態
+void tickReader() {
+    NfcReadResult read;
+    if (!nfc.pollReader(read)) return;
+    Packet result;
+    if (read.is_peer) {
+        uint8_t record[PEER_RECORD_SIZE];
+        encodePeerRecord(read.peer, record);
+        result.setPayload(record, sizeof(record));
+        postEvent(EVT_NFC_ENCOUNTER, &result, 0, read.capture_us);
+    } else {
+        result.setPayload(read.uid, read.uid_length);
+        postEvent(EVT_NFC_READ, &result, 0, read.capture_us);
+    }
+}
+
+void exitReader() { nfc.stopReader(); }
+
+void enterEmulator() {
+    Serial.println("[STATE] ==> Entering Emulator Mode (Standard).");
+    leds.startCountdown(CRGB::Green, TASK_TIMEOUT_MS);
+    nfc.initEmulator(DEVICE_ID);
+}
+
+void tickEmulator() { nfc.emulateOneTick(); }
+void exitEmulator() { nfc.releaseEmulator(); }
+
+void enterWaiting() { leds.showWaitingMode(); }        // 組隊等待 / 冷卻中: 黃燈
+void enterSpotlight() { leds.showSpotlightMode(); }
+// 【更新】: 計分模式的模擬卡同樣使用快取的 NDEF 檔 (含 peer record 與分數)，讀卡方才讀得到
+void enterScoreEmulator() {
+    leds.showEmulatorMode(); // 綠燈，等待被感應
+    nfc.initEmulator(DEVICE_ID);
+}
+
+void enterScoreReader() {
+    Serial.println("[STATE] ==> Entering Score Reader Mode.");
+    leds.showReaderMode(); // 紅燈，主動讀卡
+    nfc.startReader();
+}
+
+void enterStopHold() {
+    Serial.println("[debug] STOP received; lighting RED for 5s then turning off");
+    leds.setSolid(CRGB::Red, STOP_HOLD_MS);
+}
+
+void enterNameBlink() {
+    Serial.printf("[debug] ID=%d color=WHITE name=%s (blink ~5s)\n", DEVICE_ID, registered_name.c_str());
+    leds.startBlink(CRGB::White, 250, NAME_BLINK_MS);
+}
+
+// ==================================================================
+// --- 狀態機: 狀態表與轉移表 ---
+// ==================================================================
+struct StateDef {
+    SystemMode mode;
+    unsigned long timeout_ms;   // 0 = 無時限；時限到時產生 EVT_TIMEOUT
+    void (*on_enter)();
+    void (*on_tick)();          // 每輪迴圈呼叫一次，不可長時間阻塞
+    void (*on_exit)();
+};
+
+// 順序必須與 SystemMode 相同 (以 mode 直接索引)
+const StateDef STATES[] = {
+    { MODE_JOINING,          0,                enterJoining,         tickJoining,  nullptr },
+    { MODE_CONFIRM_BLINKING, CONFIRM_BLINK_MS, enterConfirmBlinking, nullptr,      nullptr },
+    { MODE_IDLE,             0,                enterIdle,            nullptr,      nullptr },
+    { MODE_READER,           TASK_TIMEOUT_MS,  enterReader,          tickReader,   exitReader },
+    { MODE_EMULATOR,         TASK_TIMEOUT_MS,  enterEmulator,        tickEmulator, exitEmulator },
+    { MODE_TEAM_WAITING,     0,                enterWaiting,         nullptr,      nullptr },
+    { MODE_SPOTLIGHT,        0,                enterSpotlight,       nullptr,      nullptr },
+    { MODE_SCORE_EMULATOR,   0,                enterScoreEmulator,   tickEmulator, exitEmulator },
+    { MODE_SCORE_READER,     TASK_TIMEOUT_MS,  enterScoreReader,     tickReader,   exitReader },
+    { MODE_COOLDOWN,         0,                enterWaiting,         nullptr,      nullptr },
+    { MODE_STOP_HOLD,        STOP_HOLD_MS,     enterStopHold,        nullptr,      nullptr },
+    { MODE_NAME_BLINK,       NAME_BLINK_MS,    enterNameBlink,       nullptr,      nullptr },
+};
+static_assert(sizeof(STATES) / sizeof(STATES[0]) == MODE_COUNT, "STATES must cover every SystemMode");
+
+const SystemMode ANY_MODE = MODE_COUNT;                    // 轉移表: 任何狀態
+const SystemMode STAY = (SystemMode)(MODE_COUNT + 1);      // 轉移表: 只執行動作，不切換狀態
+
+struct Transition {
+    SystemMode state;
+    SlaveEventType event;
+    uint8_t opcode;             // 只對 EVT_COMMAND 有意義
+    SystemMode next;
+    void (*action)(const SlaveEvent& event);
+};
+
+// 由上往下比對，第一個符合的項目生效 (特定狀態的項目需放在 ANY_MODE 之前)
+const Transition TRANSITIONS[] = {
+    // --- 主機指令 ---
+    { MODE_READER,         EVT_COMMAND, OP_STOP,           MODE_IDLE,             nullptr },
+    { MODE_EMULATOR,       EVT_COMMAND, OP_STOP,           MODE_IDLE,             actionEmulatorStopped },
+    { ANY_MODE,            EVT_COMMAND, OP_STOP,           MODE_STOP_HOLD,        nullptr },
+    { MODE_JOINING,        EVT_COMMAND, OP_JOIN_ACK,       MODE_CONFIRM_BLINKING, actionJoinAck },
+    { ANY_MODE,            EVT_COMMAND, OP_JOIN_ACK,       STAY,                  actionJoinAck },
+    { ANY_MODE,            EVT_COMMAND, OP_REMOVE_JOIN,    MODE_JOINING,          actionKicked },
+    { ANY_MODE,            EVT_COMMAND, OP_BLINK_WHITE,    MODE_NAME_BLINK,       nullptr },
+    { ANY_MODE,            EVT_COMMAND, OP_NAME,           STAY,                  actionStoreName },
+    { ANY_MODE,            EVT_COMMAND, OP_TEST_PIPE,      MODE_IDLE,             actionChannelTest },
+    { ANY_MODE,            EVT_COMMAND, OP_READ,           MODE_READER,           actionJoinSession },
+    { ANY_MODE,            EVT_COMMAND, OP_EMULATE,        MODE_EMULATOR,         actionJoinSession },
+    { ANY_MODE,            EVT_COMMAND, OP_TEAM_WAIT,      MODE_TEAM_WAITING,     nullptr },
+    { ANY_MODE,            EVT_COMMAND, OP_SPOTLIGHT,      MODE_SPOTLIGHT,        nullptr },
+    { ANY_MODE,            EVT_COMMAND, OP_SCORE_START,    MODE_SCORE_EMULATOR,   nullptr },
+    { ANY_MODE,            EVT_COMMAND, OP_SCORE_STOP,     MODE_IDLE,             nullptr },
+    { ANY_MODE,            EVT_COMMAND, OP_COOLDOWN_START, MODE_COOLDOWN,         nullptr },
+    { MODE_COOLDOWN,       EVT_COMMAND, OP_COOLDOWN_END,   MODE_SCORE_EMULATOR,   nullptr },
+
+    // --- 積分模式按鈕 ---
+    { MODE_SCORE_EMULATOR, EVT_BUTTON1,  0, MODE_SCORE_READER,   nullptr },
+    { MODE_SCORE_READER,   EVT_BUTTON2,  0, MODE_SCORE_EMULATOR, actionReaderCancelled },
+
+    // --- 讀卡結果 ---
+    { MODE_READER,         EVT_NFC_READ, 0, MODE_IDLE,           actionSendReadResult },
+    { MODE_SCORE_READER,   EVT_NFC_READ, 0, MODE_SCORE_EMULATOR, actionSendReadResult },
+    { MODE_READER,         EVT_NFC_ENCOUNTER, 0, MODE_IDLE,           actionSendEncounter },
+    { MODE_SCORE_READER,   EVT_NFC_ENCOUNTER, 0, MODE_SCORE_EMULATOR, actionSendEncounter },
+
+    // --- 時限 ---
+    { MODE_READER,         EVT_TIMEOUT,  0, MODE_IDLE,           actionSendReadTimeout },
+    { MODE_SCORE_READER,   EVT_TIMEOUT,  0, MODE_SCORE_EMULATOR, nullptr },
+    { ANY_MODE,            EVT_TIMEOUT,  0, MODE_IDLE,           nullptr },
+};
+
+/**
+ * @brief 切換狀態 (依序執行離開與進入動作)。切換到目前狀態不會重新進入
+ */
+void transitionTo(SystemMode next) {
+    if (next == current_mode) return;
+    if (STATES[current_mode].on_exit) STATES[current_mode].on_exit();
+    current_mode = next;
+    mode_enter_time = millis();
+    if (STATES[current_mode].on_enter) STATES[current_mode].on_enter();
+}
+
+/**
+ * @brief 依轉移表處理一個事件；沒有符合的項目時事件被忽略
+ */
+void dispatchEvent(const SlaveEvent& event) {
+    for (const Transition& t : TRANSITIONS) {
+        if (t.state != ANY_MODE && t.state != current_mode) continue;
+        if (t.event != event.type) continue;
+        if (event.type == EVT_COMMAND && t.opcode != event.packet.opcode) continue;
+        if (t.action) t.action(event);
+        if (t.next != STAY) transitionTo(t.next);
+        return;
     }
 }
 
@@ -146,166 +381,36 @@ void main_logic_task(void* pvParameters) {
     unsigned long lastHeartbeatSendTime = 0;
     const unsigned long HEARTBEAT_INTERVAL_MS = 5000;
 
-    for (;;) {
-        button1.read();
-        button2.read();
+    mode_enter_time = millis();
+    if (STATES[current_mode].on_enter) STATES[current_mode].on_enter();
 
-        if (button1_pressed) {
-            button1_pressed = false;
-            if (current_mode == MODE_SCORE_EMULATOR) {
-                current_mode = MODE_SCORE_READER;
-            }
-        }
-        if (button2_pressed) {
-            button2_pressed = false;
-            if (current_mode == MODE_SCORE_READER) {
-                Serial.println("[SYSTEM] Reader mode cancelled by Button 2.");
-                current_mode = MODE_SCORE_EMULATOR;
-            }
+    for (;;) {
+        // 最多等待 LED_TICK_MS；有事件時立即醒來，並依到達順序處理完所有排隊中的事件
+        SlaveEvent event;
+        TickType_t wait = LED_TICK_MS / portTICK_PERIOD_MS;
+        while (xQueueReceive(event_queue, &event, wait) == pdTRUE) {
+            dispatchEvent(event);
+            wait = 0;
         }
 
-        if (stop_signal) {
-            Serial.println("[debug] STOP received; lighting RED for 5s then turning off");
-            leds.showSolidRed();
-            vTaskDelay(5000 / portTICK_PERIOD_MS);
-            leds.turnOff();
-            resetToIdleState();
-            stop_signal = false;
-            continue;
+        const StateDef& state = STATES[current_mode];
+        if (state.timeout_ms > 0 && millis() - mode_enter_time >= state.timeout_ms) {
+            SlaveEvent timeout;
+            timeout.type = EVT_TIMEOUT;
+            dispatchEvent(timeout);
         }
 
-        if (blink_white_pending) {
-            Serial.printf("[debug] ID=%d color=WHITE name=%s (blink ~5s)\n", DEVICE_ID, registered_name.c_str());
-            leds.blinkWhiteForSeconds(5);
-            resetToIdleState();
-            blink_white_pending = false;
-            continue;
-        }
+        button1.read(); // 按下時由 callback 放入事件
+        button2.read();
 
         if (current_mode != MODE_JOINING && current_mode != MODE_CONFIRM_BLINKING) {
             if (millis() - lastHeartbeatSendTime > HEARTBEAT_INTERVAL_MS) {
-                radio.sendResponse("*HEARTBEAT_" + String(DEVICE_ID) + "#");
+                radio.sendResponse(OP_HEARTBEAT);
                 lastHeartbeatSendTime = millis();
             }
         }
 
-        // --- 【關鍵修正】重新組織 switch 結構，確保所有 case 都被正確處理 ---
-        switch (current_mode) {
-            case MODE_JOINING:
-                // 起動直後は赤点灯しJOIN送信（debugログ）
-                Serial.printf("[debug] ID=%d LED=RED sending JOIN\n", DEVICE_ID);
-                leds.showSolidRed();
-                radio.sendJoinRequest(DEVICE_ID);
-                vTaskDelay(500 / portTICK_PERIOD_MS);
-                break;
-            case MODE_CONFIRM_BLINKING:
-                Serial.println("[STATE] ==> Entering Confirm Blinking.");
-                for(int i=0; i<5; i++){
-                    leds.showReaderMode(); vTaskDelay(200 / portTICK_PERIOD_MS);
-                    leds.turnOff(); vTaskDelay(200 / portTICK_PERIOD_MS);
-                }
-                resetToIdleState();
-                break;
-            case MODE_CHANNEL_TEST: {
-                Serial.println("[STATE] ==> Performing Commanded Channel Test.");
-                radio.sendTestPacket(DEVICE_ID);
-                vTaskDelay(100 / portTICK_PERIOD_MS);
-                resetToIdleState();
-                break;
-            }
-            case MODE_IDLE:
-                leds.turnOff();
-                vTaskDelay(100 / portTICK_PERIOD_MS);
-                break;
-            case MODE_TEAM_WAITING:
-                leds.showWaitingMode();
-                vTaskDelay(100 / portTICK_PERIOD_MS);
-                break;
-            case MODE_SPOTLIGHT:
-                leds.showSpotlightMode();
-                vTaskDelay(20 / portTICK_PERIOD_MS);
-                break;
-            case MODE_READER: { // 舊的 1v1 或 Team Building 的 Reader 模式
-                Serial.println("[STATE] ==> Entering Reader Mode (Standard).");
-                leds.showReaderMode();
-                String result = "";
-                bool success = false;
-                unsigned long reader_start_time = millis();
-                while (millis() - reader_start_time < TASK_TIMEOUT_MS) {
-                    if (stop_signal) break;
-                    if (nfc.runReaderTask(result)) { success = true; break; }
-                    vTaskDelay(50 / portTICK_PERIOD_MS);
-                }
-                if(!stop_signal) radio.sendResponse(success ? ("Read " + result) : "Reader Timed Out");
-                resetToIdleState();
-                break;
-            }
-            case MODE_EMULATOR: { // 舊的 1v1 或 Team Building 的 Emulator 模式
-                Serial.println("[STATE] ==> Entering Emulator Mode (Standard).");
-                leds.showEmulatorMode();
-                nfc.initEmulator(DEVICE_ID);
-                unsigned long start_time = millis();
-                while (millis() - start_time < TASK_TIMEOUT_MS) {
-                    if (stop_signal) break;
-                    nfc.emulateOneTick();
-                    vTaskDelay(50 / portTICK_PERIOD_MS);
-                }
-                nfc.releaseEmulator();
-                if (stop_signal) radio.sendResponse("Emulator Stopped ACK");
-                resetToIdleState();
-                break;
-            }
-            
-            // --- 積分模式的狀態處理 ---
-            case MODE_SCORE_EMULATOR:
-                leds.showEmulatorMode(); // 綠燈，等待被感應
-                vTaskDelay(100 / portTICK_PERIOD_MS);
-                break;
-            
-            case MODE_SCORE_READER: {
-                Serial.println("[STATE] ==> Entering Score Reader Mode.");
-                leds.showReaderMode(); // 紅燈，主動讀卡
-                String result = "";
-                bool success = false;
-                unsigned long reader_start_time = millis();
-                
-                while (millis() - reader_start_time < TASK_TIMEOUT_MS) {
-                    if (stop_signal) break;
-                    button2.read();
-                    if (button2_pressed) {
-                        button2_pressed = false;
-                        break; 
-                    }
-                    if (nfc.runReaderTask(result)) {
-                        success = true;
-                        break;
-                    }
-                    vTaskDelay(50 / portTICK_PERIOD_MS);
-                }
-
-                if (success) {
-                    radio.sendResponse("Read " + result);
-                }
-                
-                current_mode = MODE_SCORE_EMULATOR; // 自動回到模擬卡狀態
-                break;
-            }
-
-            case MODE_COOLDOWN:
-                leds.showWaitingMode(); // 黃燈，表示冷卻中
-                vTaskDelay(100 / portTICK_PERIOD_MS);
-                break;
-        }
+        if (STATES[current_mode].on_tick) STATES[current_mode].on_tick();
+        leds.tick();
     }
 }
-
-void resetToIdleState() {
-    if (current_mode != MODE_IDLE) {
-        Serial.println("[STATE] ==> Resetting to IDLE state.");
-    }
-    stop_signal = false;
-    button1_pressed = false; 
-    button2_pressed = false;
-    current_mode = MODE_IDLE;
-    leds.turnOff();
-}
\ No newline at end of file
@@ -0,0 +1,313 @@
+// Medium.cpp
+
+#include "Medium.h"
+#include "SimClock.h"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <chrono>
+
+namespace sim {
+
+namespace {
+
+const uint32_t TX_SETTLE_US = 130;    // PLL 穩定 (standby-I -> TX/RX)
+const uint32_t ACK_TURNAROUND_US = 130;
+
+} // namespace
+
+uint64_t nowUs() {
+    static const auto start = std::chrono::steady_clock::now();
+    return simElapsedUs(start);
+}
+
+Medium::Medium(uint32_t seed) : _rng(seed) {}
+
+void Medium::addRadio(int node, int fd) {
+    Radio& radio = _radios[node];
+    radio.node = node;
+    radio.fd = fd;
+    memset(&radio.state, 0, sizeof(radio.state));
+    for (uint8_t pipe = 0; pipe < NRF_PIPES; ++pipe) {
+        radio.last_sender[pipe] = -1;
+        radio.last_tx_id[pipe] = 0;
+    }
+}
+
+void Medium::setNoise(uint8_t first_channel, uint8_t last_channel, double probability) {
+    _noise_first = first_channel;
+    _noise_last = last_channel;
+    _noise = probability;
+}
+
+// ==================================================================
+// --- 計時器 ---
+// ==================================================================
+void Medium::schedule(uint64_t due_us, std::function<void()> fn) {
+    _timers.push(Timer{due_us, _timer_order++, fn});
+}
+
+void Medium::runTimers() {
+    uint64_t now = nowUs();
+    while (!_timers.empty() && _timers.top().due_us <= now) {
+        std::function<void()> fn = _timers.top().fn;
+        _timers.pop();
+        fn();
+    }
+}
+
+int64_t Medium::usUntilNextTimer() const {
+    if (_timers.empty()) return -1;
+    uint64_t now = nowUs();
+    return _timers.top().due_us > now ? (int64_t)(_timers.top().due_us - now) : 0;
+}
+
+// ==================================================================
+// --- 晶片訊息 ---
+// ==================================================================
+void Medium::onReadable(int node) {
+    Radio& radio = _radios[node];
+    uint8_t buffer[sizeof(MsgState) + 16];
+    for (;;) {
+        ssize_t n = recv(radio.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n <= 0) return;
+        handleMessage(radio, buffer, (size_t)n);
+    }
+}
+
+void Medium::handleMessage(Radio& radio, const uint8_t* buffer, size_t n) {
+    switch (buffer[0]) {
+        case MSG_STATE:
+            if (n >= sizeof(MsgState)) {
+                bool was_listening = radio.has_state && radio.state.listening;
+                uint8_t was_channel = radio.state.channel;
+                memcpy(&radio.state, buffer, sizeof(MsgState));
+                radio.has_state = true;
+                // 開始監聽干擾頻道時的 RPD
+                if (radio.state.listening && (!was_listening || radio.state.channel != was_channel) &&
+                    noisy(radio.state.channel) && std::uniform_real_distribution<double>(0.0, 1.0)(_rng) < _noise) {
+                    MsgCarrier carrier;
+                    carrier.channel = radio.state.channel;
+                    send(radio, &carrier, sizeof(carrier));
+                }
+            }
+            break;
+        case MSG_TX:
+            if (n >= sizeof(MsgTx) && !radio.tx_active) {
+                memcpy(&radio.tx, buffer, sizeof(MsgTx));
+                radio.tx_active = true;
+                radio.retries = 0;
+                radio.tx_id = _next_tx_id++;
+                startAttempt(radio);
+            }
+            break;
+    }
+}
+
+void Medium::send(Radio& radio, const void* msg, size_t len) {
+    ::send(radio.fd, msg, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+// ==================================================================
+// --- 空中 ---
+// ==================================================================
+/**
+ * @brief 佔用頻道一段時間；與同頻道上時間重疊的傳送 (含 ACK) 互相碰撞
+ */
+std::shared_ptr<Medium::Air> Medium::occupy(uint8_t channel, uint64_t start_us, uint64_t end_us) {
+    uint64_t now = nowUs();
+    std::vector<std::shared_ptr<Air>> active;
+    for (auto& air : _air) {
+        if (air->end_us >= now) active.push_back(air);
+    }
+    _air.swap(active);
+
+    auto air = std::make_shared<Air>(Air{channel, start_us, end_us, false});
+    _stats.airtime_us += end_us - start_us;
+    for (auto& other : _air) {
+        if (other->channel == channel && other->start_us < end_us && start_us < other->end_us) {
+            other->collided = true;
+            air->collided = true;
+        }
+    }
+    _air.push_back(air);
+    return air;
+}
+
+// 前導 1 byte + 位址 + 9 bit 封包控制欄位 + payload + CRC16
+uint32_t Medium::airtimeUs(uint8_t data_rate, uint8_t addr_width, uint8_t payload_len) const {
+    uint32_t bits = 8 + addr_width * 8 + 9 + payload_len * 8 + 16;
+    switch (data_rate) {
+        case 1:  return (bits + 1) / 2;   // RF24_2MBPS
+        case 2:  return bits * 4;         // RF24_250KBPS
+        default: return bits;             // RF24_1MBPS
+    }
+}
+
+int Medium::matchPipe(const Radio& rx, const MsgTx& tx) const {
+    const MsgState& state = rx.state;
+    if (!rx.has_state || !state.listening) return -1;
+    if (state.channel != tx.channel || state.data_rate != tx.data_rate || state.addr_width != tx.addr_width) return -1;
+    for (uint8_t pipe = 0; pipe < NRF_PIPES; ++pipe) {
+        if (!(state.en_rxaddr & (1 << pipe))) continue;
+        if (memcmp(state.rx_addr[pipe], tx.addr, tx.addr_width) != 0) continue;
+        bool dynamic = state.dynpd & (1 << pipe);
+        // 寬度不符時接收端的 CRC 會失敗
+        if (dynamic != (bool)tx.dynamic) return -1;
+        if (!dynamic && state.rx_pw[pipe] != tx.len) return -1;
+        return pipe;
+    }
+    return -1;
+}
+
+bool Medium::lost(uint8_t channel) {
+    if (_loss > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(_rng) < _loss) return true;
+    return noisy(channel) && std::uniform_real_distribution<double>(0.0, 1.0)(_rng) < _noise;
+}
+
+void Medium::startAttempt(Radio& sender) {
+    if (!sender.tx_active) return;
+    _stats.attempts++;
+    if (sender.retries == 0) {
+        _stats.frames++;
+        if (_sniffer) _sniffer(sender.node, sender.tx.payload, sender.tx.len, false);
+    }
+    uint64_t start = nowUs() + TX_SETTLE_US;
+    uint64_t end = start + airtimeUs(sender.tx.data_rate, sender.tx.addr_width, sender.tx.len);
+    sender.attempt_start_us = start;
+    auto air = occupy(sender.tx.channel, start, end);
+
+    MsgCarrier carrier;
+    carrier.channel = sender.tx.channel;
+    for (auto& entry : _radios) {
+        Radio& rx = entry.second;
+        if (rx.node != sender.node && rx.has_state && rx.state.listening && rx.state.channel == carrier.channel) {
+            send(rx, &carrier, sizeof(carrier));
+        }
+    }
+
+    int node = sender.node;
+    schedule(end, [this, node, air] { finishAttempt(_radios[node], air); });
+}
+
+/**
+ * @brief 一次傳送結束：交付給位址相符的接收端，需要 ACK 時再模擬 ACK 的空中時間
+ */
+void Medium::finishAttempt(Radio& sender, std::shared_ptr<Air> air) {
+    const MsgTx& tx = sender.tx;
+    std::vector<std::pair<int, int>> ackers;   // (node, pipe)
+
+    if (air->collided) {
+        _stats.collisions++;
+    } else {
+        for (auto& entry : _radios) {
+            Radio& rx = entry.second;
+            if (rx.node == sender.node) continue;
+            int pipe = matchPipe(rx, tx);
+            if (pipe < 0) continue;
+            if (rx.deaf_until_us > nowUs() || lost(tx.channel)) {
+                _stats.losses++;
+                continue;
+            }
+            if (rx.state.rx_full) continue;   // RX FIFO 滿: 不接收也不回 ACK
+
+            // 重送的副本 (同一個 tx_id) 只回 ACK，不再交付
+            if (rx.last_sender[pipe] != sender.node || rx.last_tx_id[pipe] != sender.tx_id) {
+                rx.last_sender[pipe] = sender.node;
+                rx.last_tx_id[pipe] = sender.tx_id;
+                MsgRx msg;
+                msg.pipe = (uint8_t)pipe;
+                msg.len = tx.len;
+                memcpy(msg.payload, tx.payload, tx.len);
+                int rx_node = rx.node;
+                schedule(nowUs() + _latency_us, [this, rx_node, msg] { send(_radios[rx_node], &msg, sizeof(msg)); });
+                _stats.deliveries++;
+            }
+            if (!tx.no_ack && (rx.state.en_aa & (1 << pipe))) ackers.emplace_back(rx.node, pipe);
+        }
+    }
+
+    if (tx.no_ack) {
+        finishTx(sender, true, nullptr, 0);
+        return;
+    }
+
+    int node = sender.node;
+    auto retry = [this, node](uint64_t after_us) {
+        Radio& radio = _radios[node];
+        if (++radio.retries > radio.tx.arc) {
+            radio.retries = radio.tx.arc;
+            finishTx(radio, false, nullptr, 0);
+            return;
+        }
+        uint64_t due = after_us + radio.tx.ard_us;
+        due = due > TX_SETTLE_US ? due - TX_SETTLE_US : due;
+        schedule(due, [this, node] { startAttempt(_radios[node]); });
+    };
+
+    if (ackers.empty()) {
+        retry(air->end_us);
+        return;
+    }
+
+    // 每個 ACK 都佔用頻道；兩台以上同時回 ACK 時彼此碰撞
+    struct Ack {
+        int node;
+        int pipe;
+        std::shared_ptr<Air> air;
+    };
+    auto acks = std::make_shared<std::vector<Ack>>();
+    uint64_t ack_start = air->end_us + ACK_TURNAROUND_US;
+    uint64_t ack_end = ack_start;
+    for (auto& acker : ackers) {
+        const MsgState& state = _radios[acker.first].state;
+        uint8_t ack_len = state.ack_len[acker.second];
+        uint64_t end = ack_start + airtimeUs(tx.data_rate, tx.addr_width, ack_len);
+        acks->push_back(Ack{acker.first, acker.second, occupy(tx.channel, ack_start, end)});
+        if (end > ack_end) ack_end = end;
+    }
+
+    uint8_t channel = tx.channel;
+    schedule(ack_end, [this, node, acks, retry, ack_end, channel] {
+        const Ack* winner = nullptr;
+        for (const Ack& ack : *acks) {
+            if (ack.air->collided) {
+                _stats.collisions++;
+            } else if (!lost(channel)) {
+                winner = &ack;
+            } else {
+                _stats.losses++;
+            }
+        }
+        if (!winner) {
+            retry(ack_end);
+            return;
+        }
+        Radio& acker = _radios[winner->node];
+        uint8_t ack_len = acker.state.ack_len[winner->pipe];
+        if (ack_len > 0) {
+            MsgAckSent sent;
+            sent.pipe = (uint8_t)winner->pipe;
+            send(acker, &sent, sizeof(sent));
+            _stats.ack_payloads++;
+            if (_sniffer) _sniffer(acker.node, acker.state.ack_payload[winner->pipe], ack_len, true);
+        }
+        finishTx(_radios[node], true, acker.state.ack_payload[winner->pipe], ack_len);
+    });
+}
+
+void Medium::finishTx(Radio& sender, bool acked, const uint8_t* ack_payload, uint8_t ack_len) {
+    sender.tx_active = false;
+    if (acked) _stats.acked++;
+    else _stats.failed++;
+
+    MsgTxDone done;
+    done.acked = acked;
+    done.retries = sender.retries;
+    done.ack_len = ack_len;
+    if (ack_len) memcpy(done.ack_payload, ack_payload, ack_len);
+    int node = sender.node;
+    schedule(nowUs() + _latency_us, [this, node, done] { send(_radios[node], &done, sizeof(done)); });
+}
+
+} // namespace sim
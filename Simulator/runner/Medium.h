@@ -0,0 +1,127 @@
+// Medium.h
+//
+// The shared 2.4 GHz medium. Every simulated nRF24 reports its receiver
+// configuration and hands over the frames it transmits; the medium models
+// airtime, same-channel collisions, random loss, extra latency, auto-ack with
+// ARD/ARC retransmits and ACK payloads, and delivers the frames that survive.
+// A noisy channel band (e.g. a Wi-Fi network) drops frames and shows up in
+// the RPD of radios that start listening there.
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "SimMediumProtocol.h"
+
+namespace sim {
+
+// 單調的模擬時鐘 (微秒，見 SimClock.h)
+uint64_t nowUs();
+
+struct MediumStats {
+    uint64_t frames = 0;          // 第一次傳送 (不含重送)
+    uint64_t attempts = 0;        // 含重送
+    uint64_t collisions = 0;      // 因碰撞而失敗的傳送 (含 ACK)
+    uint64_t losses = 0;          // 因隨機遺失而未收到的 (接收端, 傳送) 組合
+    uint64_t deliveries = 0;      // 交給接收端的封包
+    uint64_t acked = 0;
+    uint64_t failed = 0;          // 超過 ARC 仍未收到 ACK
+    uint64_t ack_payloads = 0;    // 隨 ACK 送達的上行封包
+    uint64_t airtime_us = 0;      // 所有封包與 ACK 佔用的空中時間
+};
+
+class Medium {
+public:
+    // sniffer(sender, frame, len, ack_payload): 每個封包第一次上空中時呼叫 (用於統計)；
+    // ACK payload 則在送達傳送端時呼叫
+    typedef std::function<void(int sender, const uint8_t* frame, uint8_t len, bool ack_payload)> Sniffer;
+
+    explicit Medium(uint32_t seed);
+
+    void addRadio(int node, int fd);
+    void setLoss(double probability) { _loss = probability; }
+    void setLatencyUs(uint32_t latency_us) { _latency_us = latency_us; }
+    // 頻道 first..last 上的干擾: 每個 (接收端, 傳送) 以 probability 遺失，在此開始監聽的晶片以同樣機率看到 RPD
+    void setNoise(uint8_t first_channel, uint8_t last_channel, double probability);
+    // node 在 until_us 之前收不到任何封包 (模擬被遮蔽或暫時離開範圍)
+    void setDeaf(int node, uint64_t until_us) { _radios[node].deaf_until_us = until_us; }
+    void setSniffer(Sniffer sniffer) { _sniffer = sniffer; }
+    const MediumStats& stats() const { return _stats; }
+
+    // 由事件迴圈呼叫
+    void onReadable(int node);
+    void runTimers();
+    // 下一個計時器到期前的微秒數 (-1 = 沒有計時器)
+    int64_t usUntilNextTimer() const;
+
+private:
+    struct Air {
+        uint8_t channel;
+        uint64_t start_us;
+        uint64_t end_us;
+        bool collided;
+    };
+
+    struct Radio {
+        int node;
+        int fd;
+        bool has_state = false;
+        MsgState state;
+        // 目前的傳送
+        bool tx_active = false;
+        MsgTx tx;
+        uint8_t retries = 0;
+        uint32_t tx_id = 0;
+        uint64_t attempt_start_us = 0;
+        uint64_t deaf_until_us = 0;
+        // 接收端去重: 每個 pipe 最後交付的 (傳送者, tx_id)
+        int last_sender[NRF_PIPES];
+        uint32_t last_tx_id[NRF_PIPES];
+    };
+
+    struct Timer {
+        uint64_t due_us;
+        uint64_t order;
+        std::function<void()> fn;
+        bool operator<(const Timer& rhs) const {
+            return due_us != rhs.due_us ? due_us > rhs.due_us : order > rhs.order;
+        }
+    };
+
+    void handleMessage(Radio& radio, const uint8_t* buffer, size_t n);
+    void schedule(uint64_t due_us, std::function<void()> fn);
+    void send(Radio& radio, const void* msg, size_t len);
+
+    std::shared_ptr<Air> occupy(uint8_t channel, uint64_t start_us, uint64_t end_us);
+    uint32_t airtimeUs(uint8_t data_rate, uint8_t addr_width, uint8_t payload_len) const;
+    int matchPipe(const Radio& rx, const MsgTx& tx) const;
+    bool lost(uint8_t channel);
+    bool noisy(uint8_t channel) const { return _noise > 0 && channel >= _noise_first && channel <= _noise_last; }
+
+    void startAttempt(Radio& sender);
+    void finishAttempt(Radio& sender, std::shared_ptr<Air> air);
+    void finishTx(Radio& sender, bool acked, const uint8_t* ack_payload, uint8_t ack_len);
+
+    std::map<int, Radio> _radios;
+    std::vector<std::shared_ptr<Air>> _air;
+    std::priority_queue<Timer> _timers;
+    uint64_t _timer_order = 0;
+    uint32_t _next_tx_id = 1;
+
+    std::mt19937 _rng;
+    double _loss = 0.0;
+    uint32_t _latency_us = 0;
+    uint8_t _noise_first = 0;
+    uint8_t _noise_last = 0;
+    double _noise = 0.0;
+    Sniffer _sniffer;
+    MediumStats _stats;
+};
+
+} // namespace sim
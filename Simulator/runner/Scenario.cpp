@@ -0,0 +1,313 @@
+// Scenario.cpp
+
+#include "Scenario.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "Protocol.h"
+
+namespace sim {
+
+namespace {
+
+const char* const JOIN_LINE = "New slave joined! ID: ";
+const char* const DISCOVERY_LINE = "System now in Discovery Mode";
+const char* const HEARTBEAT_LINE = "HB from ID=";
+const uint64_t HEARTBEAT_GRACE_US = 500000;   // 視窗結尾仍在傳送中的心跳不計入
+
+double ms(uint64_t us) {
+    return us / 1000.0;
+}
+
+void printLatencies(const std::string& label, std::vector<uint64_t> samples_us, size_t missing) {
+    if (samples_us.empty()) {
+        printf("[METRIC] %s n=0 missing=%zu\n", label.c_str(), missing);
+        return;
+    }
+    std::sort(samples_us.begin(), samples_us.end());
+    uint64_t sum = 0;
+    for (uint64_t sample : samples_us) sum += sample;
+    auto percentile = [&samples_us](double p) {
+        size_t index = (size_t)(p * (samples_us.size() - 1) + 0.5);
+        return samples_us[index];
+    };
+    printf("[METRIC] %s n=%zu missing=%zu min=%.2f p50=%.2f p95=%.2f max=%.2f avg=%.2f (ms)\n",
+           label.c_str(), samples_us.size(), missing, ms(samples_us.front()), ms(percentile(0.5)),
+           ms(percentile(0.95)), ms(samples_us.back()), ms(sum / samples_us.size()));
+}
+
+} // namespace
+
+bool Scenario::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "sim_runner: cannot open scenario %s\n", path.c_str());
+        return false;
+    }
+    _path = path;
+    std::string text;
+    for (int number = 1; std::getline(file, text); ++number) {
+        // 只有行首的 '#' 是註解 (主機指令本身以 '#' 結尾)
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos || text[first] == '#') continue;
+        std::istringstream words(text);
+        Step step;
+        step.line = number;
+        if (!(words >> step.command)) continue;
+        for (std::string word; words >> word;) step.args.push_back(word);
+        size_t start = text.find(step.command) + step.command.size();
+        step.rest = text.substr(start);
+        _steps.push_back(step);
+    }
+    return true;
+}
+
+bool Scenario::run(Simulation& sim) {
+    markAction(sim);
+    for (const Step& step : _steps) {
+        if (!runStep(sim, step)) fail(step, "invalid arguments");
+    }
+    stepReport(sim);
+    printf("[RESULT] %s: %s (%d failed)\n", _path.c_str(), _failures == 0 ? "PASS" : "FAIL", _failures);
+    return _failures == 0;
+}
+
+void Scenario::fail(const Step& step, const std::string& message) {
+    printf("[FAIL] %s:%d %s: %s\n", _path.c_str(), step.line, step.command.c_str(), message.c_str());
+    _failures++;
+}
+
+void Scenario::markAction(Simulation& sim) {
+    _action_us = nowUs();
+    _marks.assign(sim.slaveIds().size() + 1, 0);
+    for (size_t node = 0; node < _marks.size(); ++node) _marks[node] = sim.lines((int)node).size();
+}
+
+// 主機的輸出以最近一次 UI 指令為起點 (之後的 tap/press 不會移動)
+void Scenario::markSend(Simulation& sim) {
+    markAction(sim);
+    _send_us = _action_us;
+    _send_mark = _marks[Simulation::MASTER];
+}
+
+std::string Scenario::tail(const std::string& text, size_t skip_words) {
+    size_t pos = 0;
+    for (size_t i = 0; i < skip_words; ++i) {
+        pos = text.find_first_not_of(" \t", pos);
+        pos = text.find_first_of(" \t", pos);
+        if (pos == std::string::npos) return "";
+    }
+    pos = text.find_first_not_of(" \t", pos);
+    if (pos == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(pos, end - pos + 1);
+}
+
+std::vector<int> Scenario::parseIds(Simulation& sim, const std::string& spec) const {
+    if (spec == "ALL") return sim.slaveIds();
+    std::vector<int> ids;
+    std::istringstream parts(spec);
+    for (std::string part; std::getline(parts, part, ',');) {
+        size_t dash = part.find('-');
+        int first = atoi(part.c_str());
+        int last = dash == std::string::npos ? first : atoi(part.c_str() + dash + 1);
+        for (int id = first; id <= last; ++id) ids.push_back(id);
+    }
+    return ids;
+}
+
+// ==================================================================
+// --- 指令 ---
+// ==================================================================
+bool Scenario::runStep(Simulation& sim, const Step& step) {
+    const std::vector<std::string>& args = step.args;
+    const std::string& command = step.command;
+
+    if (command == "wait" && args.size() == 1) {
+        sim.runFor(strtoull(args[0].c_str(), nullptr, 10));
+    } else if (command == "send" && !args.empty()) {
+        sim.writeLine(Simulation::MASTER, tail(step.rest, 0));
+        markSend(sim);
+    } else if (command == "tap" && (args.size() == 2 || args.size() == 3)) {
+        for (int id : parseIds(sim, args[0])) sim.writeLine(id, "@sim tap " + tail(step.rest, 1));
+        markAction(sim);
+    } else if (command == "press" && args.size() == 2) {
+        sim.writeLine(atoi(args[0].c_str()), "@sim press " + args[1]);
+        markAction(sim);
+    } else if (command == "expect" && args.size() >= 2) {
+        if (!stepExpect(sim, step)) fail(step, "\"" + tail(step.rest, 1) + "\" not seen");
+    } else if (command == "expect_slaves" && args.size() >= 3) {
+        if (!stepExpectSlaves(sim, step)) fail(step, "not every slave printed \"" + tail(step.rest, 2) + "\"");
+    } else if (command == "joined" && args.size() == 2) {
+        if (!stepJoined(sim, step)) fail(step, "not enough slaves joined");
+    } else if (command == "heartbeats" && args.size() == 1) {
+        if (!stepHeartbeats(sim, step)) fail(step, "no heartbeats on air");
+    } else if (command == "set" && args.size() == 2 && args[0] == "loss") {
+        sim.medium().setLoss(atof(args[1].c_str()));
+    } else if (command == "set" && args.size() == 2 && args[0] == "latency_us") {
+        sim.medium().setLatencyUs((uint32_t)strtoul(args[1].c_str(), nullptr, 10));
+    } else if (command == "set" && args.size() == 4 && args[0] == "noise") {
+        sim.medium().setNoise((uint8_t)atoi(args[1].c_str()), (uint8_t)atoi(args[2].c_str()), atof(args[3].c_str()));
+    } else if (command == "deaf" && args.size() == 2) {
+        uint64_t until = nowUs() + strtoull(args[1].c_str(), nullptr, 10) * 1000;
+        for (int id : parseIds(sim, args[0])) sim.medium().setDeaf(id, until);
+    } else if (command == "report" && args.empty()) {
+        stepReport(sim);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::stepExpect(Simulation& sim, const Step& step) {
+    uint64_t timeout_ms = strtoull(step.args[0].c_str(), nullptr, 10);
+    std::string text = tail(step.rest, 1);
+    uint64_t seen_us = 0;
+    bool ok = sim.runUntil(timeout_ms, [&] {
+        const std::vector<Line>& lines = sim.lines(Simulation::MASTER);
+        for (size_t i = _send_mark; i < lines.size(); ++i) {
+            if (lines[i].text.find(text) != std::string::npos) {
+                seen_us = lines[i].time_us;
+                return true;
+            }
+        }
+        return false;
+    });
+    if (ok) printf("[METRIC] expect \"%s\" latency=%.2f ms\n", text.c_str(), ms(seen_us - _send_us));
+    return ok;
+}
+
+/**
+ * @brief 指令延遲: 從最近一次動作 (通常是 send) 到每台目標從機印出指定文字的時間
+ */
+bool Scenario::stepExpectSlaves(Simulation& sim, const Step& step) {
+    uint64_t timeout_ms = strtoull(step.args[0].c_str(), nullptr, 10);
+    std::vector<int> ids = parseIds(sim, step.args[1]);
+    std::string text = tail(step.rest, 2);
+    std::map<int, uint64_t> seen;   // id -> 時間
+
+    sim.runUntil(timeout_ms, [&] {
+        for (int id : ids) {
+            if (seen.count(id) || id >= (int)_marks.size()) continue;
+            const std::vector<Line>& lines = sim.lines(id);
+            for (size_t i = _marks[id]; i < lines.size(); ++i) {
+                if (lines[i].text.find(text) != std::string::npos) {
+                    seen[id] = lines[i].time_us;
+                    break;
+                }
+            }
+        }
+        return seen.size() == ids.size();
+    });
+
+    std::vector<uint64_t> latencies;
+    for (const auto& entry : seen) latencies.push_back(entry.second - _action_us);
+    printLatencies("command_latency \"" + text + "\"", latencies, ids.size() - seen.size());
+    if (seen.size() != ids.size()) {
+        printf("[INFO] missing:");
+        for (int id : ids) {
+            if (!seen.count(id)) printf(" %d", id);
+        }
+        printf("\n");
+    }
+    return seen.size() == ids.size();
+}
+
+/**
+ * @brief 發現時間: 從主機進入發現模式到第 count 台從機加入
+ */
+bool Scenario::stepJoined(Simulation& sim, const Step& step) {
+    size_t wanted = step.args[0] == "ALL" ? sim.slaveIds().size() : strtoul(step.args[0].c_str(), nullptr, 10);
+    uint64_t timeout_ms = strtoull(step.args[1].c_str(), nullptr, 10);
+    std::set<int> joined;
+    uint64_t discovery_start_us = 0;
+    uint64_t last_join_us = 0;
+
+    bool ok = sim.runUntil(timeout_ms, [&] {
+        joined.clear();
+        const std::vector<Line>& lines = sim.lines(Simulation::MASTER);
+        for (const Line& line : lines) {
+            if (line.text.find(DISCOVERY_LINE) != std::string::npos && discovery_start_us == 0) {
+                discovery_start_us = line.time_us;
+            }
+            size_t pos = line.text.find(JOIN_LINE);
+            if (pos == std::string::npos) continue;
+            if (joined.insert(atoi(line.text.c_str() + pos + strlen(JOIN_LINE))).second) {
+                last_join_us = line.time_us;
+                if (joined.size() == wanted) return true;
+            }
+        }
+        return false;
+    });
+
+    double discovery_ms = discovery_start_us && last_join_us ? ms(last_join_us - discovery_start_us) : -1.0;
+    printf("[METRIC] discovery joined=%zu/%zu time=%.2f ms\n", joined.size(), wanted, discovery_ms);
+    return ok;
+}
+
+/**
+ * @brief 心跳遺失率: 視窗內從機送上空中的心跳 vs 主機實際處理的心跳 (依來源 ID 配對)
+ */
+bool Scenario::stepHeartbeats(Simulation& sim, const Step& step) {
+    uint64_t window_ms = strtoull(step.args[0].c_str(), nullptr, 10);
+    uint64_t start_us = nowUs();
+    size_t master_mark = sim.lines(Simulation::MASTER).size();
+    size_t sniff_mark = sim.sniffed().size();
+    sim.runFor(window_ms);
+    uint64_t end_us = nowUs();
+
+    std::map<int, uint32_t> sent, heard;
+    const auto& sniffed = sim.sniffed();
+    for (size_t i = sniff_mark; i < sniffed.size(); ++i) {
+        if (sniffed[i].opcode == OP_HEARTBEAT && sniffed[i].time_us + HEARTBEAT_GRACE_US <= end_us) {
+            sent[sniffed[i].source]++;
+        }
+    }
+    const std::vector<Line>& lines = sim.lines(Simulation::MASTER);
+    for (size_t i = master_mark; i < lines.size(); ++i) {
+        size_t pos = lines[i].text.find(HEARTBEAT_LINE);
+        if (pos != std::string::npos) heard[atoi(lines[i].text.c_str() + pos + strlen(HEARTBEAT_LINE))]++;
+    }
+
+    uint32_t total_sent = 0, total_heard = 0;
+    for (const auto& entry : sent) {
+        total_sent += entry.second;
+        total_heard += std::min(entry.second, heard[entry.first]);
+    }
+    double loss = total_sent ? 100.0 * (total_sent - total_heard) / total_sent : 0.0;
+    printf("[METRIC] heartbeats window=%.0f ms slaves=%zu sent=%u heard=%u loss=%.2f%%\n",
+           ms(end_us - start_us), sent.size(), total_sent, total_heard, loss);
+    return total_sent > 0;
+}
+
+void Scenario::stepReport(Simulation& sim) {
+    const MediumStats& stats = sim.medium().stats();
+    printf("[METRIC] medium frames=%llu attempts=%llu deliveries=%llu acked=%llu failed=%llu collisions=%llu losses=%llu\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.attempts,
+           (unsigned long long)stats.deliveries, (unsigned long long)stats.acked, (unsigned long long)stats.failed,
+           (unsigned long long)stats.collisions, (unsigned long long)stats.losses);
+
+    uint32_t slave_tx = 0;
+    for (const auto& frame : sim.sniffed()) {
+        if (frame.node != Simulation::MASTER && !frame.ack_payload) slave_tx++;
+    }
+    uint64_t exchanges = stats.frames + stats.ack_payloads;
+    printf("[METRIC] airtime total=%.1f ms per_frame=%.1f us ack_payloads=%llu slave_tx=%u\n",
+           stats.airtime_us / 1000.0, exchanges ? (double)stats.airtime_us / exchanges : 0.0,
+           (unsigned long long)stats.ack_payloads, slave_tx);
+
+    std::map<uint8_t, uint32_t> by_opcode;
+    for (const auto& frame : sim.sniffed()) by_opcode[frame.opcode]++;
+    printf("[METRIC] frames_by_opcode");
+    for (const auto& entry : by_opcode) printf(" %s=%u", protocolOpcodeName(entry.first), entry.second);
+    printf("\n");
+}
+
+} // namespace sim
@@ -0,0 +1,70 @@
+// Scenario.h
+//
+// Line-based scenario scripts for sim_runner (lines starting with '#' are comments):
+//
+//   wait <ms>                          let the simulation run
+//   send <text>                        write a line to the master's Serial (as the UI does)
+//   tap <ids> <uid hex> [hold_ms]      put a card on the PN532 of every slave in <ids>
+//   press <id> <pin>                   press and release a button on slave <id>
+//   expect <ms> <text>                 master prints <text> after the last send (waits up to <ms>)
+//   expect_slaves <ms> <ids> <text>    every slave in <ids> prints <text> (command latency)
+//   joined <count|ALL> <ms>            master reports that many joins (discovery time)
+//   heartbeats <ms>                    heartbeats on air vs. heard by the master (loss)
+//   set loss <p> | set latency_us <us> change the medium on the fly
+//   set noise <first> <last> <p>       interference on channels first..last (p = 0 turns it off)
+//   deaf <ids> <ms>                    slaves in <ids> receive nothing for <ms>
+//   report                             medium counters
+//
+// <ids> is ALL, a list "1,4,7" or a range "1-10". Measurements are printed as
+// "[METRIC] ..." lines; a failed expectation prints "[FAIL] ..." and makes
+// the run exit non-zero.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+
+namespace sim {
+
+class Scenario {
+public:
+    bool load(const std::string& path);
+    // 回傳所有 expectation 是否成立
+    bool run(Simulation& sim);
+
+private:
+    struct Step {
+        int line;
+        std::string command;
+        std::vector<std::string> args;   // 以空白分隔
+        std::string rest;                // 第 n 個參數之後的原始文字由各指令自行取用
+    };
+
+    bool runStep(Simulation& sim, const Step& step);
+    void markAction(Simulation& sim);
+    void markSend(Simulation& sim);
+    std::vector<int> parseIds(Simulation& sim, const std::string& spec) const;
+    static std::string tail(const std::string& text, size_t skip_words);
+    void fail(const Step& step, const std::string& message);
+
+    bool stepExpect(Simulation& sim, const Step& step);
+    bool stepExpectSlaves(Simulation& sim, const Step& step);
+    bool stepJoined(Simulation& sim, const Step& step);
+    bool stepHeartbeats(Simulation& sim, const Step& step);
+    void stepReport(Simulation& sim);
+
+    std::vector<Step> _steps;
+    std::string _path;
+    int _failures = 0;
+
+    // 最近一次動作 (send/tap/press) 的時間與各節點當時的輸出行數
+    uint64_t _action_us = 0;
+    std::vector<size_t> _marks;
+    // 最近一次 send 的時間與主機當時的輸出行數 (expect 的起點)
+    uint64_t _send_us = 0;
+    size_t _send_mark = 0;
+};
+
+} // namespace sim
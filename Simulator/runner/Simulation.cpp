@@ -0,0 +1,220 @@
+// Simulation.cpp
+
+#include "Simulation.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Protocol.h"
+#include "SimClock.h"
+
+namespace sim {
+
+namespace {
+
+const int CHILD_RADIO_FD = 3;
+
+} // namespace
+
+Simulation::Simulation(const SimOptions& options) : _options(options), _medium(options.seed) {
+    _medium.setLoss(options.loss);
+    _medium.setLatencyUs(options.latency_us);
+    _medium.setSniffer([this](int node, const uint8_t* frame, uint8_t len, bool ack_payload) {
+        Packet packet;
+        if (decodePacket(frame, len, packet)) {
+            _sniffed.push_back(Sniffed{nowUs(), node, packet.opcode, packet.source, ack_payload});
+        }
+    });
+}
+
+Simulation::~Simulation() {
+    stop();
+}
+
+bool Simulation::start() {
+    signal(SIGPIPE, SIG_IGN);
+    mkdir(_options.log_dir.c_str(), 0755);
+
+    // 從機之間的 NFC 感應區 (見 stubs/PN532_SPI.h)，清掉上一次執行留下的檔案
+    std::string field = _options.log_dir + "/nfc_field";
+    mkdir(field.c_str(), 0755);
+    if (DIR* dir = opendir(field.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') unlink((field + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    setenv("SIM_NFC_FIELD", field.c_str(), 1);
+
+    Node& master = _nodes[MASTER];
+    master.id = MASTER;
+    if (!spawn(master, _options.master_path)) return false;
+    for (int id = 1; id <= _options.slaves; ++id) {
+        Node& slave = _nodes[id];
+        slave.id = id;
+        if (!spawn(slave, _options.slave_path)) return false;
+    }
+    return true;
+}
+
+bool Simulation::spawn(Node& node, const std::string& path) {
+    int radio[2], in[2], out[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, radio) != 0 ||
+        pipe2(in, O_CLOEXEC) != 0 || pipe2(out, O_CLOEXEC) != 0) {
+        perror("sim_runner: socketpair/pipe");
+        return false;
+    }
+
+    std::string name = node.id == MASTER ? "master" : "slave_" + std::to_string(node.id);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("sim_runner: fork");
+        return false;
+    }
+    if (pid == 0) {
+        // dup2 之後的 fd 不帶 CLOEXEC，其餘 (包含其他節點的) fd 在 exec 時關閉
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        dup2(out[1], STDERR_FILENO);
+        dup2(radio[1], CHILD_RADIO_FD);
+        setenv("SIM_RADIO_FD", std::to_string(CHILD_RADIO_FD).c_str(), 1);
+        setenv("SIM_DEVICE_ID", std::to_string(node.id).c_str(), 1);
+        setenv("SIM_SEED", std::to_string(_options.seed).c_str(), 1);
+        execl(path.c_str(), path.c_str(), (char*)nullptr);
+        fprintf(stderr, "sim_runner: cannot exec %s: %s\n", path.c_str(), strerror(errno));
+        _exit(127);
+    }
+
+    close(radio[1]);
+    close(in[0]);
+    close(out[1]);
+    node.pid = pid;
+    node.radio_fd = radio[0];
+    node.stdin_fd = in[1];
+    node.stdout_fd = out[0];
+    fcntl(node.stdout_fd, F_SETFL, O_NONBLOCK);
+    node.log = fopen((_options.log_dir + "/" + name + ".log").c_str(), "w");
+    _medium.addRadio(node.id, node.radio_fd);
+    return true;
+}
+
+void Simulation::stop() {
+    // 關閉 stdin 時子行程會自行結束；來不及結束的再送 SIGTERM
+    for (auto& entry : _nodes) {
+        Node& node = entry.second;
+        if (node.stdin_fd >= 0) close(node.stdin_fd);
+        node.stdin_fd = -1;
+    }
+    for (auto& entry : _nodes) {
+        Node& node = entry.second;
+        if (node.pid > 0) {
+            kill(node.pid, SIGTERM);
+            waitpid(node.pid, nullptr, 0);
+            node.pid = -1;
+        }
+        if (node.radio_fd >= 0) close(node.radio_fd);
+        if (node.stdout_fd >= 0) close(node.stdout_fd);
+        if (node.log) fclose(node.log);
+        node.radio_fd = node.stdout_fd = -1;
+        node.log = nullptr;
+    }
+}
+
+std::vector<int> Simulation::slaveIds() const {
+    std::vector<int> ids;
+    for (const auto& entry : _nodes) {
+        if (entry.first != MASTER) ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+void Simulation::writeLine(int node, const std::string& text) {
+    auto it = _nodes.find(node);
+    std::string line = text + "\n";
+    if (it == _nodes.end() || it->second.stdin_fd < 0 ||
+        write(it->second.stdin_fd, line.data(), line.size()) != (ssize_t)line.size()) {
+        fprintf(stderr, "sim_runner: failed to write to node %d\n", node);
+        return;
+    }
+    Node& target = it->second;
+    if (target.log) fprintf(target.log, "[%10.3f] <<< %s\n", nowUs() / 1000.0, text.c_str());
+}
+
+// ==================================================================
+// --- 事件迴圈 ---
+// ==================================================================
+bool Simulation::runUntil(uint64_t timeout_ms, std::function<bool()> done) {
+    uint64_t deadline = nowUs() + timeout_ms * 1000;
+    for (;;) {
+        if (done()) return true;
+        uint64_t now = nowUs();
+        if (now >= deadline) return false;
+        int64_t wait_us = (int64_t)(deadline - now);
+        int64_t timer_us = _medium.usUntilNextTimer();
+        if (timer_us >= 0 && timer_us < wait_us) wait_us = timer_us;
+        pollOnce((int)std::min<int64_t>(wait_us, 100000));
+    }
+}
+
+void Simulation::pollOnce(int timeout_us) {
+    std::vector<pollfd> fds;
+    std::vector<std::pair<int, bool>> owners;   // (node, 是否為 radio)
+    for (auto& entry : _nodes) {
+        Node& node = entry.second;
+        if (node.radio_fd >= 0) {
+            fds.push_back(pollfd{node.radio_fd, POLLIN, 0});
+            owners.emplace_back(node.id, true);
+        }
+        if (node.stdout_fd >= 0) {
+            fds.push_back(pollfd{node.stdout_fd, POLLIN, 0});
+            owners.emplace_back(node.id, false);
+        }
+    }
+
+    // timeout_us 為模擬時間
+    int64_t host_us = hostDuration((uint64_t)timeout_us).count();
+    timespec timeout = {(time_t)(host_us / 1000000), (long)(host_us % 1000000) * 1000};
+    int ready = ppoll(fds.data(), fds.size(), &timeout, nullptr);
+    if (ready > 0) {
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (owners[i].second) _medium.onReadable(owners[i].first);
+            else readOutput(_nodes[owners[i].first]);
+        }
+    }
+    _medium.runTimers();
+}
+
+void Simulation::readOutput(Node& node) {
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = read(node.stdout_fd, buffer, sizeof(buffer));
+        if (n == 0) {
+            close(node.stdout_fd);
+            node.stdout_fd = -1;
+            return;
+        }
+        if (n < 0) return;
+
+        node.partial.append(buffer, n);
+        size_t newline;
+        while ((newline = node.partial.find('\n')) != std::string::npos) {
+            Line line{nowUs(), node.partial.substr(0, newline)};
+            node.partial.erase(0, newline + 1);
+            if (!line.text.empty() && line.text.back() == '\r') line.text.pop_back();
+            if (node.log) fprintf(node.log, "[%10.3f] %s\n", line.time_us / 1000.0, line.text.c_str());
+            if (_options.verbose && node.id == MASTER) printf("[master %10.3f] %s\n", line.time_us / 1000.0, line.text.c_str());
+            node.lines.push_back(line);
+        }
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,91 @@
+// Simulation.h
+//
+// One master and N slave firmware processes attached to a shared Medium.
+// Each process gets its own socketpair to the medium plus piped stdin/stdout;
+// every output line is time-stamped, kept for the scenario and written to
+// <log_dir>/<name>.log.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Medium.h"
+
+namespace sim {
+
+struct SimOptions {
+    int slaves = 50;
+    double loss = 0.0;
+    uint32_t latency_us = 0;
+    uint32_t seed = 1;
+    uint32_t time_scale = 0;         // 模擬時間比主機時間慢幾倍 (0 = 依從機數與核心數決定)
+    std::string log_dir = "sim_logs";
+    std::string master_path;
+    std::string slave_path;
+    bool verbose = false;            // 主機輸出同時印到 stdout
+};
+
+struct Line {
+    uint64_t time_us;
+    std::string text;
+};
+
+class Simulation {
+public:
+    static constexpr int MASTER = 0;
+
+    explicit Simulation(const SimOptions& options);
+    ~Simulation();
+
+    bool start();
+    void stop();
+
+    // 執行事件迴圈直到 done() 為真或超過 timeout_ms；回傳 done() 的結果
+    bool runUntil(uint64_t timeout_ms, std::function<bool()> done);
+    void runFor(uint64_t ms) { runUntil(ms, [] { return false; }); }
+
+    void writeLine(int node, const std::string& text);
+    const std::vector<Line>& lines(int node) const { return _nodes.at(node).lines; }
+    std::vector<int> slaveIds() const;
+
+    Medium& medium() { return _medium; }
+
+    // 空中攔截到的封包 (第一次傳送)，依來源 ID 與 opcode 計數
+    struct Sniffed {
+        uint64_t time_us;
+        int node;
+        uint8_t opcode;
+        uint8_t source;
+        bool ack_payload;   // 隨 ACK 送達 (從機不需切換到 TX)
+    };
+    const std::vector<Sniffed>& sniffed() const { return _sniffed; }
+
+private:
+    struct Node {
+        int id;
+        pid_t pid = -1;
+        int radio_fd = -1;
+        int stdin_fd = -1;
+        int stdout_fd = -1;
+        std::string partial;
+        std::vector<Line> lines;
+        FILE* log = nullptr;
+    };
+
+    bool spawn(Node& node, const std::string& path);
+    void pollOnce(int timeout_us);
+    void readOutput(Node& node);
+
+    SimOptions _options;
+    Medium _medium;
+    std::map<int, Node> _nodes;
+    std::vector<Sniffed> _sniffed;
+};
+
+} // namespace sim
@@ -0,0 +1,85 @@
+// main.cpp (sim_runner)
+//
+// Usage: sim_runner [--slaves N] [--loss P] [--latency-us US] [--seed S]
+//                   [--time-scale X] [--log-dir DIR] [--master PATH]
+//                   [--slave PATH] [--verbose] scenario.sim
+//
+// Starts the master and N slave firmware processes on a simulated medium and
+// runs the scenario against them. Exits 1 if any expectation failed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+#include "Scenario.h"
+#include "Simulation.h"
+
+namespace {
+
+void usage() {
+    fprintf(stderr,
+            "usage: sim_runner [--slaves N] [--loss P] [--latency-us US] [--seed S] [--time-scale X]\n"
+            "                  [--log-dir DIR] [--master PATH] [--slave PATH] [--verbose] scenario.sim\n");
+}
+
+// 每個主機核心大約能讓 SLAVES_PER_CORE 台從機跟上即時的毫秒級時序
+const int SLAVES_PER_CORE = 8;
+
+uint32_t defaultTimeScale(int slaves) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    long scale = (slaves + 1 + cores * SLAVES_PER_CORE - 1) / (cores * SLAVES_PER_CORE);
+    return (uint32_t)(scale > 1 ? scale : 1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    sim::SimOptions options;
+    options.master_path = SIM_MASTER_PATH;
+    options.slave_path = SIM_SLAVE_PATH;
+    std::string scenario_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--slaves" && has_value) options.slaves = atoi(argv[++i]);
+        else if (arg == "--loss" && has_value) options.loss = atof(argv[++i]);
+        else if (arg == "--latency-us" && has_value) options.latency_us = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--seed" && has_value) options.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--time-scale" && has_value) options.time_scale = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--log-dir" && has_value) options.log_dir = argv[++i];
+        else if (arg == "--master" && has_value) options.master_path = argv[++i];
+        else if (arg == "--slave" && has_value) options.slave_path = argv[++i];
+        else if (arg == "--verbose") options.verbose = true;
+        else if (arg[0] != '-' && scenario_path.empty()) scenario_path = arg;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (scenario_path.empty() || options.slaves < 1 || options.slaves > 200) {
+        usage();
+        return 2;
+    }
+
+    sim::Scenario scenario;
+    if (!scenario.load(scenario_path)) return 2;
+
+    // 必須在第一次讀取時鐘之前設定；子行程繼承同一個值
+    if (options.time_scale == 0) options.time_scale = defaultTimeScale(options.slaves);
+    setenv("SIM_TIME_SCALE", std::to_string(options.time_scale).c_str(), 1);
+
+    printf("[SIM] master + %d slaves, loss=%.3f, latency=%u us, seed=%u, time scale=%ux, logs in %s/\n",
+           options.slaves, options.loss, options.latency_us, options.seed, options.time_scale,
+           options.log_dir.c_str());
+    sim::Simulation simulation(options);
+    if (!simulation.start()) return 2;
+    bool ok = scenario.run(simulation);
+    simulation.stop();
+    return ok ? 0 : 1;
+}
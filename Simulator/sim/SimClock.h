@@ -0,0 +1,45 @@
+// SimClock.h
+//
+// Simulated time shared by sim_runner and the firmware processes. It runs
+// SIM_TIME_SCALE times slower than the host clock (sim_runner --time-scale,
+// inherited by every node), so 51 processes on a small host still keep up
+// with the firmware's millisecond timing: millis(), delay(), FreeRTOS ticks,
+// the medium's airtime and the scenario timeouts all use this clock.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+namespace sim {
+
+// 模擬時間比主機時間慢幾倍 (1 = 即時)
+inline uint32_t timeScale() {
+    static const uint32_t scale = [] {
+        const char* env = getenv("SIM_TIME_SCALE");
+        int value = env ? atoi(env) : 1;
+        return (uint32_t)(value > 0 ? value : 1);
+    }();
+    return scale;
+}
+
+// 模擬時間 -> 主機時間
+inline std::chrono::microseconds hostDuration(uint64_t sim_us) {
+    return std::chrono::microseconds(sim_us * timeScale());
+}
+
+// 自 since 以來經過的模擬時間 (微秒)
+inline uint64_t simElapsedUs(std::chrono::steady_clock::time_point since) {
+    uint64_t host_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - since).count();
+    return host_us / timeScale();
+}
+
+// 睡眠一段模擬時間
+inline void sleepSimUs(uint64_t sim_us) {
+    std::this_thread::sleep_for(hostDuration(sim_us));
+}
+
+} // namespace sim
@@ -0,0 +1,80 @@
+// SimMediumProtocol.h
+//
+// Messages exchanged between a simulated nRF24L01+ (SimNrf24, inside each
+// firmware process) and the shared 2.4 GHz medium (inside sim_runner).
+// Every message is one SOCK_SEQPACKET datagram; both sides are built from
+// this header so the structs are sent as-is.
+
+#pragma once
+#include <stdint.h>
+
+namespace sim {
+
+const uint8_t NRF_MAX_PAYLOAD = 32;
+const uint8_t NRF_PIPES = 6;
+
+enum MsgType : uint8_t {
+    MSG_STATE = 1,   // chip -> medium: receiver configuration changed
+    MSG_TX,          // chip -> medium: a frame left the TX FIFO
+    MSG_RX,          // medium -> chip: a frame was received on a pipe
+    MSG_TX_DONE,     // medium -> chip: ACK received (or MAX_RT) for the last MSG_TX
+    MSG_ACK_SENT,    // medium -> chip: the head ACK payload of a pipe was sent
+    MSG_CARRIER      // medium -> chip: energy seen on the listening channel (RPD)
+};
+
+struct MsgState {
+    MsgType type = MSG_STATE;
+    uint8_t listening;                 // PWR_UP && PRIM_RX && CE
+    uint8_t channel;
+    uint8_t data_rate;                 // rf24_datarate_e
+    uint8_t addr_width;
+    uint8_t en_rxaddr;
+    uint8_t en_aa;
+    uint8_t dynpd;                     // pipes with dynamic payload length
+    uint8_t rx_full;                   // RX FIFO full: frames are neither stored nor ACKed
+    uint8_t rx_addr[NRF_PIPES][5];     // full addresses (pipes 2..5 share bytes 1..4 with pipe 1)
+    uint8_t rx_pw[NRF_PIPES];
+    uint8_t ack_len[NRF_PIPES];        // head of the ACK payload queue per pipe (0 = none)
+    uint8_t ack_payload[NRF_PIPES][NRF_MAX_PAYLOAD];
+};
+
+struct MsgTx {
+    MsgType type = MSG_TX;
+    uint8_t channel;
+    uint8_t data_rate;
+    uint8_t addr_width;
+    uint8_t addr[5];
+    uint8_t dynamic;                   // sender uses dynamic payload length
+    uint8_t no_ack;
+    uint8_t arc;                       // auto retransmit count
+    uint16_t ard_us;                   // auto retransmit delay
+    uint8_t len;
+    uint8_t payload[NRF_MAX_PAYLOAD];
+};
+
+struct MsgRx {
+    MsgType type = MSG_RX;
+    uint8_t pipe;
+    uint8_t len;
+    uint8_t payload[NRF_MAX_PAYLOAD];
+};
+
+struct MsgTxDone {
+    MsgType type = MSG_TX_DONE;
+    uint8_t acked;
+    uint8_t retries;
+    uint8_t ack_len;                   // ACK payload carried back (0 = none)
+    uint8_t ack_payload[NRF_MAX_PAYLOAD];
+};
+
+struct MsgAckSent {
+    MsgType type = MSG_ACK_SENT;
+    uint8_t pipe;
+};
+
+struct MsgCarrier {
+    MsgType type = MSG_CARRIER;
+    uint8_t channel;
+};
+
+} // namespace sim
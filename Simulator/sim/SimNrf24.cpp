@@ -0,0 +1,391 @@
+// SimNrf24.cpp
+
+#include "SimNrf24.h"
+
+#include <Arduino.h>
+#include <nRF24L01.h>
+#include <RF24.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sim {
+
+SimNrf24::SimNrf24(uint8_t ce_pin, uint8_t csn_pin, int irq_pin, int medium_fd)
+    : _ce_pin(ce_pin), _irq_pin(irq_pin), _fd(medium_fd), _status_flags(0), _ce(false), _tx_busy(false),
+      _reuse_tx(false), _rpd(false), _selected(false), _command(RF24_NOP), _index(0), _irq_low(false),
+      _state_sent(false) {
+    // 上電預設值 (datasheet 9.1)
+    memset(_regs, 0, sizeof(_regs));
+    _regs[NRF_CONFIG] = 0x08;
+    _regs[EN_AA] = 0x3F;
+    _regs[EN_RXADDR] = 0x03;
+    _regs[SETUP_AW] = 0x03;
+    _regs[SETUP_RETR] = 0x03;
+    _regs[RF_CH] = 0x02;
+    _regs[RF_SETUP] = 0x0E;
+    _regs[RX_ADDR_P2] = 0xC3;
+    _regs[RX_ADDR_P3] = 0xC4;
+    _regs[RX_ADDR_P4] = 0xC5;
+    _regs[RX_ADDR_P5] = 0xC6;
+    memset(_rx_addr_p0, 0xE7, sizeof(_rx_addr_p0));
+    memset(_rx_addr_p1, 0xC2, sizeof(_rx_addr_p1));
+    memset(_tx_addr, 0xE7, sizeof(_tx_addr));
+    memset((void*)&_last_state, 0, sizeof(_last_state));
+
+    attachSpiDevice(csn_pin, this);
+    onPinWrite(ce_pin, [this](uint8_t level) { onCe(level); });
+    if (_irq_pin >= 0) driveInputPin((uint8_t)_irq_pin, HIGH);
+    if (_fd >= 0) {
+        _thread = std::thread(&SimNrf24::mediumThread, this);
+        _thread.detach();
+    }
+}
+
+// ==================================================================
+// --- SPI ---
+// ==================================================================
+void SimNrf24::select(bool selected) {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (selected) {
+            _selected = true;
+            _command = RF24_NOP;
+            _index = 0xFF;          // 0xFF = 尚未收到指令位元組
+            return;
+        }
+        if (!_selected) return;
+        _selected = false;
+        if (_index != 0xFF) finishCommand();
+        publishState();
+    }
+    updateIrq();
+}
+
+uint8_t SimNrf24::transfer(uint8_t out) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_selected) return 0xFF;
+    if (_index == 0xFF) {
+        _command = out;
+        _index = 0;
+        return status();
+    }
+
+    uint8_t index = _index;
+    if (_index < NRF_MAX_PAYLOAD) _index++;
+
+    if (_command < W_REGISTER) {
+        return readRegisterByte(_command & REGISTER_MASK, index);
+    }
+    if (_command == R_RX_PAYLOAD) {
+        return (!_rx_fifo.empty() && index < NRF_MAX_PAYLOAD) ? _rx_fifo.front().data[index] : 0;
+    }
+    if (_command == R_RX_PL_WID) {
+        return _rx_fifo.empty() ? 0 : _rx_fifo.front().len;
+    }
+    // W_REGISTER / W_TX_PAYLOAD / W_TX_PAYLOAD_NO_ACK / W_ACK_PAYLOAD: 交易結束時才套用
+    if (index < NRF_MAX_PAYLOAD) _buffer[index] = out;
+    return 0;
+}
+
+void SimNrf24::finishCommand() {
+    uint8_t command = _command;
+    if (command >= W_REGISTER && command < W_REGISTER + 0x20) {
+        if (_index > 0) writeRegister(command & REGISTER_MASK, _buffer, _index);
+        return;
+    }
+
+    switch (command) {
+        case R_RX_PAYLOAD:
+            if (_index > 0 && !_rx_fifo.empty()) _rx_fifo.pop_front();
+            break;
+        case W_TX_PAYLOAD:
+        case W_TX_PAYLOAD_NO_ACK:
+            if (_index > 0 && _tx_fifo.size() < FIFO_DEPTH) {
+                Fifo item = {};
+                item.len = _index;
+                memcpy(item.data, _buffer, _index);
+                item.no_ack = command == W_TX_PAYLOAD_NO_ACK && (_regs[FEATURE] & _BV(EN_DYN_ACK));
+                _tx_fifo.push_back(item);
+                _reuse_tx = false;
+                maybeStartTx();
+            }
+            break;
+        case FLUSH_TX:
+            _tx_fifo.clear();
+            _reuse_tx = false;
+            break;
+        case FLUSH_RX:
+            _rx_fifo.clear();
+            break;
+        case REUSE_TX_PL:
+            _reuse_tx = true;
+            break;
+        default:
+            if ((command & 0xF8) == W_ACK_PAYLOAD && _index > 0 && _tx_fifo.size() < FIFO_DEPTH) {
+                Fifo item = {};
+                item.len = _index;
+                memcpy(item.data, _buffer, _index);
+                item.pipe = command & 0x07;
+                item.ack_payload = true;
+                _tx_fifo.push_back(item);
+            }
+            break;
+    }
+}
+
+void SimNrf24::writeRegister(uint8_t reg, const uint8_t* data, uint8_t len) {
+    switch (reg) {
+        case NRF_STATUS:
+            _status_flags &= (uint8_t)~(data[0] & (_BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT)));
+            maybeStartTx();     // 清除 MAX_RT 後 TX FIFO 中的封包可以再次送出
+            break;
+        case RX_ADDR_P0:
+            memcpy(_rx_addr_p0, data, len < 5 ? len : 5);
+            break;
+        case RX_ADDR_P1:
+            memcpy(_rx_addr_p1, data, len < 5 ? len : 5);
+            break;
+        case TX_ADDR:
+            memcpy(_tx_addr, data, len < 5 ? len : 5);
+            break;
+        case OBSERVE_TX:
+        case RPD:
+        case FIFO_STATUS:
+            break;      // 唯讀
+        case RF_CH:
+            _regs[RF_CH] = data[0] & 0x7F;
+            _regs[OBSERVE_TX] &= 0x0F;   // 寫入 RF_CH 會清除 PLOS_CNT
+            break;
+        case NRF_CONFIG: {
+            bool was_rx = listening();
+            _regs[NRF_CONFIG] = data[0];
+            if (!was_rx && listening()) _rpd = false;
+            maybeStartTx();
+            break;
+        }
+        default:
+            _regs[reg] = data[0];
+            break;
+    }
+}
+
+uint8_t SimNrf24::readRegisterByte(uint8_t reg, uint8_t index) {
+    switch (reg) {
+        case RX_ADDR_P0:  return _rx_addr_p0[index % 5];
+        case RX_ADDR_P1:  return _rx_addr_p1[index % 5];
+        case TX_ADDR:     return _tx_addr[index % 5];
+        case NRF_STATUS:  return status();
+        case FIFO_STATUS: return fifoStatus();
+        case RPD:         return _rpd ? 1 : 0;
+        default:          return _regs[reg];
+    }
+}
+
+uint8_t SimNrf24::status() const {
+    uint8_t pipe = _rx_fifo.empty() ? 0x07 : _rx_fifo.front().pipe;
+    return (uint8_t)(_status_flags | (pipe << RX_P_NO) | (_tx_fifo.size() >= FIFO_DEPTH ? _BV(TX_FULL) : 0));
+}
+
+uint8_t SimNrf24::fifoStatus() const {
+    uint8_t value = 0;
+    if (_reuse_tx) value |= _BV(TX_REUSE);
+    if (_tx_fifo.size() >= FIFO_DEPTH) value |= _BV(FIFO_FULL);
+    if (_tx_fifo.empty()) value |= _BV(TX_EMPTY);
+    if (_rx_fifo.size() >= FIFO_DEPTH) value |= _BV(RX_FULL);
+    if (_rx_fifo.empty()) value |= _BV(RX_EMPTY);
+    return value;
+}
+
+bool SimNrf24::listening() const {
+    return (_regs[NRF_CONFIG] & _BV(PWR_UP)) && (_regs[NRF_CONFIG] & _BV(PRIM_RX)) && _ce;
+}
+
+uint8_t SimNrf24::dataRate() const {
+    if (_regs[RF_SETUP] & _BV(RF_DR_LOW)) return RF24_250KBPS;
+    if (_regs[RF_SETUP] & _BV(RF_DR_HIGH)) return RF24_2MBPS;
+    return RF24_1MBPS;
+}
+
+// ==================================================================
+// --- CE / 傳送 ---
+// ==================================================================
+void SimNrf24::onCe(uint8_t level) {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        bool was_rx = listening();
+        _ce = level == HIGH;
+        if (!was_rx && listening()) _rpd = false;
+        maybeStartTx();
+        publishState();
+    }
+    updateIrq();
+}
+
+/**
+ * @brief PTX 且 CE 為高時送出 TX FIFO 最前面的封包 (一次一筆，MAX_RT 未清除前暫停)
+ */
+void SimNrf24::maybeStartTx() {
+    const uint8_t config = _regs[NRF_CONFIG];
+    if (_tx_busy || !_ce || !(config & _BV(PWR_UP)) || (config & _BV(PRIM_RX))) return;
+    if (_status_flags & _BV(MAX_RT)) return;
+    if (_tx_fifo.empty() || _tx_fifo.front().ack_payload) return;
+
+    const Fifo& item = _tx_fifo.front();
+    MsgTx tx;
+    tx.channel = _regs[RF_CH];
+    tx.data_rate = dataRate();
+    tx.addr_width = (uint8_t)((_regs[SETUP_AW] & 0x03) + 2);
+    memcpy(tx.addr, _tx_addr, sizeof(tx.addr));
+    tx.dynamic = (_regs[FEATURE] & _BV(EN_DPL)) && (_regs[DYNPD] & _BV(DPL_P0));
+    tx.no_ack = item.no_ack || !(_regs[EN_AA] & _BV(ENAA_P0));
+    tx.arc = _regs[SETUP_RETR] & 0x0F;
+    tx.ard_us = (uint16_t)(((_regs[SETUP_RETR] >> ARD) + 1) * 250);
+    tx.len = item.len;
+    memcpy(tx.payload, item.data, item.len);
+
+    if (_fd < 0) {
+        MsgTxDone done;
+        done.acked = tx.no_ack;
+        done.retries = tx.no_ack ? 0 : tx.arc;
+        done.ack_len = 0;
+        onTxDone(done);
+        return;
+    }
+    _tx_busy = true;
+    sendToMedium(&tx, sizeof(tx));
+}
+
+void SimNrf24::onTxDone(const MsgTxDone& done) {
+    _tx_busy = false;
+    uint8_t observe = _regs[OBSERVE_TX];
+    if (done.acked) {
+        if (!_reuse_tx && !_tx_fifo.empty()) _tx_fifo.pop_front();
+        _status_flags |= _BV(TX_DS);
+        if (done.ack_len > 0 && _rx_fifo.size() < FIFO_DEPTH) {
+            Fifo item = {};
+            item.len = done.ack_len;
+            memcpy(item.data, done.ack_payload, done.ack_len);
+            item.pipe = 0;
+            _rx_fifo.push_back(item);
+            _status_flags |= _BV(RX_DR);
+        }
+        _regs[OBSERVE_TX] = (uint8_t)((observe & 0xF0) | (done.retries & 0x0F));
+    } else {
+        _status_flags |= _BV(MAX_RT);
+        uint8_t lost = observe >> PLOS_CNT;
+        if (lost < 15) lost++;
+        _regs[OBSERVE_TX] = (uint8_t)((lost << PLOS_CNT) | (done.retries & 0x0F));
+    }
+    maybeStartTx();
+}
+
+// ==================================================================
+// --- 媒介 ---
+// ==================================================================
+void SimNrf24::onRx(const MsgRx& rx) {
+    if (!listening() || _rx_fifo.size() >= FIFO_DEPTH || rx.pipe >= NRF_PIPES) return;
+    Fifo item = {};
+    item.len = rx.len > NRF_MAX_PAYLOAD ? NRF_MAX_PAYLOAD : rx.len;
+    memcpy(item.data, rx.payload, item.len);
+    item.pipe = rx.pipe;
+    _rx_fifo.push_back(item);
+    _status_flags |= _BV(RX_DR);
+    _rpd = true;
+}
+
+void SimNrf24::onAckSent(uint8_t pipe) {
+    for (auto it = _tx_fifo.begin(); it != _tx_fifo.end(); ++it) {
+        if (it->ack_payload && it->pipe == pipe) {
+            _tx_fifo.erase(it);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief 接收端設定或 FIFO 狀態改變時通知媒介 (內容相同則不送)
+ */
+void SimNrf24::publishState() {
+    if (_fd < 0) return;
+    MsgState state;
+    memset((void*)&state, 0, sizeof(state)); // 連同填充位元組清零，之後以 memcmp 比較
+    state.type = MSG_STATE;
+    state.listening = listening();
+    state.channel = _regs[RF_CH];
+    state.data_rate = dataRate();
+    state.addr_width = (uint8_t)((_regs[SETUP_AW] & 0x03) + 2);
+    state.en_rxaddr = _regs[EN_RXADDR];
+    state.en_aa = _regs[EN_AA];
+    state.dynpd = (_regs[FEATURE] & _BV(EN_DPL)) ? _regs[DYNPD] : 0;
+    state.rx_full = _rx_fifo.size() >= FIFO_DEPTH;
+    memcpy(state.rx_addr[0], _rx_addr_p0, 5);
+    memcpy(state.rx_addr[1], _rx_addr_p1, 5);
+    for (uint8_t pipe = 2; pipe < NRF_PIPES; ++pipe) {
+        memcpy(state.rx_addr[pipe], _rx_addr_p1, 5);
+        state.rx_addr[pipe][0] = _regs[RX_ADDR_P0 + pipe];
+    }
+    for (uint8_t pipe = 0; pipe < NRF_PIPES; ++pipe) {
+        state.rx_pw[pipe] = _regs[RX_PW_P0 + pipe] & 0x3F;
+    }
+    if ((_regs[FEATURE] & _BV(EN_ACK_PAY)) && (_regs[FEATURE] & _BV(EN_DPL))) {
+        for (const Fifo& item : _tx_fifo) {
+            if (item.ack_payload && state.ack_len[item.pipe] == 0) {
+                state.ack_len[item.pipe] = item.len;
+                memcpy(state.ack_payload[item.pipe], item.data, item.len);
+            }
+        }
+    }
+    if (_state_sent && memcmp(&state, &_last_state, sizeof(state)) == 0) return;
+    _last_state = state;
+    _state_sent = true;
+    sendToMedium(&state, sizeof(state));
+}
+
+void SimNrf24::sendToMedium(const void* msg, size_t len) {
+    if (send(_fd, msg, len, MSG_NOSIGNAL) < 0) _exit(0);   // runner 已結束
+}
+
+void SimNrf24::updateIrq() {
+    if (_irq_pin < 0) return;
+    static std::mutex irq_lock;
+    std::lock_guard<std::mutex> irq_guard(irq_lock);
+    bool low;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        uint8_t enabled = (uint8_t)(~_regs[NRF_CONFIG] & (_BV(MASK_RX_DR) | _BV(MASK_TX_DS) | _BV(MASK_MAX_RT)));
+        low = (_status_flags & enabled) != 0;
+    }
+    if (low == _irq_low) return;
+    _irq_low = low;
+    driveInputPin((uint8_t)_irq_pin, low ? LOW : HIGH);
+}
+
+void SimNrf24::mediumThread() {
+    uint8_t buffer[sizeof(MsgState) + 16];
+    for (;;) {
+        ssize_t n = recv(_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) _exit(0);     // runner 已結束
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            switch (buffer[0]) {
+                case MSG_TX_DONE:
+                    if ((size_t)n >= sizeof(MsgTxDone)) onTxDone(*reinterpret_cast<MsgTxDone*>(buffer));
+                    break;
+                case MSG_RX:
+                    if ((size_t)n >= sizeof(MsgRx)) onRx(*reinterpret_cast<MsgRx*>(buffer));
+                    break;
+                case MSG_ACK_SENT:
+                    if ((size_t)n >= sizeof(MsgAckSent)) onAckSent(buffer[1]);
+                    break;
+                case MSG_CARRIER:
+                    if (listening() && buffer[1] == _regs[RF_CH]) _rpd = true;
+                    break;
+            }
+            publishState();
+        }
+        updateIrq();
+    }
+}
+
+} // namespace sim
@@ -0,0 +1,92 @@
+// SimNrf24.h
+//
+// Register-level model of an nRF24L01+ behind the simulated SPI bus, so the
+// unmodified RF24 library drives it exactly as it drives the real chip.
+// Over-the-air behaviour (airtime, collisions, loss, auto-ack, retransmits)
+// belongs to the medium in sim_runner; the chip only reports its receiver
+// configuration and hands over frames that leave the TX FIFO.
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "sim_hw.h"
+#include "SimMediumProtocol.h"
+
+namespace sim {
+
+class SimNrf24 : public SpiDevice {
+public:
+    // medium_fd < 0: 沒有連接媒介，所有傳送都以 MAX_RT 結束
+    SimNrf24(uint8_t ce_pin, uint8_t csn_pin, int irq_pin, int medium_fd);
+
+    void select(bool selected) override;
+    uint8_t transfer(uint8_t out) override;
+
+private:
+    struct Fifo {
+        uint8_t len;
+        uint8_t data[NRF_MAX_PAYLOAD];
+        uint8_t pipe;       // RX: 接收的 pipe；TX: ACK payload 的 pipe
+        bool no_ack;
+        bool ack_payload;   // TX FIFO 中的 ACK payload (PRX 模式)
+    };
+
+    static const uint8_t FIFO_DEPTH = 3;
+
+    void onCe(uint8_t level);
+    void finishCommand();
+    void writeRegister(uint8_t reg, const uint8_t* data, uint8_t len);
+    uint8_t readRegisterByte(uint8_t reg, uint8_t index);
+    uint8_t status() const;
+    uint8_t fifoStatus() const;
+    bool listening() const;
+    uint8_t dataRate() const;
+
+    void maybeStartTx();
+    void onTxDone(const MsgTxDone& done);
+    void onRx(const MsgRx& rx);
+    void onAckSent(uint8_t pipe);
+
+    void publishState();
+    void sendToMedium(const void* msg, size_t len);
+    // 在鎖外呼叫：依 STATUS 與遮罩更新 IRQ 腳位
+    void updateIrq();
+    void mediumThread();
+
+    const uint8_t _ce_pin;
+    const int _irq_pin;
+    const int _fd;
+
+    std::mutex _lock;
+    std::thread _thread;
+
+    // 暫存器
+    uint8_t _regs[0x20];
+    uint8_t _rx_addr_p0[5];
+    uint8_t _rx_addr_p1[5];
+    uint8_t _tx_addr[5];
+    uint8_t _status_flags;      // RX_DR | TX_DS | MAX_RT
+    bool _ce;
+    bool _tx_busy;
+    bool _reuse_tx;
+    bool _rpd;
+
+    std::deque<Fifo> _rx_fifo;
+    std::deque<Fifo> _tx_fifo;
+
+    // 目前的 SPI 交易
+    bool _selected;
+    uint8_t _command;
+    uint8_t _index;             // 指令之後的位元組數
+    uint8_t _buffer[NRF_MAX_PAYLOAD];
+
+    bool _irq_low;
+    MsgState _last_state;
+    bool _state_sent;
+};
+
+} // namespace sim
@@ -0,0 +1,351 @@
+// Arduino.cpp (host simulation)
+
+#include "Arduino.h"
+#include "sim_hw.h"
+#include "SimClock.h"
+
+#include <stdarg.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+
+namespace {
+
+const auto boot_time = std::chrono::steady_clock::now();
+
+struct PinState {
+    uint8_t mode = INPUT;
+    uint8_t level = LOW;
+    bool driven = false;            // 由模擬裝置驅動
+    void (*isr)(void) = nullptr;
+    int isr_mode = 0;
+    std::vector<std::function<void(uint8_t)>> listeners;
+};
+
+std::mutex pin_lock;
+PinState pins[sim::MAX_PINS];
+
+std::mutex spi_lock;
+std::map<uint8_t, sim::SpiDevice*> spi_devices;
+sim::SpiDevice* spi_selected = nullptr;
+
+std::mutex serial_lock;                   // stdout
+std::mutex input_lock;                    // stdin 緩衝
+std::condition_variable input_cv;
+std::deque<char> input;
+
+std::mutex command_lock;
+std::map<std::string, std::function<void(const std::string&)>> commands;
+
+std::mt19937 rng(1);
+
+void runCommand(const std::string& line) {
+    std::string rest = line.substr(5);
+    size_t space = rest.find(' ');
+    std::string name = rest.substr(0, space);
+    std::string args = space == std::string::npos ? std::string() : rest.substr(space + 1);
+    std::function<void(const std::string&)> handler;
+    {
+        std::lock_guard<std::mutex> guard(command_lock);
+        auto it = commands.find(name);
+        if (it != commands.end()) handler = it->second;
+    }
+    if (handler) handler(args);
+    else Serial.printf("[SIM] Unknown command: %s\n", name.c_str());
+}
+
+// stdin 讀取執行緒：一般行交給 Serial，"@sim " 行交給模擬裝置；EOF 時結束行程
+void stdinReader() {
+    std::string line;
+    int c;
+    while ((c = fgetc(stdin)) != EOF) {
+        line += (char)c;
+        if (c != '\n') continue;
+        if (line.compare(0, 5, "@sim ") == 0) {
+            line.pop_back();
+            runCommand(line);
+        } else {
+            std::lock_guard<std::mutex> guard(input_lock);
+            input.insert(input.end(), line.begin(), line.end());
+            input_cv.notify_all();
+        }
+        line.clear();
+    }
+    Serial.flush();
+    _exit(0);
+}
+
+} // namespace
+
+// ==================================================================
+// --- 時間 ---
+// ==================================================================
+// 模擬時間 (見 SimClock.h)
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(sim::simElapsedUs(boot_time) / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)sim::simElapsedUs(boot_time);
+}
+
+void delay(unsigned long ms) {
+    sim::sleepSimUs((uint64_t)ms * 1000);
+}
+
+// 一律讓出 CPU：韌體中的輪詢迴圈 (例如 RF24 等待 TX_DS) 不會讓 50 個行程空轉
+void delayMicroseconds(unsigned int us) {
+    sim::sleepSimUs(us);
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+// ==================================================================
+// --- GPIO ---
+// ==================================================================
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= sim::MAX_PINS) return;
+    std::lock_guard<std::mutex> guard(pin_lock);
+    pins[pin].mode = mode;
+    if (!pins[pin].driven) pins[pin].level = (mode == INPUT_PULLUP) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= sim::MAX_PINS) return;
+    std::vector<std::function<void(uint8_t)>> listeners;
+    {
+        std::lock_guard<std::mutex> guard(pin_lock);
+        pins[pin].level = val ? HIGH : LOW;
+        listeners = pins[pin].listeners;
+    }
+    {
+        std::lock_guard<std::mutex> guard(spi_lock);
+        auto it = spi_devices.find(pin);
+        if (it != spi_devices.end()) {
+            it->second->select(val == LOW);
+            if (val == LOW) spi_selected = it->second;
+            else if (spi_selected == it->second) spi_selected = nullptr;
+        }
+    }
+    for (auto& listener : listeners) listener(val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= sim::MAX_PINS) return LOW;
+    std::lock_guard<std::mutex> guard(pin_lock);
+    return pins[pin].level;
+}
+
+void analogWrite(uint8_t pin, int value) {}
+
+int analogRead(uint8_t pin) {
+    return random(4096);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    if (pin >= sim::MAX_PINS) return;
+    std::lock_guard<std::mutex> guard(pin_lock);
+    pins[pin].isr = isr;
+    pins[pin].isr_mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= sim::MAX_PINS) return;
+    std::lock_guard<std::mutex> guard(pin_lock);
+    pins[pin].isr = nullptr;
+}
+
+// ==================================================================
+// --- 亂數 ---
+// ==================================================================
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return std::uniform_int_distribution<long>(0, howbig - 1)(rng);
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) rng.seed((uint32_t)seed);
+}
+
+// ==================================================================
+// --- String ---
+// ==================================================================
+std::string String::format(unsigned long value, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char buf[8 * sizeof(unsigned long) + 1];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do {
+        unsigned digit = value % base;
+        *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        value /= base;
+    } while (value);
+    return p;
+}
+
+std::string String::formatFloat(double value, unsigned char decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    return buf;
+}
+
+// ==================================================================
+// --- Serial ---
+// ==================================================================
+void HardwareSerial::flush() {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    fflush(stdout);
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(input_lock);
+    return (int)input.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(input_lock);
+    if (input.empty()) return -1;
+    char c = input.front();
+    input.pop_front();
+    return (unsigned char)c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> guard(input_lock);
+    return input.empty() ? -1 : (unsigned char)input.front();
+}
+
+// Arduino 預設的 1 秒逾時
+String HardwareSerial::readStringUntil(char terminator) {
+    std::string out;
+    std::unique_lock<std::mutex> guard(input_lock);
+    auto deadline = std::chrono::steady_clock::now() + sim::hostDuration(1000000);
+    for (;;) {
+        while (!input.empty()) {
+            char c = input.front();
+            input.pop_front();
+            if (c == terminator) return String(out);
+            out += c;
+        }
+        if (input_cv.wait_until(guard, deadline) == std::cv_status::timeout && input.empty()) break;
+    }
+    return String(out);
+}
+
+String HardwareSerial::readString() {
+    return readStringUntil('\0');
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    fputc(c, stdout);
+    if (c == '\n') fflush(stdout);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    fwrite(buf, 1, len, stdout);
+    if (memchr(buf, '\n', len)) fflush(stdout);
+    return len;
+}
+
+size_t HardwareSerial::print(const char* s) {
+    return write((const uint8_t*)s, strlen(s));
+}
+
+size_t HardwareSerial::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    char stack_buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stack_buf, sizeof(stack_buf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(stack_buf)) return write((const uint8_t*)stack_buf, len);
+
+    std::vector<char> heap_buf(len + 1);
+    va_start(args, format);
+    vsnprintf(heap_buf.data(), heap_buf.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heap_buf.data(), len);
+}
+
+// ==================================================================
+// --- 模擬裝置掛勾 ---
+// ==================================================================
+namespace sim {
+
+int deviceId() {
+    static int id = [] {
+        const char* env = getenv("SIM_DEVICE_ID");
+        return env ? atoi(env) : 0;
+    }();
+    return id;
+}
+
+void onPinWrite(uint8_t pin, std::function<void(uint8_t)> listener) {
+    if (pin >= MAX_PINS) return;
+    std::lock_guard<std::mutex> guard(pin_lock);
+    pins[pin].listeners.push_back(listener);
+}
+
+void driveInputPin(uint8_t pin, uint8_t level) {
+    if (pin >= MAX_PINS) return;
+    void (*isr)(void) = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(pin_lock);
+        PinState& state = pins[pin];
+        uint8_t previous = state.level;
+        state.driven = true;
+        state.level = level;
+        if (state.isr && previous != level) {
+            bool rising = level == HIGH;
+            if (state.isr_mode == CHANGE || (rising && state.isr_mode == RISING) || (!rising && state.isr_mode == FALLING)) {
+                isr = state.isr;
+            }
+        }
+    }
+    if (isr) isr();
+}
+
+void attachSpiDevice(uint8_t csn_pin, SpiDevice* device) {
+    std::lock_guard<std::mutex> guard(spi_lock);
+    spi_devices[csn_pin] = device;
+}
+
+uint8_t spiTransfer(uint8_t out) {
+    std::lock_guard<std::mutex> guard(spi_lock);
+    return spi_selected ? spi_selected->transfer(out) : 0xFF;
+}
+
+void onCommand(const std::string& name, std::function<void(const std::string&)> handler) {
+    std::lock_guard<std::mutex> guard(command_lock);
+    commands[name] = handler;
+}
+
+void startStdinReader() {
+    const char* seed = getenv("SIM_SEED");
+    rng.seed((uint32_t)(seed ? atoi(seed) : 1) * 7919u + (uint32_t)deviceId());
+    std::thread(stdinReader).detach();
+}
+
+} // namespace sim
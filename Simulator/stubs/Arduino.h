@@ -0,0 +1,218 @@
+// Arduino.h (host simulation)
+//
+// Just enough of the ESP32 Arduino core for RF24-MasterForControlUI and
+// RF24-Slave to build and run as Linux processes: String, Serial, timing,
+// GPIO with interrupts and the FreeRTOS calls the firmwares use.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#include "freertos_sim.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define A0 36
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+#define PSTR(s) (s)
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define _BV(bit) (1UL << (bit))
+
+// --- 時間 ---
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// --- GPIO ---
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+int analogRead(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// --- 亂數 ---
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// --- String ---
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(unsigned char value, unsigned char base = DEC) : _s(format((unsigned long)value, base)) {}
+    String(int value, unsigned char base = DEC) : _s(base == DEC ? std::to_string(value) : format((unsigned long)(unsigned int)value, base)) {}
+    String(unsigned int value, unsigned char base = DEC) : _s(format(value, base)) {}
+    String(long value, unsigned char base = DEC) : _s(base == DEC ? std::to_string(value) : format((unsigned long)value, base)) {}
+    String(unsigned long value, unsigned char base = DEC) : _s(format(value, base)) {}
+    String(float value, unsigned char decimals = 2) : _s(formatFloat(value, decimals)) {}
+    String(double value, unsigned char decimals = 2) : _s(formatFloat(value, decimals)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    void reserve(unsigned int size) { _s.reserve(size); }
+
+    char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return _s[index]; }
+
+    String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
+    String& operator+=(const char* rhs) { _s += rhs; return *this; }
+    String& operator+=(char rhs) { _s += rhs; return *this; }
+    String& operator+=(int rhs) { _s += std::to_string(rhs); return *this; }
+    String& operator+=(unsigned int rhs) { _s += std::to_string(rhs); return *this; }
+    String& operator+=(long rhs) { _s += std::to_string(rhs); return *this; }
+    String& operator+=(unsigned long rhs) { _s += std::to_string(rhs); return *this; }
+    bool concat(const String& rhs) { _s += rhs._s; return true; }
+    bool concat(const char* rhs) { _s += rhs; return true; }
+    bool concat(char rhs) { _s += rhs; return true; }
+
+    bool operator==(const String& rhs) const { return _s == rhs._s; }
+    bool operator==(const char* rhs) const { return _s == rhs; }
+    bool operator!=(const String& rhs) const { return _s != rhs._s; }
+    bool operator!=(const char* rhs) const { return _s != rhs; }
+    bool operator<(const String& rhs) const { return _s < rhs._s; }
+    bool equals(const String& rhs) const { return _s == rhs._s; }
+    bool equalsIgnoreCase(const String& rhs) const { return strcasecmp(c_str(), rhs.c_str()) == 0; }
+    int compareTo(const String& rhs) const { return _s.compare(rhs._s); }
+
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const {
+        return _s.size() >= suffix._s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return toIndex(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return toIndex(_s.rfind(c)); }
+    int lastIndexOf(const String& s) const { return toIndex(_s.rfind(s._s)); }
+
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= _s.size()) return String();
+        return String(_s.substr(from, std::min<size_t>(to, _s.size()) - from));
+    }
+
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    double toDouble() const { return atof(_s.c_str()); }
+
+    void trim() {
+        size_t begin = _s.find_first_not_of(" \t\r\n");
+        size_t end = _s.find_last_not_of(" \t\r\n");
+        _s = (begin == std::string::npos) ? std::string() : _s.substr(begin, end - begin + 1);
+    }
+    void toUpperCase() { for (char& c : _s) c = (char)toupper((unsigned char)c); }
+    void toLowerCase() { for (char& c : _s) c = (char)tolower((unsigned char)c); }
+    void replace(const String& from, const String& to) {
+        if (from._s.empty()) return;
+        for (size_t pos = 0; (pos = _s.find(from._s, pos)) != std::string::npos; pos += to._s.size()) {
+            _s.replace(pos, from._s.size(), to._s);
+        }
+    }
+    void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const {
+        if (!bufsize || !buf) return;
+        unsigned int n = index < _s.size() ? std::min<unsigned int>(bufsize - 1, _s.size() - index) : 0;
+        memcpy(buf, _s.data() + index, n);
+        buf[n] = 0;
+    }
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes((unsigned char*)buf, bufsize, index);
+    }
+
+    friend String operator+(const String& lhs, const String& rhs) { return String(lhs._s + rhs._s); }
+    friend String operator+(const String& lhs, const char* rhs) { return String(lhs._s + rhs); }
+    friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs._s); }
+    friend String operator+(const String& lhs, char rhs) { return String(lhs._s + rhs); }
+
+private:
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    static std::string format(unsigned long value, unsigned char base);
+    static std::string formatFloat(double value, unsigned char decimals);
+
+    std::string _s;
+};
+
+// --- Serial ---
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) {}
+    void end() {}
+    void flush();
+    operator bool() const { return true; }
+
+    int available();
+    int read();
+    int peek();
+    String readStringUntil(char terminator);
+    String readString();
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t len);
+
+    size_t print(const char* s);
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c);
+    size_t print(unsigned char value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, (unsigned char)decimals)); }
+
+    size_t println() { return print("\n"); }
+    template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+// --- Arduino 進入點 (由韌體實作) ---
+void setup();
+void loop();
@@ -0,0 +1,34 @@
+// EasyButton.cpp (host simulation)
+
+#include "EasyButton.h"
+#include "sim_hw.h"
+
+#include <thread>
+
+void EasyButton::begin() {
+    pinMode(_pin, _pullup ? INPUT_PULLUP : INPUT);
+    _current = false;
+
+    // "@sim press <pin>": 按下 100 ms 後放開 (所有按鈕共用同一個指令)
+    static bool registered = false;
+    if (registered) return;
+    registered = true;
+    bool active_low = _active_low;
+    sim::onCommand("press", [active_low](const std::string& args) {
+        uint8_t pin = (uint8_t)atoi(args.c_str());
+        std::thread([pin, active_low] {
+            sim::driveInputPin(pin, active_low ? LOW : HIGH);
+            delay(100);
+            sim::driveInputPin(pin, active_low ? HIGH : LOW);
+        }).detach();
+    });
+}
+
+bool EasyButton::read() {
+    bool level = digitalRead(_pin) == HIGH;
+    bool pressed = _active_low ? !level : level;
+    _changed = pressed != _current;
+    _current = pressed;
+    if (_changed && !_current && _pressed_callback) _pressed_callback();
+    return _current;
+}
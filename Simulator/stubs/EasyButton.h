@@ -0,0 +1,32 @@
+// EasyButton.h (host simulation)
+//
+// Same polling model as the real library: read() samples the (active-low,
+// pulled-up) pin and calls the onPressed callback on release. The runner
+// presses a button with "@sim press <pin>".
+
+#pragma once
+#include "Arduino.h"
+
+class EasyButton {
+public:
+    typedef void (*callback_t)();
+
+    explicit EasyButton(uint8_t pin, uint32_t debounce_time = 35, bool pullup_enable = true, bool active_low = true)
+        : _pin(pin), _pullup(pullup_enable), _active_low(active_low) {}
+
+    void begin();
+    bool read();
+    void onPressed(callback_t callback) { _pressed_callback = callback; }
+    bool isPressed() const { return _current; }
+    bool isReleased() const { return !_current; }
+    bool wasPressed() const { return _current && _changed; }
+    bool wasReleased() const { return !_current && _changed; }
+
+private:
+    uint8_t _pin;
+    bool _pullup;
+    bool _active_low;
+    bool _current = false;
+    bool _changed = false;
+    callback_t _pressed_callback = nullptr;
+};
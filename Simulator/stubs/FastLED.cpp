@@ -0,0 +1,54 @@
+// FastLED.cpp (host simulation)
+
+#include "FastLED.h"
+
+CFastLED FastLED;
+
+CRGB hsv2rgb(const CHSV& hsv) {
+    // 六段線性色相 (不需與 FastLED 的 rainbow 完全一致，只供模擬顯示)
+    uint8_t region = hsv.h / 43;
+    uint8_t remainder = (uint8_t)((hsv.h - region * 43) * 6);
+    uint8_t p = (uint8_t)((hsv.v * (255 - hsv.s)) >> 8);
+    uint8_t q = (uint8_t)((hsv.v * (255 - ((hsv.s * remainder) >> 8))) >> 8);
+    uint8_t t = (uint8_t)((hsv.v * (255 - ((hsv.s * (255 - remainder)) >> 8))) >> 8);
+    switch (region) {
+        case 0:  return CRGB(hsv.v, t, p);
+        case 1:  return CRGB(q, hsv.v, p);
+        case 2:  return CRGB(p, hsv.v, t);
+        case 3:  return CRGB(p, q, hsv.v);
+        case 4:  return CRGB(t, p, hsv.v);
+        default: return CRGB(hsv.v, p, q);
+    }
+}
+
+CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amount) {
+    auto mix = [amount](uint8_t a, uint8_t b) {
+        return (uint8_t)((a * (255 - amount) + b * amount) / 255);
+    };
+    return CRGB(mix(p1.r, p2.r), mix(p1.g, p2.g), mix(p1.b, p2.b));
+}
+
+void fill_solid(CRGB* leds, int num_leds, const CRGB& color) {
+    for (int i = 0; i < num_leds; ++i) leds[i] = color;
+}
+
+void fill_rainbow(CRGB* leds, int num_leds, uint8_t initial_hue, uint8_t delta_hue) {
+    uint8_t hue = initial_hue;
+    for (int i = 0; i < num_leds; ++i, hue += delta_hue) {
+        leds[i] = hsv2rgb(CHSV(hue, 240, 255));
+    }
+}
+
+void CFastLED::show() {
+    static const bool trace = getenv("SIM_LED_TRACE") != nullptr;
+    if (!trace || !_leds || _num_leds == 0) return;
+    if (_shown && _leds[0] == _last_first) return;
+    _shown = true;
+    _last_first = _leds[0];
+    Serial.printf("[SIM LED] %02X%02X%02X\n", _leds[0].r, _leds[0].g, _leds[0].b);
+}
+
+void CFastLED::clear(bool write_data) {
+    if (_leds) fill_solid(_leds, _num_leds, CRGB::Black);
+    if (write_data) show();
+}
@@ -0,0 +1,69 @@
+// FastLED.h (host simulation)
+//
+// CRGB, the fill/blend helpers and a FastLED controller that only keeps the
+// frame in memory. With SIM_LED_TRACE set in the environment, every frame
+// whose first pixel changed is printed as "[SIM LED] RRGGBB".
+
+#pragma once
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+
+struct CRGB {
+    enum HTMLColorCode : uint32_t {
+        Black  = 0x000000,
+        White  = 0xFFFFFF,
+        Red    = 0xFF0000,
+        Green  = 0x008000,
+        Blue   = 0x0000FF,
+        Yellow = 0xFFFF00,
+        Orange = 0xFFA500,
+        Purple = 0x800080,
+        Cyan   = 0x00FFFF
+    };
+
+    uint8_t r, g, b;
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+    CRGB(HTMLColorCode code) : r((uint8_t)(code >> 16)), g((uint8_t)(code >> 8)), b((uint8_t)code) {}
+    CRGB(uint32_t code) : r((uint8_t)(code >> 16)), g((uint8_t)(code >> 8)), b((uint8_t)code) {}
+
+    bool operator==(const CRGB& rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+    bool operator!=(const CRGB& rhs) const { return !(*this == rhs); }
+};
+
+struct CHSV {
+    uint8_t h, s, v;
+    CHSV(uint8_t h, uint8_t s, uint8_t v) : h(h), s(s), v(v) {}
+};
+
+CRGB hsv2rgb(const CHSV& hsv);
+CRGB blend(const CRGB& p1, const CRGB& p2, fract8 amount);
+void fill_solid(CRGB* leds, int num_leds, const CRGB& color);
+void fill_rainbow(CRGB* leds, int num_leds, uint8_t initial_hue, uint8_t delta_hue = 5);
+
+enum ESPIChipsets { NEOPIXEL, WS2812B };
+
+class CFastLED {
+public:
+    template <ESPIChipsets CHIPSET, uint8_t DATA_PIN>
+    CFastLED& addLeds(CRGB* leds, int num_leds) {
+        _leds = leds;
+        _num_leds = num_leds;
+        return *this;
+    }
+    void setBrightness(uint8_t scale) { _brightness = scale; }
+    uint8_t getBrightness() const { return _brightness; }
+    void show();
+    void clear(bool write_data = false);
+
+private:
+    CRGB* _leds = nullptr;
+    int _num_leds = 0;
+    uint8_t _brightness = 255;
+    CRGB _last_first;
+    bool _shown = false;
+};
+
+extern CFastLED FastLED;
@@ -0,0 +1,9 @@
+// MD_MAX72xx.h (host simulation): only the hardware type constants are needed
+
+#pragma once
+#include "Arduino.h"
+
+class MD_MAX72XX {
+public:
+    enum moduleType_t { PAROLA_HW, GENERIC_HW, ICSTATION_HW, FC16_HW };
+};
@@ -0,0 +1,31 @@
+// MD_Parola.h (host simulation)
+//
+// Keeps the text that would be on the LED matrix; with SIM_MATRIX_TRACE set
+// in the environment, every new text is printed as "[SIM MATRIX] <text>".
+
+#pragma once
+#include "Arduino.h"
+#include "MD_MAX72xx.h"
+
+enum textPosition_t { PA_LEFT, PA_CENTER, PA_RIGHT };
+enum textEffect_t { PA_NO_EFFECT, PA_PRINT, PA_SCROLL_UP, PA_SCROLL_DOWN, PA_SCROLL_LEFT, PA_SCROLL_RIGHT };
+
+class MD_Parola {
+public:
+    MD_Parola(MD_MAX72XX::moduleType_t type, uint8_t data_pin, uint8_t clk_pin, uint8_t cs_pin, uint8_t num_devices = 1) {}
+    MD_Parola(uint8_t type, uint8_t data_pin, uint8_t clk_pin, uint8_t cs_pin, uint8_t num_devices = 1) {}
+
+    bool begin(uint8_t num_zones = 1) { return true; }
+    void setIntensity(uint8_t intensity) {}
+    void displayClear() { _text = ""; }
+    void displayText(const char* text, textPosition_t align, uint16_t speed, uint16_t pause,
+                     textEffect_t effect_in, textEffect_t effect_out = PA_NO_EFFECT) {
+        _text = text;
+        if (getenv("SIM_MATRIX_TRACE")) Serial.printf("[SIM MATRIX] %s\n", text);
+    }
+    bool displayAnimate() { return true; }
+    const char* text() const { return _text.c_str(); }
+
+private:
+    String _text;
+};
@@ -0,0 +1,334 @@
+// PN532_SPI.cpp (host simulation)
+
+#include "PN532_SPI.h"
+#include "PN532.h"
+#include "sim_hw.h"
+#include "SimClock.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// 感應區中的卡片 (所有 PN532_SPI 物件共用同一個天線)
+std::mutex field_lock;
+std::condition_variable field_cv;
+uint8_t card_uid[10];
+uint8_t card_uid_len = 0;
+unsigned long card_leave_time = 0;
+std::string claimed;            // 讀卡機這一側已選取的其他從機 (空字串 = 無)
+
+const unsigned long EXCHANGE_TIMEOUT_MS = 500;
+
+bool cardPresent() {
+    return card_uid_len > 0 && (long)(card_leave_time - millis()) > 0;
+}
+
+// --- 與其他從機共用的感應區目錄 (SIM_NFC_FIELD) ---
+
+std::string fieldPath(const std::string& uid, const char* suffix) {
+    static const char* dir = getenv("SIM_NFC_FIELD");
+    return (dir && *dir) ? std::string(dir) + "/" + uid + suffix : std::string();
+}
+
+std::string hexString(const uint8_t* data, uint8_t len) {
+    std::string hex;
+    char digits[3];
+    for (uint8_t i = 0; i < len; ++i) {
+        snprintf(digits, sizeof(digits), "%02X", data[i]);
+        hex += digits;
+    }
+    return hex;
+}
+
+bool fieldExists(const std::string& uid, const char* suffix) {
+    std::string path = fieldPath(uid, suffix);
+    return !path.empty() && access(path.c_str(), F_OK) == 0;
+}
+
+// 先寫入暫存檔再改名，對方不會讀到寫到一半的內容
+void fieldWrite(const std::string& uid, const char* suffix, const uint8_t* data, uint8_t len) {
+    std::string path = fieldPath(uid, suffix);
+    if (path.empty()) return;
+    std::string tmp = path + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (!file) return;
+    fwrite(data, 1, len, file);
+    fclose(file);
+    rename(tmp.c_str(), path.c_str());
+}
+
+// 讀出並刪除；檔案不存在時回傳 -1
+int fieldTake(const std::string& uid, const char* suffix, uint8_t* data, uint8_t cap) {
+    std::string path = fieldPath(uid, suffix);
+    if (path.empty()) return -1;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return -1;
+    int len = (int)fread(data, 1, cap, file);
+    fclose(file);
+    unlink(path.c_str());
+    return len;
+}
+
+// 讀出但不刪除；檔案不存在時回傳空字串
+std::string fieldRead(const std::string& uid, const char* suffix) {
+    std::string path = fieldPath(uid, suffix);
+    FILE* file = path.empty() ? nullptr : fopen(path.c_str(), "rb");
+    if (!file) return std::string();
+    char text[32];
+    size_t len = fread(text, 1, sizeof(text), file);
+    fclose(file);
+    return std::string(text, len);
+}
+
+void fieldRemove(const std::string& uid, const char* suffix) {
+    std::string path = fieldPath(uid, suffix);
+    if (!path.empty()) unlink(path.c_str());
+}
+
+// 同一時間只有一台讀卡機能選取模擬中的從機；.claim 內容為讀卡機的 pid
+bool claimTarget(const std::string& uid) {
+    if (claimed == uid) return true;
+    std::string path = fieldPath(uid, ".claim");
+    int fd = path.empty() ? -1 : open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd < 0) return false;
+    std::string owner = std::to_string(getpid());
+    if (write(fd, owner.data(), owner.size()) < 0) perror("sim: claim");
+    close(fd);
+    claimed = uid;
+    return true;
+}
+
+void releaseClaim() {
+    if (claimed.empty()) return;
+    fieldRemove(claimed, ".capdu");
+    fieldRemove(claimed, ".rapdu");
+    fieldRemove(claimed, ".claim");
+    claimed.clear();
+}
+
+// "@sim tap 04A1B2C3 [hold_ms]"
+void tapCommand(const std::string& args) {
+    std::string hex = args.substr(0, args.find(' '));
+    unsigned long hold_ms = 300;
+    if (hex.size() < args.size()) hold_ms = strtoul(args.c_str() + hex.size() + 1, nullptr, 10);
+
+    std::lock_guard<std::mutex> guard(field_lock);
+    releaseClaim();
+    card_uid_len = 0;
+    for (size_t i = 0; i + 1 < hex.size() && card_uid_len < sizeof(card_uid); i += 2) {
+        card_uid[card_uid_len++] = (uint8_t)strtoul(hex.substr(i, 2).c_str(), nullptr, 16);
+    }
+    card_leave_time = millis() + hold_ms;
+    field_cv.notify_all();
+}
+
+} // namespace
+
+PN532_SPI::PN532_SPI(SPIClass& spi, uint8_t ss)
+    : _command(0), _autopoll(0), _response_len(0), _prepared(false), _exchange_deadline(0) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        sim::onCommand("tap", tapCommand);
+    }
+}
+
+void PN532_SPI::begin() {}
+
+void PN532_SPI::wakeup() {}
+
+int8_t PN532_SPI::writeCommand(const uint8_t* header, uint8_t hlen, const uint8_t* body, uint8_t blen) {
+    std::lock_guard<std::mutex> guard(field_lock);
+    _command = header[0];
+    _prepared = false;
+    _autopoll = (_command == PN532_COMMAND_INAUTOPOLL && hlen >= 4) ? header[3] : 0;
+    _response_len = 0;
+
+    switch (_command) {
+        case PN532_COMMAND_TGINITASTARGET:
+            // NFCID1 = 0x08 + 3 bytes (EmulateTag::setUid)
+            if (hlen >= 7) {
+                const uint8_t uid[4] = { 0x08, header[4], header[5], header[6] };
+                _target = hexString(uid, sizeof(uid));
+                _target_owner.clear();
+                fieldWrite(_target, ".target", uid, sizeof(uid));
+            }
+            break;
+        case PN532_COMMAND_TGSETDATA:
+            if (!_target.empty()) {
+                uint8_t rapdu[255];
+                uint8_t len = 0;
+                for (uint8_t i = 1; i < hlen; ++i) rapdu[len++] = header[i];
+                for (uint8_t i = 0; i < blen; ++i) rapdu[len++] = body[i];
+                fieldWrite(_target, ".rapdu", rapdu, len);
+            }
+            break;
+        case PN532_COMMAND_INDATAEXCHANGE:
+            if (!claimed.empty()) {
+                uint8_t capdu[255];
+                uint8_t len = 0;
+                for (uint8_t i = 2; i < hlen; ++i) capdu[len++] = header[i];
+                for (uint8_t i = 0; i < blen; ++i) capdu[len++] = body[i];
+                fieldRemove(claimed, ".rapdu");
+                fieldWrite(claimed, ".capdu", capdu, len);
+                _exchange_deadline = millis() + EXCHANGE_TIMEOUT_MS;
+            }
+            break;
+        case PN532_COMMAND_INRELEASE:
+            // 讀卡機放開選取的從機；模擬卡在 session 之外收到則代表離開模擬模式
+            if (!claimed.empty()) releaseClaim();
+            else if (!_target_owner.empty()) _target_owner.clear();
+            else stopTarget();
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+bool PN532_SPI::prepareResponse() {
+    switch (_command) {
+        case 0:
+            return false;
+        case PN532_COMMAND_GETFIRMWAREVERSION: {
+            const uint8_t version[] = { 0x32, 0x01, 0x06, 0x07 };   // PN532 v1.6
+            memcpy(_response, version, sizeof(version));
+            _response_len = sizeof(version);
+            return true;
+        }
+        case PN532_COMMAND_INLISTPASSIVETARGET:
+        case PN532_COMMAND_INAUTOPOLL: {
+            if (!cardPresent()) return false;
+            // 模擬中的從機: 選取成功才算偵測到 (另一台讀卡機使用中時等待)
+            std::string uid = hexString(card_uid, card_uid_len);
+            bool peer = fieldExists(uid, ".target");
+            if (peer && !claimTarget(uid)) return false;
+            uint8_t n = 0;
+            _response[n++] = 1;                                      // NbTg
+            if (_command == PN532_COMMAND_INAUTOPOLL) {
+                _response[n++] = _autopoll;                          // Type
+                _response[n++] = (uint8_t)(5 + card_uid_len);        // DataLength
+            }
+            _response[n++] = 1;                                      // Tg
+            _response[n++] = 0x00;                                   // SENS_RES
+            _response[n++] = card_uid_len == 7 ? 0x44 : 0x04;
+            _response[n++] = peer ? 0x20 : 0x00;                     // SEL_RES (0x20 = ISO14443-4)
+            _response[n++] = card_uid_len;
+            memcpy(_response + n, card_uid, card_uid_len);
+            _response_len = (uint8_t)(n + card_uid_len);
+            return true;
+        }
+        case PN532_COMMAND_TGINITASTARGET:
+        case PN532_COMMAND_TGGETDATA:
+        case PN532_COMMAND_TGSETDATA:
+            return prepareTargetResponse();
+        case PN532_COMMAND_INDATAEXCHANGE:
+            if (!claimed.empty()) return prepareExchangeResponse();
+            _response[0] = 0x00;                                     // Status OK
+            _response_len = 1;
+            return true;
+        case PN532_COMMAND_INRELEASE:
+            _response[0] = 0x00;                                     // Status OK
+            _response_len = 1;
+            return true;
+        default:
+            _response_len = 0;
+            return true;
+    }
+}
+
+/**
+ * @brief 模擬卡這一側: 讀卡機選取後 TgInitAsTarget 完成，TgGetData 取得讀卡機的 C-APDU
+ */
+bool PN532_SPI::prepareTargetResponse() {
+    if (_target.empty()) return false;
+    // 讀卡機已換人時視為前一個讀卡機已離開
+    std::string owner = fieldRead(_target, ".claim");
+    bool selected = !owner.empty() && owner == _target_owner;
+    switch (_command) {
+        case PN532_COMMAND_TGINITASTARGET:
+            if (owner.empty()) return false;
+            _target_owner = owner;
+            _response[0] = 0x04;                                     // Mode: 106 kbps, ISO14443-4 PICC
+            _response_len = 1;
+            return true;
+        case PN532_COMMAND_TGGETDATA: {
+            int len = selected ? fieldTake(_target, ".capdu", _response + 1, sizeof(_response) - 1) : -1;
+            if (len < 0 && selected) return false;
+            _response[0] = len < 0 ? 0x29 : 0x00;                    // 0x29 = released by the initiator
+            _response_len = (uint8_t)(1 + (len < 0 ? 0 : len));
+            return true;
+        }
+        default:
+            _response[0] = selected ? 0x00 : 0x29;
+            _response_len = 1;
+            return true;
+    }
+}
+
+/**
+ * @brief 讀卡機這一側: 等待模擬卡以 TgSetData 回覆的 R-APDU
+ */
+bool PN532_SPI::prepareExchangeResponse() {
+    int len = fieldTake(claimed, ".rapdu", _response + 1, sizeof(_response) - 1);
+    if (len >= 0) {
+        _response[0] = 0x00;                                         // Status OK
+        _response_len = (uint8_t)(1 + len);
+        return true;
+    }
+    if (cardPresent() && fieldExists(claimed, ".target") && (long)(_exchange_deadline - millis()) > 0) return false;
+    _response[0] = 0x01;                                             // Timeout
+    _response_len = 1;
+    return true;
+}
+
+void PN532_SPI::stopTarget() {
+    if (_target.empty()) return;
+    fieldRemove(_target, ".target");
+    _target.clear();
+    _target_owner.clear();
+}
+
+bool PN532_SPI::isResponseReady() {
+    std::lock_guard<std::mutex> guard(field_lock);
+    // 回應只準備一次: TgGetData / InDataExchange 會取走感應區中的 APDU
+    if (!_prepared) _prepared = prepareResponse();
+    return _prepared;
+}
+
+int16_t PN532_SPI::readResponse(uint8_t buf[], uint8_t len, uint16_t timeout) {
+    std::unique_lock<std::mutex> guard(field_lock);
+    auto ready = [this] {
+        if (!_prepared) _prepared = prepareResponse();
+        return _prepared;
+    };
+    // 卡片可能在等待期間離開，因此以短間隔重新檢查
+    auto deadline = std::chrono::steady_clock::now() + sim::hostDuration((uint64_t)timeout * 1000);
+    while (!ready()) {
+        if (timeout != 0 && std::chrono::steady_clock::now() >= deadline) return PN532_TIMEOUT;
+        field_cv.wait_for(guard, std::chrono::milliseconds(5));
+    }
+    _command = 0;
+    _prepared = false;
+    if (_response_len > len) return PN532_NO_SPACE;
+    memcpy(buf, _response, _response_len);
+    return _response_len;
+}
+
+void PN532_SPI::abortCommand() {
+    std::lock_guard<std::mutex> guard(field_lock);
+    // 等待讀卡機時被中止 = 離開模擬模式
+    if (_command == PN532_COMMAND_TGINITASTARGET || _command == PN532_COMMAND_TGGETDATA ||
+        _command == PN532_COMMAND_TGSETDATA) {
+        stopTarget();
+    }
+    _command = 0;
+    _prepared = false;
+}
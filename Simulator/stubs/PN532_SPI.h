@@ -0,0 +1,57 @@
+// PN532_SPI.h (host simulation)
+//
+// Replaces lib/PN532_SPI with a PN532 that answers at the command level, so
+// the real PN532, EmulateTag and NfcAdapter code runs on top of it. A card is
+// brought into the field with "@sim tap <uid hex> [hold_ms]"; while it is
+// there, InListPassiveTarget / InAutoPoll complete with its UID.
+//
+// Slaves in emulation mode publish their tag in the directory named by
+// SIM_NFC_FIELD (set by sim_runner). Tapping a slave with the UID of an
+// emulating slave connects the two PN532s: the reader claims the target
+// (one reader at a time), its InDataExchange C-APDUs are handed to the
+// emulator's TgGetData and the TgSetData answers come back, file by file:
+//   <uid>.target  the emulator waits for / serves a reader
+//   <uid>.claim   a reader (its pid) has selected it (TgInitAsTarget completes)
+//   <uid>.capdu   C-APDU, reader -> emulator
+//   <uid>.rapdu   R-APDU, emulator -> reader
+// Without a reader TgInitAsTarget never completes.
+
+#ifndef __PN532_SPI_H__
+#define __PN532_SPI_H__
+
+#include <SPI.h>
+#include <string>
+#include "PN532Interface.h"
+
+class PN532_SPI : public PN532Interface {
+public:
+    PN532_SPI(SPIClass& spi, uint8_t ss);
+
+    void begin();
+    void wakeup();
+    int8_t writeCommand(const uint8_t* header, uint8_t hlen, const uint8_t* body = 0, uint8_t blen = 0);
+    int16_t readResponse(uint8_t buf[], uint8_t len, uint16_t timeout);
+
+    bool isResponseReady();
+    void abortCommand();
+
+private:
+    // 回應已可讀取時填入 _response 並回傳 true (呼叫端需持有鎖)
+    bool prepareResponse();
+    bool prepareTargetResponse();
+    bool prepareExchangeResponse();
+    void stopTarget();
+
+    uint8_t _command;          // 等待回應的指令 (0 = 無)
+    uint8_t _autopoll;         // InAutoPoll 的回應格式
+    uint8_t _response[255];
+    uint8_t _response_len;
+    bool _prepared;            // _response 已填入，等待 readResponse 取走
+
+    // 模擬卡 (EmulateTag) 這一側
+    std::string _target;       // 發布中的 UID (空字串 = 未模擬)
+    std::string _target_owner; // 目前 session 的讀卡機 (空字串 = 尚未被選取或已 InRelease)
+    unsigned long _exchange_deadline;
+};
+
+#endif
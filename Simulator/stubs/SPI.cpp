@@ -0,0 +1,31 @@
+// SPI.cpp (host simulation)
+
+#include "SPI.h"
+#include "sim_hw.h"
+
+SPIClass SPI(VSPI);
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    return sim::spiTransfer(data);
+}
+
+uint16_t SPIClass::transfer16(uint16_t data) {
+    uint16_t high = transfer((uint8_t)(data >> 8));
+    return (uint16_t)(high << 8 | transfer((uint8_t)data));
+}
+
+void SPIClass::transfer(void* buf, uint32_t count) {
+    uint8_t* bytes = static_cast<uint8_t*>(buf);
+    for (uint32_t i = 0; i < count; ++i) bytes[i] = transfer(bytes[i]);
+}
+
+void SPIClass::transferBytes(const uint8_t* out, uint8_t* in, uint32_t size) {
+    for (uint32_t i = 0; i < size; ++i) {
+        uint8_t received = transfer(out ? out[i] : 0xFF);
+        if (in) in[i] = received;
+    }
+}
+
+void SPIClass::writeBytes(const uint8_t* data, uint32_t size) {
+    transferBytes(data, nullptr, size);
+}
@@ -0,0 +1,54 @@
+// SPI.h (host simulation)
+//
+// Bytes are routed to whichever simulated device currently has its CSN pin
+// pulled low (see sim::attachSpiDevice); with nothing selected, MISO reads 0xFF.
+
+#pragma once
+#include "Arduino.h"
+
+#define SPI_HAS_TRANSACTION 1
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+#define FSPI 1
+#define HSPI 2
+#define VSPI 3
+
+class SPISettings {
+public:
+    SPISettings(uint32_t clock = 1000000, uint8_t bit_order = MSBFIRST, uint8_t data_mode = SPI_MODE0)
+        : clock(clock), bit_order(bit_order), data_mode(data_mode) {}
+    uint32_t clock;
+    uint8_t bit_order;
+    uint8_t data_mode;
+};
+
+class SPIClass {
+public:
+    explicit SPIClass(uint8_t bus = VSPI) : _bus(bus) {}
+
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+    void end() {}
+
+    void beginTransaction(SPISettings settings) {}
+    void endTransaction() {}
+
+    void setBitOrder(uint8_t bit_order) {}
+    void setDataMode(uint8_t data_mode) {}
+    void setFrequency(uint32_t freq) {}
+    void setClockDivider(uint32_t divider) {}
+
+    uint8_t transfer(uint8_t data);
+    uint16_t transfer16(uint16_t data);
+    void transfer(void* buf, uint32_t count);
+    void transferBytes(const uint8_t* out, uint8_t* in, uint32_t size);
+    void writeBytes(const uint8_t* data, uint32_t size);
+
+private:
+    uint8_t _bus;
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,204 @@
+// freertos_sim.cpp (host simulation)
+
+#include "freertos_sim.h"
+#include "SimClock.h"
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimTask {
+    std::string name;
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notify_count = 0;
+};
+
+struct SimQueue {
+    SimQueue(UBaseType_t length, UBaseType_t item_size) : length(length), item_size(item_size) {}
+    const UBaseType_t length;
+    const UBaseType_t item_size;
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+namespace {
+
+thread_local SimTask* current_task = nullptr;
+
+// 等待條件成立；ticks 為 portMAX_DELAY 時不逾時
+template <typename Pred>
+bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& guard, TickType_t ticks, Pred pred) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(guard, pred);
+        return true;
+    }
+    return cv.wait_for(guard, sim::hostDuration((uint64_t)ticks * portTICK_PERIOD_MS * 1000), pred);
+}
+
+} // namespace
+
+// ==================================================================
+// --- 工作 ---
+// ==================================================================
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core_id) {
+    SimTask* task = new SimTask();
+    task->name = name ? name : "";
+    // handle 必須在工作開始執行前設定好 (ISR 可能立即通知它)
+    if (handle) *handle = task;
+    std::thread([fn, param, task] {
+        current_task = task;
+        fn(param);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* param,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, param, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // 只支援刪除自己：目前的執行緒永久睡眠 (SimTask 不回收，避免 ISR 使用懸空指標)
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(24));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        for (;;) std::this_thread::sleep_for(std::chrono::hours(24));
+    }
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    sim::sleepSimUs((uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (TickType_t)(sim::simElapsedUs(start) / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (!current_task) current_task = new SimTask();
+    return current_task;
+}
+
+// ==================================================================
+// --- 工作通知 ---
+// ==================================================================
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    SimTask* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(task->lock);
+    waitFor(task->cv, guard, ticks, [task] { return task->notify_count > 0; });
+    uint32_t count = task->notify_count;
+    if (count > 0) task->notify_count = clear_on_exit ? 0 : count - 1;
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notify_count++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken) *higher_priority_task_woken = pdTRUE;
+}
+
+// ==================================================================
+// --- 佇列 ---
+// ==================================================================
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return new SimQueue(length, item_size);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->not_full, guard, ticks, [queue] { return queue->items.size() < queue->length; })) {
+        return pdFALSE;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    queue->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    return xQueueSend(queue, item, ticks);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->not_full, guard, ticks, [queue] { return queue->items.size() < queue->length; })) {
+        return pdFALSE;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_front(bytes, bytes + queue->item_size);
+    queue->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->not_empty, guard, ticks, [queue] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (item && queue->item_size) memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    queue->not_full.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!waitFor(queue->not_empty, guard, ticks, [queue] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (item && queue->item_size) memcpy(item, queue->items.front().data(), queue->item_size);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return (UBaseType_t)queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->items.clear();
+    queue->not_full.notify_all();
+    return pdPASS;
+}
+
+// ==================================================================
+// --- 號誌 ---
+// ==================================================================
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SimQueue* sem = new SimQueue(1, 0);
+    sem->items.emplace_back();   // mutex 建立時為可取得狀態
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new SimQueue(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    return xQueueReceive(sem, nullptr, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return xQueueSend(sem, nullptr, 0);
+}
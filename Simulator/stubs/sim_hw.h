@@ -0,0 +1,42 @@
+// sim_hw.h (host simulation)
+//
+// Hooks that let the simulated peripherals (nRF24 chip model, PN532, buttons)
+// sit behind the ordinary Arduino GPIO/SPI calls made by the firmware.
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+namespace sim {
+
+const uint8_t MAX_PINS = 64;
+
+// 裝置的 ID (環境變數 SIM_DEVICE_ID，主機為 0)
+int deviceId();
+
+// --- GPIO ---
+// 韌體 digitalWrite() 該腳位時呼叫 (例如 nRF24 的 CE)
+void onPinWrite(uint8_t pin, std::function<void(uint8_t level)> listener);
+// 由模擬裝置驅動輸入腳位；電位改變時依 attachInterrupt() 的邊緣觸發 ISR
+void driveInputPin(uint8_t pin, uint8_t level);
+
+// --- SPI ---
+class SpiDevice {
+public:
+    virtual ~SpiDevice() {}
+    virtual void select(bool selected) = 0;   // CSN 下降 (true) / 上升 (false)
+    virtual uint8_t transfer(uint8_t out) = 0;
+};
+// CSN 腳位為 LOW 的裝置接收 SPIClass::transfer() 的位元組
+void attachSpiDevice(uint8_t csn_pin, SpiDevice* device);
+uint8_t spiTransfer(uint8_t out);
+
+// --- 控制指令 ---
+// stdin 中以 "@sim <name> <args>" 開頭的行不會交給 Serial，而是呼叫對應的 handler
+void onCommand(const std::string& name, std::function<void(const std::string& args)> handler);
+// 啟動 stdin 讀取執行緒 (stdin 關閉時行程結束)
+void startStdinReader();
+
+} // namespace sim
@@ -0,0 +1,27 @@
+// sim_main.cpp (host simulation)
+//
+// Process entry point for sim_master / sim_slave: wires the nRF24 chip model
+// to the medium socket inherited from sim_runner (env SIM_RADIO_FD), then runs
+// the firmware's setup() and loop() like the Arduino core does.
+
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+
+#include "SimClock.h"
+#include "SimNrf24.h"
+#include "sim_hw.h"
+
+int main() {
+    setvbuf(stdout, nullptr, _IOFBF, 1 << 16);
+    sim::startStdinReader();
+
+    const char* fd_env = getenv("SIM_RADIO_FD");
+    static sim::SimNrf24 nrf(SIM_NRF_CE_PIN, SIM_NRF_CSN_PIN, SIM_NRF_IRQ_PIN, fd_env ? atoi(fd_env) : -1);
+
+    setup();
+    for (;;) {
+        loop();
+        sim::sleepSimUs(100);
+    }
+}